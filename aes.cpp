@@ -302,199 +302,160 @@ void aes_decrypt_128(const uint8_t* roundkeys, const uint8_t* ciphertext,
   }
 }
 
-std::string DecryptionModelComplete(std::string strFileName) {
-  uint8_t *plain_data = NULL, *cipher_data = NULL;
-  uint8_t *dest_data = NULL;
-
-  FILE *f_pb_in = NULL;
+static const char g_formatData[] = "KEDACOMGUOX";
 
-  char formatData[] = "KEDACOMGUOX";
-  int nFileLen = 0;
-  char tmpData[32]; //解密时存放格式头
-  int nCurSize = 0;
+/* 128 bit key */
+static const uint8_t g_key[16] = {
+     0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+     0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+};
 
-  /* 128 bit key */
-  uint8_t key[16] = {
-       0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
-       0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
-  };
+// 格式头 + 明文长度, 之后是16字节对齐的数据
+static const size_t g_headerSize = sizeof(g_formatData) + sizeof(int);
 
-  uint8_t roundkeys[AES_ROUND_KEY_SIZE];
-
-  f_pb_in = fopen(strFileName.data(), "rb");
-  if (f_pb_in == NULL) {
-    std::cout << "Open file  " << strFileName   << "failed !!!" <<std::endl;
-     return "error";
-  } else {
-    std::cout << "Open pb file: " << strFileName  <<std::endl;
+std::string ReadModelFile(const std::string &strFileName) {
+  FILE *f_in = fopen(strFileName.c_str(), "rb");
+  if (f_in == NULL) {
+    printf("load model file [%s] is failed\n", strFileName.c_str());
+    return "error";
   }
 
-  // key schedule
-  aes_key_schedule_128(key, roundkeys);
-
-  plain_data = (uint8_t *)malloc(16 * sizeof(uint8_t));
-  cipher_data = (uint8_t *)malloc(16 * sizeof(uint8_t));
-
   //确定文件大小
-  fseek(f_pb_in, 0, SEEK_END);
-  int nInFileSize = ftell(f_pb_in);
-  fseek(f_pb_in, 0, SEEK_SET);
+  fseek(f_in, 0, SEEK_END);
+  long nInFileSize = ftell(f_in);
+  fseek(f_in, 0, SEEK_SET);
+
+  std::string strFileContent;
+  if (nInFileSize > 0) {
+    strFileContent.resize(nInFileSize);
+    size_t readBytes = fread(&strFileContent[0], sizeof(uint8_t), nInFileSize, f_in);
+    strFileContent.resize(readBytes);
+  }
 
-  dest_data = (uint8_t *)malloc(nInFileSize * sizeof(uint8_t));
+  fclose(f_in);
+  return strFileContent;
+}
 
-  fread(tmpData, sizeof(formatData), 1, f_pb_in);
-  if (strcmp(tmpData, formatData) == 0) {
-    std::cout << "Input encryption  pb file format is valid"  << std::endl;
-  } else {
-    std::cout << "Open file "  <<  strFileName  << "  is invalid" << std::endl;
-    return "error";
+/**
+ * @purpose:            check format head and read plain length of an encrypted model
+ * @return:             plain length, -1 if the content is not a valid encrypted model
+ */
+static int ParseEncryptionHeader(const std::string &strFileContent) {
+  if (strFileContent.size() < g_headerSize) {
+    printf("Input encryption file is too short\n");
+    return -1;
   }
 
-  fread(&nFileLen, sizeof(nFileLen), 1, f_pb_in);
-  std::cout  << "pb file size is:  " << nFileLen  << std::endl;
-
-  nCurSize = 0;
-  while (fread(cipher_data, sizeof(uint8_t), 16, f_pb_in)) {
-    aes_decrypt_128(roundkeys, cipher_data, plain_data);
+  if (memcmp(strFileContent.data(), g_formatData, sizeof(g_formatData)) != 0) {
+    printf("Input encryption file format is invalid\n");
+    return -1;
+  }
 
-    nCurSize += 16;
+  int nFileLen = 0;
+  memcpy(&nFileLen, strFileContent.data() + sizeof(g_formatData), sizeof(nFileLen));
+  printf("pb file size is %d \n", nFileLen);
 
-    if (nCurSize < nFileLen) {
-      memcpy(dest_data + nCurSize - 16, plain_data, 16);
-    } else {
-      memcpy(dest_data + nCurSize - 16, plain_data, 16 - (nCurSize - nFileLen));
-    }
+  if (nFileLen < 0 || (size_t)nFileLen > strFileContent.size() - g_headerSize) {
+    printf("Input encryption file length %d is invalid\n", nFileLen);
+    return -1;
   }
+  return nFileLen;
+}
 
-  //转换为string
-  char *tmpPchar = (char *)dest_data;
+/**
+ * @purpose:            decrypt blocks [nStartBlock, nStartBlock + nBlocks) of the payload in place
+ */
+static void DecryptBlocks(std::string &strPayload, int nStartBlock, int nBlocks) {
+  uint8_t roundkeys[AES_ROUND_KEY_SIZE];
+  aes_key_schedule_128(g_key, roundkeys);
 
-  std::string strDecFileContent;
+  long nTotalBlocks = (long)(strPayload.size() / AES_BLOCK_SIZE);
+  long nEndBlock = (long)nStartBlock + nBlocks;
+  if (nEndBlock > nTotalBlocks) {
+    nEndBlock = nTotalBlocks;
+  }
 
-  for (int i = 0; i < nFileLen; i++) {
-    strDecFileContent += tmpPchar[i];
+  uint8_t *data = (uint8_t *)&strPayload[0];
+  for (long j = nStartBlock; j < nEndBlock; ++j) {
+    aes_decrypt_128(roundkeys, data + j * AES_BLOCK_SIZE, data + j * AES_BLOCK_SIZE);
   }
+}
 
-  if (cipher_data)
-    free(cipher_data);
-  if (plain_data)
-    free(plain_data);
-  if (dest_data)
-    free(dest_data);
+std::string DecryptionBufferComplete(const std::string &strFileContent) {
+  int nFileLen = ParseEncryptionHeader(strFileContent);
+  if (nFileLen < 0) {
+    return "error";
+  }
 
-  if (f_pb_in)
-    fclose(f_pb_in);
+  std::string strDecFileContent = strFileContent.substr(g_headerSize);
+  DecryptBlocks(strDecFileContent, 0, (int)(strDecFileContent.size() / AES_BLOCK_SIZE));
+  strDecFileContent.resize(nFileLen);
 
   return strDecFileContent;
 }
 
-std::string DecryptionModelPartial(std::string strFileName, int nEncStartPoint, int nEncLength) {
-  uint8_t *plain_data = NULL, *cipher_data = NULL;
-  uint8_t *dest_data = NULL;
-
-  FILE *f_pb_in = fopen(strFileName.c_str(), "rb");
-  if (f_pb_in == NULL) {
-    printf("load encryption file [%s] is failed\n", strFileName.c_str());
+std::string DecryptionBufferPartial(const std::string &strFileContent, int nEncStartPoint, int nEncLength) {
+  int nFileLen = ParseEncryptionHeader(strFileContent);
+  if (nFileLen < 0) {
     return "error";
-  } else {
-    printf("Open encryption input file: %s \n", strFileName.c_str());
   }
 
-  char formatData[] = "KEDACOMGUOX";
-  int nFileLen = 0;
-  char tmpData[32]; //解密时存放格式头
-  int nCurSize = 0;
-  int readBytes = 0;
-
   int encStartPoint = nEncStartPoint / 16;
   int encLength = nEncLength / 16;
 
-  /* 128 bit key */
-  uint8_t key[16] = {
-       0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
-       0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
-  };
-
-  uint8_t roundkeys[AES_ROUND_KEY_SIZE];
-
-  // key schedule
-  aes_key_schedule_128(key, roundkeys);
-
-  plain_data = (uint8_t *)malloc(16 * sizeof(uint8_t));
-  cipher_data = (uint8_t *)malloc(16 * sizeof(uint8_t));
+  //开始未加密部分原样保留, 只解密中间的加密块
+  std::string strDecFileContent = strFileContent.substr(g_headerSize);
+  DecryptBlocks(strDecFileContent, encStartPoint, encLength);
+  strDecFileContent.resize(nFileLen);
 
-  //确定文件大小
-  fseek(f_pb_in, 0, SEEK_END);
-  int nInFileSize = ftell(f_pb_in);
-  fseek(f_pb_in, 0, SEEK_SET);
+  return strDecFileContent;
+}
 
-  dest_data = (uint8_t *)malloc(nInFileSize * sizeof(uint8_t));
+std::string EncryptionBufferPartial(const std::string &strPlainContent, int nEncStartPoint, int nEncLength) {
+  uint8_t roundkeys[AES_ROUND_KEY_SIZE];
+  aes_key_schedule_128(g_key, roundkeys);
 
-  fread(tmpData, sizeof(formatData), 1, f_pb_in);
-  if (strcmp(tmpData, formatData) == 0) {
-    printf("Input file format is valid\n");
-  }
+  int nFileLen = (int)strPlainContent.size();
+  size_t nPaddedSize = (strPlainContent.size() + AES_BLOCK_SIZE - 1) / AES_BLOCK_SIZE * AES_BLOCK_SIZE;
 
-  fread(&nFileLen, sizeof(nFileLen), 1, f_pb_in);
-  printf("pb file size is %d \n", nFileLen);
+  std::string strEncFileContent(g_headerSize + nPaddedSize, '\0');
+  memcpy(&strEncFileContent[0], g_formatData, sizeof(g_formatData));
+  memcpy(&strEncFileContent[sizeof(g_formatData)], &nFileLen, sizeof(nFileLen));
+  memcpy(&strEncFileContent[g_headerSize], strPlainContent.data(), strPlainContent.size());
 
-  //写出开始未加密部分
-  nCurSize = 0;
-  memset(plain_data, 0, 16 * sizeof(uint8_t));
-  for (int i = 0; i < encStartPoint; ++i) {
-    readBytes = fread(plain_data, sizeof(uint8_t), 16, f_pb_in);
-    memcpy(dest_data + nCurSize, plain_data, 16);
-    nCurSize += 16;
-    // fwrite(plain_data, sizeof(uint8_t), 16, f_pb_out);
+  long nTotalBlocks = (long)(nPaddedSize / AES_BLOCK_SIZE);
+  long nStartBlock = nEncStartPoint / 16;
+  long nEndBlock = nStartBlock + nEncLength / 16;
+  if (nEndBlock > nTotalBlocks) {
+    nEndBlock = nTotalBlocks;
   }
 
-  //解密文件
-  for (int j = 0; j < encLength; ++j) {
-    readBytes = fread(cipher_data, sizeof(uint8_t), 16, f_pb_in);
-
-    aes_decrypt_128(roundkeys, cipher_data, plain_data);
-
-    nCurSize += 16;
-
-    if (nCurSize < nFileLen) {
-      // fwrite(plain_data, sizeof(uint8_t), 16, f_pb_out);
-      memcpy(dest_data + nCurSize - 16, plain_data, 16);
-    } else {
-      // fwrite(plain_data, sizeof(uint8_t), 16 - (nCurSize - nFileLen),
-      // f_pb_out);
-      memcpy(dest_data + nCurSize - 16, plain_data, 16 - (nCurSize - nFileLen));
-    }
-
-    if (readBytes <= 0) {
-      break;
-    }
+  uint8_t *data = (uint8_t *)&strEncFileContent[g_headerSize];
+  for (long j = nStartBlock; j < nEndBlock; ++j) {
+    aes_encrypt_128(roundkeys, data + j * AES_BLOCK_SIZE, data + j * AES_BLOCK_SIZE);
   }
 
-  while (!feof(f_pb_in) && !ferror(f_pb_in)) {
-    readBytes = fread(plain_data, sizeof(uint8_t), 16, f_pb_in);
+  return strEncFileContent;
+}
 
-    memcpy(dest_data + nCurSize, plain_data, 16);
-    nCurSize += 16;
+std::string DecryptionModelComplete(std::string strFileName) {
+  std::string strFileContent = ReadModelFile(strFileName);
+  if (strFileContent == "error") {
+    return strFileContent;
   }
+  std::cout << "Open pb file: " << strFileName << std::endl;
 
-  char *tmpPchar = (char *)dest_data;
-
-  // fwrite(tmpPchar, sizeof(uint8_t), nFileLen, f_pb_out);
-  std::string strDecFileContent;
+  return DecryptionBufferComplete(strFileContent);
+}
 
-  for (int i = 0; i < nFileLen; i++) {
-    strDecFileContent += tmpPchar[i];
+std::string DecryptionModelPartial(std::string strFileName, int nEncStartPoint, int nEncLength) {
+  std::string strFileContent = ReadModelFile(strFileName);
+  if (strFileContent == "error") {
+    return strFileContent;
   }
+  printf("Open encryption input file: %s \n", strFileName.c_str());
 
-  // fwrite(strDecFileContent->data(), sizeof(uint8_t), nFileLen, f_pb_out);
-
-  if (cipher_data)
-    free(cipher_data);
-  if (plain_data)
-    free(plain_data);
-  if (dest_data)
-    free(dest_data);
-  return strDecFileContent;
+  return DecryptionBufferPartial(strFileContent, nEncStartPoint, nEncLength);
 }
 
 }  // namespace cida_core
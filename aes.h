@@ -51,6 +51,26 @@ void aes_decrypt_128(const uint8_t *roundkeys, const uint8_t *ciphertext, uint8_
 std::string DecryptionModelComplete(std::string strFileName);
 std::string DecryptionModelPartial(std::string strFileName, int nEncStartPoint, int nEncLength);
 
+/**
+ * @purpose:            Read the whole model file into memory. Returns "error" if the file can't be opened.
+ *                      Split out of the decryption functions so that file IO and decryption can be timed apart.
+ */
+std::string ReadModelFile(const std::string &strFileName);
+
+/**
+ * @purpose:            Same as DecryptionModelComplete/DecryptionModelPartial, but work on the file content
+ *                      already read by ReadModelFile.
+ */
+std::string DecryptionBufferComplete(const std::string &strFileContent);
+std::string DecryptionBufferPartial(const std::string &strFileContent, int nEncStartPoint, int nEncLength);
+
+/**
+ * @purpose:            Inverse of DecryptionBufferPartial, writes the "KEDACOMGUOX" header, the plain length
+ *                      and the payload with blocks [nEncStartPoint/16, (nEncStartPoint+nEncLength)/16) encrypted.
+ *                      Used to generate synthetic encrypted models for load benchmarks.
+ */
+std::string EncryptionBufferPartial(const std::string &strPlainContent, int nEncStartPoint, int nEncLength);
+
 } //end namespace cida_core
 
 #endif
@@ -60,6 +60,11 @@ extern "C"
         MY_MEMORY_MALLOC_FAILED, //内存分配失败
         MY_MODEL_LOAD_FAILED,    //模型加载失败
         MY_TENSOR_ALLOC_FAILED,  //tensor内存分配失败
+        MY_MODEL_NOT_FOUND,      //注册表中没有该模型或版本
+        MY_OVERLOADED,           //请求队列已满, 稍后重试
+        MY_DEADLINE_EXCEEDED,    //请求超过截止时间, 已丢弃或中止
+        MY_CANCELLED,            //请求已被取消
+        MY_STREAM_NOT_FOUND,     //流不存在, 已关闭或因空闲被回收
     } result_t;
 
     typedef enum
@@ -98,6 +103,203 @@ extern "C"
         signed long long max_cached_engines;       //控制可以缓存的engine数量
     } tf_trt_custom_config_t;
 
+    typedef enum
+    {
+        CPU_ARENA_DEFAULT = 0, //使用onnxruntime默认的CPU arena, 只增长不收缩
+        CPU_ARENA_DISABLED,    //关闭arena, 每次Run结束后内存直接归还系统
+    } cpu_arena_mode_t;
+
+    //CPU内存相关参数
+    typedef struct
+    {
+        cpu_arena_mode_t arena_mode;
+        MY_BOOL bDisableMemPattern;   //关闭按首次Run的shape预分配内存, 动态shape时可减少内存占用
+        MY_BOOL bShareEnvThreadPools; //使用env级别共享的线程池, 不再为每个session创建线程池
+    } memory_params_t;
+
+    //把模型的符号维度(如 batch、seq_len)固定成具体值
+    typedef struct
+    {
+        char aDimName[64];      //符号维度名; bByDenotation 时为维度的 denotation, 如 DATA_BATCH
+        MY_BOOL bByDenotation;  //按 denotation 而不是按名字匹配
+        long long nDimValue;    //固定的值
+    } free_dim_override_t;
+
+    //同一个模型按某个符号维度的不同取值加载多个特化session, 推理时按输入shape选择
+    typedef struct
+    {
+        char aDimName[64]; //用于特化的符号维度名
+        int nValues;       //特化session个数, 0 表示不加载
+        int aValues[8];    //每个特化session中该维度的值
+    } model_variants_t;
+
+    //变长输入按长度分桶补齐, 输出再截回真实长度
+    typedef struct
+    {
+        int nBuckets;              //桶个数, 0 表示不分桶
+        int aBuckets[16];          //从小到大的长度桶, 如 32/64/128/256
+        int nSeqDimIndex;          //序列长度所在的维度, 输入和输出相同, 如 [batch, seq_len] 中为1
+        float fPadValue;           //补齐的值, 按输入类型转换
+        char aMaskInputName[256];  //attention mask 输入名, 补齐时生成对应的mask; 为空表示没有mask
+    } bucket_params_t;
+
+    //图像像素格式, 数据类型都是 uint8, HWC
+    typedef enum
+    {
+        PIXEL_FORMAT_BGR = 0,
+        PIXEL_FORMAT_RGB,
+        PIXEL_FORMAT_GRAY,
+    } pixel_format_t;
+
+    //图像预处理参数: resize -> (x - mean) / std -> HWC 转 NCHW, 结果直接写入 DT_FLOAT 输入tensor
+    typedef struct
+    {
+        MY_BOOL bEnable;            //是否启用
+        int nInputIndex;            //写入哪个输入tensor, shape 为 [N, C, H, W]
+        pixel_format_t dst_format;  //模型需要的通道顺序, C 为 3 时 BGR/RGB, C 为 1 时 GRAY
+        float aMean[3];             //均值, 按 dst_format 的通道顺序, 像素值范围 0~255
+        float aStd[3];              //标准差, 0 视为 1
+        int nInterpolation;         //resize 插值方式, 同 cv::InterpolationFlags, 0: 最近邻 1: 双线性
+        MY_BOOL bLetterbox;         //保持宽高比缩放, 居中放置, 其余部分填充 fPadValue
+        float fPadValue;            //letterbox 填充的像素值, 如 114
+    } image_preprocess_params_t;
+
+    //预处理时源图像到输入tensor的坐标变换: x_tensor = x_src * fScaleX + fPadX
+    typedef struct
+    {
+        float fScaleX;
+        float fScaleY;
+        float fPadX;
+        float fPadY;
+        int nSrcWidth;
+        int nSrcHeight;
+    } letterbox_info_t;
+
+    //一张 uint8 HWC 图像
+    typedef struct
+    {
+        const my_u8 *pData;
+        int nWidth;
+        int nHeight;
+        int nStride; //行字节数
+        pixel_format_t format;
+    } image_t;
+
+    //一个检测结果, 坐标为源图像坐标
+    typedef struct
+    {
+        float x1;
+        float y1;
+        float x2;
+        float y2;
+        float score;
+        int nClass;
+    } detection_t;
+
+    //输出后处理类型
+    typedef enum
+    {
+        POSTPROCESS_NONE = 0,
+        POSTPROCESS_SOFTMAX, //最后一维做softmax, shape不变
+        POSTPROCESS_ARGMAX,  //最后一维取最大值, 输出 [..., 1, 2], 每项为 (index, score)
+        POSTPROCESS_TOPK,    //最后一维取前 nTopK 个, 输出 [..., nTopK, 2], 按 score 从大到小
+        POSTPROCESS_NMS,     //检测框解码 + NMS, 输出 [batch, nMaxDetections, 6]
+    } postprocess_type_t;
+
+    //检测输出 [batch, N, C] 中每个框的排布
+    typedef enum
+    {
+        BOX_LAYOUT_XYXY_SCORE_CLASS = 0, //C = 6: x1, y1, x2, y2, score, class
+        BOX_LAYOUT_CXCYWH_OBJ_CLS,       //C = 5 + 类别数: cx, cy, w, h, objectness, 各类别分数 (YOLOv5)
+    } box_layout_t;
+
+    //按输出名配置的后处理, 结果为 DT_FLOAT, 直接写入该输出的 tensor_t, 并改写其 shape
+    typedef struct
+    {
+        char aTensorName[256];     //输出名
+        postprocess_type_t type;
+        MY_BOOL bSoftmax;          //ARGMAX/TOPK 的 score 是否为softmax概率, 否则为原始值
+        int nTopK;                 //TOPK 的 k
+        box_layout_t box_layout;   //NMS 输入的排布
+        float fScoreThreshold;     //NMS 前丢弃 score 低于该值的框
+        float fIouThreshold;       //IoU 大于该值的同类框被抑制
+        int nMaxDetections;        //每张图最多保留的框数, 不足时补 class 为 -1, score 为 0 的行
+        MY_BOOL bClassAgnostic;    //不区分类别做NMS
+    } postprocess_params_t;
+
+    typedef enum
+    {
+        DT_INVALID = 0,
+        DT_FLOAT = 1,
+        DT_DOUBLE = 2,
+        DT_INT32 = 3,
+        DT_UINT8 = 4,
+        DT_INT16 = 5,
+        DT_INT8 = 6,
+        DT_STRING = 7,
+        DT_INT64 = 9,
+        DT_BOOL = 10,
+        DT_BFLOAT16 = 14,
+        DT_HALF = 19,
+    } tensor_types_t;
+
+    //float 输出在拷贝时转换成更小的类型, 输出 tensor 的 type 需要与 type 一致
+    typedef struct
+    {
+        char aTensorName[256]; //输出名
+        tensor_types_t type;   //DT_HALF / DT_BFLOAT16 / DT_INT8
+        float fScale;          //DT_INT8 的量化步长, q = round(x / fScale), 饱和到 [-128, 127]
+    } output_convert_params_t;
+
+    //单个模型句柄的准入控制: 超出并发和排队上限的请求立即返回 MY_OVERLOADED, 而不是在句柄锁上无限等待
+    typedef struct
+    {
+        int nMaxConcurrency;   //同时执行的请求上限, 0 表示不做准入控制
+        int nQueueDepth;       //等待执行的请求上限, 0 表示不排队, 超出并发上限直接拒绝
+        MY_BOOL bAdaptive;     //按观察到的延迟自适应调整并发上限(AIMD), 范围 1 ~ nMaxConcurrency
+        int nTargetLatencyMs;  //自适应的目标延迟, <=0 时取近期最小延迟的2倍
+    } admission_params_t;
+
+    //准入控制的统计
+    typedef struct
+    {
+        long long nAdmitted;  //已放行的请求
+        long long nRejected;  //以 MY_OVERLOADED 拒绝的请求
+        int nLimit;           //当前的并发上限
+        int nRunning;         //正在执行的请求
+        int nQueued;          //等待执行的请求
+        double dAvgLatencyMs; //执行延迟的滑动平均, 含等待句柄锁的时间
+    } admission_stats_t;
+
+    //推理结果缓存: 输入内容相同的请求直接拷贝缓存的输出, 不再执行模型
+    typedef struct
+    {
+        long nCapacityKB; //缓存输出的字节上限(KB), 0 表示不缓存
+        int nTtlMs;       //缓存的有效期(ms), <=0 表示不过期
+        int nShards;      //分片数, 每片一把锁和独立的LRU, <=0 时为16
+    } result_cache_params_t;
+
+    //推理结果缓存的统计
+    typedef struct
+    {
+        long long nHits;
+        long long nMisses;
+        long long nEvictions; //因容量淘汰的条目
+        long long nExpired;   //因过期删除的条目
+        long nEntries;
+        long nBytes;
+    } result_cache_stats_t;
+
+    //加载模型后的warm-up参数
+    typedef struct
+    {
+        int nIterations;      //warm-up 次数, 0 表示不做 warm-up
+        int nDynamicDimValue; //模型中的动态维度(<0)替换成该值, <=0 时替换成1
+        int nInputs;          //指定了shape的输入个数, 0 表示使用模型自身的shape
+        int nDims[8];         //每个输入的rank, 顺序与模型输入一致
+        int pShape[8][8];     //每个输入的shape, 其中 <=0 的维度同样用 nDynamicDimValue 替换
+    } warmup_params_t;
+
     typedef struct
     {
         int cpu_or_gpu;           //模型加载再cpu：０；　　gpu: 1
@@ -120,26 +322,155 @@ extern "C"
         //TF-TRT参数
         tf_trt_optimize_level_t model_optimize_level;
         tf_trt_custom_config_t tf_trt_config_st;
+
+        MY_BOOL bProfileLoad; //是否记录加载各阶段的耗时和内存
+        warmup_params_t warmup_params;
+        memory_params_t memory_params;
+
+        int nFreeDimOverrides;                   //aFreeDimOverrides 的个数
+        free_dim_override_t aFreeDimOverrides[8]; //所有session共用的维度固定值
+        model_variants_t variants;
+        bucket_params_t bucket_params;
+        image_preprocess_params_t preprocess_params;
+
+        int nPostprocess;                    //aPostprocess 的个数
+        postprocess_params_t aPostprocess[8]; //输出后处理, 未配置的输出按原样拷贝
+
+        int nOutputConverts;                       //aOutputConverts 的个数
+        output_convert_params_t aOutputConverts[8]; //输出类型转换, 与后处理不能同时用于同一个输出
+
+        MY_BOOL bQuantizedModel; //int8 QDQ 模型, CPU 上使用 ORT_ENABLE_ALL 融合成 QLinear 算子; 未设置时按模型元数据识别
+        admission_params_t admission_params;
+        int nIntraOpThreads; //每个session的计算线程数, <=0 时为1; 使用env共享线程池时无效
+        MY_BOOL bCoalesceRequests; //输入逐字节相同的并发请求只执行一次, 结果拷贝给所有请求; 带请求选项(超时/取消)的请求不合并
+        result_cache_params_t cache_params;
     } model_params_t;
 
+    // 模型加载的各个阶段
+    typedef enum
+    {
+        LOAD_PHASE_FILE_READ = 0,  //读取模型文件
+        LOAD_PHASE_DECRYPT,        //解密模型
+        LOAD_PHASE_CREATE_SESSION, //CreateSession / CreateSessionFromArray
+        LOAD_PHASE_MODEL_INFO,     //GetModelInfo
+        LOAD_PHASE_FIRST_RUN,      //第一次Run(warm-up)
+        LOAD_PHASE_NUM,
+    } load_phase_t;
+
+    //模型加载耗时和内存统计
+    typedef struct
+    {
+        double aPhaseMs[LOAD_PHASE_NUM];      //各阶段耗时(ms)
+        long aPhaseRssKB[LOAD_PHASE_NUM];     //阶段结束时的常驻内存(KB)
+        long aPhasePeakRssKB[LOAD_PHASE_NUM]; //阶段内的峰值内存(KB)
+        long long nModelFileBytes;            //模型文件大小
+        double dTotalMs;                      //各阶段耗时之和
+    } load_profile_t;
+
     typedef struct
     {
         void *model_handle; //模型句柄
     } model_handle_t;
 
-    typedef enum
+    typedef struct
     {
-        DT_INVALID = 0,
-        DT_FLOAT = 1,
-        DT_DOUBLE = 2,
-        DT_INT32 = 3,
-        DT_UINT8 = 4,
-        DT_INT16 = 5,
-        DT_INT8 = 6,
-        DT_STRING = 7,
-        DT_INT64 = 9,
-        DT_BOOL = 10,
-    } tensor_types_t;
+        void *pipeline_handle; //预处理+推理流水线句柄
+    } pipeline_handle_t;
+
+    typedef struct
+    {
+        void *registry_handle; //多模型注册表句柄
+    } registry_handle_t;
+
+    typedef struct
+    {
+        void *sharded_handle; //按核分片的模型句柄
+    } sharded_handle_t;
+
+    //按核分片执行: 每个分片一个session, 独占同一NUMA节点上的一组核
+    typedef struct
+    {
+        int nCoresPerShard; //每个分片的核数, 也是该分片session的计算线程数, <=0 时为1
+        int nMaxShards;     //分片个数上限, <=0 时按可用核数尽量多
+        int nQueueDepth;    //每个分片的队列长度, 取整为2的幂, <=0 时为默认值
+    } shard_params_t;
+
+    typedef struct
+    {
+        void *graph_handle; //多模型串联/并联的图句柄
+    } graph_handle_t;
+
+    //图中模型之间的裁剪缩放节点, 输入 "image" 为 float NCHW 的 [1,C,H,W], "boxes" 为 [...,K] (K>=4),
+    //每行前4列为 x1,y1,x2,y2; 输出 "crops" 为 [M,C,nOutHeight,nOutWidth], 双线性插值
+    typedef struct
+    {
+        int nOutWidth;       //输出宽
+        int nOutHeight;      //输出高
+        int nMaxBoxes;       //最多裁剪的框数, <=0 时不限制
+        int nScoreIndex;     //每行中分数所在列, <0 时不按分数过滤
+        float fMinScore;     //分数低于此值的框跳过
+        MY_BOOL bNormalized; //坐标为 0~1 的比例, 否则为像素
+    } crop_resize_params_t;
+
+    typedef struct
+    {
+        void *cascade_handle; //小模型+大模型的级联句柄
+    } cascade_handle_t;
+
+    //级联执行: 先执行小模型, 置信度足够时直接返回, 否则交给大模型; 两个模型的输出名和 shape 相同
+    typedef struct
+    {
+        char aScoreOutput[64]; //小模型中用于判断的 float 输出, [N,K] 每行一个样本, 所有行都满足才直接返回
+        float fThreshold;      //每行最大的 softmax 概率不低于此值时算作满足
+        MY_BOOL bApplySoftmax; //输出为 logits 时为1, 已是概率时为0
+        int nMaxBatch;         //升级到大模型的请求按第0维合并, 合并的最大行数, <=1 或大模型第0维固定时不合并
+        int nBatchWaitMs;      //凑 batch 最多等待的时间(ms)
+    } cascade_params_t;
+
+    typedef struct
+    {
+        long long nRequests;   //请求数
+        long long nEarlyExits; //小模型直接返回的请求数
+        long long nEscalated;  //交给大模型的请求数
+        long long nLargeRuns;  //大模型的执行次数, 合并后少于 nEscalated
+    } cascade_stats_t;
+
+    typedef struct
+    {
+        void *stream_handle; //有状态的流式模型句柄, 管理多个流
+    } stream_handle_t;
+
+    //流式模型的一对状态: 每次调用的输出 aOutputName 留在流中, 作为下一次调用的输入 aInputName
+    typedef struct
+    {
+        char aInputName[64];  //状态输入名
+        char aOutputName[64]; //状态输出名
+        int nDims;            //初始状态(全0)的维数, 0 ~ 8, 为0时按模型声明的 shape, 符号维度为1
+        int pShape[8];        //初始状态的 shape, 每一维 >= 0
+    } stream_state_t;
+
+    typedef struct
+    {
+        stream_state_t aStates[8]; //状态
+        int nStates;               //状态个数
+        int nIdleTimeoutMs;        //超过此时间没有调用的流被回收, <=0 时不回收
+        int nMaxStreams;           //同时打开的流个数上限, <=0 时不限制
+    } stream_params_t;
+
+    //注册表中一个模型版本的信息
+    typedef struct
+    {
+        char aName[128];           //模型名
+        int nVersion;              //版本号
+        int nInputs;               //输入个数
+        int nOutputs;              //输出个数
+        long nMemoryKB;            //加载前后常驻内存的差值(KB), 为近似值; 第一个加载的模型包含 env 和线程池
+        long long nModelFileBytes; //模型文件大小
+        double dLoadMs;            //加载耗时(ms)
+        int nGeneration;           //热更新次数, 首次加载为0
+        MY_BOOL bPinned;           //常驻, 不会因内存预算被淘汰
+        double dLastUsedMs;        //最近一次推理的时间(GetTimeMs)
+    } registry_model_info_t;
 
     //Tensor参数的数据结构
     typedef struct
@@ -173,6 +504,29 @@ extern "C"
         char pcSignatureDef[256]; //函数签名
     } tensor_array_t;
 
+    //异步推理的优先级, 排队时高优先级总是先执行
+    typedef enum
+    {
+        PRIORITY_INTERACTIVE = 0, //在线请求
+        PRIORITY_BATCH,           //离线/回填请求, 不占满所有执行线程
+        PRIORITY_COUNT,
+    } request_priority_t;
+
+    //单次推理请求的选项
+    typedef struct
+    {
+        int nTimeoutMs;              //从提交开始计算的超时(ms), <=0 不限制; 排队和执行都计入
+        request_priority_t priority; //优先级
+        char aTenant[64];            //公平调度的租户, 为空时按模型句柄; 同一优先级内各租户按权重分享执行线程
+    } request_options_t;
+
+    //异步推理完成后的回调, 在执行线程中调用, 不应长时间阻塞
+    typedef void (*inference_callback_t)(result_t res, tensor_array_t *output_tensors, void *user_data);
+
+    //流水线一个batch推理完成后的回调, output_tensors 只在回调内有效
+    typedef void (*pipeline_callback_t)(const long long *pFrameIds, int nFrames, result_t res,
+                                        tensor_array_t *output_tensors, void *user_data);
+
 #ifdef __cplusplus
 }
 #endif
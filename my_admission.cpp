@@ -0,0 +1,152 @@
+#include "my_admission.h"
+
+#include <algorithm>
+#include <cstring>
+#include "my_utils.h"
+
+#define ADMISSION_LATENCY_WINDOW 256   // 每多少个样本更新一次最小延迟
+#define ADMISSION_DECREASE_FACTOR 0.8  // 延迟超标时的乘性减小
+#define ADMISSION_EWMA_ALPHA 0.1
+
+/**
+ * @brief start at the max concurrency, the adaptive limit moves down from there
+ *
+ * @param pParams  准入控制参数
+ */
+AdmissionController::AdmissionController(const admission_params_t *pParams)
+{
+    memcpy(&m_tParams, pParams, sizeof(admission_params_t));
+    m_tParams.nMaxConcurrency = m_tParams.nMaxConcurrency > 0 ? m_tParams.nMaxConcurrency : 1;
+    m_tParams.nQueueDepth = m_tParams.nQueueDepth > 0 ? m_tParams.nQueueDepth : 0;
+
+    m_dLimit = m_tParams.nMaxConcurrency;
+    m_nRunning = 0;
+    m_nQueued = 0;
+    m_nNextTicket = 0;
+    m_nServingTicket = 0;
+    m_nAdmitted = 0;
+    m_nRejected = 0;
+
+    m_dAvgLatencyMs = 0;
+    m_dMinLatencyMs = 0;
+    m_dWindowMinLatencyMs = 0;
+    m_nWindowSamples = 0;
+    m_dLastDecreaseMs = 0;
+}
+
+int AdmissionController::CurrentLimit() const
+{
+    int nLimit = (int)m_dLimit;
+    return nLimit > 0 ? nLimit : 1;
+}
+
+/**
+ * @brief take an execution slot, waiting in arrival order if the queue has room
+ *
+ * @return result_t  MY_OVERLOADED if both the slots and the queue are full
+ */
+result_t AdmissionController::Acquire()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_nQueued == 0 && m_nRunning < CurrentLimit())
+    {
+        m_nRunning++;
+        m_nAdmitted++;
+        return MY_SUCCESS;
+    }
+    if (m_nQueued >= m_tParams.nQueueDepth)
+    {
+        m_nRejected++;
+        return MY_OVERLOADED;
+    }
+
+    unsigned long long nTicket = m_nNextTicket++;
+    m_nQueued++;
+    m_cvSlot.wait(lock, [this, nTicket]() { return nTicket == m_nServingTicket && m_nRunning < CurrentLimit(); });
+    m_nServingTicket++;
+    m_nQueued--;
+    m_nRunning++;
+    m_nAdmitted++;
+    lock.unlock();
+
+    // 下一个票号可能也有空位
+    m_cvSlot.notify_all();
+    return MY_SUCCESS;
+}
+
+/**
+ * @brief give the slot back and feed the latency to the adaptive limit
+ *
+ * @param dLatencyMs  从拿到执行位置到完成的时间
+ * @param bSuccess  失败的请求不计入延迟
+ */
+void AdmissionController::Release(double dLatencyMs, bool bSuccess)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        int nRunning = m_nRunning;
+        m_nRunning--;
+        if (bSuccess)
+        {
+            UpdateLimit(dLatencyMs, nRunning);
+        }
+    }
+    m_cvSlot.notify_all();
+}
+
+void AdmissionController::UpdateLimit(double dLatencyMs, int nRunning)
+{
+    m_dAvgLatencyMs = m_dAvgLatencyMs > 0 ? m_dAvgLatencyMs + ADMISSION_EWMA_ALPHA * (dLatencyMs - m_dAvgLatencyMs)
+                                          : dLatencyMs;
+
+    if (m_nWindowSamples == 0 || dLatencyMs < m_dWindowMinLatencyMs)
+    {
+        m_dWindowMinLatencyMs = dLatencyMs;
+    }
+    if (m_dMinLatencyMs <= 0 || dLatencyMs < m_dMinLatencyMs)
+    {
+        m_dMinLatencyMs = dLatencyMs;
+    }
+    if (++m_nWindowSamples >= ADMISSION_LATENCY_WINDOW)
+    {
+        // 模型或负载变化后基准跟着变化
+        m_dMinLatencyMs = m_dWindowMinLatencyMs;
+        m_nWindowSamples = 0;
+    }
+
+    if (!m_tParams.bAdaptive)
+    {
+        return;
+    }
+
+    double dTargetMs = m_tParams.nTargetLatencyMs > 0 ? m_tParams.nTargetLatencyMs : 2 * m_dMinLatencyMs;
+    double dNowMs = GetTimeMs();
+    if (dLatencyMs > dTargetMs)
+    {
+        if (dNowMs - m_dLastDecreaseMs >= m_dAvgLatencyMs)
+        {
+            m_dLimit = std::max(1.0, m_dLimit * ADMISSION_DECREASE_FACTOR);
+            m_dLastDecreaseMs = dNowMs;
+        }
+    }
+    else if (nRunning >= CurrentLimit())
+    {
+        m_dLimit = std::min((double)m_tParams.nMaxConcurrency, m_dLimit + 1.0 / m_dLimit);
+    }
+}
+
+/**
+ * @brief counters and the current limit
+ *
+ * @param pStats  统计
+ */
+void AdmissionController::GetStats(admission_stats_t *pStats)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    pStats->nAdmitted = m_nAdmitted;
+    pStats->nRejected = m_nRejected;
+    pStats->nLimit = CurrentLimit();
+    pStats->nRunning = m_nRunning;
+    pStats->nQueued = m_nQueued;
+    pStats->dAvgLatencyMs = m_dAvgLatencyMs;
+}
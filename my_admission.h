@@ -0,0 +1,40 @@
+#ifndef MY_INFERENCE_ONNX_MY_ADMISSION_H
+#define MY_INFERENCE_ONNX_MY_ADMISSION_H
+#include <condition_variable>
+#include <mutex>
+#include "common.h"
+
+// 一个模型句柄前的准入控制: 并发上限内直接执行, 其后 nQueueDepth 个按到达顺序等待, 再多的立即拒绝
+// 自适应时延迟超过目标就乘性减小上限, 上限用满且延迟达标时加性增大
+class AdmissionController
+{
+public:
+    explicit AdmissionController(const admission_params_t *pParams);
+    result_t Acquire();
+    void Release(double dLatencyMs, bool bSuccess);
+    void GetStats(admission_stats_t *pStats);
+
+private:
+    int CurrentLimit() const;
+    void UpdateLimit(double dLatencyMs, int nRunning);
+
+private:
+    admission_params_t m_tParams;
+    std::mutex m_mutex;
+    std::condition_variable m_cvSlot;
+    double m_dLimit;               // 自适应时为小数, 取整后使用
+    int m_nRunning;
+    int m_nQueued;
+    unsigned long long m_nNextTicket;    // 排队按票号先来先服务
+    unsigned long long m_nServingTicket;
+    long long m_nAdmitted;
+    long long m_nRejected;
+
+    double m_dAvgLatencyMs;
+    double m_dMinLatencyMs;        // 上一个窗口的最小延迟, 作为无排队时的基准
+    double m_dWindowMinLatencyMs;
+    int m_nWindowSamples;
+    double m_dLastDecreaseMs;      // 一个延迟周期内只减小一次
+};
+
+#endif //MY_INFERENCE_ONNX_MY_ADMISSION_H
@@ -0,0 +1,415 @@
+#include "my_async.h"
+
+#include <iostream>
+#include <cstdio>
+#include <algorithm>
+#include "my_utils.h"
+#include "my_onnx_inference.h"
+#include "my_request.h"
+
+#define DEFAULT_EXECUTOR_QUEUE_DEPTH 1024
+#define DEFAULT_REQUEST_COST_MS 1.0 // 模型还没有执行过时的代价估计
+#define REQUEST_COST_EWMA_ALPHA 0.2
+
+static InferenceExecutor *g_pExecutor = nullptr; // 进程退出时不析构, 避免在静态析构阶段等待推理线程
+static std::mutex g_executor_mutex;
+static int g_nExecutorThreads = 0;
+static int g_nExecutorQueueDepth = DEFAULT_EXECUTOR_QUEUE_DEPTH;
+static std::map<std::string, int> g_mapTenantWeights; // 执行器创建前设置的调度参数, 创建时应用
+static int g_nMaxBatchWorkers = 0;                     // 0 表示默认值
+
+/**
+ * @brief start nThreads workers
+ *
+ * @param nThreads  执行线程数, <=0 时为CPU核数
+ * @param nQueueDepth  每个优先级排队请求的上限, 不含正在执行的请求
+ */
+InferenceExecutor::InferenceExecutor(int nThreads, int nQueueDepth)
+{
+    if (nThreads <= 0)
+    {
+        nThreads = (int)std::thread::hardware_concurrency();
+        nThreads = nThreads > 0 ? nThreads : 1;
+    }
+    m_nQueueDepth = nQueueDepth > 0 ? nQueueDepth : DEFAULT_EXECUTOR_QUEUE_DEPTH;
+    m_nMaxBatchWorkers = nThreads > 1 ? nThreads - 1 : 1; // 至少留一个线程给在线请求
+    m_nBatchRunning = 0;
+    m_bStop = false;
+
+    for (int i = 0; i < nThreads; i++)
+    {
+        m_vecWorkers.push_back(std::thread(&InferenceExecutor::WorkerLoop, this));
+    }
+}
+
+/**
+ * @brief finish the queued requests and stop the workers
+ */
+InferenceExecutor::~InferenceExecutor()
+{
+    m_mutex.lock();
+    m_bStop = true;
+    m_mutex.unlock();
+    m_cvRequest.notify_all();
+
+    for (size_t i = 0; i < m_vecWorkers.size(); i++)
+    {
+        m_vecWorkers[i].join();
+    }
+}
+
+/**
+ * @brief queue a request without blocking, its place among the other tenants of the same priority is set here
+ *
+ * @param request  推理请求
+ * @return result_t  MY_OVERLOADED if the queue of its priority is full, the callback is not called then
+ */
+result_t InferenceExecutor::Submit(const InferenceRequest &request)
+{
+    MY_CHECK_NULL(request.pOnnxHdl, MY_PARAM_NULL);
+    MY_CHECK_NULL(request.callback, MY_PARAM_NULL);
+    if (request.priority < 0 || request.priority >= PRIORITY_COUNT)
+    {
+        MY_ERROR("invalid request priority %d\n", (int)request.priority);
+        return MY_PARAM_SET_ERROR;
+    }
+
+    InferenceRequest queued = request;
+    if (queued.strTenant.empty())
+    {
+        char aKey[32];
+        snprintf(aKey, sizeof(aKey), "#%p", (void *)request.pOnnxHdl);
+        queued.strTenant = aKey;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        PriorityQueue &priorityQueue = m_aQueues[request.priority];
+        if (m_bStop || priorityQueue.nQueued >= m_nQueueDepth)
+        {
+            return MY_OVERLOADED;
+        }
+
+        std::map<std::string, int>::const_iterator itWeight = m_mapWeights.find(queued.strTenant);
+        int nWeight = itWeight != m_mapWeights.end() ? itWeight->second : 1;
+
+        // 开始时间不早于当前虚拟时间, 空闲后重新提交的租户不能补回之前没用的份额
+        TenantQueue &tenantQueue = priorityQueue.mapTenants[queued.strTenant];
+        queued.dStartTag = std::max(priorityQueue.dVirtualTime, tenantQueue.dLastFinishTag);
+        queued.dFinishTag = queued.dStartTag + EstimateCostMs(request.pOnnxHdl) / nWeight;
+        tenantQueue.dLastFinishTag = queued.dFinishTag;
+        tenantQueue.queue.push_back(queued);
+        priorityQueue.nQueued++;
+    }
+    m_cvRequest.notify_one();
+    return MY_SUCCESS;
+}
+
+/**
+ * @brief share of the tenant within its priority, relative to the default weight 1
+ *
+ * @param pcTenant  租户, 与 request_options_t::aTenant 相同
+ * @param nWeight  权重, <=0 时恢复为1
+ */
+void InferenceExecutor::SetTenantWeight(const char *pcTenant, int nWeight)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (nWeight <= 0 || nWeight == 1)
+    {
+        m_mapWeights.erase(pcTenant);
+    }
+    else
+    {
+        m_mapWeights[pcTenant] = nWeight;
+    }
+}
+
+/**
+ * @brief how many workers may run PRIORITY_BATCH requests at the same time
+ *
+ * @param nMaxBatchWorkers  批量请求最多占用的线程数, 限制在 1 ~ 线程数
+ */
+void InferenceExecutor::SetMaxBatchWorkers(int nMaxBatchWorkers)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_nMaxBatchWorkers = std::min(std::max(nMaxBatchWorkers, 1), (int)m_vecWorkers.size());
+    }
+    m_cvRequest.notify_all();
+}
+
+/**
+ * @brief drop the cost estimate of a model handle being destroyed, so that the map does not grow with every
+ *        reload and a new handle at the same address starts from the default estimate.
+ *        Does not create the executor.
+ *
+ * @param pOnnxHdl  即将释放的模型句柄
+ */
+void InferenceExecutor::ForgetModel(OnnxRuntimeModelHandle *pOnnxHdl)
+{
+    std::lock_guard<std::mutex> lock(g_executor_mutex);
+    if (g_pExecutor != nullptr)
+    {
+        std::lock_guard<std::mutex> executor_lock(g_pExecutor->m_mutex);
+        g_pExecutor->m_mapCostMs.erase(pOnnxHdl);
+    }
+}
+
+double InferenceExecutor::EstimateCostMs(OnnxRuntimeModelHandle *pOnnxHdl) const
+{
+    std::map<OnnxRuntimeModelHandle *, double>::const_iterator it = m_mapCostMs.find(pOnnxHdl);
+    return it != m_mapCostMs.end() ? it->second : DEFAULT_REQUEST_COST_MS;
+}
+
+bool InferenceExecutor::CanDispatch(int nPriority) const
+{
+    if (m_aQueues[nPriority].nQueued == 0)
+    {
+        return false;
+    }
+    return PRIORITY_BATCH != nPriority || m_nBatchRunning < m_nMaxBatchWorkers;
+}
+
+/**
+ * @brief take the request with the smallest finish tag from the highest priority that can run, m_mutex held
+ *
+ * @param request  出队的请求
+ * @return bool  false if nothing can run now
+ */
+bool InferenceExecutor::PopNext(InferenceRequest &request)
+{
+    for (int nPriority = 0; nPriority < PRIORITY_COUNT; nPriority++)
+    {
+        if (!CanDispatch(nPriority))
+        {
+            continue;
+        }
+
+        PriorityQueue &priorityQueue = m_aQueues[nPriority];
+        std::map<std::string, TenantQueue>::iterator itNext = priorityQueue.mapTenants.end();
+        for (std::map<std::string, TenantQueue>::iterator it = priorityQueue.mapTenants.begin();
+             it != priorityQueue.mapTenants.end(); ++it)
+        {
+            if (itNext == priorityQueue.mapTenants.end() ||
+                it->second.queue.front().dFinishTag < itNext->second.queue.front().dFinishTag)
+            {
+                itNext = it;
+            }
+        }
+
+        request = itNext->second.queue.front();
+        itNext->second.queue.pop_front();
+        if (itNext->second.queue.empty())
+        {
+            priorityQueue.mapTenants.erase(itNext);
+        }
+        priorityQueue.nQueued--;
+        priorityQueue.dVirtualTime = request.dStartTag;
+        if (PRIORITY_BATCH == nPriority)
+        {
+            m_nBatchRunning++;
+        }
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief run one request; a cancelled or expired request is dropped without running
+ *
+ * @param request  推理请求
+ * @return result_t  MY_CANCELLED / MY_DEADLINE_EXCEEDED if the request was stopped before it completed
+ */
+result_t RunRequest(const InferenceRequest &request)
+{
+    RequestState *pState = request.pState.get();
+    if (pState == NULL)
+    {
+        return request.pOnnxHdl->my_onnxruntime_inference_tensors(request.input_tensors, request.output_tensors);
+    }
+
+    result_t res = pState->StopReason();
+    if (!pState->IsStopped())
+    {
+        res = request.pOnnxHdl->my_onnxruntime_inference_tensors(request.input_tensors, request.output_tensors,
+                                                                 pState->pRunOptions);
+        if (MY_SUCCESS != res && pState->IsStopped())
+        {
+            res = pState->StopReason();
+        }
+    }
+    RequestTracker::GetInstance()->Finish(request.pState);
+    return res;
+}
+
+void InferenceExecutor::WorkerLoop()
+{
+    while (true)
+    {
+        InferenceRequest request;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cvRequest.wait(lock, [this]() {
+                return m_bStop || CanDispatch(PRIORITY_INTERACTIVE) || CanDispatch(PRIORITY_BATCH);
+            });
+            // 停止时, 受线程数限制暂不能执行的批量请求由正在执行批量请求的线程接着处理
+            if (!PopNext(request))
+            {
+                return;
+            }
+        }
+
+        double dStartMs = GetTimeMs();
+        result_t res = RunRequest(request);
+        double dCostMs = GetTimeMs() - dStartMs;
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (MY_SUCCESS == res)
+            {
+                std::map<OnnxRuntimeModelHandle *, double>::iterator it = m_mapCostMs.find(request.pOnnxHdl);
+                if (it == m_mapCostMs.end())
+                {
+                    m_mapCostMs[request.pOnnxHdl] = dCostMs;
+                }
+                else
+                {
+                    it->second += REQUEST_COST_EWMA_ALPHA * (dCostMs - it->second);
+                }
+            }
+            if (PRIORITY_BATCH == request.priority)
+            {
+                m_nBatchRunning--;
+            }
+        }
+        if (PRIORITY_BATCH == request.priority)
+        {
+            m_cvRequest.notify_one();
+        }
+
+        request.callback(res, request.output_tensors, request.user_data);
+    }
+}
+
+/**
+ * @brief the process wide executor, created on first use with the Configure settings
+ *
+ * @return InferenceExecutor*
+ */
+InferenceExecutor *InferenceExecutor::GetInstance()
+{
+    std::lock_guard<std::mutex> lock(g_executor_mutex);
+    if (g_pExecutor == nullptr)
+    {
+        g_pExecutor = new InferenceExecutor(g_nExecutorThreads, g_nExecutorQueueDepth);
+        for (std::map<std::string, int>::const_iterator it = g_mapTenantWeights.begin();
+             it != g_mapTenantWeights.end(); ++it)
+        {
+            g_pExecutor->SetTenantWeight(it->first.c_str(), it->second);
+        }
+        if (g_nMaxBatchWorkers > 0)
+        {
+            g_pExecutor->SetMaxBatchWorkers(g_nMaxBatchWorkers);
+        }
+    }
+    return g_pExecutor;
+}
+
+/**
+ * @brief set the thread count and queue depth of the process wide executor, before its first use
+ *
+ * @param nThreads  执行线程数, <=0 时为CPU核数
+ * @param nQueueDepth  排队请求的上限
+ * @return result_t  MY_PARAM_SET_ERROR if the executor is already running
+ */
+result_t InferenceExecutor::Configure(int nThreads, int nQueueDepth)
+{
+    std::lock_guard<std::mutex> lock(g_executor_mutex);
+    if (g_pExecutor != nullptr)
+    {
+        MY_ERROR("executor is already running\n");
+        return MY_PARAM_SET_ERROR;
+    }
+    g_nExecutorThreads = nThreads;
+    g_nExecutorQueueDepth = nQueueDepth;
+    return MY_SUCCESS;
+}
+
+/**
+ * @brief SetTenantWeight on the process wide executor, kept until it is created if it is not running yet,
+ *        so that setting a weight does not start the executor before Configure
+ *
+ * @param pcTenant  租户
+ * @param nWeight  权重, <=0 时恢复为1
+ */
+void InferenceExecutor::ConfigureTenantWeight(const char *pcTenant, int nWeight)
+{
+    std::lock_guard<std::mutex> lock(g_executor_mutex);
+    if (g_pExecutor != nullptr)
+    {
+        g_pExecutor->SetTenantWeight(pcTenant, nWeight);
+    }
+    else if (nWeight <= 0 || nWeight == 1)
+    {
+        g_mapTenantWeights.erase(pcTenant);
+    }
+    else
+    {
+        g_mapTenantWeights[pcTenant] = nWeight;
+    }
+}
+
+/**
+ * @brief SetMaxBatchWorkers on the process wide executor, kept until it is created if it is not running yet
+ *
+ * @param nMaxBatchWorkers  批量请求最多占用的线程数
+ */
+void InferenceExecutor::ConfigureBatchWorkers(int nMaxBatchWorkers)
+{
+    std::lock_guard<std::mutex> lock(g_executor_mutex);
+    if (g_pExecutor != nullptr)
+    {
+        g_pExecutor->SetMaxBatchWorkers(nMaxBatchWorkers);
+    }
+    else
+    {
+        g_nMaxBatchWorkers = std::max(nMaxBatchWorkers, 1);
+    }
+}
+
+static void FutureCallback(result_t res, tensor_array_t * /*output_tensors*/, void *user_data)
+{
+    std::promise<result_t> *pPromise = (std::promise<result_t> *)user_data;
+    pPromise->set_value(res);
+    delete pPromise;
+}
+
+/**
+ * @brief submit an inference to the process wide executor, the future holds its result
+ *
+ * @param load_model_handle  模型句柄
+ * @param input_tensors  输入tensor, future 就绪前不能修改
+ * @param output_tensors  输出tensor
+ * @return std::future<result_t>
+ */
+std::future<result_t> InferenceTensorsAsync(model_handle_t *load_model_handle, tensor_array_t *input_tensors,
+                                            tensor_array_t *output_tensors)
+{
+    std::promise<result_t> *pPromise = new std::promise<result_t>();
+    std::future<result_t> future = pPromise->get_future();
+
+    InferenceRequest request;
+    request.pOnnxHdl = load_model_handle != NULL ? (OnnxRuntimeModelHandle *)load_model_handle->model_handle : NULL;
+    request.input_tensors = input_tensors;
+    request.output_tensors = output_tensors;
+    request.callback = FutureCallback;
+    request.user_data = pPromise;
+
+    result_t res = InferenceExecutor::GetInstance()->Submit(request);
+    if (MY_SUCCESS != res)
+    {
+        pPromise->set_value(res);
+        delete pPromise;
+    }
+    return future;
+}
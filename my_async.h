@@ -0,0 +1,101 @@
+#ifndef MY_INFERENCE_ONNX_MY_ASYNC_H
+#define MY_INFERENCE_ONNX_MY_ASYNC_H
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "common.h"
+
+class OnnxRuntimeModelHandle;
+struct RequestState;
+
+// 一次异步推理, 句柄和tensor在回调返回前必须有效
+struct InferenceRequest
+{
+    InferenceRequest()
+        : pOnnxHdl(NULL), input_tensors(NULL), output_tensors(NULL), callback(NULL), user_data(NULL),
+          priority(PRIORITY_INTERACTIVE), dStartTag(0), dFinishTag(0)
+    {
+    }
+
+    OnnxRuntimeModelHandle *pOnnxHdl;
+    tensor_array_t *input_tensors;
+    tensor_array_t *output_tensors;
+    inference_callback_t callback;
+    void *user_data;
+    std::shared_ptr<RequestState> pState; // 可为空; 有截止时间或可取消的请求由 RequestTracker 登记
+
+    request_priority_t priority;
+    std::string strTenant; // 为空时按模型句柄公平调度
+    double dStartTag;      // 加权公平队列的虚拟开始/结束时间, 由 Submit 设置
+    double dFinishTag;
+};
+
+// 固定线程数执行推理请求, 队列满时拒绝而不是阻塞提交者
+// 高优先级的请求总是先执行, 批量请求最多占用 nMaxBatchWorkers 个线程
+// 同一优先级内按租户(或模型)做加权公平排队, 请求的代价按该模型的平均执行时间估计
+class InferenceExecutor
+{
+public:
+    InferenceExecutor(int nThreads, int nQueueDepth);
+    ~InferenceExecutor();
+    result_t Submit(const InferenceRequest &request);
+    void SetTenantWeight(const char *pcTenant, int nWeight);
+    void SetMaxBatchWorkers(int nMaxBatchWorkers);
+
+    static InferenceExecutor *GetInstance();
+    static result_t Configure(int nThreads, int nQueueDepth);
+    static void ConfigureTenantWeight(const char *pcTenant, int nWeight);
+    static void ConfigureBatchWorkers(int nMaxBatchWorkers);
+    static void ForgetModel(OnnxRuntimeModelHandle *pOnnxHdl);
+
+private:
+    // 一个租户在某个优先级中排队的请求, 请求的结束时间单调递增
+    struct TenantQueue
+    {
+        TenantQueue() : dLastFinishTag(0) {}
+
+        std::deque<InferenceRequest> queue;
+        double dLastFinishTag;
+    };
+
+    struct PriorityQueue
+    {
+        PriorityQueue() : nQueued(0), dVirtualTime(0) {}
+
+        std::map<std::string, TenantQueue> mapTenants; // 空队列即删除, 空闲的租户不积累额度
+        size_t nQueued;
+        double dVirtualTime; // 最近出队请求的开始时间
+    };
+
+    void WorkerLoop();
+    bool CanDispatch(int nPriority) const;
+    bool PopNext(InferenceRequest &request);
+    double EstimateCostMs(OnnxRuntimeModelHandle *pOnnxHdl) const;
+
+private:
+    std::vector<std::thread> m_vecWorkers;
+    PriorityQueue m_aQueues[PRIORITY_COUNT];
+    size_t m_nQueueDepth; // 每个优先级分别计数
+    int m_nMaxBatchWorkers;
+    int m_nBatchRunning;
+    std::map<std::string, int> m_mapWeights;                  // 租户 -> 权重, 默认1
+    std::map<OnnxRuntimeModelHandle *, double> m_mapCostMs;   // 模型 -> 执行时间的滑动平均, 句柄析构时删除
+    std::mutex m_mutex;
+    std::condition_variable m_cvRequest;
+    bool m_bStop;
+};
+
+// 在当前线程执行请求, 已取消或超时的请求不执行; 执行后从 RequestTracker 注销
+result_t RunRequest(const InferenceRequest &request);
+
+// my_inference_tensors_async 的 future 版本, 提交失败时 future 立即就绪
+std::future<result_t> InferenceTensorsAsync(model_handle_t *load_model_handle, tensor_array_t *input_tensors,
+                                            tensor_array_t *output_tensors);
+
+#endif //MY_INFERENCE_ONNX_MY_ASYNC_H
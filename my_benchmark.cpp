@@ -0,0 +1,526 @@
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <unistd.h>
+#include <cmath>
+#include <vector>
+#include "aes.h"
+#include "my_utils.h"
+#include "my_kernels.h"
+#include "my_memory.h"
+#include "my_onnx_inference.h"
+#include "my_onnx_proto.h"
+#include "my_benchmark.h"
+
+static const char *g_load_phase_names[LOAD_PHASE_NUM] = {"file_read", "decrypt", "create_session", "model_info",
+                                                         "first_run"};
+
+/*===================== synthetic models =====================*/
+
+/**
+ * @brief ValueInfoProto of a 1-D float tensor
+ */
+static std::string PbFloatValueInfo(const char *name, long long dim)
+{
+    std::string dimension, shape, tensor_type, type, value_info;
+    PbVarintField(dimension, 1, dim);      // Dimension.dim_value
+    PbBytesField(shape, 1, dimension);     // TensorShapeProto.dim
+    PbVarintField(tensor_type, 1, 1);      // TypeProto.Tensor.elem_type = FLOAT
+    PbBytesField(tensor_type, 2, shape);   // TypeProto.Tensor.shape
+    PbBytesField(type, 1, tensor_type);    // TypeProto.tensor_type
+    PbBytesField(value_info, 1, name);     // ValueInfoProto.name
+    PbBytesField(value_info, 2, type);     // ValueInfoProto.type
+    return value_info;
+}
+
+/**
+ * @brief generate an onnx model "Y = X + W", X: float[1], W/Y: float[nWeightElements].
+ *        The size of the model is dominated by the initializer W, so it is used to benchmark loading
+ *        of models with different sizes without shipping real model files.
+ *
+ * @param nWeightElements  number of float elements of W
+ * @return std::string  serialized ModelProto
+ */
+std::string GenerateSyntheticOnnxModel(long long nWeightElements)
+{
+    std::string raw_data(nWeightElements * sizeof(float), '\0');
+    float *pWeight = (float *)&raw_data[0];
+    for (long long i = 0; i < nWeightElements; i++)
+    {
+        pWeight[i] = (float)(i % 1000) * 0.001f;
+    }
+
+    std::string node, initializer, graph, opset, model;
+
+    PbBytesField(node, 1, "X");   // NodeProto.input
+    PbBytesField(node, 1, "W");
+    PbBytesField(node, 2, "Y");   // NodeProto.output
+    PbBytesField(node, 4, "Add"); // NodeProto.op_type
+
+    PbVarintField(initializer, 1, nWeightElements); // TensorProto.dims
+    PbVarintField(initializer, 2, 1);               // TensorProto.data_type = FLOAT
+    PbBytesField(initializer, 8, "W");              // TensorProto.name
+    PbBytesField(initializer, 9, raw_data);         // TensorProto.raw_data
+    std::string().swap(raw_data);
+
+    PbBytesField(graph, 1, node);                             // GraphProto.node
+    PbBytesField(graph, 2, "synthetic");                      // GraphProto.name
+    PbBytesField(graph, 5, initializer);                      // GraphProto.initializer
+    PbBytesField(graph, 11, PbFloatValueInfo("X", 1));               // GraphProto.input
+    PbBytesField(graph, 12, PbFloatValueInfo("Y", nWeightElements)); // GraphProto.output
+
+    PbVarintField(opset, 2, 11); // OperatorSetIdProto.version
+
+    PbVarintField(model, 1, 6);          // ModelProto.ir_version
+    PbBytesField(model, 2, "my_benchmark"); // ModelProto.producer_name
+    PbBytesField(model, 7, graph);       // ModelProto.graph
+    PbBytesField(model, 8, opset);       // ModelProto.opset_import
+    return model;
+}
+
+/*===================== benchmark =====================*/
+
+static void PrintLoadProfile(const char *pcTitle, const load_profile_t *load_profile)
+{
+    printf("%s: model %lld bytes, total %.3f ms\n", pcTitle, load_profile->nModelFileBytes, load_profile->dTotalMs);
+    for (int i = 0; i < LOAD_PHASE_NUM; i++)
+    {
+        printf("    %-16s %10.3f ms  rss %8ld KB  peak %8ld KB\n", g_load_phase_names[i], load_profile->aPhaseMs[i],
+               load_profile->aPhaseRssKB[i], load_profile->aPhasePeakRssKB[i]);
+    }
+}
+
+/**
+ * @brief load -> first run -> release the model nRepeat times, average the load profile of every phase.
+ *        Peak memory is the max over all repeats.
+ *
+ * @param load_model_param  模型参数, bProfileLoad 会被打开
+ * @param input_tensors  first run 的输入, 为NULL时不统计first run
+ * @param output_tensors  first run 的输出
+ * @param nRepeat  重复次数
+ * @param load_profile  平均后的统计结果
+ * @return result_t
+ */
+result_t BenchmarkLoadModel(model_params_t *load_model_param, tensor_array_t *input_tensors,
+                            tensor_array_t *output_tensors, int nRepeat, load_profile_t *load_profile)
+{
+    MY_CHECK_NULL(load_model_param, MY_PARAM_NULL);
+    MY_CHECK_NULL(load_profile, MY_PARAM_NULL);
+    if (nRepeat <= 0)
+    {
+        return MY_PARAM_SET_ERROR;
+    }
+
+    model_params_t tModelParam;
+    memcpy(&tModelParam, load_model_param, sizeof(model_params_t));
+    tModelParam.bProfileLoad = TRUE;
+
+    memset(load_profile, 0, sizeof(load_profile_t));
+
+    for (int n = 0; n < nRepeat; n++)
+    {
+        OnnxRuntimeModelHandle *pOnnxHdl = new OnnxRuntimeModelHandle(&tModelParam);
+        pOnnxHdl->set_input_tensor_array(input_tensors);
+        pOnnxHdl->set_output_tensor_array(output_tensors);
+
+        result_t res = pOnnxHdl->my_onnxruntime_open_model();
+        if (MY_SUCCESS == res && input_tensors != NULL && output_tensors != NULL)
+        {
+            res = pOnnxHdl->my_onnxruntime_inference_tensors();
+        }
+
+        const load_profile_t &cur_profile = pOnnxHdl->get_load_profile();
+        for (int i = 0; i < LOAD_PHASE_NUM; i++)
+        {
+            load_profile->aPhaseMs[i] += cur_profile.aPhaseMs[i] / nRepeat;
+            load_profile->aPhaseRssKB[i] += cur_profile.aPhaseRssKB[i] / nRepeat;
+            if (cur_profile.aPhasePeakRssKB[i] > load_profile->aPhasePeakRssKB[i])
+            {
+                load_profile->aPhasePeakRssKB[i] = cur_profile.aPhasePeakRssKB[i];
+            }
+        }
+        load_profile->dTotalMs += cur_profile.dTotalMs / nRepeat;
+        load_profile->nModelFileBytes = cur_profile.nModelFileBytes;
+
+        pOnnxHdl->my_onnxruntime_release_model();
+        delete pOnnxHdl;
+
+        if (MY_SUCCESS != res)
+        {
+            MY_ERROR("benchmark model %s failed\n", tModelParam.model_path);
+            return res;
+        }
+    }
+
+    PrintLoadProfile(tModelParam.model_path, load_profile);
+    return MY_SUCCESS;
+}
+
+/**
+ * @brief generate synthetic models of the given sizes in a temp dir, benchmark loading plain and encrypted
+ *        versions of each one on CPU.
+ *
+ * @param pModelBytes  模型大小(字节)数组
+ * @param nSizes  数组长度
+ * @param nRepeat  每个模型重复加载次数
+ * @param pPlainProfiles  明文模型的统计结果, nSizes个
+ * @param pCipherProfiles  加密模型的统计结果, nSizes个
+ * @return result_t
+ */
+result_t BenchmarkSyntheticModels(const long long *pModelBytes, int nSizes, int nRepeat,
+                                  load_profile_t *pPlainProfiles, load_profile_t *pCipherProfiles)
+{
+    MY_CHECK_NULL(pModelBytes, MY_PARAM_NULL);
+    MY_CHECK_NULL(pPlainProfiles, MY_PARAM_NULL);
+    MY_CHECK_NULL(pCipherProfiles, MY_PARAM_NULL);
+
+    char aTmpDir[] = "/tmp/my_benchmark_XXXXXX";
+    if (mkdtemp(aTmpDir) == NULL)
+    {
+        MY_ERROR("create temp dir failed\n");
+        return MY_FAILED;
+    }
+
+    result_t res = MY_SUCCESS;
+    for (int s = 0; s < nSizes && MY_SUCCESS == res; s++)
+    {
+        long long nElements = pModelBytes[s] / (long long)sizeof(float);
+        if (nElements <= 0)
+        {
+            nElements = 1;
+        }
+
+        // 输入输出tensor: X[1], Y[nElements]
+        tensor_params_t tInputParam, tOutputParam;
+        memset(&tInputParam, 0, sizeof(tensor_params_t));
+        memset(&tOutputParam, 0, sizeof(tensor_params_t));
+        tInputParam.type = DT_FLOAT;
+        strcpy(tInputParam.aTensorName, "X");
+        tInputParam.nDims = 1;
+        tInputParam.pShape[0] = 1;
+        tOutputParam.type = DT_FLOAT;
+        strcpy(tOutputParam.aTensorName, "Y");
+        tOutputParam.nDims = 1;
+        tOutputParam.pShape[0] = (int)nElements;
+
+        tensor_params_array_t tInputParams = {1, &tInputParam, ""};
+        tensor_params_array_t tOutputParams = {1, &tOutputParam, ""};
+        tensor_array_t *input_tensors = NULL, *output_tensors = NULL;
+        alloc_tensor_arry(&tInputParams, &input_tensors);
+        alloc_tensor_arry(&tOutputParams, &output_tensors);
+        memset(input_tensors->pTensorArray[0].pValue, 0, input_tensors->pTensorArray[0].pTensorInfo->nLength);
+
+        model_params_t tModelParam;
+        memset(&tModelParam, 0, sizeof(model_params_t));
+        tModelParam.cpu_or_gpu = 0;
+        tModelParam.encStartPoint = 0;
+        tModelParam.encLength = 16 * 1024 * 16; // 解密时会两次除以16, 实际加密前16KB
+
+        std::string strModel = GenerateSyntheticOnnxModel(nElements);
+        std::string strPlainPath = std::string(aTmpDir) + "/synthetic_" + std::to_string(s) + ".onnx";
+        std::string strCipherPath = strPlainPath + ".enc";
+
+        bool bWritten = WriteFile(strPlainPath, strModel);
+        bWritten = bWritten && WriteFile(strCipherPath,
+                                         my_onnx::EncryptionBufferPartial(strModel, tModelParam.encStartPoint / 16,
+                                                                          tModelParam.encLength / 16));
+        std::string().swap(strModel);
+
+        if (!bWritten)
+        {
+            MY_ERROR("write synthetic model to %s failed\n", aTmpDir);
+            res = MY_FAILED;
+        }
+
+        if (MY_SUCCESS == res)
+        {
+            strncpy(tModelParam.model_path, strPlainPath.c_str(), sizeof(tModelParam.model_path) - 1);
+            tModelParam.bIsCipher = FALSE;
+            res = BenchmarkLoadModel(&tModelParam, input_tensors, output_tensors, nRepeat, &pPlainProfiles[s]);
+        }
+
+        if (MY_SUCCESS == res)
+        {
+            strncpy(tModelParam.model_path, strCipherPath.c_str(), sizeof(tModelParam.model_path) - 1);
+            tModelParam.bIsCipher = TRUE;
+            res = BenchmarkLoadModel(&tModelParam, input_tensors, output_tensors, nRepeat, &pCipherProfiles[s]);
+        }
+
+        unlink(strPlainPath.c_str());
+        unlink(strCipherPath.c_str());
+        release_tensor_arry(input_tensors);
+        release_tensor_arry(output_tensors);
+    }
+
+    rmdir(aTmpDir);
+    return res;
+}
+
+/**
+ * @brief max relative difference between two float arrays
+ */
+static float MaxRelativeDiff(const float *a, const float *b, size_t n)
+{
+    float fMaxDiff = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        float fDiff = std::fabs(a[i] - b[i]) / std::max(1.0f, std::fabs(b[i]));
+        fMaxDiff = std::max(fMaxDiff, fDiff);
+    }
+    return fMaxDiff;
+}
+
+/**
+ * @brief check every dispatched kernel of the selected instruction set against its scalar reference, for all
+ *        lengths 0..64 so that each SIMD block size and every tail length is exercised.
+ *        The results must be bit-exact, except exp which is a polynomial approximation in the SIMD paths.
+ *
+ * @param isa  当前选择的指令集, 只用于打印
+ * @return result_t  MY_FAILED if a kernel does not match the scalar reference
+ */
+static result_t CheckKernelTails(kernel_isa_t isa)
+{
+    // 最宽的块是 AVX2 的 32 个 uint8, 取两倍
+    const size_t nMaxLength = 64;
+    std::vector<my_u8> src(nMaxLength * 3);
+    std::vector<float> values(nMaxLength);
+    for (size_t i = 0; i < src.size(); i++)
+    {
+        src[i] = (my_u8)(i * 131 + (i >> 3));
+    }
+    for (size_t i = 0; i < values.size(); i++)
+    {
+        values[i] = (float)((int)(i * 37 % 200) - 100) * 0.1f;
+    }
+
+    const float aScale[3] = {1 / 57.375f, 1 / 57.12f, 1 / 58.395f};
+    const float aBias[3] = {-103.53f / 57.375f, -116.28f / 57.12f, -123.675f / 58.395f};
+    const float fInvScale = 1 / 0.05f;
+    std::vector<float> reference(nMaxLength * 3), output(nMaxLength * 3);
+    std::vector<my_u16> halfReference(nMaxLength), halfOutput(nMaxLength);
+    std::vector<my_s8> s8Reference(nMaxLength), s8Output(nMaxLength);
+
+    result_t res = MY_SUCCESS;
+    for (size_t n = 0; n <= nMaxLength; n++)
+    {
+        const char *pcFailed = NULL;
+
+        ConvertU8ToF32Scalar(src.data(), reference.data(), n);
+        ConvertU8ToF32(src.data(), output.data(), n);
+        if (0 != memcmp(output.data(), reference.data(), n * sizeof(float)))
+        {
+            pcFailed = "u8_to_f32";
+        }
+
+        NormalizeU8ToF32Scalar(src.data(), reference.data(), n, aScale[0], aBias[0]);
+        NormalizeU8ToF32(src.data(), output.data(), n, aScale[0], aBias[0]);
+        if (0 != memcmp(output.data(), reference.data(), n * sizeof(float)))
+        {
+            pcFailed = "normalize_u8";
+        }
+
+        NormalizeF32Scalar(values.data(), reference.data(), n, aScale[1], aBias[1]);
+        NormalizeF32(values.data(), output.data(), n, aScale[1], aBias[1]);
+        if (0 != memcmp(output.data(), reference.data(), n * sizeof(float)))
+        {
+            pcFailed = "normalize_f32";
+        }
+
+        float *const pReference[3] = {&reference[0], &reference[n], &reference[2 * n]};
+        float *const pOutput[3] = {&output[0], &output[n], &output[2 * n]};
+        HWC3ToCHWNormalizeU8Scalar(src.data(), n, pReference, aScale, aBias);
+        HWC3ToCHWNormalizeU8(src.data(), n, pOutput, aScale, aBias);
+        if (0 != memcmp(output.data(), reference.data(), 3 * n * sizeof(float)))
+        {
+            pcFailed = "hwc_to_chw_normalize";
+        }
+
+        float fMaxReference = ReduceMaxF32Scalar(values.data(), n);
+        float fMax = ReduceMaxF32(values.data(), n);
+        if (0 != memcmp(&fMax, &fMaxReference, sizeof(float)))
+        {
+            pcFailed = "reduce_max";
+        }
+
+        if (n > 0)
+        {
+            float fSumReference = ExpSumF32Scalar(values.data(), reference.data(), n, fMaxReference);
+            float fSum = ExpSumF32(values.data(), output.data(), n, fMax);
+            if (MaxRelativeDiff(output.data(), reference.data(), n) > 1e-5f ||
+                fabsf(fSum - fSumReference) > 1e-5f * fSumReference)
+            {
+                pcFailed = "exp_sum";
+            }
+        }
+
+        ConvertF32ToF16Scalar(values.data(), halfReference.data(), n);
+        ConvertF32ToF16(values.data(), halfOutput.data(), n);
+        if (0 != memcmp(halfOutput.data(), halfReference.data(), n * sizeof(my_u16)))
+        {
+            pcFailed = "f32_to_f16";
+        }
+
+        ConvertF32ToBF16Scalar(values.data(), halfReference.data(), n);
+        ConvertF32ToBF16(values.data(), halfOutput.data(), n);
+        if (0 != memcmp(halfOutput.data(), halfReference.data(), n * sizeof(my_u16)))
+        {
+            pcFailed = "f32_to_bf16";
+        }
+
+        QuantizeF32ToS8Scalar(values.data(), s8Reference.data(), n, fInvScale);
+        QuantizeF32ToS8(values.data(), s8Output.data(), n, fInvScale);
+        if (0 != memcmp(s8Output.data(), s8Reference.data(), n * sizeof(my_s8)))
+        {
+            pcFailed = "quantize_s8";
+        }
+
+        if (NULL != pcFailed)
+        {
+            MY_ERROR("%s kernel %s differs from scalar reference at length %d\n", pcFailed, GetKernelIsaName(isa),
+                     (int)n);
+            res = MY_FAILED;
+        }
+    }
+    return res;
+}
+
+/**
+ * @brief micro benchmark of the preprocessing kernels on a nWidth x nHeight BGR image, for every instruction
+ *        set supported by the CPU. The output of each one is checked against the scalar reference first.
+ *        It switches the process wide kernel dispatch, which is not thread-safe, so it must not run alongside
+ *        inference. The instruction set in effect before the call is restored when done.
+ *
+ * @param nWidth  图像宽
+ * @param nHeight  图像高
+ * @param nRepeat  重复次数
+ * @return result_t  MY_FAILED if a kernel does not match the scalar reference
+ */
+result_t BenchmarkKernels(int nWidth, int nHeight, int nRepeat)
+{
+    if (nWidth <= 0 || nHeight <= 0 || nRepeat <= 0)
+    {
+        return MY_PARAM_SET_ERROR;
+    }
+
+    size_t nPixels = (size_t)nWidth * nHeight;
+    std::vector<my_u8> src(nPixels * 3);
+    for (size_t i = 0; i < src.size(); i++)
+    {
+        src[i] = (my_u8)(i * 131 + (i >> 7));
+    }
+
+    const float aScale[3] = {1 / 57.375f, 1 / 57.12f, 1 / 58.395f};
+    const float aBias[3] = {-103.53f / 57.375f, -116.28f / 57.12f, -123.675f / 58.395f};
+
+    std::vector<float> reference(nPixels * 3), output(nPixels * 3);
+    float *const pReference[3] = {&reference[0], &reference[nPixels], &reference[2 * nPixels]};
+    float *const pOutput[3] = {&output[0], &output[nPixels], &output[2 * nPixels]};
+    HWC3ToCHWNormalizeU8Scalar(src.data(), nPixels, pReference, aScale, aBias);
+
+    // softmax 的 exp 是多项式近似, 与 expf 的差别在 1e-6 量级
+    std::vector<float> logits(1000), expReference(1000), expOutput(1000);
+    for (size_t i = 0; i < logits.size(); i++)
+    {
+        logits[i] = (float)((int)(i * 37 % 200) - 100) * 0.1f;
+    }
+
+    // 输出转换的输入再加上 NaN(带尾数)/inf/溢出/非规格化数/舍入边界, 要求与标量版本逐位一致
+    // 放在最前面, 由 SIMD 主循环而不是标量尾部处理
+    std::vector<float> values;
+    const my_u32 aSpecial[] = {0x7FC00000, 0xFFC00000, 0x7F800001, 0x7FA5A5A5, 0xFFB12345, 0x7F800000,
+                               0xFF800000, 0x477FEFFF, 0x477FF000, 0x47800000, 0x33800000, 0x33000001,
+                               0x387FC000, 0x80000001, 0x3F808000, 0x3F818000, 0x43000000, 0xC3010000};
+    for (size_t i = 0; i < sizeof(aSpecial) / sizeof(aSpecial[0]); i++)
+    {
+        float f;
+        memcpy(&f, &aSpecial[i], sizeof(f));
+        values.push_back(f);
+    }
+    values.insert(values.end(), logits.begin(), logits.end());
+    const float fInvScale = 1 / 0.05f;
+    std::vector<my_u16> halfReference(values.size()), halfOutput(values.size());
+    std::vector<my_u16> bf16Reference(values.size()), bf16Output(values.size());
+    std::vector<my_s8> s8Reference(values.size()), s8Output(values.size());
+    ConvertF32ToF16Scalar(values.data(), halfReference.data(), values.size());
+    ConvertF32ToBF16Scalar(values.data(), bf16Reference.data(), values.size());
+    QuantizeF32ToS8Scalar(values.data(), s8Reference.data(), values.size(), fInvScale);
+    float fExpSumReference = ExpSumF32Scalar(logits.data(), expReference.data(), logits.size(),
+                                             ReduceMaxF32Scalar(logits.data(), logits.size()));
+
+    result_t res = MY_SUCCESS;
+    kernel_isa_t eSavedIsa = GetKernelIsa();
+    for (int isa = KERNEL_ISA_SCALAR; isa <= KERNEL_ISA_AVX512; isa++)
+    {
+        SetKernelIsa((kernel_isa_t)isa);
+        if (GetKernelIsa() != isa)
+        {
+            continue; // not supported by this CPU
+        }
+
+        if (MY_SUCCESS != CheckKernelTails((kernel_isa_t)isa))
+        {
+            res = MY_FAILED;
+        }
+
+        HWC3ToCHWNormalizeU8(src.data(), nPixels, pOutput, aScale, aBias);
+        if (0 != memcmp(output.data(), reference.data(), output.size() * sizeof(float)))
+        {
+            MY_ERROR("kernel %s differs from scalar reference\n", GetKernelIsaName((kernel_isa_t)isa));
+            res = MY_FAILED;
+        }
+
+        float fExpSum = ExpSumF32(logits.data(), expOutput.data(), logits.size(),
+                                  ReduceMaxF32(logits.data(), logits.size()));
+        float fDiff = std::max(MaxRelativeDiff(expOutput.data(), expReference.data(), expOutput.size()),
+                               fabsf(fExpSum - fExpSumReference) / fExpSumReference);
+        if (fDiff > 1e-5f)
+        {
+            MY_ERROR("exp kernel %s differs from scalar reference by %g\n", GetKernelIsaName((kernel_isa_t)isa),
+                     fDiff);
+            res = MY_FAILED;
+        }
+
+        ConvertF32ToF16(values.data(), halfOutput.data(), values.size());
+        if (0 != memcmp(halfOutput.data(), halfReference.data(), halfOutput.size() * sizeof(my_u16)))
+        {
+            MY_ERROR("fp16 kernel %s differs from scalar reference\n", GetKernelIsaName((kernel_isa_t)isa));
+            res = MY_FAILED;
+        }
+
+        ConvertF32ToBF16(values.data(), bf16Output.data(), values.size());
+        if (0 != memcmp(bf16Output.data(), bf16Reference.data(), bf16Output.size() * sizeof(my_u16)))
+        {
+            MY_ERROR("bf16 kernel %s differs from scalar reference\n", GetKernelIsaName((kernel_isa_t)isa));
+            res = MY_FAILED;
+        }
+
+        QuantizeF32ToS8(values.data(), s8Output.data(), values.size(), fInvScale);
+        if (0 != memcmp(s8Output.data(), s8Reference.data(), s8Output.size() * sizeof(my_s8)))
+        {
+            MY_ERROR("int8 kernel %s differs from scalar reference\n", GetKernelIsaName((kernel_isa_t)isa));
+            res = MY_FAILED;
+        }
+
+        double dStartMs = GetTimeMs();
+        for (int n = 0; n < nRepeat; n++)
+        {
+            HWC3ToCHWNormalizeU8(src.data(), nPixels, pOutput, aScale, aBias);
+        }
+        double dHwcMs = (GetTimeMs() - dStartMs) / nRepeat;
+
+        dStartMs = GetTimeMs();
+        for (int n = 0; n < nRepeat; n++)
+        {
+            ConvertU8ToF32(src.data(), output.data(), src.size());
+        }
+        double dConvertMs = (GetTimeMs() - dStartMs) / nRepeat;
+
+        // 读 uint8 写 float, 每个元素5字节
+        printf("%-8s hwc_to_chw_normalize %8.3f ms %8.2f GB/s   u8_to_f32 %8.3f ms %8.2f GB/s\n",
+               GetKernelIsaName((kernel_isa_t)isa), dHwcMs, src.size() * 5 / dHwcMs / 1e6, dConvertMs,
+               src.size() * 5 / dConvertMs / 1e6);
+    }
+
+    SetKernelIsa(eSavedIsa);
+    return res;
+}
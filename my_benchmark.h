@@ -0,0 +1,16 @@
+#ifndef MY_INFERENCE_ONNX_MY_BENCHMARK_H
+#define MY_INFERENCE_ONNX_MY_BENCHMARK_H
+#include <string>
+#include "common.h"
+
+std::string GenerateSyntheticOnnxModel(long long nWeightElements);
+
+result_t BenchmarkLoadModel(model_params_t *load_model_param, tensor_array_t *input_tensors,
+                            tensor_array_t *output_tensors, int nRepeat, load_profile_t *load_profile);
+
+result_t BenchmarkSyntheticModels(const long long *pModelBytes, int nSizes, int nRepeat,
+                                  load_profile_t *pPlainProfiles, load_profile_t *pCipherProfiles);
+
+result_t BenchmarkKernels(int nWidth, int nHeight, int nRepeat);
+
+#endif //MY_INFERENCE_ONNX_MY_BENCHMARK_H
@@ -0,0 +1,195 @@
+#include "my_cache.h"
+
+#include <cstring>
+#include <iterator>
+#include "my_utils.h"
+
+#define DEFAULT_CACHE_SHARDS 16
+#define CACHE_CHECK_SEED 0x5bd1e9955bd1e995ULL
+#define CACHE_ENTRY_OVERHEAD 128 // 每个条目的链表/哈希表节点等开销, 计入容量
+
+/**
+ * @brief Construct a new Result Cache object
+ *
+ * @param pParams  缓存参数
+ */
+ResultCache::ResultCache(const result_cache_params_t *pParams)
+{
+    memcpy(&m_tParams, pParams, sizeof(result_cache_params_t));
+    if (m_tParams.nShards <= 0)
+    {
+        m_tParams.nShards = DEFAULT_CACHE_SHARDS;
+    }
+    m_nShardCapacity = (size_t)m_tParams.nCapacityKB * 1024 / m_tParams.nShards;
+    for (int i = 0; i < m_tParams.nShards; i++)
+    {
+        m_vecShards.push_back(std::unique_ptr<Shard>(new Shard()));
+    }
+}
+
+/**
+ * @brief key of a request: the input tensors plus the names, types and sizes of the requested outputs
+ *
+ * @param input_tensor_array  输入tensor
+ * @param output_tensor_array  输出tensor, 只用到签名
+ * @return ResultCacheKey
+ */
+ResultCacheKey ResultCache::MakeKey(const tensor_array_t *input_tensor_array,
+                                    const tensor_array_t *output_tensor_array)
+{
+    uint64_t nSignature = (uint64_t)output_tensor_array->nArraySize;
+    for (int i = 0; i < output_tensor_array->nArraySize; i++)
+    {
+        const tensor_params_t *pParam = output_tensor_array->pTensorArray[i].pTensorInfo;
+        nSignature = HashBytes(pParam->aTensorName, strnlen(pParam->aTensorName, sizeof(pParam->aTensorName)),
+                               nSignature);
+        nSignature = HashBytes(&pParam->type, sizeof(pParam->type), nSignature);
+        nSignature = HashBytes(&pParam->nLength, sizeof(pParam->nLength), nSignature);
+    }
+
+    ResultCacheKey key;
+    key.nHash = HashTensorArray(input_tensor_array, nSignature);
+    key.nCheck = HashTensorArray(input_tensor_array, nSignature ^ CACHE_CHECK_SEED);
+    return key;
+}
+
+/**
+ * @brief copy the cached outputs of key into output_tensor_array
+ *
+ * @param key  MakeKey 的结果
+ * @param output_tensor_array  输出tensor
+ * @return bool  false on a miss, the outputs are untouched then
+ */
+bool ResultCache::Lookup(const ResultCacheKey &key, tensor_array_t *output_tensor_array)
+{
+    Shard *pShard = m_vecShards[key.nHash % m_vecShards.size()].get();
+    std::lock_guard<std::mutex> lock(pShard->mutex);
+
+    auto itMap = pShard->mapEntries.find(key.nHash);
+    if (itMap == pShard->mapEntries.end() || itMap->second->key.nCheck != key.nCheck)
+    {
+        pShard->nMisses++;
+        return false;
+    }
+
+    std::list<Entry>::iterator it = itMap->second;
+    if (m_tParams.nTtlMs > 0 && GetTimeMs() - it->dInsertMs > m_tParams.nTtlMs)
+    {
+        EraseEntry(pShard, it);
+        pShard->nExpired++;
+        pShard->nMisses++;
+        return false;
+    }
+
+    // 签名相同, 输出个数和容量都一致
+    for (int i = 0; i < output_tensor_array->nArraySize; i++)
+    {
+        const OutputData &output = it->vecOutputs[i];
+        tensor_t *pTensor = &output_tensor_array->pTensorArray[i];
+        pTensor->pTensorInfo->nDims = output.nDims;
+        memcpy(pTensor->pTensorInfo->pShape, output.pShape, sizeof(output.pShape));
+        pTensor->pTensorInfo->nElementSize = output.nElementSize;
+        memcpy(pTensor->pValue, output.vecData.data(), output.vecData.size());
+    }
+
+    pShard->lru.splice(pShard->lru.begin(), pShard->lru, it);
+    pShard->nHits++;
+    return true;
+}
+
+/**
+ * @brief keep a copy of the outputs of a successful run, evicting least recently used entries of the shard
+ *
+ * @param key  MakeKey 的结果, 须在执行前计算
+ * @param output_tensor_array  执行后的输出tensor
+ */
+void ResultCache::Insert(const ResultCacheKey &key, const tensor_array_t *output_tensor_array)
+{
+    Entry entry;
+    entry.key = key;
+    entry.nBytes = CACHE_ENTRY_OVERHEAD;
+    entry.vecOutputs.resize(output_tensor_array->nArraySize);
+    for (int i = 0; i < output_tensor_array->nArraySize; i++)
+    {
+        const tensor_t *pTensor = &output_tensor_array->pTensorArray[i];
+        OutputData &output = entry.vecOutputs[i];
+        output.nDims = pTensor->pTensorInfo->nDims;
+        memcpy(output.pShape, pTensor->pTensorInfo->pShape, sizeof(output.pShape));
+        output.nElementSize = pTensor->pTensorInfo->nElementSize;
+        entry.nBytes += (size_t)pTensor->pTensorInfo->nLength;
+    }
+    if (entry.nBytes > m_nShardCapacity)
+    {
+        return;
+    }
+
+    // 数据在锁外拷贝
+    for (int i = 0; i < output_tensor_array->nArraySize; i++)
+    {
+        const tensor_t *pTensor = &output_tensor_array->pTensorArray[i];
+        const my_u8 *pData = (const my_u8 *)pTensor->pValue;
+        entry.vecOutputs[i].vecData.assign(pData, pData + pTensor->pTensorInfo->nLength);
+    }
+    entry.dInsertMs = GetTimeMs();
+
+    Shard *pShard = m_vecShards[key.nHash % m_vecShards.size()].get();
+    std::lock_guard<std::mutex> lock(pShard->mutex);
+
+    auto itMap = pShard->mapEntries.find(key.nHash);
+    if (itMap != pShard->mapEntries.end())
+    {
+        EraseEntry(pShard, itMap->second);
+    }
+    while (pShard->nBytes + entry.nBytes > m_nShardCapacity && !pShard->lru.empty())
+    {
+        EraseEntry(pShard, std::prev(pShard->lru.end()));
+        pShard->nEvictions++;
+    }
+
+    pShard->nBytes += entry.nBytes;
+    pShard->lru.push_front(std::move(entry));
+    pShard->mapEntries[key.nHash] = pShard->lru.begin();
+}
+
+void ResultCache::EraseEntry(Shard *pShard, std::list<Entry>::iterator it)
+{
+    pShard->nBytes -= it->nBytes;
+    pShard->mapEntries.erase(it->key.nHash);
+    pShard->lru.erase(it);
+}
+
+/**
+ * @brief drop every cached result
+ */
+void ResultCache::Clear()
+{
+    for (size_t i = 0; i < m_vecShards.size(); i++)
+    {
+        Shard *pShard = m_vecShards[i].get();
+        std::lock_guard<std::mutex> lock(pShard->mutex);
+        pShard->lru.clear();
+        pShard->mapEntries.clear();
+        pShard->nBytes = 0;
+    }
+}
+
+/**
+ * @brief counters summed over the shards
+ *
+ * @param pStats  统计
+ */
+void ResultCache::GetStats(result_cache_stats_t *pStats)
+{
+    memset(pStats, 0, sizeof(result_cache_stats_t));
+    for (size_t i = 0; i < m_vecShards.size(); i++)
+    {
+        Shard *pShard = m_vecShards[i].get();
+        std::lock_guard<std::mutex> lock(pShard->mutex);
+        pStats->nHits += pShard->nHits;
+        pStats->nMisses += pShard->nMisses;
+        pStats->nEvictions += pShard->nEvictions;
+        pStats->nExpired += pShard->nExpired;
+        pStats->nEntries += (long)pShard->lru.size();
+        pStats->nBytes += (long)pShard->nBytes;
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef MY_INFERENCE_ONNX_MY_CACHE_H
+#define MY_INFERENCE_ONNX_MY_CACHE_H
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "common.h"
+
+// 缓存的键: 输入和输出签名的两个不同种子的哈希, 合起来128位, 不保存输入本身
+struct ResultCacheKey
+{
+    uint64_t nHash;  // 选择分片和查找
+    uint64_t nCheck; // 排除 nHash 冲突
+};
+
+// 一个模型句柄的推理结果缓存, 按键分片, 每片独立的锁、LRU 和 nCapacityKB / nShards 的容量
+// 缓存属于句柄, 热更新换成新句柄后旧结果随旧句柄释放
+class ResultCache
+{
+public:
+    explicit ResultCache(const result_cache_params_t *pParams);
+    ResultCacheKey MakeKey(const tensor_array_t *input_tensor_array, const tensor_array_t *output_tensor_array);
+    bool Lookup(const ResultCacheKey &key, tensor_array_t *output_tensor_array);
+    void Insert(const ResultCacheKey &key, const tensor_array_t *output_tensor_array);
+    void Clear();
+    void GetStats(result_cache_stats_t *pStats);
+
+private:
+    struct OutputData
+    {
+        int nDims;
+        int pShape[8];
+        int nElementSize;
+        std::vector<my_u8> vecData;
+    };
+
+    struct Entry
+    {
+        ResultCacheKey key;
+        double dInsertMs;
+        size_t nBytes;
+        std::vector<OutputData> vecOutputs;
+    };
+
+    struct Shard
+    {
+        Shard() : nBytes(0), nHits(0), nMisses(0), nEvictions(0), nExpired(0) {}
+
+        std::mutex mutex;
+        std::list<Entry> lru; // 最近使用的在前
+        std::unordered_map<uint64_t, std::list<Entry>::iterator> mapEntries;
+        size_t nBytes;
+        long long nHits;
+        long long nMisses;
+        long long nEvictions;
+        long long nExpired;
+    };
+
+    void EraseEntry(Shard *pShard, std::list<Entry>::iterator it);
+
+private:
+    result_cache_params_t m_tParams;
+    size_t m_nShardCapacity;
+    std::vector<std::unique_ptr<Shard>> m_vecShards;
+};
+
+#endif //MY_INFERENCE_ONNX_MY_CACHE_H
@@ -0,0 +1,385 @@
+#include "my_cascade.h"
+
+#include <chrono>
+#include <cstring>
+#include "my_kernels.h"
+#include "my_onnx_inference.h"
+#include "my_utils.h"
+
+/**
+ * @brief Construct a new Cascade Model object
+ *
+ * @param pSmall  先执行的小模型
+ * @param pLarge  置信度不够时执行的大模型
+ * @param pParams  级联参数
+ */
+CascadeModel::CascadeModel(OnnxRuntimeModelHandle *pSmall, OnnxRuntimeModelHandle *pLarge,
+                           const cascade_params_t *pParams)
+    : m_pSmall(pSmall), m_pLarge(pLarge), m_nQueuedRows(0), m_bCollecting(false)
+{
+    memcpy(&m_tParams, pParams, sizeof(cascade_params_t));
+    memset(&m_tStats, 0, sizeof(cascade_stats_t));
+}
+
+/**
+ * @brief check that the small model has the score output. Merging is turned off when an input of the large
+ *        model has a fixed dim 0, since a merged batch would not match its declared shape.
+ *
+ * @return result_t
+ */
+result_t CascadeModel::Check()
+{
+    const std::vector<const char *> &vecNames = m_pSmall->get_output_names();
+    bool bFound = false;
+    for (size_t i = 0; i < vecNames.size() && !bFound; i++)
+    {
+        bFound = strncmp(vecNames[i], m_tParams.aScoreOutput, sizeof(m_tParams.aScoreOutput)) == 0;
+    }
+    if (!bFound)
+    {
+        MY_ERROR("cascade: small model has no output %s\n", m_tParams.aScoreOutput);
+        return MY_PARAM_SET_ERROR;
+    }
+
+    const std::vector<const char *> &vecLargeInputs = m_pLarge->get_input_names();
+    for (size_t i = 0; i < vecLargeInputs.size() && m_tParams.nMaxBatch > 1; i++)
+    {
+        if (!m_pLarge->is_dynamic_input_dim(i, 0))
+        {
+            MY_DEBUG("cascade: input %s of the large model has a fixed dim 0, requests are not merged\n",
+                     vecLargeInputs[i]);
+            m_tParams.nMaxBatch = 1;
+        }
+    }
+    return MY_SUCCESS;
+}
+
+/**
+ * @brief run the small model and return its outputs if every row is confident, otherwise overwrite them
+ *        with the outputs of the large model
+ *
+ * @param input_tensor_array  输入tensor, 两个模型相同
+ * @param output_tensor_array  输出tensor, 须包含 aScoreOutput
+ * @param pEscalated  可为NULL, 返回是否由大模型给出结果
+ * @return result_t
+ */
+result_t CascadeModel::Run(tensor_array_t *input_tensor_array, tensor_array_t *output_tensor_array,
+                           MY_BOOL *pEscalated)
+{
+    bool bConfident = false;
+    result_t res = m_pSmall->my_onnxruntime_inference_tensors(input_tensor_array, output_tensor_array);
+    if (MY_SUCCESS == res)
+    {
+        res = IsConfident(output_tensor_array, &bConfident);
+    }
+    if (MY_SUCCESS != res)
+    {
+        return res;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_tStats.nRequests++;
+        if (bConfident)
+        {
+            m_tStats.nEarlyExits++;
+        }
+        else
+        {
+            m_tStats.nEscalated++;
+        }
+    }
+    if (pEscalated)
+    {
+        *pEscalated = bConfident ? 0 : 1;
+    }
+    return bConfident ? MY_SUCCESS : RunEscalated(input_tensor_array, output_tensor_array);
+}
+
+/**
+ * @brief counters since creation
+ *
+ * @param pStats  统计
+ */
+void CascadeModel::GetStats(cascade_stats_t *pStats)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    memcpy(pStats, &m_tStats, sizeof(cascade_stats_t));
+}
+
+/**
+ * @brief whether the max probability of every row of the score output reaches the threshold
+ *
+ * @param output_tensor_array  小模型的输出
+ * @param pConfident  结果
+ * @return result_t
+ */
+result_t CascadeModel::IsConfident(const tensor_array_t *output_tensor_array, bool *pConfident)
+{
+    *pConfident = false;
+    const tensor_t *pScore = NULL;
+    for (int i = 0; i < output_tensor_array->nArraySize; i++)
+    {
+        const tensor_t *pTensor = &output_tensor_array->pTensorArray[i];
+        if (strncmp(pTensor->pTensorInfo->aTensorName, m_tParams.aScoreOutput,
+                    sizeof(m_tParams.aScoreOutput)) == 0)
+        {
+            pScore = pTensor;
+            break;
+        }
+    }
+    if (pScore == NULL || DT_FLOAT != pScore->pTensorInfo->type)
+    {
+        MY_ERROR("cascade: the outputs need the float tensor %s\n", m_tParams.aScoreOutput);
+        return MY_PARAM_SET_ERROR;
+    }
+
+    const tensor_params_t *pParam = pScore->pTensorInfo;
+    size_t nRows = pParam->nDims >= 2 && pParam->pShape[0] > 0 ? (size_t)pParam->pShape[0] : 1;
+    size_t nCols = (size_t)pParam->nElementSize / nRows;
+    if (nCols == 0)
+    {
+        return MY_SUCCESS;
+    }
+
+    std::vector<float> vecScratch(nCols);
+    for (size_t r = 0; r < nRows; r++)
+    {
+        const float *pRow = (const float *)pScore->pValue + r * nCols;
+        float fMax = ReduceMaxF32(pRow, nCols);
+        float fTop = m_tParams.bApplySoftmax ? 1.0f / ExpSumF32(pRow, vecScratch.data(), nCols, fMax) : fMax;
+        if (!(fTop >= m_tParams.fThreshold))
+        {
+            return MY_SUCCESS;
+        }
+    }
+    *pConfident = true;
+    return MY_SUCCESS;
+}
+
+/**
+ * @brief run a request on the large model, merged with other escalated requests when nMaxBatch > 1 and
+ *        every input and output has the same dim 0. The caller that finds nobody collecting waits for a
+ *        full batch or nBatchWaitMs and runs it for everyone in it; the others wait for their result.
+ *
+ * @param input_tensor_array  输入tensor
+ * @param output_tensor_array  输出tensor
+ * @return result_t
+ */
+result_t CascadeModel::RunEscalated(tensor_array_t *input_tensor_array, tensor_array_t *output_tensor_array)
+{
+    int nRows = BatchRows(input_tensor_array, output_tensor_array);
+    if (m_tParams.nMaxBatch <= 1 || nRows <= 0)
+    {
+        result_t res = m_pLarge->my_onnxruntime_inference_tensors(input_tensor_array, output_tensor_array);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_tStats.nLargeRuns++;
+        return res;
+    }
+
+    EscalatedRequest request;
+    request.input_tensors = input_tensor_array;
+    request.output_tensors = output_tensor_array;
+    request.nRows = nRows;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_queue.push_back(&request);
+    m_nQueuedRows += request.nRows;
+    m_cv.notify_all();
+
+    while (!request.bDone)
+    {
+        // 已被别人取走的请求等它执行完
+        if (m_bCollecting || request.bTaken)
+        {
+            m_cv.wait(lock);
+            continue;
+        }
+
+        m_bCollecting = true;
+        double dDeadline = GetTimeMs() + m_tParams.nBatchWaitMs;
+        while (m_nQueuedRows < m_tParams.nMaxBatch)
+        {
+            double dLeftMs = dDeadline - GetTimeMs();
+            if (dLeftMs <= 0)
+            {
+                break;
+            }
+            m_cv.wait_for(lock, std::chrono::microseconds((long long)(dLeftMs * 1000)));
+        }
+
+        std::vector<EscalatedRequest *> vecBatch;
+        TakeBatch(vecBatch);
+        m_bCollecting = false;
+        m_tStats.nLargeRuns++;
+        m_cv.notify_all();
+
+        lock.unlock();
+        result_t res = RunBatch(vecBatch);
+        lock.lock();
+
+        for (size_t i = 0; i < vecBatch.size(); i++)
+        {
+            vecBatch[i]->res = res;
+            vecBatch[i]->bDone = true;
+        }
+        m_cv.notify_all();
+    }
+    return request.res;
+}
+
+/**
+ * @brief take the oldest queued request and the following ones whose tensors differ only in dim 0,
+ *        up to nMaxBatch rows. Called with m_mutex held.
+ *
+ * @param vecBatch  取出的请求
+ */
+void CascadeModel::TakeBatch(std::vector<EscalatedRequest *> &vecBatch)
+{
+    int nRows = 0;
+    auto it = m_queue.begin();
+    while (it != m_queue.end())
+    {
+        EscalatedRequest *pRequest = *it;
+        bool bFits = vecBatch.empty() ||
+                     (nRows + pRequest->nRows <= m_tParams.nMaxBatch &&
+                      SameRowShape(vecBatch[0]->input_tensors, pRequest->input_tensors) &&
+                      SameRowShape(vecBatch[0]->output_tensors, pRequest->output_tensors));
+        if (!bFits)
+        {
+            ++it;
+            continue;
+        }
+        vecBatch.push_back(pRequest);
+        pRequest->bTaken = true;
+        nRows += pRequest->nRows;
+        m_nQueuedRows -= pRequest->nRows;
+        it = m_queue.erase(it);
+    }
+}
+
+/**
+ * @brief concatenate the inputs along dim 0, run the large model once and split the outputs back
+ *
+ * @param vecBatch  同一 batch 的请求
+ * @return result_t
+ */
+result_t CascadeModel::RunBatch(const std::vector<EscalatedRequest *> &vecBatch)
+{
+    if (vecBatch.size() == 1)
+    {
+        return m_pLarge->my_onnxruntime_inference_tensors(vecBatch[0]->input_tensors, vecBatch[0]->output_tensors);
+    }
+
+    int nTotalRows = 0;
+    for (size_t k = 0; k < vecBatch.size(); k++)
+    {
+        nTotalRows += vecBatch[k]->nRows;
+    }
+
+    // 合并后的tensor, 第0维为总行数
+    tensor_array_t *aFirst[2] = {vecBatch[0]->input_tensors, vecBatch[0]->output_tensors};
+    tensor_array_t aMerged[2];
+    std::vector<tensor_params_t> vecParams[2];
+    std::vector<tensor_t> vecTensors[2];
+    std::vector<std::vector<my_u8>> vecData[2];
+    for (int a = 0; a < 2; a++)
+    {
+        int nSize = aFirst[a]->nArraySize;
+        vecParams[a].resize(nSize);
+        vecTensors[a].resize(nSize);
+        vecData[a].resize(nSize);
+        for (int i = 0; i < nSize; i++)
+        {
+            memcpy(&vecParams[a][i], aFirst[a]->pTensorArray[i].pTensorInfo, sizeof(tensor_params_t));
+            vecParams[a][i].pShape[0] = nTotalRows;
+            vecTensors[a][i].pTensorInfo = &vecParams[a][i];
+            GetTensorSize(&vecTensors[a][i]);
+            vecData[a][i].resize(vecParams[a][i].nLength);
+            vecTensors[a][i].pValue = vecData[a][i].data();
+        }
+        memset(&aMerged[a], 0, sizeof(tensor_array_t));
+        aMerged[a].nArraySize = nSize;
+        aMerged[a].pTensorArray = vecTensors[a].data();
+    }
+
+    for (int i = 0; i < aMerged[0].nArraySize; i++)
+    {
+        size_t nRowBytes = vecParams[0][i].nLength / nTotalRows;
+        my_u8 *pDst = vecData[0][i].data();
+        for (size_t k = 0; k < vecBatch.size(); k++)
+        {
+            memcpy(pDst, vecBatch[k]->input_tensors->pTensorArray[i].pValue, nRowBytes * vecBatch[k]->nRows);
+            pDst += nRowBytes * vecBatch[k]->nRows;
+        }
+    }
+
+    result_t res = m_pLarge->my_onnxruntime_inference_tensors(&aMerged[0], &aMerged[1]);
+    for (int i = 0; i < aMerged[1].nArraySize && MY_SUCCESS == res; i++)
+    {
+        size_t nRowBytes = vecParams[1][i].nLength / nTotalRows;
+        int nRowElements = vecParams[1][i].nElementSize / nTotalRows;
+        const my_u8 *pSrc = vecData[1][i].data();
+        for (size_t k = 0; k < vecBatch.size(); k++)
+        {
+            tensor_t *pTensor = &vecBatch[k]->output_tensors->pTensorArray[i];
+            memcpy(pTensor->pValue, pSrc, nRowBytes * vecBatch[k]->nRows);
+            pTensor->pTensorInfo->nElementSize = nRowElements * vecBatch[k]->nRows;
+            pSrc += nRowBytes * vecBatch[k]->nRows;
+        }
+    }
+    return res;
+}
+
+/**
+ * @brief dim 0 shared by all inputs and outputs
+ *
+ * @param input_tensor_array  输入tensor
+ * @param output_tensor_array  输出tensor
+ * @return int  0 if the tensors can't be merged along dim 0
+ */
+int CascadeModel::BatchRows(const tensor_array_t *input_tensor_array, const tensor_array_t *output_tensor_array)
+{
+    int nRows = 0;
+    const tensor_array_t *aArrays[2] = {input_tensor_array, output_tensor_array};
+    for (int a = 0; a < 2; a++)
+    {
+        for (int i = 0; i < aArrays[a]->nArraySize; i++)
+        {
+            const tensor_params_t *pParam = aArrays[a]->pTensorArray[i].pTensorInfo;
+            if (pParam->nDims < 1 || pParam->pShape[0] <= 0 || (nRows > 0 && pParam->pShape[0] != nRows))
+            {
+                return 0;
+            }
+            nRows = pParam->pShape[0];
+        }
+    }
+    return nRows;
+}
+
+/**
+ * @brief same count, names, types and dims except dim 0, so the tensors can be concatenated along dim 0
+ *
+ * @param pArray1  tensor数组
+ * @param pArray2  tensor数组
+ * @return bool
+ */
+bool CascadeModel::SameRowShape(const tensor_array_t *pArray1, const tensor_array_t *pArray2)
+{
+    if (pArray1->nArraySize != pArray2->nArraySize)
+    {
+        return false;
+    }
+    for (int i = 0; i < pArray1->nArraySize; i++)
+    {
+        const tensor_params_t *pParam1 = pArray1->pTensorArray[i].pTensorInfo;
+        const tensor_params_t *pParam2 = pArray2->pTensorArray[i].pTensorInfo;
+        if (pParam1->type != pParam2->type || pParam1->nDims != pParam2->nDims || pParam1->nDims < 1 ||
+            strncmp(pParam1->aTensorName, pParam2->aTensorName, sizeof(pParam1->aTensorName)) != 0 ||
+            memcmp(pParam1->pShape + 1, pParam2->pShape + 1, (pParam1->nDims - 1) * sizeof(int)) != 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
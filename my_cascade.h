@@ -0,0 +1,58 @@
+#ifndef MY_INFERENCE_ONNX_MY_CASCADE_H
+#define MY_INFERENCE_ONNX_MY_CASCADE_H
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <vector>
+#include "common.h"
+
+class OnnxRuntimeModelHandle;
+
+// 交给大模型的一个请求, 由合并 batch 的线程执行并标记完成
+struct EscalatedRequest
+{
+    EscalatedRequest()
+        : input_tensors(NULL), output_tensors(NULL), nRows(1), res(MY_SUCCESS), bTaken(false), bDone(false)
+    {
+    }
+
+    tensor_array_t *input_tensors;
+    tensor_array_t *output_tensors;
+    int nRows; // 第0维
+    result_t res;
+    bool bTaken; // 已被某个 batch 取出
+    bool bDone;
+};
+
+// 小模型和大模型的级联, 两个句柄都由调用者加载和释放
+// 需要升级的并发请求在调用线程中合并: 第一个到达的等待凑够 nMaxBatch 行或 nBatchWaitMs, 然后替所有人执行
+class CascadeModel
+{
+public:
+    CascadeModel(OnnxRuntimeModelHandle *pSmall, OnnxRuntimeModelHandle *pLarge, const cascade_params_t *pParams);
+    result_t Check();
+    result_t Run(tensor_array_t *input_tensor_array, tensor_array_t *output_tensor_array, MY_BOOL *pEscalated);
+    void GetStats(cascade_stats_t *pStats);
+
+private:
+    result_t IsConfident(const tensor_array_t *output_tensor_array, bool *pConfident);
+    result_t RunEscalated(tensor_array_t *input_tensor_array, tensor_array_t *output_tensor_array);
+    void TakeBatch(std::vector<EscalatedRequest *> &vecBatch);
+    result_t RunBatch(const std::vector<EscalatedRequest *> &vecBatch);
+    static int BatchRows(const tensor_array_t *input_tensor_array, const tensor_array_t *output_tensor_array);
+    static bool SameRowShape(const tensor_array_t *pArray1, const tensor_array_t *pArray2);
+
+private:
+    OnnxRuntimeModelHandle *m_pSmall;
+    OnnxRuntimeModelHandle *m_pLarge;
+    cascade_params_t m_tParams;
+
+    std::deque<EscalatedRequest *> m_queue; // 等待合并的请求
+    int m_nQueuedRows;
+    bool m_bCollecting; // 有线程正在凑 batch
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    cascade_stats_t m_tStats;
+};
+
+#endif //MY_INFERENCE_ONNX_MY_CASCADE_H
@@ -0,0 +1,135 @@
+#include "my_coalesce.h"
+
+#include <cstring>
+#include "my_utils.h"
+
+/**
+ * @brief attach to an in-flight run with the same inputs, or register a new one
+ *
+ * @param input_tensor_array  输入tensor
+ * @param output_tensor_array  输出tensor, 与 leader 的个数、名字、类型和容量都相同才能合并
+ * @param pLeader  true 时调用者执行推理后调用 Complete, false 时调用 Wait
+ * @return std::shared_ptr<CoalescedRun>
+ */
+std::shared_ptr<CoalescedRun> RequestCoalescer::Join(tensor_array_t *input_tensor_array,
+                                                     tensor_array_t *output_tensor_array, bool *pLeader)
+{
+    uint64_t nHash = HashTensorArray(input_tensor_array);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto range = m_mapInFlight.equal_range(nHash);
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        CoalescedRun *pRun = it->second.get();
+        if (SameOutputs(pRun->output_tensors, output_tensor_array) &&
+            SameTensorArray(pRun->input_tensors, input_tensor_array))
+        {
+            pRun->nFollowers++;
+            m_nCoalesced++;
+            *pLeader = false;
+            return it->second;
+        }
+    }
+
+    std::shared_ptr<CoalescedRun> pRun = std::make_shared<CoalescedRun>();
+    pRun->nHash = nHash;
+    pRun->input_tensors = input_tensor_array;
+    pRun->output_tensors = output_tensor_array;
+    m_mapInFlight.insert(std::make_pair(nHash, pRun));
+    m_nExecuted++;
+    *pLeader = true;
+    return pRun;
+}
+
+/**
+ * @brief wait for the leader and copy its outputs
+ *
+ * @param pRun  Join 返回的执行
+ * @param output_tensor_array  follower 的输出tensor
+ * @return result_t  the leader's result; on failure nothing is copied
+ */
+result_t RequestCoalescer::Wait(const std::shared_ptr<CoalescedRun> &pRun, tensor_array_t *output_tensor_array)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cvDone.wait(lock, [&pRun]() { return pRun->bDone; });
+
+    // 拷贝时不持锁, leader 在 nFollowers 归零前不会返回, 它的输出不会被改写
+    lock.unlock();
+    if (MY_SUCCESS == pRun->res && pRun->output_tensors != output_tensor_array)
+    {
+        for (int i = 0; i < output_tensor_array->nArraySize; i++)
+        {
+            tensor_t *pSrc = &pRun->output_tensors->pTensorArray[i];
+            tensor_t *pDst = &output_tensor_array->pTensorArray[i];
+            pDst->pTensorInfo->nDims = pSrc->pTensorInfo->nDims;
+            memcpy(pDst->pTensorInfo->pShape, pSrc->pTensorInfo->pShape, sizeof(pDst->pTensorInfo->pShape));
+            pDst->pTensorInfo->nElementSize = pSrc->pTensorInfo->nElementSize;
+            memcpy(pDst->pValue, pSrc->pValue, pSrc->pTensorInfo->nLength);
+        }
+    }
+    lock.lock();
+
+    pRun->nFollowers--;
+    if (pRun->nFollowers == 0)
+    {
+        m_cvDone.notify_all();
+    }
+    return pRun->res;
+}
+
+/**
+ * @brief publish the leader's result and wait until every follower has copied it
+ *
+ * @param pRun  Join 返回的执行
+ * @param res  leader 的推理结果
+ */
+void RequestCoalescer::Complete(const std::shared_ptr<CoalescedRun> &pRun, result_t res)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    auto range = m_mapInFlight.equal_range(pRun->nHash);
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        if (it->second == pRun)
+        {
+            m_mapInFlight.erase(it);
+            break;
+        }
+    }
+
+    pRun->res = res;
+    pRun->bDone = true;
+    m_cvDone.notify_all();
+    m_cvDone.wait(lock, [&pRun]() { return pRun->nFollowers == 0; });
+}
+
+/**
+ * @brief runs executed and requests served by another request's run
+ *
+ * @param pExecuted  实际执行的次数
+ * @param pCoalesced  合并到其它请求的次数
+ */
+void RequestCoalescer::GetStats(long long *pExecuted, long long *pCoalesced)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    *pExecuted = m_nExecuted;
+    *pCoalesced = m_nCoalesced;
+}
+
+bool RequestCoalescer::SameOutputs(const tensor_array_t *pArray1, const tensor_array_t *pArray2)
+{
+    if (pArray1->nArraySize != pArray2->nArraySize)
+    {
+        return false;
+    }
+    for (int i = 0; i < pArray1->nArraySize; i++)
+    {
+        const tensor_params_t *pParam1 = pArray1->pTensorArray[i].pTensorInfo;
+        const tensor_params_t *pParam2 = pArray2->pTensorArray[i].pTensorInfo;
+        if (pParam1->type != pParam2->type || pParam1->nLength != pParam2->nLength ||
+            strncmp(pParam1->aTensorName, pParam2->aTensorName, sizeof(pParam1->aTensorName)) != 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
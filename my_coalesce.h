@@ -0,0 +1,46 @@
+#ifndef MY_INFERENCE_ONNX_MY_COALESCE_H
+#define MY_INFERENCE_ONNX_MY_COALESCE_H
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include "common.h"
+
+// 一次被合并的执行: 第一个请求(leader)执行, 输入相同的并发请求(follower)等待后拷贝 leader 的输出
+struct CoalescedRun
+{
+    CoalescedRun() : nHash(0), input_tensors(NULL), output_tensors(NULL), res(MY_SUCCESS), bDone(false),
+                     nFollowers(0) {}
+
+    uint64_t nHash;
+    tensor_array_t *input_tensors;  // leader 的tensor, 所有 follower 拷贝完之前有效
+    tensor_array_t *output_tensors;
+    result_t res;
+    bool bDone;
+    int nFollowers; // 还没拷贝完输出的 follower
+};
+
+// 同一模型句柄上输入逐字节相同的并发请求只执行一次
+class RequestCoalescer
+{
+public:
+    RequestCoalescer() : m_nExecuted(0), m_nCoalesced(0) {}
+    std::shared_ptr<CoalescedRun> Join(tensor_array_t *input_tensor_array, tensor_array_t *output_tensor_array,
+                                       bool *pLeader);
+    result_t Wait(const std::shared_ptr<CoalescedRun> &pRun, tensor_array_t *output_tensor_array);
+    void Complete(const std::shared_ptr<CoalescedRun> &pRun, result_t res);
+    void GetStats(long long *pExecuted, long long *pCoalesced);
+
+private:
+    static bool SameOutputs(const tensor_array_t *pArray1, const tensor_array_t *pArray2);
+
+private:
+    std::multimap<uint64_t, std::shared_ptr<CoalescedRun>> m_mapInFlight;
+    std::mutex m_mutex;
+    std::condition_variable m_cvDone;
+    long long m_nExecuted;
+    long long m_nCoalesced;
+};
+
+#endif //MY_INFERENCE_ONNX_MY_COALESCE_H
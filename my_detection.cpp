@@ -0,0 +1,147 @@
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include "my_preprocess.h"
+#include "my_onnx_inference.h"
+#include "my_detection.h"
+
+/**
+ * @brief undo the preprocessing transform: x_src = (x_tensor - fPadX) / fScaleX
+ *
+ * @param pLetterbox  预处理时记录的变换
+ * @param pDetection  检测框, 原地修改
+ */
+void MapDetectionToSource(const letterbox_info_t *pLetterbox, detection_t *pDetection)
+{
+    float fMaxX = (float)pLetterbox->nSrcWidth, fMaxY = (float)pLetterbox->nSrcHeight;
+    pDetection->x1 = std::min(fMaxX, std::max(0.0f, (pDetection->x1 - pLetterbox->fPadX) / pLetterbox->fScaleX));
+    pDetection->x2 = std::min(fMaxX, std::max(0.0f, (pDetection->x2 - pLetterbox->fPadX) / pLetterbox->fScaleX));
+    pDetection->y1 = std::min(fMaxY, std::max(0.0f, (pDetection->y1 - pLetterbox->fPadY) / pLetterbox->fScaleY));
+    pDetection->y2 = std::min(fMaxY, std::max(0.0f, (pDetection->y2 - pLetterbox->fPadY) / pLetterbox->fScaleY));
+}
+
+/**
+ * @brief name of the output decoded by the NMS postprocess
+ *
+ */
+static const char *FindNmsOutputName(const model_params_t *pParams)
+{
+    for (int i = 0; i < pParams->nPostprocess && i < 8; i++)
+    {
+        if (POSTPROCESS_NMS == pParams->aPostprocess[i].type)
+        {
+            return pParams->aPostprocess[i].aTensorName;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief end-to-end detection on the handle's own tensors: letterbox every frame into its batch slot of the
+ *        preallocated input tensor, run, let the NMS postprocess decode the boxes, then map them back to
+ *        source coordinates. Frames may have different sizes; more frames than the batch size are run in
+ *        chunks, and a partial chunk shrinks the batch when the model's batch dimension is symbolic.
+ *        Calls on the same handle must not overlap, like my_preprocess_image + my_inference_tensors.
+ *
+ * @param pOnnxHdl  模型, 需要启用 preprocess_params 并为某个输出配置 POSTPROCESS_NMS
+ * @param pImages  图像
+ * @param nImages  图像个数
+ * @param pDetections  [nImages, nMaxPerImage] 个检测结果
+ * @param nMaxPerImage  每张图最多返回的框数
+ * @param pCounts  每张图的框数
+ * @return result_t
+ */
+result_t DetectImages(OnnxRuntimeModelHandle *pOnnxHdl, const image_t *pImages, int nImages,
+                      detection_t *pDetections, int nMaxPerImage, int *pCounts)
+{
+    MY_CHECK_NULL(pOnnxHdl, MY_PARAM_NULL);
+    MY_CHECK_NULL(pImages, MY_PARAM_NULL);
+    MY_CHECK_NULL(pDetections, MY_PARAM_NULL);
+    MY_CHECK_NULL(pCounts, MY_PARAM_NULL);
+
+    const model_params_t *pParams = pOnnxHdl->get_model_param();
+    ImagePreprocessor *pPreprocessor = pOnnxHdl->get_preprocessor();
+    tensor_array_t *input_tensors = pOnnxHdl->get_input_tensor_array();
+    tensor_array_t *output_tensors = pOnnxHdl->get_output_tensor_array();
+    MY_CHECK_NULL(pPreprocessor, MY_PARAM_SET_ERROR);
+    MY_CHECK_NULL(input_tensors, MY_PARAM_NULL);
+    MY_CHECK_NULL(output_tensors, MY_PARAM_NULL);
+
+    const char *pNmsName = FindNmsOutputName(pParams);
+    tensor_t *pBoxTensor = NULL;
+    for (int i = 0; pNmsName && i < output_tensors->nArraySize; i++)
+    {
+        if (0 == strcmp(output_tensors->pTensorArray[i].pTensorInfo->aTensorName, pNmsName))
+        {
+            pBoxTensor = &output_tensors->pTensorArray[i];
+        }
+    }
+    int nInputIndex = pParams->preprocess_params.nInputIndex;
+    if (NULL == pBoxTensor || nInputIndex < 0 || nInputIndex >= input_tensors->nArraySize || nMaxPerImage <= 0)
+    {
+        MY_ERROR("detection needs an image input and an output with POSTPROCESS_NMS\n");
+        return MY_PARAM_SET_ERROR;
+    }
+
+    tensor_t *pImageTensor = &input_tensors->pTensorArray[nInputIndex];
+    int nBatch = pImageTensor->pTensorInfo->pShape[0];
+    bool bDynamicBatch = pOnnxHdl->is_dynamic_input_dim(nInputIndex, 0);
+    if (nBatch <= 0)
+    {
+        MY_ERROR("detection input batch must be > 0, got %d\n", nBatch);
+        return MY_PARAM_SET_ERROR;
+    }
+
+    // 后处理会改写输出shape, 每个chunk结束后恢复, 保证下一次的容量
+    tensor_params_t tBoxParam = *pBoxTensor->pTensorInfo;
+    std::vector<letterbox_info_t> vecLetterbox(nBatch);
+    result_t res = MY_SUCCESS;
+
+    for (int nStart = 0; nStart < nImages && MY_SUCCESS == res; nStart += nBatch)
+    {
+        int nChunk = std::min(nBatch, nImages - nStart);
+        for (int b = 0; b < nChunk && MY_SUCCESS == res; b++)
+        {
+            const image_t *pImage = &pImages[nStart + b];
+            res = pPreprocessor->Process(pImage->pData, pImage->nWidth, pImage->nHeight, pImage->nStride,
+                                         pImage->format, pImageTensor, b, &vecLetterbox[b]);
+        }
+        if (MY_SUCCESS != res)
+        {
+            break;
+        }
+
+        if (bDynamicBatch)
+        {
+            pImageTensor->pTensorInfo->pShape[0] = nChunk;
+        }
+        res = pOnnxHdl->my_onnxruntime_inference_tensors();
+        pImageTensor->pTensorInfo->pShape[0] = nBatch;
+
+        const tensor_params_t *pBoxParam = pBoxTensor->pTensorInfo;
+        int nRows = pBoxParam->pShape[1];
+        for (int b = 0; b < nChunk && MY_SUCCESS == res; b++)
+        {
+            const float *pRow = (const float *)pBoxTensor->pValue + (size_t)b * nRows * 6;
+            detection_t *pOut = pDetections + (size_t)(nStart + b) * nMaxPerImage;
+            int nCount = 0;
+
+            // NMS 的结果按 score 排序, class 为 -1 的是补齐行
+            for (int r = 0; r < nRows && nCount < nMaxPerImage && pRow[5] >= 0; r++, pRow += 6)
+            {
+                detection_t *pDetection = &pOut[nCount++];
+                pDetection->x1 = pRow[0];
+                pDetection->y1 = pRow[1];
+                pDetection->x2 = pRow[2];
+                pDetection->y2 = pRow[3];
+                pDetection->score = pRow[4];
+                pDetection->nClass = (int)pRow[5];
+                MapDetectionToSource(&vecLetterbox[b], pDetection);
+            }
+            pCounts[nStart + b] = nCount;
+        }
+        *pBoxTensor->pTensorInfo = tBoxParam;
+    }
+
+    return res;
+}
@@ -0,0 +1,13 @@
+#ifndef MY_INFERENCE_ONNX_MY_DETECTION_H
+#define MY_INFERENCE_ONNX_MY_DETECTION_H
+#include "common.h"
+
+class OnnxRuntimeModelHandle;
+
+// 检测框从 tensor 坐标映射回源图像坐标, 并裁剪到图像范围内
+void MapDetectionToSource(const letterbox_info_t *pLetterbox, detection_t *pDetection);
+
+result_t DetectImages(OnnxRuntimeModelHandle *pOnnxHdl, const image_t *pImages, int nImages,
+                      detection_t *pDetections, int nMaxPerImage, int *pCounts);
+
+#endif //MY_INFERENCE_ONNX_MY_DETECTION_H
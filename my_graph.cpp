@@ -0,0 +1,692 @@
+#include "my_graph.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "my_onnx_inference.h"
+
+#define CROP_INPUT_IMAGE "image"
+#define CROP_INPUT_BOXES "boxes"
+#define CROP_OUTPUT "crops"
+
+static const OrtApi *g_pOrt = OrtGetApiBase()->GetApi(ORT_API_VERSION);
+
+/**
+ * @brief dims and data of a float tensor
+ *
+ * @param pValue  onnxruntime tensor
+ * @param vecDims  shape
+ * @param ppData  数据
+ * @return bool  false if the value is not a float tensor
+ */
+static bool GetFloatTensor(OrtValue *pValue, std::vector<int64_t> &vecDims, float **ppData)
+{
+    OrtTensorTypeAndShapeInfo *shape_info;
+    OrtStatus *status = g_pOrt->GetTensorTypeAndShape(pValue, &shape_info);
+    if (status != NULL)
+    {
+        g_pOrt->ReleaseStatus(status);
+        return false;
+    }
+    ONNXTensorElementDataType type = ONNX_TENSOR_ELEMENT_DATA_TYPE_UNDEFINED;
+    size_t num_dims = 0;
+    status = g_pOrt->GetTensorElementType(shape_info, &type);
+    if (status == NULL)
+    {
+        status = g_pOrt->GetDimensionsCount(shape_info, &num_dims);
+    }
+    if (status == NULL)
+    {
+        vecDims.resize(num_dims);
+        status = g_pOrt->GetDimensions(shape_info, vecDims.data(), num_dims);
+    }
+    g_pOrt->ReleaseTensorTypeAndShapeInfo(shape_info);
+
+    if (status == NULL && ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT == type)
+    {
+        status = g_pOrt->GetTensorMutableData(pValue, (void **)ppData);
+        if (status == NULL)
+        {
+            return true;
+        }
+    }
+    if (status != NULL)
+    {
+        g_pOrt->ReleaseStatus(status);
+    }
+    return false;
+}
+
+/**
+ * @brief source positions and weights of bilinear sampling along one axis, pixel centers aligned
+ *
+ * @param fStart  框起点(像素)
+ * @param fLength  框长度(像素)
+ * @param nSrcLen  原图长度
+ * @param nDstLen  输出长度
+ * @param vecIndex  每个输出位置左/上侧的原图位置
+ * @param vecNext  右/下侧的原图位置, 已截断到图内
+ * @param vecWeight  右/下侧的权重
+ */
+static void BilinearAxis(float fStart, float fLength, int nSrcLen, int nDstLen, std::vector<int> &vecIndex,
+                         std::vector<int> &vecNext, std::vector<float> &vecWeight)
+{
+    vecIndex.resize(nDstLen);
+    vecNext.resize(nDstLen);
+    vecWeight.resize(nDstLen);
+    float fScale = fLength / nDstLen;
+    for (int i = 0; i < nDstLen; i++)
+    {
+        float fPos = fStart + (i + 0.5f) * fScale - 0.5f;
+        fPos = std::min(std::max(fPos, 0.0f), (float)(nSrcLen - 1));
+        int nIndex = (int)fPos;
+        vecIndex[i] = nIndex;
+        vecNext[i] = std::min(nIndex + 1, nSrcLen - 1);
+        vecWeight[i] = fPos - nIndex;
+    }
+}
+
+/**
+ * @brief add a model node, the model handle must outlive the graph
+ *
+ * @param pcNode  节点名, 不能含 '/'
+ * @param pOnnxHdl  模型句柄
+ * @return result_t
+ */
+result_t ModelGraph::AddModel(const char *pcNode, OnnxRuntimeModelHandle *pOnnxHdl)
+{
+    MY_CHECK_NULL(pOnnxHdl, MY_PARAM_NULL);
+    return AddNode(pcNode, pOnnxHdl, NULL);
+}
+
+/**
+ * @brief add a crop/resize node with inputs "image" and "boxes" and output "crops"
+ *
+ * @param pcNode  节点名, 不能含 '/'
+ * @param pParams  裁剪缩放参数
+ * @return result_t
+ */
+result_t ModelGraph::AddCropResize(const char *pcNode, const crop_resize_params_t *pParams)
+{
+    MY_CHECK_NULL(pParams, MY_PARAM_NULL);
+    if (pParams->nOutWidth <= 0 || pParams->nOutHeight <= 0)
+    {
+        MY_ERROR("crop_resize %s: output size must be > 0\n", pcNode ? pcNode : "");
+        return MY_PARAM_SET_ERROR;
+    }
+    return AddNode(pcNode, NULL, pParams);
+}
+
+result_t ModelGraph::AddNode(const char *pcNode, OnnxRuntimeModelHandle *pOnnxHdl,
+                             const crop_resize_params_t *pParams)
+{
+    MY_CHECK_NULL(pcNode, MY_PARAM_NULL);
+    if (pcNode[0] == '\0' || strchr(pcNode, '/') != NULL)
+    {
+        MY_ERROR("graph node name \"%s\" must be non-empty and without '/'\n", pcNode);
+        return MY_PARAM_SET_ERROR;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_bSorted)
+    {
+        MY_ERROR("graph can't be changed after the first run\n");
+        return MY_PARAM_SET_ERROR;
+    }
+    if (FindNode(pcNode) >= 0)
+    {
+        MY_ERROR("graph node %s already exists\n", pcNode);
+        return MY_PARAM_SET_ERROR;
+    }
+
+    GraphNode node;
+    node.strName = pcNode;
+    node.pOnnxHdl = pOnnxHdl;
+    memset(&node.tCropParams, 0, sizeof(node.tCropParams));
+    if (pParams)
+    {
+        memcpy(&node.tCropParams, pParams, sizeof(crop_resize_params_t));
+    }
+    m_vecNodes.push_back(node);
+    return MY_SUCCESS;
+}
+
+/**
+ * @brief feed an output of one node, or an input of the graph, to an input of another node
+ *
+ * @param pcSrcNode  产生值的节点名, 为NULL或空串时 pcSrcOutput 是图输入, 按名字从调用者的输入tensor取
+ * @param pcSrcOutput  输出名
+ * @param pcDstNode  使用值的节点名
+ * @param pcDstInput  输入名, 每个输入只能连接一次
+ * @return result_t
+ */
+result_t ModelGraph::Connect(const char *pcSrcNode, const char *pcSrcOutput, const char *pcDstNode,
+                             const char *pcDstInput)
+{
+    MY_CHECK_NULL(pcSrcOutput, MY_PARAM_NULL);
+    MY_CHECK_NULL(pcDstNode, MY_PARAM_NULL);
+    MY_CHECK_NULL(pcDstInput, MY_PARAM_NULL);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_bSorted)
+    {
+        MY_ERROR("graph can't be changed after the first run\n");
+        return MY_PARAM_SET_ERROR;
+    }
+    int nSrc = -1;
+    if (pcSrcNode != NULL && pcSrcNode[0] != '\0')
+    {
+        nSrc = FindNode(pcSrcNode);
+        if (nSrc < 0 || !HasPort(nSrc, pcSrcOutput, false))
+        {
+            MY_ERROR("graph has no output %s/%s\n", pcSrcNode, pcSrcOutput);
+            return MY_PARAM_SET_ERROR;
+        }
+    }
+
+    int nDst = FindNode(pcDstNode);
+    if (nDst < 0 || !HasPort(nDst, pcDstInput, true) || nDst == nSrc)
+    {
+        MY_ERROR("graph can't connect to input %s/%s\n", pcDstNode, pcDstInput);
+        return MY_PARAM_SET_ERROR;
+    }
+
+    GraphNode &node = m_vecNodes[nDst];
+    if (std::find(node.vecInputNames.begin(), node.vecInputNames.end(), pcDstInput) != node.vecInputNames.end())
+    {
+        MY_ERROR("graph input %s/%s is already connected\n", pcDstNode, pcDstInput);
+        return MY_PARAM_SET_ERROR;
+    }
+    node.vecInputNames.push_back(pcDstInput);
+    node.vecSources.push_back(ValueKey(nSrc, pcSrcOutput));
+    return MY_SUCCESS;
+}
+
+/**
+ * @brief run the graph once. Outputs are the caller's output tensors named "node/output"; an output whose
+ *        node was skipped because a crop found no boxes gets shape[0] = 0 and nElementSize = 0.
+ *        The first run sorts and freezes the graph, so the node tables are read without the lock afterwards.
+ *
+ * @param input_tensor_array  图输入, 按名字与 Connect 的图输入对应
+ * @param output_tensor_array  图输出
+ * @return result_t
+ */
+result_t ModelGraph::Run(tensor_array_t *input_tensor_array, tensor_array_t *output_tensor_array)
+{
+    MY_CHECK_NULL(input_tensor_array, MY_PARAM_NULL);
+    MY_CHECK_NULL(output_tensor_array, MY_PARAM_NULL);
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_bSorted)
+        {
+            result_t res = SortNodes();
+            if (MY_SUCCESS != res)
+            {
+                return res;
+            }
+        }
+    }
+
+    // 每个节点要产生的输出: 下游连接的和调用者要的, 其它输出不取出
+    std::vector<std::vector<std::string>> vecNodeOutputs(m_vecNodes.size());
+    auto AddOutput = [&vecNodeOutputs](const ValueKey &key) {
+        std::vector<std::string> &vecOutputs = vecNodeOutputs[key.first];
+        if (std::find(vecOutputs.begin(), vecOutputs.end(), key.second) == vecOutputs.end())
+        {
+            vecOutputs.push_back(key.second);
+        }
+    };
+    for (size_t i = 0; i < m_vecNodes.size(); i++)
+    {
+        for (size_t j = 0; j < m_vecNodes[i].vecSources.size(); j++)
+        {
+            if (m_vecNodes[i].vecSources[j].first >= 0)
+            {
+                AddOutput(m_vecNodes[i].vecSources[j]);
+            }
+        }
+    }
+
+    std::vector<ValueKey> vecGraphOutputs;
+    for (int i = 0; i < output_tensor_array->nArraySize; i++)
+    {
+        const char *pcName = output_tensor_array->pTensorArray[i].pTensorInfo->aTensorName;
+        const char *pcSlash = strchr(pcName, '/');
+        int nNode = pcSlash ? FindNode(std::string(pcName, pcSlash - pcName).c_str()) : -1;
+        if (nNode < 0 || !HasPort(nNode, pcSlash + 1, false))
+        {
+            MY_ERROR("graph output %s should be \"node/output\" of an existing node\n", pcName);
+            return MY_PARAM_SET_ERROR;
+        }
+        vecGraphOutputs.push_back(ValueKey(nNode, pcSlash + 1));
+        AddOutput(vecGraphOutputs.back());
+    }
+
+    // 图输入直接包装调用者的内存
+    ValueMap mapValues;
+    result_t res = MY_SUCCESS;
+    for (size_t i = 0; i < m_vecNodes.size() && MY_SUCCESS == res; i++)
+    {
+        for (size_t j = 0; j < m_vecNodes[i].vecSources.size() && MY_SUCCESS == res; j++)
+        {
+            const ValueKey &key = m_vecNodes[i].vecSources[j];
+            if (key.first >= 0 || mapValues.count(key))
+            {
+                continue;
+            }
+            int k = 0;
+            while (k < input_tensor_array->nArraySize &&
+                   key.second != input_tensor_array->pTensorArray[k].pTensorInfo->aTensorName)
+            {
+                k++;
+            }
+            if (k == input_tensor_array->nArraySize)
+            {
+                MY_ERROR("graph input %s is not given\n", key.second.c_str());
+                res = MY_PARAM_SET_ERROR;
+                break;
+            }
+            OrtValue *pValue = nullptr;
+            res = OnnxRuntimeModelHandle::WrapTensorValue(&input_tensor_array->pTensorArray[k], &pValue);
+            if (MY_SUCCESS == res)
+            {
+                mapValues[key] = pValue;
+            }
+        }
+    }
+
+    // 逐层执行, 调用线程执行每层最后一个节点, 其余交给工作线程; 只有一个节点的层不经过工作线程
+    std::mutex values_mutex;
+    for (size_t l = 0; l < m_vecLevels.size() && MY_SUCCESS == res; l++)
+    {
+        const std::vector<int> &vecLevel = m_vecLevels[l];
+        std::vector<result_t> vecResults(vecLevel.size(), MY_SUCCESS);
+        size_t nPending = vecLevel.size() - 1;
+        if (nPending > 0)
+        {
+            std::lock_guard<std::mutex> lock(m_task_mutex);
+            for (size_t i = 0; i < nPending; i++)
+            {
+                m_queTasks.push_back([&, i]() {
+                    result_t nodeRes = RunNode(vecLevel[i], vecNodeOutputs[vecLevel[i]], mapValues, values_mutex);
+                    std::lock_guard<std::mutex> task_lock(m_task_mutex);
+                    vecResults[i] = nodeRes;
+                    if (--nPending == 0)
+                    {
+                        m_cvTaskDone.notify_all();
+                    }
+                });
+            }
+            m_cvTask.notify_all();
+        }
+        vecResults.back() = RunNode(vecLevel.back(), vecNodeOutputs[vecLevel.back()], mapValues, values_mutex);
+        {
+            std::unique_lock<std::mutex> lock(m_task_mutex);
+            m_cvTaskDone.wait(lock, [&nPending]() { return nPending == 0; });
+        }
+        for (size_t i = 0; i < vecResults.size() && MY_SUCCESS == res; i++)
+        {
+            res = vecResults[i];
+        }
+    }
+
+    // 唯一的一次拷贝
+    for (int i = 0; i < output_tensor_array->nArraySize && MY_SUCCESS == res; i++)
+    {
+        tensor_t *pTensor = &output_tensor_array->pTensorArray[i];
+        auto it = mapValues.find(vecGraphOutputs[i]);
+        if (it != mapValues.end())
+        {
+            res = OnnxRuntimeModelHandle::CopyValueToTensor(it->second, pTensor);
+        }
+        else
+        {
+            pTensor->pTensorInfo->nDims = std::max(pTensor->pTensorInfo->nDims, 1);
+            pTensor->pTensorInfo->pShape[0] = 0;
+            pTensor->pTensorInfo->nElementSize = 0;
+        }
+    }
+
+    for (auto &value : mapValues)
+    {
+        g_pOrt->ReleaseValue(value.second);
+    }
+    return res;
+}
+
+/**
+ * @brief run one node on the values produced so far. A node whose input was not produced (a crop without
+ *        boxes upstream) or whose outputs nobody uses is skipped.
+ *
+ * @param nNode  节点序号
+ * @param vecOutputs  要产生的输出
+ * @param mapValues  已产生的值, 本节点的输出也放入其中
+ * @param values_mutex  保护 mapValues
+ * @return result_t
+ */
+result_t ModelGraph::RunNode(int nNode, const std::vector<std::string> &vecOutputs, ValueMap &mapValues,
+                             std::mutex &values_mutex)
+{
+    const GraphNode &node = m_vecNodes[nNode];
+    if (vecOutputs.empty())
+    {
+        return MY_SUCCESS;
+    }
+
+    std::vector<OrtValue *> vecInputs;
+    {
+        std::lock_guard<std::mutex> lock(values_mutex);
+        for (size_t i = 0; i < node.vecSources.size(); i++)
+        {
+            auto it = mapValues.find(node.vecSources[i]);
+            if (it == mapValues.end())
+            {
+                return MY_SUCCESS;
+            }
+            vecInputs.push_back(it->second);
+        }
+    }
+
+    std::vector<const char *> vecOutputNames;
+    std::vector<OrtValue *> vecOutputValues;
+    result_t res = MY_SUCCESS;
+    if (node.pOnnxHdl)
+    {
+        std::vector<const char *> vecInputNames;
+        for (size_t i = 0; i < node.vecInputNames.size(); i++)
+        {
+            vecInputNames.push_back(node.vecInputNames[i].c_str());
+        }
+        for (size_t i = 0; i < vecOutputs.size(); i++)
+        {
+            vecOutputNames.push_back(vecOutputs[i].c_str());
+        }
+        res = node.pOnnxHdl->my_onnxruntime_run_values(vecInputNames, vecInputs, vecOutputNames, vecOutputValues);
+    }
+    else
+    {
+        OrtValue *pImage = NULL, *pBoxes = NULL;
+        for (size_t i = 0; i < node.vecInputNames.size(); i++)
+        {
+            (node.vecInputNames[i] == CROP_INPUT_IMAGE ? pImage : pBoxes) = vecInputs[i];
+        }
+        if (pImage == NULL || pBoxes == NULL)
+        {
+            MY_ERROR("crop_resize %s needs both \"image\" and \"boxes\" connected\n", node.strName.c_str());
+            return MY_PARAM_SET_ERROR;
+        }
+
+        OrtValue *pCrops = NULL;
+        res = CropResize(&node.tCropParams, pImage, pBoxes, &pCrops);
+        if (pCrops != NULL)
+        {
+            vecOutputNames.push_back(CROP_OUTPUT);
+            vecOutputValues.push_back(pCrops);
+        }
+    }
+    if (MY_SUCCESS != res)
+    {
+        MY_ERROR("graph node %s failed\n", node.strName.c_str());
+        return res;
+    }
+
+    std::lock_guard<std::mutex> lock(values_mutex);
+    for (size_t i = 0; i < vecOutputValues.size(); i++)
+    {
+        mapValues[ValueKey(nNode, vecOutputNames[i])] = vecOutputValues[i];
+    }
+    return MY_SUCCESS;
+}
+
+/**
+ * @brief crop the boxes out of the first image of the batch and resize each to the output size
+ *
+ * @param pParams  裁剪缩放参数
+ * @param pImage  float [N,C,H,W]
+ * @param pBoxes  float [...,K]
+ * @param ppCrops  [M,C,nOutHeight,nOutWidth], 没有框时为 NULL
+ * @return result_t
+ */
+result_t ModelGraph::CropResize(const crop_resize_params_t *pParams, OrtValue *pImage, OrtValue *pBoxes,
+                                OrtValue **ppCrops)
+{
+    *ppCrops = NULL;
+    std::vector<int64_t> vecImageDims, vecBoxDims;
+    float *pImageData, *pBoxData;
+    if (!GetFloatTensor(pImage, vecImageDims, &pImageData) || vecImageDims.size() != 4 || vecImageDims[0] < 1 ||
+        !GetFloatTensor(pBoxes, vecBoxDims, &pBoxData) || vecBoxDims.empty() || vecBoxDims.back() < 4)
+    {
+        MY_ERROR("crop_resize needs a float [N,C,H,W] image and float [...,K>=4] boxes\n");
+        return MY_PARAM_SET_ERROR;
+    }
+
+    int nChannels = (int)vecImageDims[1];
+    int nHeight = (int)vecImageDims[2];
+    int nWidth = (int)vecImageDims[3];
+    int64_t nCols = vecBoxDims.back();
+    int64_t nRows = 1;
+    for (size_t i = 0; i + 1 < vecBoxDims.size(); i++)
+    {
+        nRows *= vecBoxDims[i];
+    }
+
+    std::vector<float> vecRects; // 每个框 x1,y1,x2,y2, 像素坐标
+    for (int64_t r = 0; r < nRows; r++)
+    {
+        const float *pRow = pBoxData + r * nCols;
+        if (pParams->nScoreIndex >= 0 && pParams->nScoreIndex < nCols &&
+            pRow[pParams->nScoreIndex] < pParams->fMinScore)
+        {
+            continue;
+        }
+        float fScaleX = pParams->bNormalized ? (float)nWidth : 1.0f;
+        float fScaleY = pParams->bNormalized ? (float)nHeight : 1.0f;
+        float x1 = std::max(pRow[0] * fScaleX, 0.0f);
+        float y1 = std::max(pRow[1] * fScaleY, 0.0f);
+        float x2 = std::min(pRow[2] * fScaleX, (float)nWidth);
+        float y2 = std::min(pRow[3] * fScaleY, (float)nHeight);
+        if (!(x2 > x1 && y2 > y1))
+        {
+            continue;
+        }
+        float aRect[4] = {x1, y1, x2, y2};
+        vecRects.insert(vecRects.end(), aRect, aRect + 4);
+        if (pParams->nMaxBoxes > 0 && (int)vecRects.size() / 4 >= pParams->nMaxBoxes)
+        {
+            break;
+        }
+    }
+    int64_t nBoxes = (int64_t)vecRects.size() / 4;
+    if (nBoxes == 0)
+    {
+        return MY_SUCCESS;
+    }
+
+    OrtAllocator *allocator;
+    result_t res = OnnxRuntimeModelHandle::ReportStatus(g_pOrt->GetAllocatorWithDefaultOptions(&allocator));
+    if (MY_SUCCESS != res)
+    {
+        return res;
+    }
+    int64_t aDims[4] = {nBoxes, nChannels, pParams->nOutHeight, pParams->nOutWidth};
+    OrtStatus *status = g_pOrt->CreateTensorAsOrtValue(allocator, aDims, 4, ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT,
+                                                       ppCrops);
+    if (status != NULL)
+    {
+        MY_ERROR("crop_resize: %s\n", g_pOrt->GetErrorMessage(status));
+        g_pOrt->ReleaseStatus(status);
+        *ppCrops = NULL;
+        return MY_FAILED;
+    }
+    float *pDst;
+    res = OnnxRuntimeModelHandle::ReportStatus(g_pOrt->GetTensorMutableData(*ppCrops, (void **)&pDst));
+    if (MY_SUCCESS != res)
+    {
+        g_pOrt->ReleaseValue(*ppCrops);
+        *ppCrops = NULL;
+        return res;
+    }
+
+    std::vector<int> vecX0, vecX1, vecY0, vecY1;
+    std::vector<float> vecWx, vecWy;
+    size_t nPlane = (size_t)nHeight * nWidth;
+    for (int64_t m = 0; m < nBoxes; m++)
+    {
+        const float *pRect = &vecRects[m * 4];
+        BilinearAxis(pRect[0], pRect[2] - pRect[0], nWidth, pParams->nOutWidth, vecX0, vecX1, vecWx);
+        BilinearAxis(pRect[1], pRect[3] - pRect[1], nHeight, pParams->nOutHeight, vecY0, vecY1, vecWy);
+        for (int c = 0; c < nChannels; c++)
+        {
+            const float *pSrc = pImageData + c * nPlane;
+            for (int oy = 0; oy < pParams->nOutHeight; oy++)
+            {
+                const float *pRow0 = pSrc + (size_t)vecY0[oy] * nWidth;
+                const float *pRow1 = pSrc + (size_t)vecY1[oy] * nWidth;
+                float wy = vecWy[oy];
+                for (int ox = 0; ox < pParams->nOutWidth; ox++)
+                {
+                    float fTop = pRow0[vecX0[ox]] + (pRow0[vecX1[ox]] - pRow0[vecX0[ox]]) * vecWx[ox];
+                    float fBottom = pRow1[vecX0[ox]] + (pRow1[vecX1[ox]] - pRow1[vecX0[ox]]) * vecWx[ox];
+                    *pDst++ = fTop + (fBottom - fTop) * wy;
+                }
+            }
+        }
+    }
+    return MY_SUCCESS;
+}
+
+/**
+ * @brief group the nodes into levels: a node is one level after the deepest node it takes a value from
+ *
+ * @return result_t  MY_PARAM_SET_ERROR if the connections form a cycle
+ */
+result_t ModelGraph::SortNodes()
+{
+    std::vector<int> vecLevel(m_vecNodes.size(), -1);
+    size_t nPlaced = 0;
+    bool bProgress = true;
+    while (nPlaced < m_vecNodes.size() && bProgress)
+    {
+        bProgress = false;
+        for (size_t i = 0; i < m_vecNodes.size(); i++)
+        {
+            if (vecLevel[i] >= 0)
+            {
+                continue;
+            }
+            int nLevel = 0;
+            bool bReady = true;
+            for (size_t j = 0; j < m_vecNodes[i].vecSources.size() && bReady; j++)
+            {
+                int nSrc = m_vecNodes[i].vecSources[j].first;
+                if (nSrc >= 0)
+                {
+                    bReady = vecLevel[nSrc] >= 0;
+                    nLevel = std::max(nLevel, vecLevel[nSrc] + 1);
+                }
+            }
+            if (bReady)
+            {
+                vecLevel[i] = nLevel;
+                nPlaced++;
+                bProgress = true;
+            }
+        }
+    }
+    if (nPlaced < m_vecNodes.size())
+    {
+        MY_ERROR("graph connections form a cycle\n");
+        return MY_PARAM_SET_ERROR;
+    }
+
+    m_vecLevels.clear();
+    for (size_t i = 0; i < m_vecNodes.size(); i++)
+    {
+        if ((size_t)vecLevel[i] >= m_vecLevels.size())
+        {
+            m_vecLevels.resize(vecLevel[i] + 1);
+        }
+        m_vecLevels[vecLevel[i]].push_back((int)i);
+    }
+
+    size_t nMaxWidth = 0;
+    for (size_t l = 0; l < m_vecLevels.size(); l++)
+    {
+        nMaxWidth = std::max(nMaxWidth, m_vecLevels[l].size());
+    }
+    for (size_t i = 1; i < nMaxWidth; i++)
+    {
+        m_vecWorkers.push_back(std::thread(&ModelGraph::WorkerLoop, this));
+    }
+    m_bSorted = true;
+    return MY_SUCCESS;
+}
+
+ModelGraph::~ModelGraph()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_task_mutex);
+        m_bStop = true;
+    }
+    m_cvTask.notify_all();
+    for (size_t i = 0; i < m_vecWorkers.size(); i++)
+    {
+        m_vecWorkers[i].join();
+    }
+}
+
+/**
+ * @brief run the nodes queued by Run, the graph's workers live as long as the graph
+ *
+ */
+void ModelGraph::WorkerLoop()
+{
+    while (true)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(m_task_mutex);
+            m_cvTask.wait(lock, [this]() { return m_bStop || !m_queTasks.empty(); });
+            if (m_queTasks.empty())
+            {
+                return;
+            }
+            task = std::move(m_queTasks.front());
+            m_queTasks.pop_front();
+        }
+        task();
+    }
+}
+
+int ModelGraph::FindNode(const char *pcNode) const
+{
+    for (size_t i = 0; i < m_vecNodes.size(); i++)
+    {
+        if (m_vecNodes[i].strName == pcNode)
+        {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+bool ModelGraph::HasPort(int nNode, const char *pcName, bool bInput) const
+{
+    const GraphNode &node = m_vecNodes[nNode];
+    if (node.pOnnxHdl == NULL)
+    {
+        return bInput ? (strcmp(pcName, CROP_INPUT_IMAGE) == 0 || strcmp(pcName, CROP_INPUT_BOXES) == 0)
+                      : strcmp(pcName, CROP_OUTPUT) == 0;
+    }
+    const std::vector<const char *> &vecNames = bInput ? node.pOnnxHdl->get_input_names()
+                                                       : node.pOnnxHdl->get_output_names();
+    for (size_t i = 0; i < vecNames.size(); i++)
+    {
+        if (strcmp(vecNames[i], pcName) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
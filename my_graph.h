@@ -0,0 +1,68 @@
+#ifndef MY_INFERENCE_ONNX_MY_GRAPH_H
+#define MY_INFERENCE_ONNX_MY_GRAPH_H
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "common.h"
+#include "onnxruntime/onnxruntime_c_api.h"
+
+class OnnxRuntimeModelHandle;
+
+// 多个模型按输入/输出名连成的有向无环图, 节点之间直接传递 OrtValue, 不拷贝到 tensor_t
+// 图输入从调用者的输入tensor按名字包装, 图输出是调用者输出tensor名 "节点名/输出名" 指定的值, 只在最后拷贝一次
+// 同一层(依赖都在前面各层)的节点并行执行, 调用线程执行其中一个, 其余交给图自己的工作线程
+// 第一次 Run 后图不能再修改, 可以多线程同时 Run
+class ModelGraph
+{
+public:
+    ModelGraph() : m_bSorted(false), m_bStop(false) {}
+    ~ModelGraph();
+    result_t AddModel(const char *pcNode, OnnxRuntimeModelHandle *pOnnxHdl);
+    result_t AddCropResize(const char *pcNode, const crop_resize_params_t *pParams);
+    result_t Connect(const char *pcSrcNode, const char *pcSrcOutput, const char *pcDstNode, const char *pcDstInput);
+    result_t Run(tensor_array_t *input_tensor_array, tensor_array_t *output_tensor_array);
+
+private:
+    typedef std::pair<int, std::string> ValueKey; // (产生值的节点, 输出名), 图输入的节点为 -1
+    typedef std::map<ValueKey, OrtValue *> ValueMap;
+
+    struct GraphNode
+    {
+        std::string strName;
+        OnnxRuntimeModelHandle *pOnnxHdl; // 为 NULL 时是裁剪缩放节点
+        crop_resize_params_t tCropParams;
+        std::vector<std::string> vecInputNames; // 已连接的输入
+        std::vector<ValueKey> vecSources;       // 与 vecInputNames 一一对应
+    };
+
+    int FindNode(const char *pcNode) const;
+    bool HasPort(int nNode, const char *pcName, bool bInput) const;
+    result_t AddNode(const char *pcNode, OnnxRuntimeModelHandle *pOnnxHdl, const crop_resize_params_t *pParams);
+    result_t SortNodes();
+    void WorkerLoop();
+    result_t RunNode(int nNode, const std::vector<std::string> &vecOutputs, ValueMap &mapValues,
+                     std::mutex &values_mutex);
+    static result_t CropResize(const crop_resize_params_t *pParams, OrtValue *pImage, OrtValue *pBoxes,
+                               OrtValue **ppCrops);
+
+private:
+    std::vector<GraphNode> m_vecNodes;
+    std::vector<std::vector<int>> m_vecLevels; // 拓扑分层, 每层内的节点互不依赖
+    bool m_bSorted; // 第一次 Run 时排序, 之后 AddModel/Connect 返回错误
+    std::mutex m_mutex;
+
+    std::vector<std::thread> m_vecWorkers; // 排序后启动, 个数为最宽一层的节点数 - 1
+    std::deque<std::function<void()>> m_queTasks;
+    bool m_bStop;
+    std::mutex m_task_mutex;
+    std::condition_variable m_cvTask;
+    std::condition_variable m_cvTaskDone; // 某个 Run 的一层节点执行完
+};
+
+#endif //MY_INFERENCE_ONNX_MY_GRAPH_H
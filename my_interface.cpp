@@ -1,7 +1,23 @@
 
 #include "common.h"
+#include "my_interface.h"
 #include "my_memory.h"
 #include "my_onnx_inference.h"
+#include "my_benchmark.h"
+#include "my_preprocess.h"
+#include "my_pipeline.h"
+#include "my_detection.h"
+#include "my_quantize.h"
+#include "my_registry.h"
+#include "my_async.h"
+#include "my_request.h"
+#include "my_admission.h"
+#include "my_sharded.h"
+#include "my_coalesce.h"
+#include "my_cache.h"
+#include "my_graph.h"
+#include "my_cascade.h"
+#include "my_stream.h"
 
 /**
  * @brief  init process
@@ -88,8 +104,19 @@ result_t my_load_model(model_params_t *load_model_param,
     OnnxRuntimeModelHandle *pOnnxHdl = new OnnxRuntimeModelHandle(load_model_param);
     pOnnxHdl->set_input_tensor_array(input_tensors);
     pOnnxHdl->set_output_tensor_array(output_tensors);
+
+    // 加载和warm-up完成后才把句柄交给调用者
+    result_t res = pOnnxHdl->my_onnxruntime_open_model();
+    if (MY_SUCCESS != res)
+    {
+        MY_ERROR("load model %s failed!\n", load_model_param->model_path);
+        pOnnxHdl->my_onnxruntime_release_model();
+        delete pOnnxHdl;
+        load_model_handle->model_handle = NULL;
+        return res;
+    }
+
     load_model_handle->model_handle = pOnnxHdl;
-    pOnnxHdl->my_onnxruntime_open_model();
     return MY_SUCCESS;
 }
 
@@ -110,11 +137,1269 @@ result_t my_release_model(model_handle_t *load_model_handle)
  * @brief  run inference. Results are stored in output_tensors object.
  * 
  * @param load_model_handle  模型句柄
- * @return result_t 
+ * @return result_t  MY_OVERLOADED if admission control rejects the request
  */
 result_t my_inference_tensors(model_handle_t *load_model_handle)
 {
     OnnxRuntimeModelHandle *pOnnxHdl = (OnnxRuntimeModelHandle *)load_model_handle->model_handle;
-    pOnnxHdl->my_onnxruntime_inference_tensors();
+    return pOnnxHdl->my_onnxruntime_inference_tensors();
+}
+
+/**
+ * @brief thread count and queue depth of the executor behind my_inference_tensors_async,
+ *        only before the first asynchronous inference
+ *
+ * @param nThreads  执行线程数, <=0 时为CPU核数
+ * @param nQueueDepth  排队请求的上限, <=0 时为默认值
+ * @return result_t
+ */
+result_t my_executor_config(int nThreads, int nQueueDepth)
+{
+    return InferenceExecutor::Configure(nThreads, nQueueDepth);
+}
+
+/**
+ * @brief queue an inference and return immediately, callback is called on an executor thread when it is done.
+ *        The handle and tensors must stay valid until the callback returns.
+ *
+ * @param load_model_handle  模型句柄
+ * @param input_tensors  输入tensor
+ * @param output_tensors  输出tensor
+ * @param callback  完成回调
+ * @param user_data  传给回调
+ * @return result_t  MY_OVERLOADED if the queue is full; the callback is only called on MY_SUCCESS
+ */
+result_t my_inference_tensors_async(model_handle_t *load_model_handle, tensor_array_t *input_tensors,
+                                    tensor_array_t *output_tensors, inference_callback_t callback,
+                                    void *user_data)
+{
+    MY_CHECK_NULL(load_model_handle, MY_PARAM_NULL);
+    MY_CHECK_NULL(input_tensors, MY_PARAM_NULL);
+    MY_CHECK_NULL(output_tensors, MY_PARAM_NULL);
+
+    InferenceRequest request;
+    request.pOnnxHdl = (OnnxRuntimeModelHandle *)load_model_handle->model_handle;
+    request.input_tensors = input_tensors;
+    request.output_tensors = output_tensors;
+    request.callback = callback;
+    request.user_data = user_data;
+    return InferenceExecutor::GetInstance()->Submit(request);
+}
+
+/**
+ * @brief run inference on the calling thread with a timeout. The run is terminated inside onnxruntime
+ *        when the timeout passes, or when my_cancel_request is called from another thread.
+ *
+ * @param load_model_handle  模型句柄
+ * @param input_tensors  输入tensor
+ * @param output_tensors  输出tensor
+ * @param request_options  请求选项, 可为NULL
+ * @return result_t  MY_DEADLINE_EXCEEDED / MY_CANCELLED if the run was stopped
+ */
+result_t my_inference_tensors_ex(model_handle_t *load_model_handle, tensor_array_t *input_tensors,
+                                 tensor_array_t *output_tensors, const request_options_t *request_options)
+{
+    MY_CHECK_NULL(load_model_handle, MY_PARAM_NULL);
+    MY_CHECK_NULL(input_tensors, MY_PARAM_NULL);
+    MY_CHECK_NULL(output_tensors, MY_PARAM_NULL);
+
+    InferenceRequest request;
+    request.pOnnxHdl = (OnnxRuntimeModelHandle *)load_model_handle->model_handle;
+    request.input_tensors = input_tensors;
+    request.output_tensors = output_tensors;
+    request.callback = NULL;
+    request.user_data = NULL;
+    request.pState = RequestTracker::GetInstance()->Create(request_options);
+    if (!request.pState)
+    {
+        return MY_FAILED;
+    }
+    return RunRequest(request);
+}
+
+/**
+ * @brief my_inference_tensors_async with a deadline, a priority and a tenant, and a request id for
+ *        my_cancel_request. A request still queued at its deadline is dropped without running, a running one
+ *        is terminated; the callback then gets MY_DEADLINE_EXCEEDED or MY_CANCELLED.
+ *
+ * @param load_model_handle  模型句柄
+ * @param input_tensors  输入tensor
+ * @param output_tensors  输出tensor
+ * @param callback  完成回调
+ * @param user_data  传给回调
+ * @param request_options  请求选项, 可为NULL
+ * @param pRequestId  返回请求id, 可为NULL
+ * @return result_t  MY_OVERLOADED if the queue is full; the callback is only called on MY_SUCCESS
+ */
+result_t my_inference_tensors_async_ex(model_handle_t *load_model_handle, tensor_array_t *input_tensors,
+                                       tensor_array_t *output_tensors, inference_callback_t callback,
+                                       void *user_data, const request_options_t *request_options,
+                                       long long *pRequestId)
+{
+    MY_CHECK_NULL(load_model_handle, MY_PARAM_NULL);
+    MY_CHECK_NULL(input_tensors, MY_PARAM_NULL);
+    MY_CHECK_NULL(output_tensors, MY_PARAM_NULL);
+
+    InferenceRequest request;
+    request.pOnnxHdl = (OnnxRuntimeModelHandle *)load_model_handle->model_handle;
+    request.input_tensors = input_tensors;
+    request.output_tensors = output_tensors;
+    request.callback = callback;
+    request.user_data = user_data;
+    if (request_options != NULL)
+    {
+        request.priority = request_options->priority;
+        request.strTenant.assign(request_options->aTenant,
+                                 strnlen(request_options->aTenant, sizeof(request_options->aTenant)));
+    }
+    request.pState = RequestTracker::GetInstance()->Create(request_options);
+    if (!request.pState)
+    {
+        return MY_FAILED;
+    }
+
+    // 先返回id, 回调可能在 Submit 返回前就已执行
+    if (pRequestId != NULL)
+    {
+        *pRequestId = request.pState->nRequestId;
+    }
+    result_t res = InferenceExecutor::GetInstance()->Submit(request);
+    if (MY_SUCCESS != res)
+    {
+        RequestTracker::GetInstance()->Finish(request.pState);
+    }
+    return res;
+}
+
+/**
+ * @brief share of a tenant among the requests of the same priority in the executor.
+ *        Can be called before my_executor_config, it does not start the executor.
+ *
+ * @param pcTenant  租户, 同 request_options_t::aTenant
+ * @param nWeight  权重, 默认1, <=0 时恢复默认
+ * @return result_t
+ */
+result_t my_scheduler_set_tenant_weight(const char *pcTenant, int nWeight)
+{
+    MY_CHECK_NULL(pcTenant, MY_PARAM_NULL);
+    InferenceExecutor::ConfigureTenantWeight(pcTenant, nWeight);
+    return MY_SUCCESS;
+}
+
+/**
+ * @brief how many executor threads PRIORITY_BATCH requests may occupy, the rest stay free for
+ *        PRIORITY_INTERACTIVE. Defaults to all threads but one. Can be called before my_executor_config.
+ *
+ * @param nMaxBatchWorkers  批量请求最多占用的线程数
+ * @return result_t
+ */
+result_t my_scheduler_set_batch_workers(int nMaxBatchWorkers)
+{
+    InferenceExecutor::ConfigureBatchWorkers(nMaxBatchWorkers);
+    return MY_SUCCESS;
+}
+
+/**
+ * @brief cancel a request of my_inference_tensors_ex / my_inference_tensors_async_ex
+ *
+ * @param nRequestId  请求id
+ * @return result_t  MY_PARAM_SET_ERROR if the request is unknown or already finished
+ */
+result_t my_cancel_request(long long nRequestId)
+{
+    return RequestTracker::GetInstance()->Cancel(nRequestId);
+}
+
+/**
+ * @brief admission counters of a model loaded with admission_params
+ *
+ * @param load_model_handle  模型句柄
+ * @param pStats  统计
+ * @return result_t  MY_PARAM_SET_ERROR if admission control is not enabled for this model
+ */
+result_t my_get_admission_stats(model_handle_t *load_model_handle, admission_stats_t *pStats)
+{
+    MY_CHECK_NULL(load_model_handle, MY_PARAM_NULL);
+    MY_CHECK_NULL(load_model_handle->model_handle, MY_PARAM_NULL);
+    MY_CHECK_NULL(pStats, MY_PARAM_NULL);
+
+    OnnxRuntimeModelHandle *pOnnxHdl = (OnnxRuntimeModelHandle *)load_model_handle->model_handle;
+    AdmissionController *pAdmission = pOnnxHdl->get_admission_controller();
+    if (pAdmission == NULL)
+    {
+        MY_ERROR("admission_params is not enabled for this model\n");
+        return MY_PARAM_SET_ERROR;
+    }
+    pAdmission->GetStats(pStats);
+    return MY_SUCCESS;
+}
+
+/**
+ * @brief how many requests of a model loaded with bCoalesceRequests were served by another request's run
+ *
+ * @param load_model_handle  模型句柄
+ * @param pExecuted  实际执行的次数
+ * @param pCoalesced  合并到其它请求的次数
+ * @return result_t  MY_PARAM_SET_ERROR if coalescing is not enabled for this model
+ */
+result_t my_get_coalesce_stats(model_handle_t *load_model_handle, long long *pExecuted, long long *pCoalesced)
+{
+    MY_CHECK_NULL(load_model_handle, MY_PARAM_NULL);
+    MY_CHECK_NULL(load_model_handle->model_handle, MY_PARAM_NULL);
+    MY_CHECK_NULL(pExecuted, MY_PARAM_NULL);
+    MY_CHECK_NULL(pCoalesced, MY_PARAM_NULL);
+
+    OnnxRuntimeModelHandle *pOnnxHdl = (OnnxRuntimeModelHandle *)load_model_handle->model_handle;
+    RequestCoalescer *pCoalescer = pOnnxHdl->get_coalescer();
+    if (pCoalescer == NULL)
+    {
+        MY_ERROR("bCoalesceRequests is not enabled for this model\n");
+        return MY_PARAM_SET_ERROR;
+    }
+    pCoalescer->GetStats(pExecuted, pCoalesced);
+    return MY_SUCCESS;
+}
+
+/**
+ * @brief get the result cache of a loaded model
+ *
+ * @param load_model_handle  模型句柄
+ * @param ppCache  结果缓存
+ * @return result_t  MY_PARAM_SET_ERROR if cache_params is not set for this model
+ */
+static result_t GetResultCache(model_handle_t *load_model_handle, ResultCache **ppCache)
+{
+    MY_CHECK_NULL(load_model_handle, MY_PARAM_NULL);
+    MY_CHECK_NULL(load_model_handle->model_handle, MY_PARAM_NULL);
+
+    OnnxRuntimeModelHandle *pOnnxHdl = (OnnxRuntimeModelHandle *)load_model_handle->model_handle;
+    *ppCache = pOnnxHdl->get_result_cache();
+    if (*ppCache == NULL)
+    {
+        MY_ERROR("cache_params is not enabled for this model\n");
+        return MY_PARAM_SET_ERROR;
+    }
+    return MY_SUCCESS;
+}
+
+/**
+ * @brief hit/miss counters and size of the result cache of a model
+ *
+ * @param load_model_handle  模型句柄
+ * @param pStats  统计
+ * @return result_t
+ */
+result_t my_get_result_cache_stats(model_handle_t *load_model_handle, result_cache_stats_t *pStats)
+{
+    MY_CHECK_NULL(pStats, MY_PARAM_NULL);
+
+    ResultCache *pCache = NULL;
+    result_t res = GetResultCache(load_model_handle, &pCache);
+    if (MY_SUCCESS == res)
+    {
+        pCache->GetStats(pStats);
+    }
+    return res;
+}
+
+/**
+ * @brief drop the cached results of a model, e.g. after its inputs changed meaning. Models reloaded through
+ *        the registry start with an empty cache and need no call.
+ *
+ * @param load_model_handle  模型句柄
+ * @return result_t
+ */
+result_t my_clear_result_cache(model_handle_t *load_model_handle)
+{
+    ResultCache *pCache = NULL;
+    result_t res = GetResultCache(load_model_handle, &pCache);
+    if (MY_SUCCESS == res)
+    {
+        pCache->Clear();
+    }
+    return res;
+}
+
+/**
+ * @brief get the preprocessor and its target input tensor of a loaded model
+ *
+ * @param load_model_handle  模型句柄
+ * @param ppPreprocessor  预处理对象
+ * @param ppDstTensor  预处理结果写入的输入tensor
+ * @return result_t
+ */
+static result_t GetPreprocessTarget(model_handle_t *load_model_handle, ImagePreprocessor **ppPreprocessor,
+                                    tensor_t **ppDstTensor)
+{
+    MY_CHECK_NULL(load_model_handle, MY_PARAM_NULL);
+    MY_CHECK_NULL(load_model_handle->model_handle, MY_PARAM_NULL);
+
+    OnnxRuntimeModelHandle *pOnnxHdl = (OnnxRuntimeModelHandle *)load_model_handle->model_handle;
+    *ppPreprocessor = pOnnxHdl->get_preprocessor();
+    if (*ppPreprocessor == NULL)
+    {
+        MY_ERROR("preprocess_params is not enabled for this model\n");
+        return MY_PARAM_SET_ERROR;
+    }
+
+    tensor_array_t *input_tensors = pOnnxHdl->get_input_tensor_array();
+    int nInputIndex = pOnnxHdl->get_model_param()->preprocess_params.nInputIndex;
+    if (input_tensors == NULL || nInputIndex < 0 || nInputIndex >= input_tensors->nArraySize)
+    {
+        MY_ERROR("preprocess input index %d is invalid\n", nInputIndex);
+        return MY_PARAM_SET_ERROR;
+    }
+
+    *ppDstTensor = &input_tensors->pTensorArray[nInputIndex];
+    return MY_SUCCESS;
+}
+
+/**
+ * @brief resize, normalize and transpose a uint8 HWC image directly into the bound float NCHW input tensor,
+ *        as configured by model_params_t::preprocess_params
+ *
+ * @param load_model_handle  模型句柄
+ * @param nBatchIndex  写到输入tensor的第几个batch
+ * @param pData  图像数据
+ * @param nWidth  宽
+ * @param nHeight  高
+ * @param nStride  每行字节数, 0 表示连续
+ * @param src_format  像素格式
+ * @return result_t
+ */
+result_t my_preprocess_image(model_handle_t *load_model_handle, int nBatchIndex, const my_u8 *pData,
+                             int nWidth, int nHeight, int nStride, pixel_format_t src_format)
+{
+    ImagePreprocessor *pPreprocessor = NULL;
+    tensor_t *pDstTensor = NULL;
+    result_t res = GetPreprocessTarget(load_model_handle, &pPreprocessor, &pDstTensor);
+    if (MY_SUCCESS != res)
+    {
+        return res;
+    }
+
+    return pPreprocessor->Process(pData, nWidth, nHeight, nStride, src_format, pDstTensor, nBatchIndex);
+}
+
+/**
+ * @brief decode an encoded image (jpg/png/...) and preprocess it into the bound input tensor
+ *
+ * @param load_model_handle  模型句柄
+ * @param nBatchIndex  写到输入tensor的第几个batch
+ * @param pData  编码后的图像
+ * @param nLength  字节数
+ * @return result_t
+ */
+result_t my_preprocess_encoded_image(model_handle_t *load_model_handle, int nBatchIndex,
+                                     const my_u8 *pData, int nLength)
+{
+    ImagePreprocessor *pPreprocessor = NULL;
+    tensor_t *pDstTensor = NULL;
+    result_t res = GetPreprocessTarget(load_model_handle, &pPreprocessor, &pDstTensor);
+    if (MY_SUCCESS != res)
+    {
+        return res;
+    }
+
+    return pPreprocessor->ProcessEncoded(pData, nLength, pDstTensor, nBatchIndex);
+}
+
+/**
+ * @brief letterbox, run, NMS and map boxes back to source coordinates for a batch of differently sized images.
+ *        Uses the tensors given to my_load_model.
+ *
+ * @param load_model_handle  模型句柄, 需要启用 preprocess_params 并配置 POSTPROCESS_NMS 输出
+ * @param pImages  图像
+ * @param nImages  图像个数
+ * @param pDetections  [nImages, nMaxPerImage] 个检测结果
+ * @param nMaxPerImage  每张图最多返回的框数
+ * @param pCounts  每张图实际的框数
+ * @return result_t
+ */
+result_t my_detect_images(model_handle_t *load_model_handle, const image_t *pImages, int nImages,
+                          detection_t *pDetections, int nMaxPerImage, int *pCounts)
+{
+    MY_CHECK_NULL(load_model_handle, MY_PARAM_NULL);
+    MY_CHECK_NULL(load_model_handle->model_handle, MY_PARAM_NULL);
+
+    OnnxRuntimeModelHandle *pOnnxHdl = (OnnxRuntimeModelHandle *)load_model_handle->model_handle;
+    return DetectImages(pOnnxHdl, pImages, nImages, pDetections, nMaxPerImage, pCounts);
+}
+
+/**
+ * @brief create a pipeline that preprocesses frames on nWorkers threads and batches them into the model,
+ *        preprocessing of the next batch overlaps with inference of the current one
+ *
+ * @param load_model_handle  已加载的模型, preprocess_params 必须启用
+ * @param input_tensors_params  每个batch的输入tensor参数
+ * @param output_tensors_params  每个batch的输出tensor参数
+ * @param nWorkers  预处理线程数
+ * @param nSlots  输入输出buffer组数, 至少2
+ * @param nQueueDepth  等待预处理的最大帧数
+ * @param callback  batch完成回调, output_tensors 只在回调内有效
+ * @param user_data  回调参数
+ * @param pipeline_handle  pipeline句柄
+ * @return result_t
+ */
+result_t my_pipeline_create(model_handle_t *load_model_handle,
+                            tensor_params_array_t *input_tensors_params,
+                            tensor_params_array_t *output_tensors_params,
+                            int nWorkers, int nSlots, int nQueueDepth,
+                            pipeline_callback_t callback, void *user_data,
+                            pipeline_handle_t *pipeline_handle)
+{
+    MY_CHECK_NULL(load_model_handle, MY_PARAM_NULL);
+    MY_CHECK_NULL(load_model_handle->model_handle, MY_PARAM_NULL);
+    MY_CHECK_NULL(pipeline_handle, MY_PARAM_NULL);
+
+    OnnxRuntimeModelHandle *pOnnxHdl = (OnnxRuntimeModelHandle *)load_model_handle->model_handle;
+    ImagePipeline *pPipeline = new ImagePipeline(pOnnxHdl, callback, user_data);
+    result_t res = pPipeline->Start(input_tensors_params, output_tensors_params, nWorkers, nSlots, nQueueDepth);
+    if (MY_SUCCESS != res)
+    {
+        delete pPipeline;
+        pipeline_handle->pipeline_handle = NULL;
+        return res;
+    }
+
+    pipeline_handle->pipeline_handle = (void *)pPipeline;
     return MY_SUCCESS;
 }
+
+/**
+ * @brief queue a raw frame, blocks when the pipeline is full. pData must stay valid until the frame's callback.
+ *
+ * @param pipeline_handle  pipeline句柄
+ * @param nFrameId  帧号
+ * @param pData  图像数据, uint8
+ * @param nWidth  宽
+ * @param nHeight  高
+ * @param nStride  行字节数
+ * @param src_format  像素格式
+ * @return result_t
+ */
+result_t my_pipeline_submit_image(pipeline_handle_t *pipeline_handle, long long nFrameId, const my_u8 *pData,
+                                  int nWidth, int nHeight, int nStride, pixel_format_t src_format)
+{
+    MY_CHECK_NULL(pipeline_handle, MY_PARAM_NULL);
+    MY_CHECK_NULL(pipeline_handle->pipeline_handle, MY_PARAM_NULL);
+    MY_CHECK_NULL(pData, MY_PARAM_NULL);
+
+    int nType = (PIXEL_FORMAT_GRAY == src_format) ? CV_8UC1 : CV_8UC3;
+    cv::Mat image(nHeight, nWidth, nType, (void *)pData, (size_t)nStride);
+
+    ImagePipeline *pPipeline = (ImagePipeline *)pipeline_handle->pipeline_handle;
+    return pPipeline->Submit(nFrameId, image, src_format);
+}
+
+/**
+ * @brief queue an encoded frame (jpg/png/...), the data is copied
+ *
+ * @param pipeline_handle  pipeline句柄
+ * @param nFrameId  帧号
+ * @param pData  编码数据
+ * @param nLength  字节数
+ * @return result_t
+ */
+result_t my_pipeline_submit_encoded(pipeline_handle_t *pipeline_handle, long long nFrameId,
+                                    const my_u8 *pData, int nLength)
+{
+    MY_CHECK_NULL(pipeline_handle, MY_PARAM_NULL);
+    MY_CHECK_NULL(pipeline_handle->pipeline_handle, MY_PARAM_NULL);
+
+    ImagePipeline *pPipeline = (ImagePipeline *)pipeline_handle->pipeline_handle;
+    return pPipeline->SubmitEncoded(nFrameId, pData, nLength);
+}
+
+/**
+ * @brief run the partial batch and wait for all callbacks
+ *
+ * @param pipeline_handle  pipeline句柄
+ * @return result_t
+ */
+result_t my_pipeline_flush(pipeline_handle_t *pipeline_handle)
+{
+    MY_CHECK_NULL(pipeline_handle, MY_PARAM_NULL);
+    MY_CHECK_NULL(pipeline_handle->pipeline_handle, MY_PARAM_NULL);
+
+    ImagePipeline *pPipeline = (ImagePipeline *)pipeline_handle->pipeline_handle;
+    return pPipeline->Flush();
+}
+
+/**
+ * @brief flush and destroy the pipeline, the model handle is not released
+ *
+ * @param pipeline_handle  pipeline句柄
+ * @return result_t
+ */
+result_t my_pipeline_destroy(pipeline_handle_t *pipeline_handle)
+{
+    MY_CHECK_NULL(pipeline_handle, MY_PARAM_NULL);
+    MY_CHECK_NULL(pipeline_handle->pipeline_handle, MY_PARAM_NULL);
+
+    ImagePipeline *pPipeline = (ImagePipeline *)pipeline_handle->pipeline_handle;
+    delete pPipeline;
+    pipeline_handle->pipeline_handle = NULL;
+    return MY_SUCCESS;
+}
+
+/**
+ * @brief create a registry of models stored as <pcRootDir>/<name>/<version>/model.onnx, no model is loaded yet
+ *
+ * @param pcRootDir  模型根目录
+ * @param default_model_param  所有模型的默认加载参数, model_path 不使用; 线程池总是共享
+ * @param registry_handle  注册表句柄
+ * @return result_t
+ */
+result_t my_registry_create(const char *pcRootDir, model_params_t *default_model_param,
+                            registry_handle_t *registry_handle)
+{
+    MY_CHECK_NULL(pcRootDir, MY_PARAM_NULL);
+    MY_CHECK_NULL(default_model_param, MY_PARAM_NULL);
+    MY_CHECK_NULL(registry_handle, MY_PARAM_NULL);
+
+    registry_handle->registry_handle = new ModelRegistry(pcRootDir, default_model_param);
+    return MY_SUCCESS;
+}
+
+/**
+ * @brief load one model version into the registry
+ *
+ * @param registry_handle  注册表句柄
+ * @param pcName  模型名
+ * @param nVersion  版本号, <=0 时加载目录中最大的版本
+ * @return result_t
+ */
+result_t my_registry_load_model(registry_handle_t *registry_handle, const char *pcName, int nVersion)
+{
+    MY_CHECK_NULL(registry_handle, MY_PARAM_NULL);
+    MY_CHECK_NULL(registry_handle->registry_handle, MY_PARAM_NULL);
+
+    ModelRegistry *pRegistry = (ModelRegistry *)registry_handle->registry_handle;
+    return pRegistry->LoadModel(pcName, nVersion);
+}
+
+/**
+ * @brief load the highest version of every model under the root dir
+ *
+ * @param registry_handle  注册表句柄
+ * @return result_t
+ */
+result_t my_registry_load_all(registry_handle_t *registry_handle)
+{
+    MY_CHECK_NULL(registry_handle, MY_PARAM_NULL);
+    MY_CHECK_NULL(registry_handle->registry_handle, MY_PARAM_NULL);
+
+    ModelRegistry *pRegistry = (ModelRegistry *)registry_handle->registry_handle;
+    return pRegistry->LoadAll();
+}
+
+/**
+ * @brief unload one model version, inferences already running on it finish first
+ *
+ * @param registry_handle  注册表句柄
+ * @param pcName  模型名
+ * @param nVersion  版本号, <=0 表示最新版本
+ * @return result_t
+ */
+result_t my_registry_unload_model(registry_handle_t *registry_handle, const char *pcName, int nVersion)
+{
+    MY_CHECK_NULL(registry_handle, MY_PARAM_NULL);
+    MY_CHECK_NULL(registry_handle->registry_handle, MY_PARAM_NULL);
+
+    ModelRegistry *pRegistry = (ModelRegistry *)registry_handle->registry_handle;
+    return pRegistry->UnloadModel(pcName, nVersion);
+}
+
+/**
+ * @brief replace a registered model version with a fresh load of its file without interrupting requests:
+ *        the new session is loaded and warmed up first, requests already running finish on the old one.
+ *
+ * @param registry_handle  注册表句柄
+ * @param pcName  模型名
+ * @param nVersion  版本号, <=0 表示最新版本
+ * @param bBackground  在后台线程加载并立即返回, 失败只记录日志
+ * @return result_t
+ */
+result_t my_registry_reload_model(registry_handle_t *registry_handle, const char *pcName, int nVersion,
+                                  MY_BOOL bBackground)
+{
+    MY_CHECK_NULL(registry_handle, MY_PARAM_NULL);
+    MY_CHECK_NULL(registry_handle->registry_handle, MY_PARAM_NULL);
+
+    ModelRegistry *pRegistry = (ModelRegistry *)registry_handle->registry_handle;
+    if (bBackground)
+    {
+        return pRegistry->ReloadModelAsync(pcName, nVersion);
+    }
+    return pRegistry->ReloadModel(pcName, nVersion);
+}
+
+/**
+ * @brief keep the loaded models within a memory budget by unloading the least recently used idle ones,
+ *        optionally loading models on their first request
+ *
+ * @param registry_handle  注册表句柄
+ * @param nMemoryBudgetKB  所有模型的内存预算(KB), <=0 表示不限制; 常驻和正在推理的模型不淘汰
+ * @param bLazyLoad  推理或分配tensor时自动加载未加载的模型
+ * @return result_t
+ */
+result_t my_registry_set_cache_policy(registry_handle_t *registry_handle, long nMemoryBudgetKB,
+                                      MY_BOOL bLazyLoad)
+{
+    MY_CHECK_NULL(registry_handle, MY_PARAM_NULL);
+    MY_CHECK_NULL(registry_handle->registry_handle, MY_PARAM_NULL);
+
+    ModelRegistry *pRegistry = (ModelRegistry *)registry_handle->registry_handle;
+    pRegistry->SetCachePolicy(nMemoryBudgetKB, bLazyLoad != FALSE);
+    return MY_SUCCESS;
+}
+
+/**
+ * @brief pin a model so that it is never evicted, the model is loaded if needed
+ *
+ * @param registry_handle  注册表句柄
+ * @param pcName  模型名
+ * @param nVersion  版本号, <=0 表示最新版本
+ * @param bPin  常驻或取消常驻
+ * @return result_t
+ */
+result_t my_registry_pin_model(registry_handle_t *registry_handle, const char *pcName, int nVersion,
+                               MY_BOOL bPin)
+{
+    MY_CHECK_NULL(registry_handle, MY_PARAM_NULL);
+    MY_CHECK_NULL(registry_handle->registry_handle, MY_PARAM_NULL);
+
+    ModelRegistry *pRegistry = (ModelRegistry *)registry_handle->registry_handle;
+    return pRegistry->PinModel(pcName, nVersion, bPin != FALSE);
+}
+
+/**
+ * @brief allocate input and output tensors shaped from the model's declared inputs and outputs,
+ *        release them with my_deinit_tensors
+ *
+ * @param registry_handle  注册表句柄
+ * @param pcName  模型名
+ * @param nVersion  版本号, <=0 表示最新版本
+ * @param nBatch  batch 维为符号维度时的大小
+ * @param input_tensors  输入tensor
+ * @param output_tensors  输出tensor
+ * @return result_t
+ */
+result_t my_registry_init_tensors(registry_handle_t *registry_handle, const char *pcName, int nVersion,
+                                  int nBatch, tensor_array_t **input_tensors, tensor_array_t **output_tensors)
+{
+    MY_CHECK_NULL(registry_handle, MY_PARAM_NULL);
+    MY_CHECK_NULL(registry_handle->registry_handle, MY_PARAM_NULL);
+
+    ModelRegistry *pRegistry = (ModelRegistry *)registry_handle->registry_handle;
+    std::vector<tensor_params_t> vecInputs, vecOutputs;
+    result_t res = pRegistry->GetTensorParams(pcName, nVersion, nBatch, vecInputs, vecOutputs);
+    if (MY_SUCCESS != res)
+    {
+        return res;
+    }
+
+    tensor_params_array_t tInputParams, tOutputParams;
+    memset(&tInputParams, 0, sizeof(tensor_params_array_t));
+    memset(&tOutputParams, 0, sizeof(tensor_params_array_t));
+    tInputParams.nArraySize = (int)vecInputs.size();
+    tInputParams.pTensorParamArray = vecInputs.data();
+    tOutputParams.nArraySize = (int)vecOutputs.size();
+    tOutputParams.pTensorParamArray = vecOutputs.data();
+    return my_init_tensors(&tInputParams, &tOutputParams, input_tensors, output_tensors);
+}
+
+/**
+ * @brief run a registered model by name
+ *
+ * @param registry_handle  注册表句柄
+ * @param pcName  模型名
+ * @param nVersion  版本号, <=0 表示最新版本
+ * @param input_tensors  输入tensor
+ * @param output_tensors  输出tensor
+ * @return result_t
+ */
+result_t my_registry_inference(registry_handle_t *registry_handle, const char *pcName, int nVersion,
+                               tensor_array_t *input_tensors, tensor_array_t *output_tensors)
+{
+    MY_CHECK_NULL(registry_handle, MY_PARAM_NULL);
+    MY_CHECK_NULL(registry_handle->registry_handle, MY_PARAM_NULL);
+
+    ModelRegistry *pRegistry = (ModelRegistry *)registry_handle->registry_handle;
+    return pRegistry->Inference(pcName, nVersion, input_tensors, output_tensors);
+}
+
+/**
+ * @brief information and memory use of the registered models
+ *
+ * @param registry_handle  注册表句柄
+ * @param pInfos  模型信息, nMaxInfos 个
+ * @param nMaxInfos  pInfos 的大小
+ * @param pCount  注册的模型版本总数, 可能大于 nMaxInfos
+ * @return result_t
+ */
+result_t my_registry_list_models(registry_handle_t *registry_handle, registry_model_info_t *pInfos,
+                                 int nMaxInfos, int *pCount)
+{
+    MY_CHECK_NULL(registry_handle, MY_PARAM_NULL);
+    MY_CHECK_NULL(registry_handle->registry_handle, MY_PARAM_NULL);
+    MY_CHECK_NULL(pCount, MY_PARAM_NULL);
+
+    ModelRegistry *pRegistry = (ModelRegistry *)registry_handle->registry_handle;
+    std::vector<registry_model_info_t> vecInfos;
+    pRegistry->ListModels(vecInfos);
+    for (int i = 0; i < nMaxInfos && i < (int)vecInfos.size() && pInfos != NULL; i++)
+    {
+        pInfos[i] = vecInfos[i];
+    }
+    *pCount = (int)vecInfos.size();
+    return MY_SUCCESS;
+}
+
+/**
+ * @brief unload all models and destroy the registry
+ *
+ * @param registry_handle  注册表句柄
+ * @return result_t
+ */
+result_t my_registry_destroy(registry_handle_t *registry_handle)
+{
+    MY_CHECK_NULL(registry_handle, MY_PARAM_NULL);
+    MY_CHECK_NULL(registry_handle->registry_handle, MY_PARAM_NULL);
+
+    delete (ModelRegistry *)registry_handle->registry_handle;
+    registry_handle->registry_handle = NULL;
+    return MY_SUCCESS;
+}
+
+/**
+ * @brief load one session per shard, each pinned to its own cores on one NUMA node
+ *
+ * @param load_model_param  模型参数; nIntraOpThreads 和 bShareEnvThreadPools 由分片参数决定
+ * @param shard_params  分片参数
+ * @param sharded_handle  返回分片模型句柄
+ * @param pShards  返回分片个数, 可为NULL
+ * @return result_t
+ */
+result_t my_sharded_create(model_params_t *load_model_param, const shard_params_t *shard_params,
+                           sharded_handle_t *sharded_handle, int *pShards)
+{
+    MY_CHECK_NULL(load_model_param, MY_PARAM_NULL);
+    MY_CHECK_NULL(shard_params, MY_PARAM_NULL);
+    MY_CHECK_NULL(sharded_handle, MY_PARAM_NULL);
+
+    ShardedModel *pSharded = new ShardedModel(load_model_param, shard_params);
+    result_t res = pSharded->Start();
+    if (MY_SUCCESS != res)
+    {
+        MY_ERROR("load sharded model %s failed!\n", load_model_param->model_path);
+        delete pSharded;
+        sharded_handle->sharded_handle = NULL;
+        return res;
+    }
+
+    if (pShards != NULL)
+    {
+        *pShards = pSharded->GetShardCount();
+    }
+    sharded_handle->sharded_handle = (void *)pSharded;
+    return MY_SUCCESS;
+}
+
+/**
+ * @brief run on one of the shards and wait for the result
+ *
+ * @param sharded_handle  分片模型句柄
+ * @param input_tensors  输入tensor
+ * @param output_tensors  输出tensor
+ * @return result_t  MY_OVERLOADED if the shard queues are full
+ */
+result_t my_sharded_inference(sharded_handle_t *sharded_handle, tensor_array_t *input_tensors,
+                              tensor_array_t *output_tensors)
+{
+    MY_CHECK_NULL(sharded_handle, MY_PARAM_NULL);
+    MY_CHECK_NULL(sharded_handle->sharded_handle, MY_PARAM_NULL);
+    MY_CHECK_NULL(input_tensors, MY_PARAM_NULL);
+    MY_CHECK_NULL(output_tensors, MY_PARAM_NULL);
+
+    return ((ShardedModel *)sharded_handle->sharded_handle)->Inference(input_tensors, output_tensors);
+}
+
+/**
+ * @brief queue an inference on the shards, callback is called on the shard thread that ran it.
+ *        The priority and tenant of request_options are not used, shards run in arrival order.
+ *
+ * @param sharded_handle  分片模型句柄
+ * @param input_tensors  输入tensor
+ * @param output_tensors  输出tensor
+ * @param callback  完成回调
+ * @param user_data  传给回调
+ * @param request_options  请求选项, 可为NULL
+ * @param pRequestId  返回请求id, 可为NULL
+ * @return result_t  MY_OVERLOADED if the shard queues are full; the callback is only called on MY_SUCCESS
+ */
+result_t my_sharded_inference_async(sharded_handle_t *sharded_handle, tensor_array_t *input_tensors,
+                                    tensor_array_t *output_tensors, inference_callback_t callback,
+                                    void *user_data, const request_options_t *request_options,
+                                    long long *pRequestId)
+{
+    MY_CHECK_NULL(sharded_handle, MY_PARAM_NULL);
+    MY_CHECK_NULL(sharded_handle->sharded_handle, MY_PARAM_NULL);
+    MY_CHECK_NULL(input_tensors, MY_PARAM_NULL);
+    MY_CHECK_NULL(output_tensors, MY_PARAM_NULL);
+
+    InferenceRequest request;
+    request.input_tensors = input_tensors;
+    request.output_tensors = output_tensors;
+    request.callback = callback;
+    request.user_data = user_data;
+    request.pState = RequestTracker::GetInstance()->Create(request_options);
+    if (!request.pState)
+    {
+        return MY_FAILED;
+    }
+
+    if (pRequestId != NULL)
+    {
+        *pRequestId = request.pState->nRequestId;
+    }
+    result_t res = ((ShardedModel *)sharded_handle->sharded_handle)->Submit(request);
+    if (MY_SUCCESS != res)
+    {
+        RequestTracker::GetInstance()->Finish(request.pState);
+    }
+    return res;
+}
+
+/**
+ * @brief run the queued requests and release all shards
+ *
+ * @param sharded_handle  分片模型句柄
+ * @return result_t
+ */
+result_t my_sharded_destroy(sharded_handle_t *sharded_handle)
+{
+    MY_CHECK_NULL(sharded_handle, MY_PARAM_NULL);
+    MY_CHECK_NULL(sharded_handle->sharded_handle, MY_PARAM_NULL);
+
+    delete (ShardedModel *)sharded_handle->sharded_handle;
+    sharded_handle->sharded_handle = NULL;
+    return MY_SUCCESS;
+}
+
+/**
+ * @brief create an empty model graph
+ *
+ * @param graph_handle  图句柄
+ * @return result_t
+ */
+result_t my_graph_create(graph_handle_t *graph_handle)
+{
+    MY_CHECK_NULL(graph_handle, MY_PARAM_NULL);
+
+    graph_handle->graph_handle = (void *)new ModelGraph();
+    return MY_SUCCESS;
+}
+
+/**
+ * @brief add a loaded model as a node, the model must be released after the graph
+ *
+ * @param graph_handle  图句柄
+ * @param pcNode  节点名, 不能含 '/'
+ * @param load_model_handle  已加载的模型
+ * @return result_t
+ */
+result_t my_graph_add_model(graph_handle_t *graph_handle, const char *pcNode, model_handle_t *load_model_handle)
+{
+    MY_CHECK_NULL(graph_handle, MY_PARAM_NULL);
+    MY_CHECK_NULL(graph_handle->graph_handle, MY_PARAM_NULL);
+    MY_CHECK_NULL(load_model_handle, MY_PARAM_NULL);
+    MY_CHECK_NULL(load_model_handle->model_handle, MY_PARAM_NULL);
+
+    ModelGraph *pGraph = (ModelGraph *)graph_handle->graph_handle;
+    return pGraph->AddModel(pcNode, (OnnxRuntimeModelHandle *)load_model_handle->model_handle);
+}
+
+/**
+ * @brief add a crop/resize node with inputs "image" and "boxes" and output "crops"
+ *
+ * @param graph_handle  图句柄
+ * @param pcNode  节点名, 不能含 '/'
+ * @param crop_params  裁剪缩放参数
+ * @return result_t
+ */
+result_t my_graph_add_crop_resize(graph_handle_t *graph_handle, const char *pcNode,
+                                  const crop_resize_params_t *crop_params)
+{
+    MY_CHECK_NULL(graph_handle, MY_PARAM_NULL);
+    MY_CHECK_NULL(graph_handle->graph_handle, MY_PARAM_NULL);
+
+    ModelGraph *pGraph = (ModelGraph *)graph_handle->graph_handle;
+    return pGraph->AddCropResize(pcNode, crop_params);
+}
+
+/**
+ * @brief connect an output of a node, or a graph input when pcSrcNode is NULL, to an input of a node
+ *
+ * @param graph_handle  图句柄
+ * @param pcSrcNode  产生值的节点名, NULL 或空串表示图输入
+ * @param pcSrcOutput  输出名或图输入名
+ * @param pcDstNode  使用值的节点名
+ * @param pcDstInput  输入名
+ * @return result_t
+ */
+result_t my_graph_connect(graph_handle_t *graph_handle, const char *pcSrcNode, const char *pcSrcOutput,
+                          const char *pcDstNode, const char *pcDstInput)
+{
+    MY_CHECK_NULL(graph_handle, MY_PARAM_NULL);
+    MY_CHECK_NULL(graph_handle->graph_handle, MY_PARAM_NULL);
+
+    ModelGraph *pGraph = (ModelGraph *)graph_handle->graph_handle;
+    return pGraph->Connect(pcSrcNode, pcSrcOutput, pcDstNode, pcDstInput);
+}
+
+/**
+ * @brief run the graph, intermediate values stay in onnxruntime and only the graph outputs are copied.
+ *        The graph can't be changed after the first run.
+ *
+ * @param graph_handle  图句柄
+ * @param input_tensors  图输入, 按 my_graph_connect 中的图输入名对应
+ * @param output_tensors  图输出, 名字为 "节点名/输出名", 按实际shape填写 pShape
+ * @return result_t
+ */
+result_t my_graph_run(graph_handle_t *graph_handle, tensor_array_t *input_tensors, tensor_array_t *output_tensors)
+{
+    MY_CHECK_NULL(graph_handle, MY_PARAM_NULL);
+    MY_CHECK_NULL(graph_handle->graph_handle, MY_PARAM_NULL);
+
+    ModelGraph *pGraph = (ModelGraph *)graph_handle->graph_handle;
+    return pGraph->Run(input_tensors, output_tensors);
+}
+
+/**
+ * @brief destroy the graph, the models in it are not released
+ *
+ * @param graph_handle  图句柄
+ * @return result_t
+ */
+result_t my_graph_destroy(graph_handle_t *graph_handle)
+{
+    MY_CHECK_NULL(graph_handle, MY_PARAM_NULL);
+    MY_CHECK_NULL(graph_handle->graph_handle, MY_PARAM_NULL);
+
+    delete (ModelGraph *)graph_handle->graph_handle;
+    graph_handle->graph_handle = NULL;
+    return MY_SUCCESS;
+}
+
+/**
+ * @brief cascade a cheap model and an expensive one with the same inputs and outputs, both must be
+ *        released after the cascade
+ *
+ * @param small_model_handle  先执行的小模型
+ * @param large_model_handle  置信度不够时执行的大模型
+ * @param cascade_params  级联参数
+ * @param cascade_handle  级联句柄
+ * @return result_t
+ */
+result_t my_cascade_create(model_handle_t *small_model_handle, model_handle_t *large_model_handle,
+                           const cascade_params_t *cascade_params, cascade_handle_t *cascade_handle)
+{
+    MY_CHECK_NULL(small_model_handle, MY_PARAM_NULL);
+    MY_CHECK_NULL(small_model_handle->model_handle, MY_PARAM_NULL);
+    MY_CHECK_NULL(large_model_handle, MY_PARAM_NULL);
+    MY_CHECK_NULL(large_model_handle->model_handle, MY_PARAM_NULL);
+    MY_CHECK_NULL(cascade_params, MY_PARAM_NULL);
+    MY_CHECK_NULL(cascade_handle, MY_PARAM_NULL);
+
+    CascadeModel *pCascade = new CascadeModel((OnnxRuntimeModelHandle *)small_model_handle->model_handle,
+                                              (OnnxRuntimeModelHandle *)large_model_handle->model_handle,
+                                              cascade_params);
+    result_t res = pCascade->Check();
+    if (MY_SUCCESS != res)
+    {
+        delete pCascade;
+        cascade_handle->cascade_handle = NULL;
+        return res;
+    }
+    cascade_handle->cascade_handle = (void *)pCascade;
+    return MY_SUCCESS;
+}
+
+/**
+ * @brief run the small model and, if it is not confident, the large one; the outputs come from the last run
+ *
+ * @param cascade_handle  级联句柄
+ * @param input_tensors  输入tensor
+ * @param output_tensors  输出tensor, 须包含 aScoreOutput
+ * @param pEscalated  可为NULL, 返回是否执行了大模型
+ * @return result_t
+ */
+result_t my_cascade_inference(cascade_handle_t *cascade_handle, tensor_array_t *input_tensors,
+                              tensor_array_t *output_tensors, MY_BOOL *pEscalated)
+{
+    MY_CHECK_NULL(cascade_handle, MY_PARAM_NULL);
+    MY_CHECK_NULL(cascade_handle->cascade_handle, MY_PARAM_NULL);
+    MY_CHECK_NULL(input_tensors, MY_PARAM_NULL);
+    MY_CHECK_NULL(output_tensors, MY_PARAM_NULL);
+
+    CascadeModel *pCascade = (CascadeModel *)cascade_handle->cascade_handle;
+    return pCascade->Run(input_tensors, output_tensors, pEscalated);
+}
+
+/**
+ * @brief early exit and escalation counters of a cascade
+ *
+ * @param cascade_handle  级联句柄
+ * @param pStats  统计
+ * @return result_t
+ */
+result_t my_get_cascade_stats(cascade_handle_t *cascade_handle, cascade_stats_t *pStats)
+{
+    MY_CHECK_NULL(cascade_handle, MY_PARAM_NULL);
+    MY_CHECK_NULL(cascade_handle->cascade_handle, MY_PARAM_NULL);
+    MY_CHECK_NULL(pStats, MY_PARAM_NULL);
+
+    ((CascadeModel *)cascade_handle->cascade_handle)->GetStats(pStats);
+    return MY_SUCCESS;
+}
+
+/**
+ * @brief destroy the cascade, the two models are not released
+ *
+ * @param cascade_handle  级联句柄
+ * @return result_t
+ */
+result_t my_cascade_destroy(cascade_handle_t *cascade_handle)
+{
+    MY_CHECK_NULL(cascade_handle, MY_PARAM_NULL);
+    MY_CHECK_NULL(cascade_handle->cascade_handle, MY_PARAM_NULL);
+
+    delete (CascadeModel *)cascade_handle->cascade_handle;
+    cascade_handle->cascade_handle = NULL;
+    return MY_SUCCESS;
+}
+
+/**
+ * @brief create the stream manager of a loaded streaming model, the model must be released after it
+ *
+ * @param load_model_handle  已加载的流式模型
+ * @param stream_params  状态输入/输出对和空闲回收参数
+ * @param stream_handle  流句柄
+ * @return result_t
+ */
+result_t my_stream_create(model_handle_t *load_model_handle, const stream_params_t *stream_params,
+                          stream_handle_t *stream_handle)
+{
+    MY_CHECK_NULL(load_model_handle, MY_PARAM_NULL);
+    MY_CHECK_NULL(load_model_handle->model_handle, MY_PARAM_NULL);
+    MY_CHECK_NULL(stream_params, MY_PARAM_NULL);
+    MY_CHECK_NULL(stream_handle, MY_PARAM_NULL);
+
+    StreamModel *pStreamModel = new StreamModel((OnnxRuntimeModelHandle *)load_model_handle->model_handle,
+                                                stream_params);
+    result_t res = pStreamModel->Start();
+    if (MY_SUCCESS != res)
+    {
+        delete pStreamModel;
+        stream_handle->stream_handle = NULL;
+        return res;
+    }
+    stream_handle->stream_handle = (void *)pStreamModel;
+    return MY_SUCCESS;
+}
+
+/**
+ * @brief open a stream starting from zero states
+ *
+ * @param stream_handle  流句柄
+ * @param pStreamId  流id
+ * @return result_t  MY_OVERLOADED if nMaxStreams streams are open
+ */
+result_t my_stream_open(stream_handle_t *stream_handle, long long *pStreamId)
+{
+    MY_CHECK_NULL(stream_handle, MY_PARAM_NULL);
+    MY_CHECK_NULL(stream_handle->stream_handle, MY_PARAM_NULL);
+    MY_CHECK_NULL(pStreamId, MY_PARAM_NULL);
+
+    return ((StreamModel *)stream_handle->stream_handle)->Open(pStreamId);
+}
+
+/**
+ * @brief run the next chunk of a stream, the states are passed on inside the stream without copies
+ *
+ * @param stream_handle  流句柄
+ * @param nStreamId  流id
+ * @param input_tensors  除状态外的输入
+ * @param output_tensors  要取的输出, 按实际shape填写 pShape
+ * @return result_t  MY_STREAM_NOT_FOUND if the stream was closed or expired
+ */
+result_t my_stream_inference(stream_handle_t *stream_handle, long long nStreamId, tensor_array_t *input_tensors,
+                             tensor_array_t *output_tensors)
+{
+    MY_CHECK_NULL(stream_handle, MY_PARAM_NULL);
+    MY_CHECK_NULL(stream_handle->stream_handle, MY_PARAM_NULL);
+    MY_CHECK_NULL(input_tensors, MY_PARAM_NULL);
+    MY_CHECK_NULL(output_tensors, MY_PARAM_NULL);
+
+    return ((StreamModel *)stream_handle->stream_handle)->Run(nStreamId, input_tensors, output_tensors);
+}
+
+/**
+ * @brief start a stream over from zero states
+ *
+ * @param stream_handle  流句柄
+ * @param nStreamId  流id
+ * @return result_t
+ */
+result_t my_stream_reset(stream_handle_t *stream_handle, long long nStreamId)
+{
+    MY_CHECK_NULL(stream_handle, MY_PARAM_NULL);
+    MY_CHECK_NULL(stream_handle->stream_handle, MY_PARAM_NULL);
+
+    return ((StreamModel *)stream_handle->stream_handle)->Reset(nStreamId);
+}
+
+/**
+ * @brief close a stream and release its states
+ *
+ * @param stream_handle  流句柄
+ * @param nStreamId  流id
+ * @return result_t
+ */
+result_t my_stream_close(stream_handle_t *stream_handle, long long nStreamId)
+{
+    MY_CHECK_NULL(stream_handle, MY_PARAM_NULL);
+    MY_CHECK_NULL(stream_handle->stream_handle, MY_PARAM_NULL);
+
+    return ((StreamModel *)stream_handle->stream_handle)->Close(nStreamId);
+}
+
+/**
+ * @brief close all streams and destroy the stream handle, the model is not released
+ *
+ * @param stream_handle  流句柄
+ * @return result_t
+ */
+result_t my_stream_destroy(stream_handle_t *stream_handle)
+{
+    MY_CHECK_NULL(stream_handle, MY_PARAM_NULL);
+    MY_CHECK_NULL(stream_handle->stream_handle, MY_PARAM_NULL);
+
+    delete (StreamModel *)stream_handle->stream_handle;
+    stream_handle->stream_handle = NULL;
+    return MY_SUCCESS;
+}
+
+/**
+ * @brief collect activation ranges of a float model on representative inputs, write the calibration table
+ *        and/or the int8 QDQ model. The quantized model is recognized by my_load_model and run with
+ *        ORT_ENABLE_ALL on CPU.
+ *
+ * @param load_model_param  float 模型的加载参数
+ * @param input_tensors  nBatches 组代表性输入, 与模型输入一致
+ * @param nBatches  输入组数
+ * @param pcTablePath  校准表路径, 为NULL时不写
+ * @param pcQuantizedModelPath  量化模型路径, 为NULL时不写; 原模型加密时按相同参数加密
+ * @return result_t
+ */
+result_t my_calibrate_model(model_params_t *load_model_param, tensor_array_t **input_tensors, int nBatches,
+                            const char *pcTablePath, const char *pcQuantizedModelPath)
+{
+    MY_CHECK_NULL(load_model_param, MY_PARAM_NULL);
+    MY_CHECK_NULL(input_tensors, MY_PARAM_NULL);
+    if (nBatches <= 0)
+    {
+        MY_ERROR("calibration needs at least one batch\n");
+        return MY_PARAM_SET_ERROR;
+    }
+
+    ModelCalibrator calibrator(load_model_param);
+    result_t res = calibrator.Open();
+    for (int i = 0; i < nBatches && MY_SUCCESS == res; i++)
+    {
+        res = calibrator.Collect(input_tensors[i]);
+        if (MY_SUCCESS != res)
+        {
+            MY_ERROR("calibration batch %d failed\n", i);
+        }
+    }
+    if (MY_SUCCESS == res && pcTablePath != NULL)
+    {
+        res = calibrator.WriteCalibrationTable(pcTablePath);
+    }
+    if (MY_SUCCESS == res && pcQuantizedModelPath != NULL)
+    {
+        res = calibrator.WriteQuantizedModel(pcQuantizedModelPath);
+    }
+    return res;
+}
+
+/**
+ * @brief get time and memory cost of every load phase, see load_profile_t.
+ *        Memory is only recorded when model_params_t::bProfileLoad is set.
+ *
+ * @param load_model_handle  模型句柄
+ * @param load_profile  加载统计
+ * @return result_t
+ */
+result_t my_get_load_profile(model_handle_t *load_model_handle, load_profile_t *load_profile)
+{
+    MY_CHECK_NULL(load_model_handle, MY_PARAM_NULL);
+    MY_CHECK_NULL(load_model_handle->model_handle, MY_PARAM_NULL);
+    MY_CHECK_NULL(load_profile, MY_PARAM_NULL);
+
+    OnnxRuntimeModelHandle *pOnnxHdl = (OnnxRuntimeModelHandle *)load_model_handle->model_handle;
+    memcpy(load_profile, &pOnnxHdl->get_load_profile(), sizeof(load_profile_t));
+    return MY_SUCCESS;
+}
+
+/**
+ * @brief benchmark mode: load, first run and release a model nRepeat times and average the cost of each phase
+ *
+ * @param load_model_param  模型参数
+ * @param input_tensors  first run 的输入, 可以为NULL
+ * @param output_tensors  first run 的输出, 可以为NULL
+ * @param nRepeat  重复次数
+ * @param load_profile  平均的加载统计
+ * @return result_t
+ */
+result_t my_benchmark_load_model(model_params_t *load_model_param,
+                                 tensor_array_t *input_tensors,
+                                 tensor_array_t *output_tensors,
+                                 int nRepeat,
+                                 load_profile_t *load_profile)
+{
+    return BenchmarkLoadModel(load_model_param, input_tensors, output_tensors, nRepeat, load_profile);
+}
+
+/**
+ * @brief benchmark mode on synthetic models generated locally, plain and encrypted, one per size
+ *
+ * @param pModelBytes  模型大小(字节)
+ * @param nSizes  模型个数
+ * @param nRepeat  重复次数
+ * @param pPlainProfiles  明文模型统计, nSizes个
+ * @param pCipherProfiles  加密模型统计, nSizes个
+ * @return result_t
+ */
+result_t my_benchmark_synthetic_models(const long long *pModelBytes, int nSizes, int nRepeat,
+                                       load_profile_t *pPlainProfiles, load_profile_t *pCipherProfiles)
+{
+    return BenchmarkSyntheticModels(pModelBytes, nSizes, nRepeat, pPlainProfiles, pCipherProfiles);
+}
+
+/**
+ * @brief micro benchmark of the preprocessing SIMD kernels, checked against the scalar reference.
+ *        Must not run alongside inference: it switches the process wide kernel dispatch while it runs.
+ *
+ * @param nWidth  图像宽
+ * @param nHeight  图像高
+ * @param nRepeat  重复次数
+ * @return result_t
+ */
+result_t my_benchmark_kernels(int nWidth, int nHeight, int nRepeat)
+{
+    return BenchmarkKernels(nWidth, nHeight, nRepeat);
+}
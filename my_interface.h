@@ -22,6 +22,156 @@ extern "C"
 
     result_t my_inference_tensors(model_handle_t *load_model_handle);
 
+    result_t my_executor_config(int nThreads, int nQueueDepth);
+
+    result_t my_inference_tensors_async(model_handle_t *load_model_handle, tensor_array_t *input_tensors,
+                                        tensor_array_t *output_tensors, inference_callback_t callback,
+                                        void *user_data);
+
+    result_t my_inference_tensors_ex(model_handle_t *load_model_handle, tensor_array_t *input_tensors,
+                                     tensor_array_t *output_tensors, const request_options_t *request_options);
+
+    result_t my_inference_tensors_async_ex(model_handle_t *load_model_handle, tensor_array_t *input_tensors,
+                                           tensor_array_t *output_tensors, inference_callback_t callback,
+                                           void *user_data, const request_options_t *request_options,
+                                           long long *pRequestId);
+
+    result_t my_cancel_request(long long nRequestId);
+
+    result_t my_scheduler_set_tenant_weight(const char *pcTenant, int nWeight);
+
+    result_t my_scheduler_set_batch_workers(int nMaxBatchWorkers);
+
+    result_t my_get_admission_stats(model_handle_t *load_model_handle, admission_stats_t *pStats);
+
+    result_t my_get_coalesce_stats(model_handle_t *load_model_handle, long long *pExecuted, long long *pCoalesced);
+
+    result_t my_get_result_cache_stats(model_handle_t *load_model_handle, result_cache_stats_t *pStats);
+
+    result_t my_clear_result_cache(model_handle_t *load_model_handle);
+
+    result_t my_preprocess_image(model_handle_t *load_model_handle, int nBatchIndex, const my_u8 *pData,
+                                 int nWidth, int nHeight, int nStride, pixel_format_t src_format);
+
+    result_t my_preprocess_encoded_image(model_handle_t *load_model_handle, int nBatchIndex,
+                                         const my_u8 *pData, int nLength);
+
+    result_t my_detect_images(model_handle_t *load_model_handle, const image_t *pImages, int nImages,
+                              detection_t *pDetections, int nMaxPerImage, int *pCounts);
+
+    result_t my_pipeline_create(model_handle_t *load_model_handle,
+                                tensor_params_array_t *input_tensors_params,
+                                tensor_params_array_t *output_tensors_params,
+                                int nWorkers, int nSlots, int nQueueDepth,
+                                pipeline_callback_t callback, void *user_data,
+                                pipeline_handle_t *pipeline_handle);
+
+    result_t my_pipeline_submit_image(pipeline_handle_t *pipeline_handle, long long nFrameId, const my_u8 *pData,
+                                      int nWidth, int nHeight, int nStride, pixel_format_t src_format);
+
+    result_t my_pipeline_submit_encoded(pipeline_handle_t *pipeline_handle, long long nFrameId,
+                                        const my_u8 *pData, int nLength);
+
+    result_t my_pipeline_flush(pipeline_handle_t *pipeline_handle);
+
+    result_t my_pipeline_destroy(pipeline_handle_t *pipeline_handle);
+
+    result_t my_registry_create(const char *pcRootDir, model_params_t *default_model_param,
+                                registry_handle_t *registry_handle);
+
+    result_t my_registry_load_model(registry_handle_t *registry_handle, const char *pcName, int nVersion);
+
+    result_t my_registry_load_all(registry_handle_t *registry_handle);
+
+    result_t my_registry_unload_model(registry_handle_t *registry_handle, const char *pcName, int nVersion);
+
+    result_t my_registry_reload_model(registry_handle_t *registry_handle, const char *pcName, int nVersion,
+                                      MY_BOOL bBackground);
+
+    result_t my_registry_set_cache_policy(registry_handle_t *registry_handle, long nMemoryBudgetKB,
+                                          MY_BOOL bLazyLoad);
+
+    result_t my_registry_pin_model(registry_handle_t *registry_handle, const char *pcName, int nVersion,
+                                   MY_BOOL bPin);
+
+    result_t my_registry_init_tensors(registry_handle_t *registry_handle, const char *pcName, int nVersion,
+                                      int nBatch, tensor_array_t **input_tensors, tensor_array_t **output_tensors);
+
+    result_t my_registry_inference(registry_handle_t *registry_handle, const char *pcName, int nVersion,
+                                   tensor_array_t *input_tensors, tensor_array_t *output_tensors);
+
+    result_t my_registry_list_models(registry_handle_t *registry_handle, registry_model_info_t *pInfos,
+                                     int nMaxInfos, int *pCount);
+
+    result_t my_registry_destroy(registry_handle_t *registry_handle);
+
+    result_t my_sharded_create(model_params_t *load_model_param, const shard_params_t *shard_params,
+                               sharded_handle_t *sharded_handle, int *pShards);
+
+    result_t my_sharded_inference(sharded_handle_t *sharded_handle, tensor_array_t *input_tensors,
+                                  tensor_array_t *output_tensors);
+
+    result_t my_sharded_inference_async(sharded_handle_t *sharded_handle, tensor_array_t *input_tensors,
+                                        tensor_array_t *output_tensors, inference_callback_t callback,
+                                        void *user_data, const request_options_t *request_options,
+                                        long long *pRequestId);
+
+    result_t my_sharded_destroy(sharded_handle_t *sharded_handle);
+
+    result_t my_graph_create(graph_handle_t *graph_handle);
+
+    result_t my_graph_add_model(graph_handle_t *graph_handle, const char *pcNode, model_handle_t *load_model_handle);
+
+    result_t my_graph_add_crop_resize(graph_handle_t *graph_handle, const char *pcNode,
+                                      const crop_resize_params_t *crop_params);
+
+    result_t my_graph_connect(graph_handle_t *graph_handle, const char *pcSrcNode, const char *pcSrcOutput,
+                              const char *pcDstNode, const char *pcDstInput);
+
+    result_t my_graph_run(graph_handle_t *graph_handle, tensor_array_t *input_tensors, tensor_array_t *output_tensors);
+
+    result_t my_graph_destroy(graph_handle_t *graph_handle);
+
+    result_t my_cascade_create(model_handle_t *small_model_handle, model_handle_t *large_model_handle,
+                               const cascade_params_t *cascade_params, cascade_handle_t *cascade_handle);
+
+    result_t my_cascade_inference(cascade_handle_t *cascade_handle, tensor_array_t *input_tensors,
+                                  tensor_array_t *output_tensors, MY_BOOL *pEscalated);
+
+    result_t my_get_cascade_stats(cascade_handle_t *cascade_handle, cascade_stats_t *pStats);
+
+    result_t my_cascade_destroy(cascade_handle_t *cascade_handle);
+
+    result_t my_stream_create(model_handle_t *load_model_handle, const stream_params_t *stream_params,
+                              stream_handle_t *stream_handle);
+
+    result_t my_stream_open(stream_handle_t *stream_handle, long long *pStreamId);
+
+    result_t my_stream_inference(stream_handle_t *stream_handle, long long nStreamId, tensor_array_t *input_tensors,
+                                 tensor_array_t *output_tensors);
+
+    result_t my_stream_reset(stream_handle_t *stream_handle, long long nStreamId);
+
+    result_t my_stream_close(stream_handle_t *stream_handle, long long nStreamId);
+
+    result_t my_stream_destroy(stream_handle_t *stream_handle);
+
+    result_t my_calibrate_model(model_params_t *load_model_param, tensor_array_t **input_tensors, int nBatches,
+                                const char *pcTablePath, const char *pcQuantizedModelPath);
+
+    result_t my_get_load_profile(model_handle_t *load_model_handle, load_profile_t *load_profile);
+
+    result_t my_benchmark_load_model(model_params_t *load_model_param,
+                                     tensor_array_t *input_tensors,
+                                     tensor_array_t *output_tensors,
+                                     int nRepeat,
+                                     load_profile_t *load_profile);
+
+    result_t my_benchmark_synthetic_models(const long long *pModelBytes, int nSizes, int nRepeat,
+                                           load_profile_t *pPlainProfiles, load_profile_t *pCipherProfiles);
+
+    result_t my_benchmark_kernels(int nWidth, int nHeight, int nRepeat);
+
 #ifdef __cplusplus
 }
 #endif
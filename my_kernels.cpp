@@ -0,0 +1,836 @@
+#include <cmath>
+#include <cstring>
+#include "my_kernels.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define MY_KERNELS_X86
+#include <immintrin.h>
+#define MY_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+/*===================== scalar reference =====================*/
+
+void ConvertU8ToF32Scalar(const my_u8 *src, float *dst, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        dst[i] = (float)src[i];
+    }
+}
+
+void NormalizeF32Scalar(const float *src, float *dst, size_t n, float scale, float bias)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        dst[i] = src[i] * scale + bias;
+    }
+}
+
+void NormalizeU8ToF32Scalar(const my_u8 *src, float *dst, size_t n, float scale, float bias)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        dst[i] = (float)src[i] * scale + bias;
+    }
+}
+
+void HWC3ToCHWNormalizeU8Scalar(const my_u8 *src, size_t nPixels, float *const pDst[3], const float aScale[3],
+                                const float aBias[3])
+{
+    float *dst0 = pDst[0], *dst1 = pDst[1], *dst2 = pDst[2];
+    for (size_t i = 0; i < nPixels; i++)
+    {
+        dst0[i] = (float)src[3 * i] * aScale[0] + aBias[0];
+        dst1[i] = (float)src[3 * i + 1] * aScale[1] + aBias[1];
+        dst2[i] = (float)src[3 * i + 2] * aScale[2] + aBias[2];
+    }
+}
+
+float ReduceMaxF32Scalar(const float *src, size_t n)
+{
+    float fMax = -INFINITY;
+    for (size_t i = 0; i < n; i++)
+    {
+        fMax = src[i] > fMax ? src[i] : fMax;
+    }
+    return fMax;
+}
+
+float ExpSumF32Scalar(const float *src, float *dst, size_t n, float fMax)
+{
+    float fSum = 0.0f;
+    for (size_t i = 0; i < n; i++)
+    {
+        dst[i] = expf(src[i] - fMax);
+        fSum += dst[i];
+    }
+    return fSum;
+}
+
+// float -> fp16, 就近舍入到偶数, 与 F16C 的结果一致
+static inline my_u16 FloatToHalf(float f)
+{
+    my_u32 x;
+    memcpy(&x, &f, sizeof(x));
+    my_u32 sign = (x >> 16) & 0x8000;
+    my_u32 absx = x & 0x7FFFFFFF;
+
+    if (absx > 0x7F800000) // NaN: 与 F16C 一样置 quiet 位并保留尾数的高10位
+    {
+        return (my_u16)(sign | 0x7E00 | ((absx & 0x7FFFFF) >> 13));
+    }
+    if (absx >= 0x47800000) // >= 65536 或 inf
+    {
+        return (my_u16)(sign | 0x7C00);
+    }
+    if (absx < 0x38800000) // fp16 的非规格化数, 加 0.5 让硬件完成舍入
+    {
+        float fAbs;
+        memcpy(&fAbs, &absx, sizeof(fAbs));
+        fAbs += 0.5f;
+        my_u32 r;
+        memcpy(&r, &fAbs, sizeof(r));
+        return (my_u16)(sign | (r - 0x3F000000));
+    }
+    my_u32 nMantOdd = (absx >> 13) & 1;
+    absx += 0xC8000FFF + nMantOdd; // 指数 -112, 加上舍入量
+    return (my_u16)(sign | (absx >> 13));
+}
+
+// float -> bf16, 就近舍入到偶数, NaN 保持为 quiet NaN
+static inline my_u16 FloatToBFloat16(float f)
+{
+    my_u32 x;
+    memcpy(&x, &f, sizeof(x));
+    if ((x & 0x7FFFFFFF) > 0x7F800000)
+    {
+        return (my_u16)((x >> 16) | 0x40);
+    }
+    return (my_u16)((x + 0x7FFF + ((x >> 16) & 1)) >> 16);
+}
+
+void ConvertF32ToF16Scalar(const float *src, my_u16 *dst, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        dst[i] = FloatToHalf(src[i]);
+    }
+}
+
+void ConvertF32ToBF16Scalar(const float *src, my_u16 *dst, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        dst[i] = FloatToBFloat16(src[i]);
+    }
+}
+
+void QuantizeF32ToS8Scalar(const float *src, my_s8 *dst, size_t n, float fInvScale)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        // 先在 float 上饱和, NaN 视为 -128, 与 SIMD 的 max/min 顺序一致
+        float v = src[i] * fInvScale;
+        v = v > -128.0f ? v : -128.0f;
+        v = v < 127.0f ? v : 127.0f;
+        dst[i] = (my_s8)nearbyintf(v);
+    }
+}
+
+#ifdef MY_KERNELS_X86
+
+/*===================== 3通道解交错 =====================*/
+
+// 16个像素(48字节, 3个寄存器)解交错成3个通道各16字节: 通道k的第j个字节来自全局字节 3j+k,
+// 对每个源寄存器做一次 pshufb, 不属于该寄存器的位置置0, 再把3个结果或起来
+struct Deinterleave3Masks
+{
+    my_u8 aMask[3][3][16]; // [通道][源寄存器][输出字节]
+
+    Deinterleave3Masks()
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            for (int s = 0; s < 3; s++)
+            {
+                for (int j = 0; j < 16; j++)
+                {
+                    int g = 3 * j + k;
+                    aMask[k][s][j] = (g / 16 == s) ? (my_u8)(g % 16) : 0x80;
+                }
+            }
+        }
+    }
+};
+
+static const Deinterleave3Masks g_deinterleave3;
+
+MY_TARGET("sse4.1")
+static inline void Deinterleave3(const my_u8 *src, __m128i out[3])
+{
+    __m128i a = _mm_loadu_si128((const __m128i *)src);
+    __m128i b = _mm_loadu_si128((const __m128i *)(src + 16));
+    __m128i c = _mm_loadu_si128((const __m128i *)(src + 32));
+    for (int k = 0; k < 3; k++)
+    {
+        __m128i ra = _mm_shuffle_epi8(a, _mm_loadu_si128((const __m128i *)g_deinterleave3.aMask[k][0]));
+        __m128i rb = _mm_shuffle_epi8(b, _mm_loadu_si128((const __m128i *)g_deinterleave3.aMask[k][1]));
+        __m128i rc = _mm_shuffle_epi8(c, _mm_loadu_si128((const __m128i *)g_deinterleave3.aMask[k][2]));
+        out[k] = _mm_or_si128(_mm_or_si128(ra, rb), rc);
+    }
+}
+
+/*===================== SSE4.1 =====================*/
+
+// 16个 uint8 -> 16个 float, x * scale + bias
+MY_TARGET("sse4.1")
+static inline void Normalize16Sse41(__m128i v, float *dst, __m128 scale, __m128 bias)
+{
+    for (int q = 0; q < 4; q++)
+    {
+        __m128 f = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(v));
+        _mm_storeu_ps(dst + 4 * q, _mm_add_ps(_mm_mul_ps(f, scale), bias));
+        v = _mm_srli_si128(v, 4);
+    }
+}
+
+MY_TARGET("sse4.1")
+static void NormalizeU8ToF32Sse41(const my_u8 *src, float *dst, size_t n, float scale, float bias)
+{
+    __m128 vscale = _mm_set1_ps(scale), vbias = _mm_set1_ps(bias);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        Normalize16Sse41(_mm_loadu_si128((const __m128i *)(src + i)), dst + i, vscale, vbias);
+    }
+    NormalizeU8ToF32Scalar(src + i, dst + i, n - i, scale, bias);
+}
+
+MY_TARGET("sse4.1")
+static void NormalizeF32Sse41(const float *src, float *dst, size_t n, float scale, float bias)
+{
+    __m128 vscale = _mm_set1_ps(scale), vbias = _mm_set1_ps(bias);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        _mm_storeu_ps(dst + i, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(src + i), vscale), vbias));
+    }
+    NormalizeF32Scalar(src + i, dst + i, n - i, scale, bias);
+}
+
+MY_TARGET("sse4.1")
+static void HWC3ToCHWNormalizeU8Sse41(const my_u8 *src, size_t nPixels, float *const pDst[3],
+                                      const float aScale[3], const float aBias[3])
+{
+    __m128 vscale[3], vbias[3];
+    for (int k = 0; k < 3; k++)
+    {
+        vscale[k] = _mm_set1_ps(aScale[k]);
+        vbias[k] = _mm_set1_ps(aBias[k]);
+    }
+
+    size_t i = 0;
+    for (; i + 16 <= nPixels; i += 16)
+    {
+        __m128i ch[3];
+        Deinterleave3(src + 3 * i, ch);
+        for (int k = 0; k < 3; k++)
+        {
+            Normalize16Sse41(ch[k], pDst[k] + i, vscale[k], vbias[k]);
+        }
+    }
+
+    float *const pTail[3] = {pDst[0] + i, pDst[1] + i, pDst[2] + i};
+    HWC3ToCHWNormalizeU8Scalar(src + 3 * i, nPixels - i, pTail, aScale, aBias);
+}
+
+MY_TARGET("sse4.1")
+static float ReduceMaxF32Sse41(const float *src, size_t n)
+{
+    __m128 vmax = _mm_set1_ps(-INFINITY);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        vmax = _mm_max_ps(vmax, _mm_loadu_ps(src + i));
+    }
+    vmax = _mm_max_ps(vmax, _mm_shuffle_ps(vmax, vmax, _MM_SHUFFLE(1, 0, 3, 2)));
+    vmax = _mm_max_ps(vmax, _mm_shuffle_ps(vmax, vmax, _MM_SHUFFLE(2, 3, 0, 1)));
+    float fMax = _mm_cvtss_f32(vmax);
+    float fTail = ReduceMaxF32Scalar(src + i, n - i);
+    return fTail > fMax ? fTail : fMax;
+}
+
+// Cephes expf: exp(x) = 2^k * exp(r), r = x - k * ln2, exp(r) 用5阶多项式, 相对误差约 2e-7
+MY_TARGET("sse4.1")
+static inline __m128 ExpSse41(__m128 x)
+{
+    x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(-87.3f)), _mm_set1_ps(88.3f));
+    __m128 k = _mm_floor_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(1.44269504f)), _mm_set1_ps(0.5f)));
+    x = _mm_sub_ps(x, _mm_mul_ps(k, _mm_set1_ps(0.693359375f)));
+    x = _mm_sub_ps(x, _mm_mul_ps(k, _mm_set1_ps(-2.12194440e-4f)));
+
+    __m128 y = _mm_set1_ps(1.9875691500e-4f);
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.3981999507e-3f));
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(8.3334519073e-3f));
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(4.1665795894e-2f));
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.6666665459e-1f));
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(5.0000001201e-1f));
+    y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_mul_ps(y, x), x), x), _mm_set1_ps(1.0f));
+
+    __m128i e = _mm_slli_epi32(_mm_add_epi32(_mm_cvtps_epi32(k), _mm_set1_epi32(127)), 23);
+    return _mm_mul_ps(y, _mm_castsi128_ps(e));
+}
+
+MY_TARGET("sse4.1")
+static float ExpSumF32Sse41(const float *src, float *dst, size_t n, float fMax)
+{
+    __m128 vmax = _mm_set1_ps(fMax), vsum = _mm_setzero_ps();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128 e = ExpSse41(_mm_sub_ps(_mm_loadu_ps(src + i), vmax));
+        _mm_storeu_ps(dst + i, e);
+        vsum = _mm_add_ps(vsum, e);
+    }
+    float aSum[4];
+    _mm_storeu_ps(aSum, vsum);
+    return aSum[0] + aSum[1] + aSum[2] + aSum[3] + ExpSumF32Scalar(src + i, dst + i, n - i, fMax);
+}
+
+// 4个 float -> 4个 bf16 (低16位有效)
+MY_TARGET("sse4.1")
+static inline __m128i BFloat16Sse41(__m128 x)
+{
+    __m128i b = _mm_castps_si128(x);
+    __m128i lsb = _mm_and_si128(_mm_srli_epi32(b, 16), _mm_set1_epi32(1));
+    __m128i r = _mm_srli_epi32(_mm_add_epi32(b, _mm_add_epi32(lsb, _mm_set1_epi32(0x7FFF))), 16);
+    __m128i nan = _mm_or_si128(_mm_srli_epi32(b, 16), _mm_set1_epi32(0x40));
+    return _mm_blendv_epi8(r, nan, _mm_castps_si128(_mm_cmpunord_ps(x, x)));
+}
+
+MY_TARGET("sse4.1")
+static void ConvertF32ToBF16Sse41(const float *src, my_u16 *dst, size_t n)
+{
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        __m128i lo = BFloat16Sse41(_mm_loadu_ps(src + i));
+        __m128i hi = BFloat16Sse41(_mm_loadu_ps(src + i + 4));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi32(lo, hi));
+    }
+    ConvertF32ToBF16Scalar(src + i, dst + i, n - i);
+}
+
+// 4个 float -> 4个 int32, 先饱和到 int8 范围
+MY_TARGET("sse4.1")
+static inline __m128i QuantizeSse41(const float *src, __m128 inv)
+{
+    __m128 v = _mm_max_ps(_mm_mul_ps(_mm_loadu_ps(src), inv), _mm_set1_ps(-128.0f));
+    return _mm_cvtps_epi32(_mm_min_ps(v, _mm_set1_ps(127.0f)));
+}
+
+MY_TARGET("sse4.1")
+static void QuantizeF32ToS8Sse41(const float *src, my_s8 *dst, size_t n, float fInvScale)
+{
+    __m128 inv = _mm_set1_ps(fInvScale);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128i ab = _mm_packs_epi32(QuantizeSse41(src + i, inv), QuantizeSse41(src + i + 4, inv));
+        __m128i cd = _mm_packs_epi32(QuantizeSse41(src + i + 8, inv), QuantizeSse41(src + i + 12, inv));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_packs_epi16(ab, cd));
+    }
+    QuantizeF32ToS8Scalar(src + i, dst + i, n - i, fInvScale);
+}
+
+/*===================== AVX2 =====================*/
+
+// 乘和加分开做: FMA 只舍入一次, 结果会与标量版本差 1ulp
+MY_TARGET("avx2,fma")
+static inline void Normalize16Avx2(__m128i v, float *dst, __m256 scale, __m256 bias)
+{
+    __m256 lo = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(v));
+    __m256 hi = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(v, 8)));
+    _mm256_storeu_ps(dst, _mm256_add_ps(_mm256_mul_ps(lo, scale), bias));
+    _mm256_storeu_ps(dst + 8, _mm256_add_ps(_mm256_mul_ps(hi, scale), bias));
+}
+
+MY_TARGET("avx2,fma")
+static void NormalizeU8ToF32Avx2(const my_u8 *src, float *dst, size_t n, float scale, float bias)
+{
+    __m256 vscale = _mm256_set1_ps(scale), vbias = _mm256_set1_ps(bias);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32)
+    {
+        Normalize16Avx2(_mm_loadu_si128((const __m128i *)(src + i)), dst + i, vscale, vbias);
+        Normalize16Avx2(_mm_loadu_si128((const __m128i *)(src + i + 16)), dst + i + 16, vscale, vbias);
+    }
+    for (; i + 16 <= n; i += 16)
+    {
+        Normalize16Avx2(_mm_loadu_si128((const __m128i *)(src + i)), dst + i, vscale, vbias);
+    }
+    NormalizeU8ToF32Scalar(src + i, dst + i, n - i, scale, bias);
+}
+
+MY_TARGET("avx2,fma")
+static void NormalizeF32Avx2(const float *src, float *dst, size_t n, float scale, float bias)
+{
+    __m256 vscale = _mm256_set1_ps(scale), vbias = _mm256_set1_ps(bias);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        _mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(src + i), vscale), vbias));
+        _mm256_storeu_ps(dst + i + 8, _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(src + i + 8), vscale), vbias));
+    }
+    for (; i + 8 <= n; i += 8)
+    {
+        _mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(src + i), vscale), vbias));
+    }
+    NormalizeF32Scalar(src + i, dst + i, n - i, scale, bias);
+}
+
+MY_TARGET("avx2,fma")
+static void HWC3ToCHWNormalizeU8Avx2(const my_u8 *src, size_t nPixels, float *const pDst[3],
+                                     const float aScale[3], const float aBias[3])
+{
+    __m256 vscale[3], vbias[3];
+    for (int k = 0; k < 3; k++)
+    {
+        vscale[k] = _mm256_set1_ps(aScale[k]);
+        vbias[k] = _mm256_set1_ps(aBias[k]);
+    }
+
+    size_t i = 0;
+    for (; i + 16 <= nPixels; i += 16)
+    {
+        __m128i ch[3];
+        Deinterleave3(src + 3 * i, ch);
+        for (int k = 0; k < 3; k++)
+        {
+            Normalize16Avx2(ch[k], pDst[k] + i, vscale[k], vbias[k]);
+        }
+    }
+
+    float *const pTail[3] = {pDst[0] + i, pDst[1] + i, pDst[2] + i};
+    HWC3ToCHWNormalizeU8Scalar(src + 3 * i, nPixels - i, pTail, aScale, aBias);
+}
+
+MY_TARGET("avx2,fma")
+static float ReduceMaxF32Avx2(const float *src, size_t n)
+{
+    __m256 vmax = _mm256_set1_ps(-INFINITY);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        vmax = _mm256_max_ps(vmax, _mm256_loadu_ps(src + i));
+    }
+    __m128 v = _mm_max_ps(_mm256_castps256_ps128(vmax), _mm256_extractf128_ps(vmax, 1));
+    v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+    v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+    float fMax = _mm_cvtss_f32(v);
+    float fTail = ReduceMaxF32Scalar(src + i, n - i);
+    return fTail > fMax ? fTail : fMax;
+}
+
+MY_TARGET("avx2,fma")
+static inline __m256 ExpAvx2(__m256 x)
+{
+    x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(-87.3f)), _mm256_set1_ps(88.3f));
+    __m256 k = _mm256_floor_ps(_mm256_fmadd_ps(x, _mm256_set1_ps(1.44269504f), _mm256_set1_ps(0.5f)));
+    x = _mm256_fnmadd_ps(k, _mm256_set1_ps(0.693359375f), x);
+    x = _mm256_fnmadd_ps(k, _mm256_set1_ps(-2.12194440e-4f), x);
+
+    __m256 y = _mm256_set1_ps(1.9875691500e-4f);
+    y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(1.3981999507e-3f));
+    y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(8.3334519073e-3f));
+    y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(4.1665795894e-2f));
+    y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(1.6666665459e-1f));
+    y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(5.0000001201e-1f));
+    y = _mm256_add_ps(_mm256_fmadd_ps(_mm256_mul_ps(y, x), x, x), _mm256_set1_ps(1.0f));
+
+    __m256i e = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(k), _mm256_set1_epi32(127)), 23);
+    return _mm256_mul_ps(y, _mm256_castsi256_ps(e));
+}
+
+MY_TARGET("avx2,fma")
+static float ExpSumF32Avx2(const float *src, float *dst, size_t n, float fMax)
+{
+    __m256 vmax = _mm256_set1_ps(fMax), vsum = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256 e = ExpAvx2(_mm256_sub_ps(_mm256_loadu_ps(src + i), vmax));
+        _mm256_storeu_ps(dst + i, e);
+        vsum = _mm256_add_ps(vsum, e);
+    }
+    float aSum[8];
+    _mm256_storeu_ps(aSum, vsum);
+    float fSum = 0.0f;
+    for (int j = 0; j < 8; j++)
+    {
+        fSum += aSum[j];
+    }
+    return fSum + ExpSumF32Scalar(src + i, dst + i, n - i, fMax);
+}
+
+MY_TARGET("avx2,fma,f16c")
+static void ConvertF32ToF16Avx2(const float *src, my_u16 *dst, size_t n)
+{
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        _mm_storeu_si128((__m128i *)(dst + i), _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT));
+        _mm_storeu_si128((__m128i *)(dst + i + 8),
+                         _mm256_cvtps_ph(_mm256_loadu_ps(src + i + 8), _MM_FROUND_TO_NEAREST_INT));
+    }
+    for (; i + 8 <= n; i += 8)
+    {
+        _mm_storeu_si128((__m128i *)(dst + i), _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT));
+    }
+    ConvertF32ToF16Scalar(src + i, dst + i, n - i);
+}
+
+MY_TARGET("avx2,fma")
+static inline __m256i BFloat16Avx2(__m256 x)
+{
+    __m256i b = _mm256_castps_si256(x);
+    __m256i lsb = _mm256_and_si256(_mm256_srli_epi32(b, 16), _mm256_set1_epi32(1));
+    __m256i r = _mm256_srli_epi32(_mm256_add_epi32(b, _mm256_add_epi32(lsb, _mm256_set1_epi32(0x7FFF))), 16);
+    __m256i nan = _mm256_or_si256(_mm256_srli_epi32(b, 16), _mm256_set1_epi32(0x40));
+    return _mm256_blendv_epi8(r, nan, _mm256_castps_si256(_mm256_cmp_ps(x, x, _CMP_UNORD_Q)));
+}
+
+MY_TARGET("avx2,fma")
+static void ConvertF32ToBF16Avx2(const float *src, my_u16 *dst, size_t n)
+{
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        // packus 按128位通道交错, 再把4个64位块排回顺序
+        __m256i r = _mm256_packus_epi32(BFloat16Avx2(_mm256_loadu_ps(src + i)),
+                                        BFloat16Avx2(_mm256_loadu_ps(src + i + 8)));
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_permute4x64_epi64(r, 0xD8));
+    }
+    ConvertF32ToBF16Scalar(src + i, dst + i, n - i);
+}
+
+MY_TARGET("avx2,fma")
+static inline __m256i QuantizeAvx2(const float *src, __m256 inv)
+{
+    __m256 v = _mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(src), inv), _mm256_set1_ps(-128.0f));
+    return _mm256_cvtps_epi32(_mm256_min_ps(v, _mm256_set1_ps(127.0f)));
+}
+
+MY_TARGET("avx2,fma")
+static void QuantizeF32ToS8Avx2(const float *src, my_s8 *dst, size_t n, float fInvScale)
+{
+    __m256 inv = _mm256_set1_ps(fInvScale);
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32)
+    {
+        __m256i ab = _mm256_packs_epi32(QuantizeAvx2(src + i, inv), QuantizeAvx2(src + i + 8, inv));
+        __m256i cd = _mm256_packs_epi32(QuantizeAvx2(src + i + 16, inv), QuantizeAvx2(src + i + 24, inv));
+        __m256i r = _mm256_packs_epi16(ab, cd);
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_permutevar8x32_epi32(r, order));
+    }
+    QuantizeF32ToS8Scalar(src + i, dst + i, n - i, fInvScale);
+}
+
+/*===================== AVX-512 =====================*/
+
+MY_TARGET("avx512f")
+static inline void Normalize16Avx512(__m128i v, float *dst, __m512 scale, __m512 bias)
+{
+    __m512 f = _mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(v));
+    _mm512_storeu_ps(dst, _mm512_add_ps(_mm512_mul_ps(f, scale), bias));
+}
+
+MY_TARGET("avx512f")
+static void NormalizeU8ToF32Avx512(const my_u8 *src, float *dst, size_t n, float scale, float bias)
+{
+    __m512 vscale = _mm512_set1_ps(scale), vbias = _mm512_set1_ps(bias);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        Normalize16Avx512(_mm_loadu_si128((const __m128i *)(src + i)), dst + i, vscale, vbias);
+    }
+    NormalizeU8ToF32Scalar(src + i, dst + i, n - i, scale, bias);
+}
+
+MY_TARGET("avx512f")
+static void NormalizeF32Avx512(const float *src, float *dst, size_t n, float scale, float bias)
+{
+    __m512 vscale = _mm512_set1_ps(scale), vbias = _mm512_set1_ps(bias);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        _mm512_storeu_ps(dst + i, _mm512_add_ps(_mm512_mul_ps(_mm512_loadu_ps(src + i), vscale), vbias));
+    }
+    NormalizeF32Scalar(src + i, dst + i, n - i, scale, bias);
+}
+
+MY_TARGET("avx512f,sse4.1")
+static void HWC3ToCHWNormalizeU8Avx512(const my_u8 *src, size_t nPixels, float *const pDst[3],
+                                       const float aScale[3], const float aBias[3])
+{
+    __m512 vscale[3], vbias[3];
+    for (int k = 0; k < 3; k++)
+    {
+        vscale[k] = _mm512_set1_ps(aScale[k]);
+        vbias[k] = _mm512_set1_ps(aBias[k]);
+    }
+
+    size_t i = 0;
+    for (; i + 16 <= nPixels; i += 16)
+    {
+        __m128i ch[3];
+        Deinterleave3(src + 3 * i, ch);
+        for (int k = 0; k < 3; k++)
+        {
+            Normalize16Avx512(ch[k], pDst[k] + i, vscale[k], vbias[k]);
+        }
+    }
+
+    float *const pTail[3] = {pDst[0] + i, pDst[1] + i, pDst[2] + i};
+    HWC3ToCHWNormalizeU8Scalar(src + 3 * i, nPixels - i, pTail, aScale, aBias);
+}
+
+MY_TARGET("avx512f")
+static float ReduceMaxF32Avx512(const float *src, size_t n)
+{
+    __m512 vmax = _mm512_set1_ps(-INFINITY);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        vmax = _mm512_max_ps(vmax, _mm512_loadu_ps(src + i));
+    }
+    float fMax = _mm512_reduce_max_ps(vmax);
+    float fTail = ReduceMaxF32Scalar(src + i, n - i);
+    return fTail > fMax ? fTail : fMax;
+}
+
+MY_TARGET("avx512f")
+static inline __m512 ExpAvx512(__m512 x)
+{
+    x = _mm512_min_ps(_mm512_max_ps(x, _mm512_set1_ps(-87.3f)), _mm512_set1_ps(88.3f));
+    __m512 k = _mm512_roundscale_ps(_mm512_fmadd_ps(x, _mm512_set1_ps(1.44269504f), _mm512_set1_ps(0.5f)),
+                                    _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+    x = _mm512_fnmadd_ps(k, _mm512_set1_ps(0.693359375f), x);
+    x = _mm512_fnmadd_ps(k, _mm512_set1_ps(-2.12194440e-4f), x);
+
+    __m512 y = _mm512_set1_ps(1.9875691500e-4f);
+    y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(1.3981999507e-3f));
+    y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(8.3334519073e-3f));
+    y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(4.1665795894e-2f));
+    y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(1.6666665459e-1f));
+    y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(5.0000001201e-1f));
+    y = _mm512_add_ps(_mm512_fmadd_ps(_mm512_mul_ps(y, x), x, x), _mm512_set1_ps(1.0f));
+
+    return _mm512_scalef_ps(y, k);
+}
+
+MY_TARGET("avx512f")
+static float ExpSumF32Avx512(const float *src, float *dst, size_t n, float fMax)
+{
+    __m512 vmax = _mm512_set1_ps(fMax), vsum = _mm512_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        __m512 e = ExpAvx512(_mm512_sub_ps(_mm512_loadu_ps(src + i), vmax));
+        _mm512_storeu_ps(dst + i, e);
+        vsum = _mm512_add_ps(vsum, e);
+    }
+    return _mm512_reduce_add_ps(vsum) + ExpSumF32Scalar(src + i, dst + i, n - i, fMax);
+}
+
+MY_TARGET("avx512f")
+static void ConvertF32ToF16Avx512(const float *src, my_u16 *dst, size_t n)
+{
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        _mm256_storeu_si256((__m256i *)(dst + i),
+                            _mm512_cvtps_ph(_mm512_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT));
+    }
+    ConvertF32ToF16Scalar(src + i, dst + i, n - i);
+}
+
+MY_TARGET("avx512f")
+static void ConvertF32ToBF16Avx512(const float *src, my_u16 *dst, size_t n)
+{
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        __m512 x = _mm512_loadu_ps(src + i);
+        __m512i b = _mm512_castps_si512(x);
+        __m512i lsb = _mm512_and_si512(_mm512_srli_epi32(b, 16), _mm512_set1_epi32(1));
+        __m512i r = _mm512_srli_epi32(_mm512_add_epi32(b, _mm512_add_epi32(lsb, _mm512_set1_epi32(0x7FFF))), 16);
+        __m512i nan = _mm512_or_si512(_mm512_srli_epi32(b, 16), _mm512_set1_epi32(0x40));
+        r = _mm512_mask_blend_epi32(_mm512_cmp_ps_mask(x, x, _CMP_UNORD_Q), r, nan);
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm512_cvtepi32_epi16(r));
+    }
+    ConvertF32ToBF16Scalar(src + i, dst + i, n - i);
+}
+
+MY_TARGET("avx512f")
+static void QuantizeF32ToS8Avx512(const float *src, my_s8 *dst, size_t n, float fInvScale)
+{
+    __m512 inv = _mm512_set1_ps(fInvScale);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        __m512 v = _mm512_max_ps(_mm512_mul_ps(_mm512_loadu_ps(src + i), inv), _mm512_set1_ps(-128.0f));
+        v = _mm512_min_ps(v, _mm512_set1_ps(127.0f));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm512_cvtsepi32_epi8(_mm512_cvtps_epi32(v)));
+    }
+    QuantizeF32ToS8Scalar(src + i, dst + i, n - i, fInvScale);
+}
+
+#endif // MY_KERNELS_X86
+
+/*===================== runtime dispatch =====================*/
+
+typedef void (*normalize_u8_fn)(const my_u8 *, float *, size_t, float, float);
+typedef void (*normalize_f32_fn)(const float *, float *, size_t, float, float);
+typedef void (*hwc3_to_chw_fn)(const my_u8 *, size_t, float *const *, const float *, const float *);
+typedef float (*reduce_max_fn)(const float *, size_t);
+typedef float (*exp_sum_fn)(const float *, float *, size_t, float);
+typedef void (*convert_f16_fn)(const float *, my_u16 *, size_t);
+typedef void (*quantize_s8_fn)(const float *, my_s8 *, size_t, float);
+
+struct KernelTable
+{
+    kernel_isa_t isa;
+    normalize_u8_fn normalize_u8;
+    normalize_f32_fn normalize_f32;
+    hwc3_to_chw_fn hwc3_to_chw;
+    reduce_max_fn reduce_max;
+    exp_sum_fn exp_sum;
+    convert_f16_fn to_f16;
+    convert_f16_fn to_bf16;
+    quantize_s8_fn quantize_s8;
+};
+
+static KernelTable MakeKernelTable(kernel_isa_t isa)
+{
+    KernelTable table = {KERNEL_ISA_SCALAR, NormalizeU8ToF32Scalar, NormalizeF32Scalar, HWC3ToCHWNormalizeU8Scalar,
+                         ReduceMaxF32Scalar, ExpSumF32Scalar, ConvertF32ToF16Scalar, ConvertF32ToBF16Scalar,
+                         QuantizeF32ToS8Scalar};
+#ifdef MY_KERNELS_X86
+    if (isa >= KERNEL_ISA_AVX512 && __builtin_cpu_supports("avx512f"))
+    {
+        KernelTable avx512 = {KERNEL_ISA_AVX512, NormalizeU8ToF32Avx512, NormalizeF32Avx512,
+                              HWC3ToCHWNormalizeU8Avx512, ReduceMaxF32Avx512, ExpSumF32Avx512,
+                              ConvertF32ToF16Avx512, ConvertF32ToBF16Avx512, QuantizeF32ToS8Avx512};
+        return avx512;
+    }
+    if (isa >= KERNEL_ISA_AVX2 && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") &&
+        __builtin_cpu_supports("f16c"))
+    {
+        KernelTable avx2 = {KERNEL_ISA_AVX2, NormalizeU8ToF32Avx2, NormalizeF32Avx2, HWC3ToCHWNormalizeU8Avx2,
+                            ReduceMaxF32Avx2, ExpSumF32Avx2, ConvertF32ToF16Avx2, ConvertF32ToBF16Avx2,
+                            QuantizeF32ToS8Avx2};
+        return avx2;
+    }
+    if (isa >= KERNEL_ISA_SSE41 && __builtin_cpu_supports("sse4.1"))
+    {
+        KernelTable sse41 = {KERNEL_ISA_SSE41, NormalizeU8ToF32Sse41, NormalizeF32Sse41, HWC3ToCHWNormalizeU8Sse41,
+                             ReduceMaxF32Sse41, ExpSumF32Sse41, ConvertF32ToF16Scalar, ConvertF32ToBF16Sse41,
+                             QuantizeF32ToS8Sse41};
+        return sse41;
+    }
+#endif
+    (void)isa;
+    return table;
+}
+
+static KernelTable g_kernels = MakeKernelTable(KERNEL_ISA_AVX512);
+
+/**
+ * @brief instruction set of the kernels in use
+ *
+ * @return kernel_isa_t
+ */
+kernel_isa_t GetKernelIsa()
+{
+    return g_kernels.isa;
+}
+
+/**
+ * @brief name of an instruction set, for logs and benchmarks
+ *
+ * @param isa
+ * @return const char*
+ */
+const char *GetKernelIsaName(kernel_isa_t isa)
+{
+    switch (isa)
+    {
+    case KERNEL_ISA_SSE41:
+        return "sse4.1";
+    case KERNEL_ISA_AVX2:
+        return "avx2";
+    case KERNEL_ISA_AVX512:
+        return "avx512";
+    default:
+        return "scalar";
+    }
+}
+
+/**
+ * @brief limit the kernels to an instruction set, the best one supported by the CPU and not above isa is used.
+ *        Not thread safe, call it before any inference.
+ *
+ * @param isa  最高使用的指令集
+ */
+void SetKernelIsa(kernel_isa_t isa)
+{
+    g_kernels = MakeKernelTable(isa);
+}
+
+void ConvertU8ToF32(const my_u8 *src, float *dst, size_t n)
+{
+    g_kernels.normalize_u8(src, dst, n, 1.0f, 0.0f);
+}
+
+void NormalizeF32(const float *src, float *dst, size_t n, float scale, float bias)
+{
+    g_kernels.normalize_f32(src, dst, n, scale, bias);
+}
+
+void NormalizeU8ToF32(const my_u8 *src, float *dst, size_t n, float scale, float bias)
+{
+    g_kernels.normalize_u8(src, dst, n, scale, bias);
+}
+
+void HWC3ToCHWNormalizeU8(const my_u8 *src, size_t nPixels, float *const pDst[3], const float aScale[3],
+                          const float aBias[3])
+{
+    g_kernels.hwc3_to_chw(src, nPixels, pDst, aScale, aBias);
+}
+
+float ReduceMaxF32(const float *src, size_t n)
+{
+    return g_kernels.reduce_max(src, n);
+}
+
+float ExpSumF32(const float *src, float *dst, size_t n, float fMax)
+{
+    return g_kernels.exp_sum(src, dst, n, fMax);
+}
+
+void ConvertF32ToF16(const float *src, my_u16 *dst, size_t n)
+{
+    g_kernels.to_f16(src, dst, n);
+}
+
+void ConvertF32ToBF16(const float *src, my_u16 *dst, size_t n)
+{
+    g_kernels.to_bf16(src, dst, n);
+}
+
+void QuantizeF32ToS8(const float *src, my_s8 *dst, size_t n, float fInvScale)
+{
+    g_kernels.quantize_s8(src, dst, n, fInvScale);
+}
@@ -0,0 +1,61 @@
+#ifndef MY_INFERENCE_ONNX_MY_KERNELS_H
+#define MY_INFERENCE_ONNX_MY_KERNELS_H
+#include <cstddef>
+#include "common.h"
+
+// 按CPU支持的指令集选择的实现
+typedef enum
+{
+    KERNEL_ISA_SCALAR = 0,
+    KERNEL_ISA_SSE41,
+    KERNEL_ISA_AVX2,
+    KERNEL_ISA_AVX512,
+} kernel_isa_t;
+
+kernel_isa_t GetKernelIsa();
+
+const char *GetKernelIsaName(kernel_isa_t isa);
+
+void SetKernelIsa(kernel_isa_t isa);
+
+// dst[i] = src[i]
+void ConvertU8ToF32(const my_u8 *src, float *dst, size_t n);
+
+// dst[i] = src[i] * scale + bias, 即 (x - mean) * inv_std
+void NormalizeF32(const float *src, float *dst, size_t n, float scale, float bias);
+
+// dst[i] = (float)src[i] * scale + bias
+void NormalizeU8ToF32(const my_u8 *src, float *dst, size_t n, float scale, float bias);
+
+// 3通道交错的 uint8 像素 -> 3个 float 平面, 源通道k写入 pDst[k], 使用 aScale[k]/aBias[k]
+void HWC3ToCHWNormalizeU8(const my_u8 *src, size_t nPixels, float *const pDst[3], const float aScale[3],
+                          const float aBias[3]);
+
+// 最大值, n 为 0 时返回 -inf
+float ReduceMaxF32(const float *src, size_t n);
+
+// dst[i] = exp(src[i] - fMax), 返回 dst 之和; 用于 softmax
+float ExpSumF32(const float *src, float *dst, size_t n, float fMax);
+
+// float -> IEEE fp16, 就近舍入到偶数; SSE4.1 没有 F16C, 使用标量实现
+void ConvertF32ToF16(const float *src, my_u16 *dst, size_t n);
+
+// float -> bfloat16, 就近舍入到偶数
+void ConvertF32ToBF16(const float *src, my_u16 *dst, size_t n);
+
+// dst[i] = saturate(round(src[i] * fInvScale)), 对称量化到 int8
+void QuantizeF32ToS8(const float *src, my_s8 *dst, size_t n, float fInvScale);
+
+// 标量参考实现, 用于校验
+void ConvertU8ToF32Scalar(const my_u8 *src, float *dst, size_t n);
+void NormalizeF32Scalar(const float *src, float *dst, size_t n, float scale, float bias);
+void NormalizeU8ToF32Scalar(const my_u8 *src, float *dst, size_t n, float scale, float bias);
+void HWC3ToCHWNormalizeU8Scalar(const my_u8 *src, size_t nPixels, float *const pDst[3], const float aScale[3],
+                                const float aBias[3]);
+float ReduceMaxF32Scalar(const float *src, size_t n);
+float ExpSumF32Scalar(const float *src, float *dst, size_t n, float fMax);
+void ConvertF32ToF16Scalar(const float *src, my_u16 *dst, size_t n);
+void ConvertF32ToBF16Scalar(const float *src, my_u16 *dst, size_t n);
+void QuantizeF32ToS8Scalar(const float *src, my_s8 *dst, size_t n, float fInvScale);
+
+#endif //MY_INFERENCE_ONNX_MY_KERNELS_H
@@ -4,13 +4,25 @@
 #include <chrono>
 #include <string>
 #include <unistd.h>
+#include <sys/stat.h>
 #include <assert.h>
+#include <algorithm>
 #include "aes.h"
 #include "my_utils.h"
+#include "my_kernels.h"
+#include "my_preprocess.h"
+#include "my_postprocess.h"
+#include "my_quantize.h"
+#include "my_admission.h"
+#include "my_coalesce.h"
+#include "my_cache.h"
+#include "my_async.h"
 
 static const OrtApi *g_pOrt = OrtGetApiBase()->GetApi(ORT_API_VERSION); // global api manager
 static OrtEnv *g_pEnv = nullptr;
 static int g_pEnv_ref_count = 0;
+static bool g_bEnvGlobalThreadPools = false; // env created with thread pools shared by all sessions
+static std::mutex g_env_mutex;               // env is shared by all model handles
 
 /**
  * @brief get saved model dir
@@ -27,78 +39,472 @@ static std::string getCurrentModelDir()
     return myPath;
 }
 
+/**
+ * @brief bytes of one element of an onnx tensor type
+ *
+ * @param type  onnx tensor element type
+ * @return size_t, 0 for unsupported types such as string
+ */
+static size_t OnnxElementSize(ONNXTensorElementDataType type)
+{
+    switch (type)
+    {
+    case ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT:
+    case ONNX_TENSOR_ELEMENT_DATA_TYPE_INT32:
+    case ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT32:
+        return 4;
+    case ONNX_TENSOR_ELEMENT_DATA_TYPE_DOUBLE:
+    case ONNX_TENSOR_ELEMENT_DATA_TYPE_INT64:
+    case ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT64:
+        return 8;
+    case ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT16:
+    case ONNX_TENSOR_ELEMENT_DATA_TYPE_BFLOAT16:
+    case ONNX_TENSOR_ELEMENT_DATA_TYPE_INT16:
+    case ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT16:
+        return 2;
+    case ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT8:
+    case ONNX_TENSOR_ELEMENT_DATA_TYPE_INT8:
+    case ONNX_TENSOR_ELEMENT_DATA_TYPE_BOOL:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+/**
+ * @brief map tensor_types_t to onnx tensor element type
+ *
+ * @param type  tensor type
+ * @param onnx_type  onnx tensor element type
+ * @return bool  false if the type is not supported
+ */
+static bool TensorTypeToOnnx(tensor_types_t type, ONNXTensorElementDataType *onnx_type)
+{
+    switch (type)
+    {
+    case DT_FLOAT:
+        *onnx_type = ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT;
+        return true;
+    case DT_DOUBLE:
+        *onnx_type = ONNX_TENSOR_ELEMENT_DATA_TYPE_DOUBLE;
+        return true;
+    case DT_INT32:
+        *onnx_type = ONNX_TENSOR_ELEMENT_DATA_TYPE_INT32;
+        return true;
+    case DT_UINT8:
+        *onnx_type = ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT8;
+        return true;
+    case DT_INT16:
+        *onnx_type = ONNX_TENSOR_ELEMENT_DATA_TYPE_INT16;
+        return true;
+    case DT_INT8:
+        *onnx_type = ONNX_TENSOR_ELEMENT_DATA_TYPE_INT8;
+        return true;
+    case DT_INT64:
+        *onnx_type = ONNX_TENSOR_ELEMENT_DATA_TYPE_INT64;
+        return true;
+    case DT_BOOL:
+        *onnx_type = ONNX_TENSOR_ELEMENT_DATA_TYPE_BOOL;
+        return true;
+    case DT_HALF:
+        *onnx_type = ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT16;
+        return true;
+    case DT_BFLOAT16:
+        *onnx_type = ONNX_TENSOR_ELEMENT_DATA_TYPE_BFLOAT16;
+        return true;
+    default:
+        return false;
+    }
+}
+
+/**
+ * @brief map onnx tensor element type to tensor_types_t
+ *
+ * @param onnx_type  onnx tensor element type
+ * @param type  tensor type
+ * @return bool  false if the type is not supported
+ */
+static bool OnnxToTensorType(ONNXTensorElementDataType onnx_type, tensor_types_t *type)
+{
+    static const tensor_types_t aTypes[] = {DT_FLOAT, DT_DOUBLE, DT_INT32, DT_UINT8, DT_INT16,
+                                            DT_INT8, DT_INT64, DT_BOOL, DT_HALF, DT_BFLOAT16};
+    for (size_t i = 0; i < sizeof(aTypes) / sizeof(aTypes[0]); i++)
+    {
+        ONNXTensorElementDataType cur_type;
+        if (TensorTypeToOnnx(aTypes[i], &cur_type) && cur_type == onnx_type)
+        {
+            *type = aTypes[i];
+            return true;
+        }
+    }
+    return false;
+}
+
 /**
  * @brief get runtime env and load encrypted model
  * 
+ * @param pModelContent  可为NULL; 不为NULL时是内存中的明文模型, 不读 model_path, 也不写临时文件
  * @return result_t 
  */
-result_t OnnxRuntimeModelHandle::my_onnxruntime_open_model()
+result_t OnnxRuntimeModelHandle::my_onnxruntime_open_model(const std::string *pModelContent)
 {
     // 线程安全
     m_onnx_mutex.lock();
 
+    const memory_params_t *pMemParam = &m_tModelParam->memory_params;
+
+    g_env_mutex.lock();
     if (g_pEnv == nullptr)  // 主线程中初始化OnnxRuntime Env
     {
-        CheckStatus(g_pOrt->CreateEnv(ORT_LOGGING_LEVEL_WARNING, "OnnxRuntime", &g_pEnv));
+        if (pMemParam->bShareEnvThreadPools)
+        {
+            OrtThreadingOptions *pThreadingOptions;
+            CheckStatus(g_pOrt->CreateThreadingOptions(&pThreadingOptions));
+            CheckStatus(g_pOrt->CreateEnvWithGlobalThreadPools(ORT_LOGGING_LEVEL_WARNING, "OnnxRuntime",
+                                                               pThreadingOptions, &g_pEnv));
+            g_pOrt->ReleaseThreadingOptions(pThreadingOptions);
+            g_bEnvGlobalThreadPools = true;
+        }
+        else
+        {
+            CheckStatus(g_pOrt->CreateEnv(ORT_LOGGING_LEVEL_WARNING, "OnnxRuntime", &g_pEnv));
+        }
         std::cout << "Create  env =========" << std::endl;
     }
     g_pEnv_ref_count++;
+    g_env_mutex.unlock();
 
     // session option
     CheckStatus(g_pOrt->CreateSessionOptions(&m_pSessionOptions));
-    g_pOrt->SetIntraOpNumThreads(m_pSessionOptions, 1);
+    SetupSessionOptions(m_pSessionOptions);
+
+    // 输入tensor使用调用者的内存, memory info 只需创建一次
+    CheckStatus(g_pOrt->CreateCpuMemoryInfo(OrtArenaAllocator, OrtMemTypeDefault, &m_pCpuMemoryInfo));
+
+    std::string strModelAbsolutePath = getCurrentModelDir() + "/" + m_tModelParam->model_path;
+    if (m_tModelParam->model_path[0] == '/')  // absolute path
+    {
+        strModelAbsolutePath = std::string(m_tModelParam->model_path);
+    }
+
+    double dStartMs = GetTimeMs();
+    std::string strOutFileContent; // 解密后的模型, 创建完所有特化session后释放
+
+    // 内存中的明文模型
+    if (pModelContent != NULL)
+    {
+        strOutFileContent = *pModelContent;
+        m_tLoadProfile.nModelFileBytes = strOutFileContent.size();
+        CheckStatus(g_pOrt->CreateSessionFromArray(g_pEnv, strOutFileContent.c_str(), strOutFileContent.size(),
+                                                   m_pSessionOptions, &m_pSession));
+        RecordLoadPhase(LOAD_PHASE_CREATE_SESSION, dStartMs);
+    }
+    // 解密加载模型
+    else if (m_tModelParam->bIsCipher)
+    {
+        int encStartPoint = m_tModelParam->encStartPoint / 16;
+        int encLength = m_tModelParam->encLength / 16;
+
+        // 读文件和解密分开, 便于分别统计耗时
+        std::string strFileContent = my_onnx::ReadModelFile(strModelAbsolutePath);
+        m_tLoadProfile.nModelFileBytes = strFileContent.size();
+        RecordLoadPhase(LOAD_PHASE_FILE_READ, dStartMs);
+
+        dStartMs = GetTimeMs();
+        strOutFileContent = my_onnx::DecryptionBufferPartial(strFileContent, encStartPoint, encLength);
+        std::string().swap(strFileContent);
+        RecordLoadPhase(LOAD_PHASE_DECRYPT, dStartMs);
+        if (strOutFileContent == "error")
+        {
+            MY_ERROR("decrypt model %s failed\n", strModelAbsolutePath.c_str());
+            m_onnx_mutex.unlock();
+            return MY_MODEL_LOAD_FAILED;
+        }
+
+        dStartMs = GetTimeMs();
+        CheckStatus(g_pOrt->CreateSessionFromArray(g_pEnv, strOutFileContent.c_str(), strOutFileContent.size(),
+                                                   m_pSessionOptions, &m_pSession));
+        RecordLoadPhase(LOAD_PHASE_CREATE_SESSION, dStartMs);
+    }
+    else
+    {
+        std::cout << "Begin to load onnx model  " << strModelAbsolutePath << std::endl;
+        struct stat tFileStat;
+        if (stat(strModelAbsolutePath.c_str(), &tFileStat) == 0)
+        {
+            m_tLoadProfile.nModelFileBytes = tFileStat.st_size;
+        }
+        CheckStatus(g_pOrt->CreateSession(g_pEnv, strModelAbsolutePath.c_str(), m_pSessionOptions, &m_pSession));
+        RecordLoadPhase(LOAD_PHASE_CREATE_SESSION, dStartMs);
+    }
+
+    // 量化模型在未开启完整优化时会按 Q/DQ 逐个执行, 比 fp32 还慢
+    if (!m_tModelParam->bQuantizedModel && m_tModelParam->cpu_or_gpu == 0 && IsQuantizedModel(m_pSession) &&
+        (int)m_tModelParam->model_optimize_level < (int)ORT_ENABLE_EXTENDED)
+    {
+        std::cout << "Model " << strModelAbsolutePath << " is int8 quantized, reload with ORT_ENABLE_ALL" << std::endl;
+        m_tModelParam->bQuantizedModel = TRUE;
+        g_pOrt->ReleaseSession(m_pSession);
+        m_pSession = nullptr;
+        CheckStatus(g_pOrt->SetSessionGraphOptimizationLevel(m_pSessionOptions, ORT_ENABLE_ALL));
+
+        dStartMs = GetTimeMs();
+        if (strOutFileContent.empty())
+        {
+            CheckStatus(g_pOrt->CreateSession(g_pEnv, strModelAbsolutePath.c_str(), m_pSessionOptions, &m_pSession));
+        }
+        else
+        {
+            CheckStatus(g_pOrt->CreateSessionFromArray(g_pEnv, strOutFileContent.c_str(), strOutFileContent.size(),
+                                                       m_pSessionOptions, &m_pSession));
+        }
+        RecordLoadPhase(LOAD_PHASE_CREATE_SESSION, dStartMs);
+    }
+
+    CreateVariantSessions(strModelAbsolutePath, strOutFileContent);
+    std::string().swap(strOutFileContent);
+
+    m_onnx_mutex.unlock();
+
+    dStartMs = GetTimeMs();
+    GetModelInfo();
+    FindVariantDims();
+    RecordLoadPhase(LOAD_PHASE_MODEL_INFO, dStartMs);
+
+    if (MY_SUCCESS != WarmUp())
+    {
+        MY_ERROR("warm up model %s failed\n", strModelAbsolutePath.c_str());
+        return MY_MODEL_LOAD_FAILED;
+    }
+
+    std::cout << "Load onnx model  " << strModelAbsolutePath << "  succeed!!" << std::endl;
+
+    return MY_SUCCESS;
+}
+
+/**
+ * @brief whether the model carries the MY_QUANTIZATION_METADATA_KEY written by the calibration tool
+ *
+ * @param pSession  已加载的session
+ * @return bool
+ */
+bool OnnxRuntimeModelHandle::IsQuantizedModel(OrtSession *pSession)
+{
+    OrtModelMetadata *pMetadata = nullptr;
+    OrtStatus *status = g_pOrt->SessionGetModelMetadata(pSession, &pMetadata);
+    if (status != nullptr)
+    {
+        g_pOrt->ReleaseStatus(status);
+        return false;
+    }
+
+    OrtAllocator *pAllocator = nullptr;
+    CheckStatus(g_pOrt->GetAllocatorWithDefaultOptions(&pAllocator));
+    char *pValue = nullptr;
+    status = g_pOrt->ModelMetadataLookupCustomMetadataMap(pMetadata, pAllocator, MY_QUANTIZATION_METADATA_KEY,
+                                                          &pValue);
+    bool bQuantized = false;
+    if (status != nullptr)
+    {
+        g_pOrt->ReleaseStatus(status);
+    }
+    else if (pValue != nullptr)
+    {
+        bQuantized = true;
+        CheckStatus(g_pOrt->AllocatorFree(pAllocator, pValue));
+    }
+    g_pOrt->ReleaseModelMetadata(pMetadata);
+    return bQuantized;
+}
+
+/**
+ * @brief apply threads, memory, free dimension overrides and execution provider settings of m_tModelParam
+ *
+ * @param pSessionOptions  session options to setup
+ */
+void OnnxRuntimeModelHandle::SetupSessionOptions(OrtSessionOptions *pSessionOptions)
+{
+    const memory_params_t *pMemParam = &m_tModelParam->memory_params;
+
+    if (pMemParam->bShareEnvThreadPools && g_bEnvGlobalThreadPools)
+    {
+        CheckStatus(g_pOrt->DisablePerSessionThreads(pSessionOptions));
+    }
+    else
+    {
+        if (pMemParam->bShareEnvThreadPools)
+        {
+            std::cout << "Env is created without global thread pools, use per session threads" << std::endl;
+        }
+        int nIntraOpThreads = m_tModelParam->nIntraOpThreads > 0 ? m_tModelParam->nIntraOpThreads : 1;
+        CheckStatus(g_pOrt->SetIntraOpNumThreads(pSessionOptions, nIntraOpThreads));
+    }
+
+    // memory: arena只增长不收缩, 关闭后内存在Run结束时归还
+    if (pMemParam->arena_mode == CPU_ARENA_DISABLED)
+    {
+        CheckStatus(g_pOrt->DisableCpuMemArena(pSessionOptions));
+    }
+    if (pMemParam->bDisableMemPattern)
+    {
+        CheckStatus(g_pOrt->DisableMemPattern(pSessionOptions));
+    }
 
     // Sets graph optimization level.  For TensorRT
     GraphOptimizationLevel optmizeLevel = (GraphOptimizationLevel)m_tModelParam->model_optimize_level;
-    g_pOrt->SetSessionGraphOptimizationLevel(m_pSessionOptions, optmizeLevel);
+    if (m_tModelParam->bQuantizedModel && m_tModelParam->cpu_or_gpu == 0)
+    {
+        optmizeLevel = ORT_ENABLE_ALL; // QDQ -> QLinearConv / MatMulInteger 的融合在 ORT_ENABLE_EXTENDED 以上
+    }
+    g_pOrt->SetSessionGraphOptimizationLevel(pSessionOptions, optmizeLevel);
 
     if (m_tModelParam->cpu_or_gpu == 1)  // GPU or CPU
     {
 #ifdef USE_TRT
         if (optmizeLevel > ORT_DISABLE_ALL)
         {
-            OrtSessionOptionsAppendExecutionProvider_Tensorrt(m_pSessionOptions, m_tModelParam->gpu_id);
+            OrtSessionOptionsAppendExecutionProvider_Tensorrt(pSessionOptions, m_tModelParam->gpu_id);
         }
         else
         {
 #endif
-            OrtSessionOptionsAppendExecutionProvider_CUDA(m_pSessionOptions, m_tModelParam->gpu_id);
+            OrtSessionOptionsAppendExecutionProvider_CUDA(pSessionOptions, m_tModelParam->gpu_id);
 
 #ifdef USE_TRT
         }
 #endif
     }
 
-    std::string strModelAbsolutePath = getCurrentModelDir() + "/" + m_tModelParam->model_path;
-    if (m_tModelParam->model_path[0] == '/')  // absolute path
+    // 固定符号维度, 便于常量折叠和选择固定shape的kernel
+    for (int i = 0; i < m_tModelParam->nFreeDimOverrides; i++)
     {
-        strModelAbsolutePath = std::string(m_tModelParam->model_path);
+        const free_dim_override_t *pOverride = &m_tModelParam->aFreeDimOverrides[i];
+        if (pOverride->bByDenotation)
+        {
+            CheckStatus(g_pOrt->AddFreeDimensionOverride(pSessionOptions, pOverride->aDimName, pOverride->nDimValue));
+        }
+        else
+        {
+            CheckStatus(g_pOrt->AddFreeDimensionOverrideByName(pSessionOptions, pOverride->aDimName,
+                                                               pOverride->nDimValue));
+        }
     }
+}
 
-    // 解密加载模型
-    if (m_tModelParam->bIsCipher)
+/**
+ * @brief load one more session per model_variants_t value, with the variant dim fixed to that value
+ *
+ * @param strModelPath  模型路径, strModelContent 为空时从文件加载
+ * @param strModelContent  解密后的模型
+ */
+void OnnxRuntimeModelHandle::CreateVariantSessions(const std::string &strModelPath, const std::string &strModelContent)
+{
+    const model_variants_t *pVariants = &m_tModelParam->variants;
+
+    for (int i = 0; i < pVariants->nValues && i < 8; i++)
     {
-        int encStartPoint = m_tModelParam->encStartPoint / 16;
-        int encLength = m_tModelParam->encLength / 16;
+        OrtSessionOptions *pSessionOptions;
+        CheckStatus(g_pOrt->CreateSessionOptions(&pSessionOptions));
+        SetupSessionOptions(pSessionOptions);
+        CheckStatus(g_pOrt->AddFreeDimensionOverrideByName(pSessionOptions, pVariants->aDimName,
+                                                           pVariants->aValues[i]));
+
+        OrtSession *pSession = nullptr;
+        if (strModelContent.empty())
+        {
+            CheckStatus(g_pOrt->CreateSession(g_pEnv, strModelPath.c_str(), pSessionOptions, &pSession));
+        }
+        else
+        {
+            CheckStatus(g_pOrt->CreateSessionFromArray(g_pEnv, strModelContent.data(), strModelContent.size(),
+                                                       pSessionOptions, &pSession));
+        }
+        g_pOrt->ReleaseSessionOptions(pSessionOptions);
 
-        std::string strOutFileContent = my_onnx::DecryptionModelPartial(strModelAbsolutePath, encStartPoint, encLength);
+        m_vecVariantSessions.push_back(pSession);
+        m_vecVariantValues.push_back(pVariants->aValues[i]);
+        std::cout << "Load variant session " << pVariants->aDimName << "=" << pVariants->aValues[i] << std::endl;
+    }
+}
 
-        CheckStatus(g_pOrt->CreateSessionFromArray(g_pEnv, strOutFileContent.c_str(), strOutFileContent.size(),
-                                                   m_pSessionOptions, &m_pSession));
+/**
+ * @brief find where the variant dim appears in the model inputs, by symbolic dim name
+ *
+ */
+void OnnxRuntimeModelHandle::FindVariantDims()
+{
+    m_vecVariantDimPos.clear();
+    if (m_vecVariantSessions.empty())
+    {
+        return;
     }
-    else
+
+    for (size_t i = 0; i < m_vecInputNodesName.size(); i++)
     {
-        std::cout << "Begin to load onnx model  " << strModelAbsolutePath << std::endl;
-        CheckStatus(g_pOrt->CreateSession(g_pEnv, strModelAbsolutePath.c_str(), m_pSessionOptions, &m_pSession));
+        OrtTypeInfo *typeinfo;
+        CheckStatus(g_pOrt->SessionGetInputTypeInfo(m_pSession, i, &typeinfo));
+        const OrtTensorTypeAndShapeInfo *tensor_info;
+        CheckStatus(g_pOrt->CastTypeInfoToTensorInfo(typeinfo, &tensor_info));
+
+        size_t num_dims;
+        CheckStatus(g_pOrt->GetDimensionsCount(tensor_info, &num_dims));
+        std::vector<const char *> dim_names(num_dims, nullptr);
+        CheckStatus(g_pOrt->GetSymbolicDimensions(tensor_info, dim_names.data(), num_dims));
+
+        for (size_t j = 0; j < num_dims; j++)
+        {
+            if (dim_names[j] != nullptr && strcmp(dim_names[j], m_tModelParam->variants.aDimName) == 0)
+            {
+                m_vecVariantDimPos.push_back(std::make_pair(i, j));
+            }
+        }
+        g_pOrt->ReleaseTypeInfo(typeinfo);
     }
 
-    m_onnx_mutex.unlock();
+    if (m_vecVariantDimPos.empty())
+    {
+        std::cout << "Variant dim " << m_tModelParam->variants.aDimName << " not found in inputs, "
+                  << "variant sessions will not be used" << std::endl;
+    }
+}
 
-    GetModelInfo();
+/**
+ * @brief pick the variant session whose fixed dim equals the dim of the inputs, or the generic session
+ *
+ * @param vecInputDims  dims of every input
+ * @return OrtSession*
+ */
+OrtSession *OnnxRuntimeModelHandle::SelectSession(const std::vector<std::vector<int64_t>> &vecInputDims)
+{
+    if (m_vecVariantDimPos.empty())
+    {
+        return m_pSession;
+    }
 
-    std::cout << "Load onnx model  " << strModelAbsolutePath << "  succeed!!" << std::endl;
+    // 特化的维度在所有输入中必须一致
+    int64_t nValue = -1;
+    for (size_t k = 0; k < m_vecVariantDimPos.size(); k++)
+    {
+        size_t i = m_vecVariantDimPos[k].first, j = m_vecVariantDimPos[k].second;
+        if (i >= vecInputDims.size() || j >= vecInputDims[i].size())
+        {
+            return m_pSession;
+        }
+        if (nValue >= 0 && vecInputDims[i][j] != nValue)
+        {
+            return m_pSession;
+        }
+        nValue = vecInputDims[i][j];
+    }
 
-    return MY_SUCCESS;
+    for (size_t v = 0; v < m_vecVariantValues.size(); v++)
+    {
+        if (m_vecVariantValues[v] == nValue)
+        {
+            return m_vecVariantSessions[v];
+        }
+    }
+    return m_pSession;
 }
 
 /**
@@ -116,18 +522,34 @@ result_t OnnxRuntimeModelHandle::my_onnxruntime_release_model()
         m_pSession = nullptr;
     }
 
+    for (size_t i = 0; i < m_vecVariantSessions.size(); i++)
+    {
+        g_pOrt->ReleaseSession(m_vecVariantSessions[i]);
+    }
+    m_vecVariantSessions.clear();
+    m_vecVariantValues.clear();
+
     if (m_pSessionOptions)
     {
         g_pOrt->ReleaseSessionOptions(m_pSessionOptions);
         m_pSessionOptions = nullptr;
     }
 
+    if (m_pCpuMemoryInfo)
+    {
+        g_pOrt->ReleaseMemoryInfo(m_pCpuMemoryInfo);
+        m_pCpuMemoryInfo = nullptr;
+    }
+
+    g_env_mutex.lock();
     g_pEnv_ref_count--;
     if (g_pEnv_ref_count <= 0)
     {
         g_pOrt->ReleaseEnv(g_pEnv);
         g_pEnv = nullptr;
+        g_bEnvGlobalThreadPools = false;
     }
+    g_env_mutex.unlock();
 
     m_onnx_mutex.unlock();
 
@@ -150,6 +572,23 @@ void OnnxRuntimeModelHandle::CheckStatus(OrtStatus *status)
     }
 }
 
+/**
+ * @brief for errors that only fail the current call: log the onnxruntime error and release it
+ *
+ * @param status  onnxruntime 返回值, 可为NULL
+ * @return result_t  MY_FAILED if status is an error
+ */
+result_t OnnxRuntimeModelHandle::ReportStatus(OrtStatus *status)
+{
+    if (status != NULL)
+    {
+        MY_ERROR("onnxruntime: %s\n", g_pOrt->GetErrorMessage(status));
+        g_pOrt->ReleaseStatus(status);
+        return MY_FAILED;
+    }
+    return MY_SUCCESS;
+}
+
 /**
  * @brief 加载模型后，保存和打印模型信息
  * 
@@ -199,6 +638,7 @@ void OnnxRuntimeModelHandle::GetModelInfo()
             printf("Input %zu : dim %zu=%jd\n", i, j, cur_node_dims[j]);
 
         m_vecInputNodesDims.push_back(cur_node_dims);
+        m_vecModelInputDims.push_back(cur_node_dims);
         g_pOrt->ReleaseTypeInfo(typeinfo);
     }
 
@@ -269,122 +709,446 @@ bool OnnxRuntimeModelHandle::FindNameInTensorNames(const char *cur_name, std::ve
  */
 result_t OnnxRuntimeModelHandle::my_onnxruntime_inference_tensors()
 {
-    m_onnx_mutex.lock();
+    return my_onnxruntime_inference_tensors(m_input_tensor_array, m_ouput_tensor_array);
+}
 
-    /*===================== process input tensor =====================*/
-    MY_DEBUG("Begin onnx inference tensors!\n");
-    assert(m_input_tensor_array->nArraySize == m_vecInputNodesType.size());
+/**
+ * @brief inference on caller provided tensors instead of the ones bound at load time, so that several
+ *        buffers (e.g. double buffered inputs) can be used with one handle
+ *
+ * @param input_tensor_array  输入tensor
+ * @param output_tensor_array  输出tensor
+ * @return result_t
+ */
+result_t OnnxRuntimeModelHandle::my_onnxruntime_inference_tensors(tensor_array_t *input_tensor_array,
+                                                                  tensor_array_t *output_tensor_array)
+{
+    return my_onnxruntime_inference_tensors(input_tensor_array, output_tensor_array, NULL);
+}
 
-    // OrtValue *input_tensors[1];
-    std::vector<OrtValue *> input_tensors(m_input_tensor_array->nArraySize);
-    OrtValue *input_tensor = NULL;
+/**
+ * @brief run with run options that another thread may terminate, for deadlines and cancellation.
+ *        A terminated run returns MY_FAILED instead of exiting the process.
+ *
+ * @param input_tensor_array  输入tensor
+ * @param output_tensor_array  输出tensor
+ * @param pRunOptions  可为NULL; RunOptionsSetTerminate 后正在执行或等待锁的推理失败返回
+ * @return result_t
+ */
+result_t OnnxRuntimeModelHandle::my_onnxruntime_inference_tensors(tensor_array_t *input_tensor_array,
+                                                                  tensor_array_t *output_tensor_array,
+                                                                  OrtRunOptions *pRunOptions)
+{
+    MY_CHECK_NULL(input_tensor_array, MY_PARAM_NULL);
+    MY_CHECK_NULL(output_tensor_array, MY_PARAM_NULL);
 
-    for (int i = 0; i < m_input_tensor_array->nArraySize; i++)
+    if (m_pResultCache == nullptr)
     {
-        tensor_t *cur_tensor = &(m_input_tensor_array->pTensorArray[i]);
-        tensor_params_t *cur_tensor_param = cur_tensor->pTensorInfo;
-
-        // Check shape of inputs
-        for (int j = 0; j < cur_tensor_param->nDims; j++)
-        {
-            if (cur_tensor_param->pShape[j] <= 0)
-            {
-                std::cout << "Tensor " << cur_tensor_param->aTensorName << " shape[ " << j << " ] should be  > 0" << std::endl;
-                return MY_FAILED;
-            }
-        }
+        return RunCoalesced(input_tensor_array, output_tensor_array, pRunOptions);
+    }
 
-        // input size
-        GetTensorSize(cur_tensor);
+    // 命中时只拷贝缓存的输出, 不经过准入控制和句柄锁
+    ResultCacheKey key = m_pResultCache->MakeKey(input_tensor_array, output_tensor_array);
+    if (m_pResultCache->Lookup(key, output_tensor_array))
+    {
+        return MY_SUCCESS;
+    }
+    result_t res = RunCoalesced(input_tensor_array, output_tensor_array, pRunOptions);
+    if (MY_SUCCESS == res)
+    {
+        m_pResultCache->Insert(key, output_tensor_array);
+    }
+    return res;
+}
 
-        // input dims
-        m_vecInputNodesDims[i].clear();
-        for (int j = 0; j < cur_tensor_param->nDims; j++)
-        {
-            m_vecInputNodesDims[i].push_back(cur_tensor_param->pShape[j]);
-        }
+/**
+ * @brief run, or wait for a concurrent run with the same inputs when bCoalesceRequests is set.
+ *        Requests with run options carry their own deadline or cancellation, which a follower waiting on
+ *        another request's run could not honour, so they always run by themselves.
+ *
+ * @param input_tensor_array  输入tensor
+ * @param output_tensor_array  输出tensor
+ * @param pRunOptions  可为NULL, 非NULL时不合并
+ * @return result_t  a follower gets the leader's result, including MY_OVERLOADED
+ */
+result_t OnnxRuntimeModelHandle::RunCoalesced(tensor_array_t *input_tensor_array,
+                                              tensor_array_t *output_tensor_array, OrtRunOptions *pRunOptions)
+{
+    if (m_pCoalescer == nullptr || pRunOptions != NULL)
+    {
+        return RunAdmitted(input_tensor_array, output_tensor_array, pRunOptions);
+    }
 
-        // create inputs memory
-        OrtMemoryInfo *memory_info;
-        CheckStatus(g_pOrt->CreateCpuMemoryInfo(OrtArenaAllocator, OrtMemTypeDefault, &memory_info));
+    // 输入相同的并发请求等待同一次执行, 失败时也共用结果, 不各自重试
+    bool bLeader = false;
+    std::shared_ptr<CoalescedRun> pRun = m_pCoalescer->Join(input_tensor_array, output_tensor_array, &bLeader);
+    if (!bLeader)
+    {
+        return m_pCoalescer->Wait(pRun, output_tensor_array);
+    }
+
+    result_t res = RunAdmitted(input_tensor_array, output_tensor_array, pRunOptions);
+    m_pCoalescer->Complete(pRun, res);
+    return res;
+}
+
+/**
+ * @brief run behind the admission controller and the handle lock
+ *
+ * @param input_tensor_array  输入tensor
+ * @param output_tensor_array  输出tensor
+ * @param pRunOptions  可为NULL
+ * @return result_t  MY_OVERLOADED if admission control rejected the request
+ */
+result_t OnnxRuntimeModelHandle::RunAdmitted(tensor_array_t *input_tensor_array, tensor_array_t *output_tensor_array,
+                                             OrtRunOptions *pRunOptions)
+{
+    // 超出并发和排队上限时立即拒绝, 不在 m_onnx_mutex 上堆积
+    if (m_pAdmission != nullptr && MY_SUCCESS != m_pAdmission->Acquire())
+    {
+        return MY_OVERLOADED;
+    }
+    double dAdmittedMs = GetTimeMs();
+
+    m_onnx_mutex.lock();
+
+    double dFirstRunStartMs = m_bFirstRunDone ? 0 : GetTimeMs();
+
+    result_t res = RunTensors(input_tensor_array, output_tensor_array, pRunOptions);
+
+    if (MY_SUCCESS == res && !m_bFirstRunDone)
+    {
+        RecordLoadPhase(LOAD_PHASE_FIRST_RUN, dFirstRunStartMs);
+        m_bFirstRunDone = true;
+    }
+
+    m_onnx_mutex.unlock();
+
+    if (m_pAdmission != nullptr)
+    {
+        m_pAdmission->Release(GetTimeMs() - dAdmittedMs, MY_SUCCESS == res);
+    }
+    return res;
+}
 
-        if (cur_tensor_param->type == DT_FLOAT)
+/**
+ * @brief run and hand back the onnxruntime outputs without copying them into tensor_t, for chaining models
+ *        and for tools that need tensors whose shape is not known in advance. Bucket padding is not sliced
+ *        back here. The caller releases output_values with OrtApi::ReleaseValue.
+ *
+ * @param input_tensor_array  输入tensor
+ * @param output_names  需要的输出名
+ * @param output_values  与 output_names 一一对应的输出
+ * @return result_t
+ */
+result_t OnnxRuntimeModelHandle::my_onnxruntime_run_ort_values(tensor_array_t *input_tensor_array,
+                                                               std::vector<const char *> &output_names,
+                                                               std::vector<OrtValue *> &output_values)
+{
+    MY_CHECK_NULL(input_tensor_array, MY_PARAM_NULL);
+
+    for (size_t i = 0; i < output_names.size(); i++)
+    {
+        if (!FindNameInTensorNames(output_names[i], m_vecOutputNodesName))
         {
-            CheckStatus(g_pOrt->CreateTensorWithDataAsOrtValue(
-                memory_info, cur_tensor->pValue, cur_tensor_param->nLength, m_vecInputNodesDims[i].data(),
-                m_vecInputNodesDims[i].size(), ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT, &input_tensor));
+            MY_ERROR("Can't find output tensor name %s in model\n", output_names[i]);
+            return MY_FAILED;
         }
-        else if (cur_tensor_param->type == DT_UINT8)
+    }
+
+    m_onnx_mutex.lock();
+
+    std::vector<std::vector<int64_t>> vecInputDims;
+    std::vector<OrtValue *> input_tensors;
+    result_t res = CreateInputValues(input_tensor_array, vecInputDims, input_tensors, NULL, NULL);
+
+    output_values.assign(output_names.size(), nullptr);
+    if (MY_SUCCESS == res)
+    {
+        res = ReportStatus(g_pOrt->Run(SelectSession(vecInputDims), NULL, m_vecInputNodesName.data(),
+                                       (const OrtValue *const *)input_tensors.data(), input_tensors.size(),
+                                       output_names.data(), output_names.size(), output_values.data()));
+    }
+
+    for (auto &tensor : input_tensors)
+    {
+        if (tensor != nullptr)
         {
-            CheckStatus(g_pOrt->CreateTensorWithDataAsOrtValue(
-                memory_info, cur_tensor->pValue, cur_tensor_param->nLength, m_vecInputNodesDims[i].data(),
-                m_vecInputNodesDims[i].size(), ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT8, &input_tensor));
+            g_pOrt->ReleaseValue(tensor);
         }
-        else if (cur_tensor_param->type == DT_INT32)
+    }
+
+    m_onnx_mutex.unlock();
+    return res;
+}
+
+/**
+ * @brief run on OrtValues given by input name and hand back the outputs, the values are passed to onnxruntime
+ *        as they are, without padding or copies. Used to chain models. Run errors are returned, not fatal,
+ *        since the inputs come from another model. The caller releases output_values with OrtApi::ReleaseValue.
+ *
+ * @param input_names  输入名, 可以只给出部分输入(可选输入)
+ * @param input_values  与 input_names 一一对应的输入
+ * @param output_names  需要的输出名
+ * @param output_values  与 output_names 一一对应的输出
+ * @return result_t
+ */
+result_t OnnxRuntimeModelHandle::my_onnxruntime_run_values(const std::vector<const char *> &input_names,
+                                                           const std::vector<OrtValue *> &input_values,
+                                                           std::vector<const char *> &output_names,
+                                                           std::vector<OrtValue *> &output_values)
+{
+    if (input_names.size() != input_values.size())
+    {
+        MY_ERROR("got %zu input names and %zu values\n", input_names.size(), input_values.size());
+        return MY_PARAM_SET_ERROR;
+    }
+    for (size_t i = 0; i < output_names.size(); i++)
+    {
+        if (!FindNameInTensorNames(output_names[i], m_vecOutputNodesName))
         {
-            CheckStatus(g_pOrt->CreateTensorWithDataAsOrtValue(
-                memory_info, cur_tensor->pValue, cur_tensor_param->nLength, m_vecInputNodesDims[i].data(),
-                m_vecInputNodesDims[i].size(), ONNX_TENSOR_ELEMENT_DATA_TYPE_INT32, &input_tensor));
+            MY_ERROR("Can't find output tensor name %s in model\n", output_names[i]);
+            return MY_FAILED;
         }
-        else
+    }
+
+    // 按模型输入顺序的 shape, 用于选择特化的session
+    std::vector<std::vector<int64_t>> vecInputDims(m_vecInputNodesName.size());
+    for (size_t i = 0; i < input_names.size(); i++)
+    {
+        auto it = std::find_if(m_vecInputNodesName.begin(), m_vecInputNodesName.end(),
+                               [&](const char *pName) { return strcmp(pName, input_names[i]) == 0; });
+        if (it == m_vecInputNodesName.end())
         {
-            std::cout << "Now the tensor data type not supported!!!" << std::endl;
+            MY_ERROR("Can't find input tensor name %s in model\n", input_names[i]);
             return MY_FAILED;
         }
+        MY_CHECK_NULL(input_values[i], MY_PARAM_NULL);
+
+        OrtTensorTypeAndShapeInfo *shape_info;
+        CheckStatus(g_pOrt->GetTensorTypeAndShape(input_values[i], &shape_info));
+        size_t num_dims;
+        CheckStatus(g_pOrt->GetDimensionsCount(shape_info, &num_dims));
+        std::vector<int64_t> &dims = vecInputDims[it - m_vecInputNodesName.begin()];
+        dims.resize(num_dims);
+        CheckStatus(g_pOrt->GetDimensions(shape_info, dims.data(), num_dims));
+        g_pOrt->ReleaseTensorTypeAndShapeInfo(shape_info);
+    }
+
+    std::lock_guard<std::mutex> lock(m_onnx_mutex);
+    OrtSession *pSession = input_names.size() == m_vecInputNodesName.size() ? SelectSession(vecInputDims)
+                                                                            : m_pSession;
+
+    output_values.assign(output_names.size(), nullptr);
+    OrtStatus *status = g_pOrt->Run(pSession, NULL, input_names.data(),
+                                    (const OrtValue *const *)input_values.data(), input_values.size(),
+                                    output_names.data(), output_names.size(), output_values.data());
+    if (status != NULL)
+    {
+        MY_ERROR("onnx run failed: %s\n", g_pOrt->GetErrorMessage(status));
+        g_pOrt->ReleaseStatus(status);
+        return MY_FAILED;
+    }
+    return MY_SUCCESS;
+}
+
+/**
+ * @brief check the input tensors and wrap them (padded to the length bucket if bucket_params_t is set)
+ *        into OrtValues, the caller releases input_tensors even on failure
+ *
+ * @param input_array  输入tensor
+ * @param vecInputDims  实际送入session的shape
+ * @param input_tensors  创建的OrtValue
+ * @param pSeqLen  真实长度, 没有补齐时为0; 为NULL时不返回
+ * @param pBucketLen  补齐后的长度
+ * @return result_t
+ */
+result_t OnnxRuntimeModelHandle::CreateInputValues(tensor_array_t *input_array,
+                                                   std::vector<std::vector<int64_t>> &vecInputDims,
+                                                   std::vector<OrtValue *> &input_tensors, int64_t *pSeqLen,
+                                                   int64_t *pBucketLen)
+{
+    /*===================== process input tensor =====================*/
+    MY_DEBUG("Begin onnx inference tensors!\n");
+    if ((size_t)input_array->nArraySize != m_vecInputNodesType.size())
+    {
+        MY_ERROR("model has %zu inputs, got %d\n", m_vecInputNodesType.size(), input_array->nArraySize);
+        return MY_FAILED;
+    }
+
+    size_t num_inputs = input_array->nArraySize;
+    vecInputDims.assign(num_inputs, std::vector<int64_t>());
+
+    for (size_t i = 0; i < num_inputs; i++)
+    {
+        tensor_t *cur_tensor = &(input_array->pTensorArray[i]);
+        tensor_params_t *cur_tensor_param = cur_tensor->pTensorInfo;
+
+        // Check shape of inputs
+        for (int j = 0; j < cur_tensor_param->nDims; j++)
+        {
+            if (cur_tensor_param->pShape[j] <= 0)
+            {
+                std::cout << "Tensor " << cur_tensor_param->aTensorName << " shape[ " << j << " ] should be  > 0" << std::endl;
+                return MY_FAILED;
+            }
+        }
+
+        // input size
+        GetTensorSize(cur_tensor);
+
+        // input dims
+        for (int j = 0; j < cur_tensor_param->nDims; j++)
+        {
+            vecInputDims[i].push_back(cur_tensor_param->pShape[j]);
+        }
+    }
+    m_vecInputNodesDims = vecInputDims;
+
+    // 变长输入补齐到长度桶
+    int64_t nSeqLen = 0, nBucketLen = 0;
+    bool bPadded = GetBucketLength(vecInputDims, &nSeqLen, &nBucketLen);
+    if (pSeqLen)
+    {
+        *pSeqLen = bPadded ? nSeqLen : 0;
+        *pBucketLen = nBucketLen;
+    }
+
+    input_tensors.assign(num_inputs, nullptr);
+    result_t res = MY_SUCCESS;
+
+    for (size_t i = 0; i < num_inputs; i++)
+    {
+        tensor_t *cur_tensor = &(input_array->pTensorArray[i]);
+        tensor_params_t *cur_tensor_param = cur_tensor->pTensorInfo;
+
+        ONNXTensorElementDataType onnx_type;
+        if (!TensorTypeToOnnx(cur_tensor_param->type, &onnx_type))
+        {
+            std::cout << "Now the tensor data type not supported!!!" << std::endl;
+            res = MY_FAILED;
+            break;
+        }
+
+        void *pData = cur_tensor->pValue;
+        size_t nLength = cur_tensor_param->nLength;
+        if (bPadded)
+        {
+            PadInputToBucket(i, cur_tensor, nSeqLen, nBucketLen, vecInputDims[i]);
+            if (!m_vecPadBuffers[i].empty())
+            {
+                pData = m_vecPadBuffers[i].data();
+                nLength = m_vecPadBuffers[i].size();
+            }
+        }
+
+        // 输入来自调用者, shape 或长度不对时只让这一次调用失败
+        res = ReportStatus(g_pOrt->CreateTensorWithDataAsOrtValue(m_pCpuMemoryInfo, pData, nLength,
+                                                                  vecInputDims[i].data(), vecInputDims[i].size(),
+                                                                  onnx_type, &input_tensors[i]));
+        if (MY_SUCCESS != res)
+        {
+            break;
+        }
 
-        // store input data and release resources of info
         int is_tensor;
-        CheckStatus(g_pOrt->IsTensor(input_tensor, &is_tensor));
+        CheckStatus(g_pOrt->IsTensor(input_tensors[i], &is_tensor));
         assert(is_tensor);
-        g_pOrt->ReleaseMemoryInfo(memory_info);
-
-        input_tensors[i] = input_tensor;
     }
 
+    return res;
+}
+
+/**
+ * @brief run the session on the input tensors and copy results into the output tensors.
+ *        Inputs are padded to the length bucket first if bucket_params_t is set, and outputs sliced back.
+ *
+ * @param input_array  输入tensor
+ * @param output_array  输出tensor
+ * @param pRunOptions  可为NULL; 不为NULL时 Run 失败(如被终止)返回 MY_FAILED 而不退出
+ * @return result_t
+ */
+result_t OnnxRuntimeModelHandle::RunTensors(tensor_array_t *input_array, tensor_array_t *output_array,
+                                            OrtRunOptions *pRunOptions)
+{
+    std::vector<std::vector<int64_t>> vecInputDims;
+    std::vector<OrtValue *> input_tensors;
+    int64_t nSeqLen = 0, nBucketLen = 0;
+    result_t res = CreateInputValues(input_array, vecInputDims, input_tensors, &nSeqLen, &nBucketLen);
+    bool bPadded = nSeqLen > 0;
+
     /*===================== process output tensor =====================*/
     std::vector<const char *> output_node_names;
-    for (int i = 0; i < m_ouput_tensor_array->nArraySize; i++)
+    for (int i = 0; i < output_array->nArraySize && MY_SUCCESS == res; i++)
     {
-        tensor_t *cur_tensor = &(m_ouput_tensor_array->pTensorArray[i]);
+        tensor_t *cur_tensor = &(output_array->pTensorArray[i]);
         tensor_params_t *cur_tensor_param = cur_tensor->pTensorInfo;
         if (!FindNameInTensorNames(cur_tensor_param->aTensorName, m_vecOutputNodesName))
         {
             std::cout << "Can't find output tensor names " << cur_tensor_param->aTensorName << " in model " << std::endl;
-            return MY_FAILED;
+            res = MY_FAILED;
+            break;
         }
 
         output_node_names.push_back(cur_tensor_param->aTensorName);
     }
 
-    std::vector<OrtValue *> output_tensors(output_node_names.size());
+    std::vector<OrtValue *> output_tensors(output_node_names.size(), nullptr);
 
-    CheckStatus(g_pOrt->Run(m_pSession,                                    // session
-                                   NULL,                                          // run_options
-                                   m_vecInputNodesName.data(),                    // input_names
-                                   (const OrtValue *const *)input_tensors.data(), // input   values
-                                   input_tensors.size(),                          // input_len
-                                   m_vecOutputNodesName.data(),                   // output_names
-                                   m_vecOutputNodesName.size(),                   // output_names_len
-                                   output_tensors.data()));                       // OrtValue** output
+    if (MY_SUCCESS == res)
+    {
+        OrtSession *pSession = SelectSession(vecInputDims);
+
+        OrtStatus *status = g_pOrt->Run(pSession,                                      // session
+                                        pRunOptions,                                   // run_options
+                                        m_vecInputNodesName.data(),                    // input_names
+                                        (const OrtValue *const *)input_tensors.data(), // input   values
+                                        input_tensors.size(),                          // input_len
+                                        output_node_names.data(),                      // output_names
+                                        output_node_names.size(),                      // output_names_len
+                                        output_tensors.data());                        // OrtValue** output
+        if (status != NULL && pRunOptions != NULL)
+        {
+            // 终止的请求只影响自己, 不能像其它错误一样退出进程
+            MY_DEBUG("onnx run stopped: %s\n", g_pOrt->GetErrorMessage(status));
+            g_pOrt->ReleaseStatus(status);
+            res = MY_FAILED;
+        }
+        else
+        {
+            CheckStatus(status);
+        }
+    }
 
-    for (size_t i = 0; i < output_tensors.size(); i++)
+    for (size_t i = 0; i < output_tensors.size() && MY_SUCCESS == res; i++)
     {
         int is_tensor;
         CheckStatus(g_pOrt->IsTensor(output_tensors[i], &is_tensor));
         assert(is_tensor);
 
-        float *floatarr;
-        CheckStatus(g_pOrt->GetTensorMutableData(output_tensors[i], (void **)&floatarr));
-
-        tensor_t *cur_tensor = &(m_ouput_tensor_array->pTensorArray[i]);
-        tensor_params_t *cur_tensor_param = cur_tensor->pTensorInfo;
-
+        tensor_t *cur_tensor = &(output_array->pTensorArray[i]);
         GetTensorSize(cur_tensor);
 
-        memcpy(cur_tensor->pValue, floatarr, cur_tensor_param->nLength);
+        OutputPostprocessor *pPostprocessor = FindPostprocessor(cur_tensor->pTensorInfo->aTensorName);
+        if (pPostprocessor)
+        {
+            res = PostprocessOutputTensor(output_tensors[i], cur_tensor, pPostprocessor);
+        }
+        else
+        {
+            res = CopyOutputTensor(output_tensors[i], cur_tensor, bPadded ? nSeqLen : 0, nBucketLen,
+                                   FindOutputConvert(cur_tensor->pTensorInfo->aTensorName));
+        }
     }
 
-    // Release output tensor if set
+    // Release input and output tensor if set
+    for (auto &tensor : input_tensors)
+    {
+        if (tensor != nullptr)
+        {
+            g_pOrt->ReleaseValue(tensor);
+        }
+    }
     for (auto &tensor : output_tensors)
     {
         if (tensor != nullptr)
@@ -392,54 +1156,877 @@ result_t OnnxRuntimeModelHandle::my_onnxruntime_inference_tensors()
             g_pOrt->ReleaseValue(tensor);
         }
     }
-    input_tensors.clear();
-    output_tensors.clear();
 
-    m_onnx_mutex.unlock();
+    if (MY_SUCCESS == res)
+    {
+        MY_DEBUG("End onnx  inference tensors succeed!!!\n");
+    }
+    return res;
+}
 
-    MY_DEBUG("End onnx  inference tensors succeed!!!\n");
-    return MY_SUCCESS;
+/**
+ * @brief find the sequence length of the inputs and the length bucket it is padded to
+ *
+ * @param vecInputDims  dims of every input
+ * @param pSeqLen  true sequence length
+ * @param pBucketLen  bucket length
+ * @return bool  true if the inputs need padding
+ */
+bool OnnxRuntimeModelHandle::GetBucketLength(const std::vector<std::vector<int64_t>> &vecInputDims, int64_t *pSeqLen,
+                                             int64_t *pBucketLen)
+{
+    const bucket_params_t *pBucket = &m_tModelParam->bucket_params;
+    if (pBucket->nBuckets <= 0)
+    {
+        return false;
+    }
+
+    size_t axis = pBucket->nSeqDimIndex;
+    int64_t nSeqLen = -1;
+    for (size_t i = 0; i < vecInputDims.size(); i++)
+    {
+        if (vecInputDims[i].size() > axis)
+        {
+            nSeqLen = std::max(nSeqLen, vecInputDims[i][axis]);
+        }
+    }
+    if (nSeqLen <= 0)
+    {
+        return false;
+    }
+
+    // 大于最大的桶时不补齐
+    for (int b = 0; b < pBucket->nBuckets && b < 16; b++)
+    {
+        if (pBucket->aBuckets[b] >= nSeqLen)
+        {
+            *pSeqLen = nSeqLen;
+            *pBucketLen = pBucket->aBuckets[b];
+            return *pBucketLen > nSeqLen;
+        }
+    }
+    return false;
 }
 
 /**
- * @brief Construct a new Onnx Runtime Model Handle:: Onnx Runtime Model Handle object
- * 
- * @param tModelParam 
+ * @brief copy input i padded along the sequence dim into m_vecPadBuffers[i], or generate the attention mask
+ *        if it is the configured mask input. Inputs without the sequence dim are left untouched.
+ *
+ * @param i  输入序号
+ * @param cur_tensor  输入tensor
+ * @param nSeqLen  真实长度
+ * @param nBucketLen  补齐后的长度
+ * @param dims  输入的shape, 补齐后更新
  */
-OnnxRuntimeModelHandle::OnnxRuntimeModelHandle(model_params_t *tModelParam)
+void OnnxRuntimeModelHandle::PadInputToBucket(size_t i, tensor_t *cur_tensor, int64_t nSeqLen, int64_t nBucketLen,
+                                              std::vector<int64_t> &dims)
 {
-    m_tModelParam = new model_params_t();
-    memcpy(m_tModelParam, tModelParam, sizeof(model_params_t));
+    const bucket_params_t *pBucket = &m_tModelParam->bucket_params;
+    tensor_params_t *cur_tensor_param = cur_tensor->pTensorInfo;
+    size_t axis = pBucket->nSeqDimIndex;
+
+    if (m_vecPadBuffers.size() <= i)
+    {
+        m_vecPadBuffers.resize(i + 1);
+    }
+    std::vector<my_u8> &buffer = m_vecPadBuffers[i];
+
+    if (dims.size() <= axis || dims[axis] != nSeqLen)
+    {
+        buffer.clear();
+        return;
+    }
+
+    size_t nElementSize = ElementSize(cur_tensor_param->type);
+    size_t nOuter = 1, nInner = 1;
+    for (size_t j = 0; j < axis; j++)
+    {
+        nOuter *= dims[j];
+    }
+    for (size_t j = axis + 1; j < dims.size(); j++)
+    {
+        nInner *= dims[j];
+    }
+
+    size_t nSrcRow = nSeqLen * nInner;    // 每行真实元素个数
+    size_t nDstRow = nBucketLen * nInner; // 每行补齐后元素个数
+    buffer.resize(nOuter * nDstRow * nElementSize);
+
+    bool bIsMask = pBucket->aMaskInputName[0] != '\0' &&
+                   strcmp(pBucket->aMaskInputName, cur_tensor_param->aTensorName) == 0;
+
+    for (size_t o = 0; o < nOuter; o++)
+    {
+        my_u8 *pDstRow = buffer.data() + o * nDstRow * nElementSize;
+        if (bIsMask)
+        {
+            FillTensorValue(pDstRow, nSrcRow, cur_tensor_param->type, 1);
+        }
+        else
+        {
+            memcpy(pDstRow, (my_u8 *)cur_tensor->pValue + o * nSrcRow * nElementSize, nSrcRow * nElementSize);
+        }
+        FillTensorValue(pDstRow + nSrcRow * nElementSize, nDstRow - nSrcRow, cur_tensor_param->type,
+                        bIsMask ? 0 : pBucket->fPadValue);
+    }
+
+    dims[axis] = nBucketLen;
 }
 
 /**
- * @brief Destroy the Onnx Runtime Model Handle:: Onnx Runtime Model Handle object
- * 
+ * @brief postprocessor configured for an output name
+ *
+ * @param pName  输出名
+ * @return OutputPostprocessor*, nullptr if the output is copied as is
  */
-OnnxRuntimeModelHandle::~OnnxRuntimeModelHandle()
+OutputPostprocessor *OnnxRuntimeModelHandle::FindPostprocessor(const char *pName)
 {
-    if (m_tModelParam)
+    for (size_t i = 0; i < m_vecPostprocessors.size(); i++)
     {
-        delete m_tModelParam;
+        if (0 == strcmp(m_vecPostprocessors[i]->GetTensorName(), pName))
+        {
+            return m_vecPostprocessors[i];
+        }
     }
+    return nullptr;
 }
 
 /**
- * @brief member set
- * 
- * @param input_tensor_array 
+ * @brief run postprocessing directly on the onnxruntime output buffer, only the compact result is copied
+ *        into cur_tensor. Length bucket slicing does not apply to postprocessed outputs.
+ *
+ * @param output_value  onnxruntime输出
+ * @param cur_tensor  结果
+ * @param pPostprocessor  后处理
+ * @return result_t
  */
-void OnnxRuntimeModelHandle::set_input_tensor_array(tensor_array_t *input_tensor_array)
+result_t OnnxRuntimeModelHandle::PostprocessOutputTensor(OrtValue *output_value, tensor_t *cur_tensor,
+                                                         OutputPostprocessor *pPostprocessor)
 {
-    m_input_tensor_array = input_tensor_array;
+    void *pOutput;
+    CheckStatus(g_pOrt->GetTensorMutableData(output_value, &pOutput));
+
+    OrtTensorTypeAndShapeInfo *shape_info;
+    CheckStatus(g_pOrt->GetTensorTypeAndShape(output_value, &shape_info));
+    ONNXTensorElementDataType type;
+    CheckStatus(g_pOrt->GetTensorElementType(shape_info, &type));
+    size_t num_dims;
+    CheckStatus(g_pOrt->GetDimensionsCount(shape_info, &num_dims));
+    std::vector<int64_t> dims(num_dims);
+    CheckStatus(g_pOrt->GetDimensions(shape_info, dims.data(), num_dims));
+    g_pOrt->ReleaseTensorTypeAndShapeInfo(shape_info);
+
+    if (ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT != type)
+    {
+        MY_ERROR("postprocess of %s needs a float output\n", cur_tensor->pTensorInfo->aTensorName);
+        return MY_FAILED;
+    }
+    return pPostprocessor->Process((const float *)pOutput, dims.data(), num_dims, cur_tensor);
 }
 
 /**
- * @brief member set
- * 
- * @param ouput_tensor_array 
+ * @brief output conversion configured for an output name
+ *
+ * @param pName  输出名
+ * @return const output_convert_params_t*, nullptr if the output keeps its type
  */
-void OnnxRuntimeModelHandle::set_output_tensor_array(tensor_array_t *ouput_tensor_array)
+const output_convert_params_t *OnnxRuntimeModelHandle::FindOutputConvert(const char *pName)
 {
-    m_ouput_tensor_array = ouput_tensor_array;
+    for (int i = 0; i < m_tModelParam->nOutputConverts && i < 8; i++)
+    {
+        if (0 == strcmp(m_tModelParam->aOutputConverts[i].aTensorName, pName))
+        {
+            return &m_tModelParam->aOutputConverts[i];
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * @brief copy nElements, or convert float to the configured type in the same pass
+ *
+ */
+static void CopyOrConvert(void *pDst, const void *pSrc, size_t nElements, size_t nSrcElementSize,
+                          const output_convert_params_t *pConvert)
+{
+    if (nullptr == pConvert)
+    {
+        memcpy(pDst, pSrc, nElements * nSrcElementSize);
+        return;
+    }
+
+    switch (pConvert->type)
+    {
+    case DT_HALF:
+        ConvertF32ToF16((const float *)pSrc, (my_u16 *)pDst, nElements);
+        break;
+    case DT_BFLOAT16:
+        ConvertF32ToBF16((const float *)pSrc, (my_u16 *)pDst, nElements);
+        break;
+    case DT_INT8:
+        QuantizeF32ToS8((const float *)pSrc, (my_s8 *)pDst, nElements, 1.0f / pConvert->fScale);
+        break;
+    default:
+        memcpy(pDst, pSrc, nElements * nSrcElementSize);
+        break;
+    }
+}
+
+/**
+ * @brief copy an output value into the caller's tensor, slicing the sequence dim back to nSeqLen if the
+ *        output has been computed on padded inputs. With pConvert the float values are converted to
+ *        fp16/bf16/int8 in the same pass instead of the memcpy.
+ *
+ * @param output_value  onnxruntime output
+ * @param cur_tensor  caller's output tensor
+ * @param nSeqLen  true length, 0 if the inputs are not padded
+ * @param nBucketLen  padded length
+ * @param pConvert  output conversion, nullptr to copy as is
+ * @return result_t
+ */
+result_t OnnxRuntimeModelHandle::CopyOutputTensor(OrtValue *output_value, tensor_t *cur_tensor, int64_t nSeqLen,
+                                                  int64_t nBucketLen, const output_convert_params_t *pConvert)
+{
+    tensor_params_t *cur_tensor_param = cur_tensor->pTensorInfo;
+
+    void *pOutput;
+    CheckStatus(g_pOrt->GetTensorMutableData(output_value, &pOutput));
+
+    OrtTensorTypeAndShapeInfo *shape_info;
+    CheckStatus(g_pOrt->GetTensorTypeAndShape(output_value, &shape_info));
+    ONNXTensorElementDataType type;
+    CheckStatus(g_pOrt->GetTensorElementType(shape_info, &type));
+    size_t num_dims, nElements;
+    CheckStatus(g_pOrt->GetDimensionsCount(shape_info, &num_dims));
+    std::vector<int64_t> dims(num_dims);
+    CheckStatus(g_pOrt->GetDimensions(shape_info, dims.data(), num_dims));
+    CheckStatus(g_pOrt->GetTensorShapeElementCount(shape_info, &nElements));
+    g_pOrt->ReleaseTensorTypeAndShapeInfo(shape_info);
+
+    size_t nSrcElementSize = OnnxElementSize(type);
+    size_t nDstElementSize = nSrcElementSize;
+    if (pConvert)
+    {
+        if (ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT != type || pConvert->type != cur_tensor_param->type ||
+            (DT_INT8 == pConvert->type && pConvert->fScale <= 0))
+        {
+            MY_ERROR("output %s: conversion needs a float output, a tensor of the target type and fScale > 0\n",
+                     cur_tensor_param->aTensorName);
+            return MY_PARAM_SET_ERROR;
+        }
+        nDstElementSize = ElementSize(pConvert->type);
+    }
+
+    size_t nCapacity = cur_tensor_param->nLength / nDstElementSize; // 按元素计
+    size_t axis = m_tModelParam->bucket_params.nSeqDimIndex;
+
+    if (nSeqLen <= 0 || num_dims <= axis || dims[axis] != nBucketLen)
+    {
+        CopyOrConvert(cur_tensor->pValue, pOutput, std::min(nCapacity, nElements), nSrcElementSize, pConvert);
+        return MY_SUCCESS;
+    }
+
+    // 去掉补齐的部分
+    size_t nOuter = 1, nInner = 1;
+    for (size_t j = 0; j < axis; j++)
+    {
+        nOuter *= dims[j];
+    }
+    for (size_t j = axis + 1; j < num_dims; j++)
+    {
+        nInner *= dims[j];
+    }
+
+    size_t nDstRow = nSeqLen * nInner;
+    size_t nSrcRow = nBucketLen * nInner;
+    for (size_t o = 0; o < nOuter && (o + 1) * nDstRow <= nCapacity; o++)
+    {
+        CopyOrConvert((my_u8 *)cur_tensor->pValue + o * nDstRow * nDstElementSize,
+                      (my_u8 *)pOutput + o * nSrcRow * nSrcElementSize, nDstRow, nSrcElementSize, pConvert);
+    }
+    return MY_SUCCESS;
+}
+
+/**
+ * @brief Construct a new Onnx Runtime Model Handle:: Onnx Runtime Model Handle object
+ * 
+ * @param tModelParam 
+ */
+OnnxRuntimeModelHandle::OnnxRuntimeModelHandle(model_params_t *tModelParam)
+{
+    m_tModelParam = new model_params_t();
+    memcpy(m_tModelParam, tModelParam, sizeof(model_params_t));
+    m_input_tensor_array = nullptr;
+    m_ouput_tensor_array = nullptr;
+    m_pSessionOptions = nullptr;
+    m_pSession = nullptr;
+    m_pCpuMemoryInfo = nullptr;
+
+    m_pPreprocessor = nullptr;
+    if (m_tModelParam->preprocess_params.bEnable)
+    {
+        m_pPreprocessor = new ImagePreprocessor(&m_tModelParam->preprocess_params);
+    }
+    for (int i = 0; i < m_tModelParam->nPostprocess && i < 8; i++)
+    {
+        if (POSTPROCESS_NONE != m_tModelParam->aPostprocess[i].type)
+        {
+            m_vecPostprocessors.push_back(new OutputPostprocessor(&m_tModelParam->aPostprocess[i]));
+        }
+    }
+
+    m_pAdmission = nullptr;
+    if (m_tModelParam->admission_params.nMaxConcurrency > 0)
+    {
+        m_pAdmission = new AdmissionController(&m_tModelParam->admission_params);
+    }
+    m_pCoalescer = m_tModelParam->bCoalesceRequests ? new RequestCoalescer() : nullptr;
+    m_pResultCache = m_tModelParam->cache_params.nCapacityKB > 0 ? new ResultCache(&m_tModelParam->cache_params)
+                                                                  : nullptr;
+
+    memset(&m_tLoadProfile, 0, sizeof(m_tLoadProfile));
+    m_bFirstRunDone = false;
+    if (m_tModelParam->bProfileLoad)
+    {
+        ResetPeakRss();
+    }
+}
+
+/**
+ * @brief Destroy the Onnx Runtime Model Handle:: Onnx Runtime Model Handle object
+ * 
+ */
+OnnxRuntimeModelHandle::~OnnxRuntimeModelHandle()
+{
+    if (m_tModelParam)
+    {
+        delete m_tModelParam;
+    }
+
+    if (m_pPreprocessor)
+    {
+        delete m_pPreprocessor;
+    }
+
+    for (size_t i = 0; i < m_vecPostprocessors.size(); i++)
+    {
+        delete m_vecPostprocessors[i];
+    }
+
+    if (m_pAdmission)
+    {
+        delete m_pAdmission;
+    }
+
+    if (m_pCoalescer)
+    {
+        delete m_pCoalescer;
+    }
+
+    if (m_pResultCache)
+    {
+        delete m_pResultCache;
+    }
+
+    InferenceExecutor::ForgetModel(this);
+}
+
+/**
+ * @brief member set
+ * 
+ * @param input_tensor_array 
+ */
+void OnnxRuntimeModelHandle::set_input_tensor_array(tensor_array_t *input_tensor_array)
+{
+    m_input_tensor_array = input_tensor_array;
+}
+
+/**
+ * @brief member set
+ * 
+ * @param ouput_tensor_array 
+ */
+void OnnxRuntimeModelHandle::set_output_tensor_array(tensor_array_t *ouput_tensor_array)
+{
+    m_ouput_tensor_array = ouput_tensor_array;
+}
+
+/**
+ * @brief member get
+ *
+ * @return const load_profile_t&
+ */
+const load_profile_t &OnnxRuntimeModelHandle::get_load_profile() const
+{
+    return m_tLoadProfile;
+}
+
+/**
+ * @brief record duration and memory of one load phase, then reset the peak memory for the next phase.
+ *        A phase recorded twice (the session is created again for a quantized model) adds up.
+ *
+ * @param ePhase  load phase
+ * @param dStartMs  start time of the phase, from GetTimeMs
+ */
+void OnnxRuntimeModelHandle::RecordLoadPhase(load_phase_t ePhase, double dStartMs)
+{
+    double dCostMs = GetTimeMs() - dStartMs;
+    m_tLoadProfile.aPhaseMs[ePhase] += dCostMs;
+    m_tLoadProfile.dTotalMs += dCostMs;
+
+    if (!m_tModelParam->bProfileLoad)
+    {
+        return;
+    }
+
+    m_tLoadProfile.aPhaseRssKB[ePhase] = GetCurrentRssKB();
+    m_tLoadProfile.aPhasePeakRssKB[ePhase] = GetPeakRssKB();
+    ResetPeakRss();
+
+    MY_DEBUG("load phase %d cost %.3f ms, rss %ld KB, peak %ld KB\n", ePhase, dCostMs,
+             m_tLoadProfile.aPhaseRssKB[ePhase], m_tLoadProfile.aPhasePeakRssKB[ePhase]);
+}
+
+/**
+ * @brief run the model nIterations times on zero inputs before the handle is returned, so that arena growth,
+ *        kernel selection and lazy initialization are not paid by the first real request.
+ *        Input shapes are taken from warmup_params_t, or from the model dims with dynamic dims replaced.
+ *        Every variant session is warmed up with its own value of the variant dim.
+ *
+ * @return result_t
+ */
+result_t OnnxRuntimeModelHandle::WarmUp()
+{
+    if (m_tModelParam->warmup_params.nIterations <= 0)
+    {
+        return MY_SUCCESS;
+    }
+
+    result_t res = WarmUpSession(m_pSession, -1);
+    for (size_t v = 0; v < m_vecVariantSessions.size() && MY_SUCCESS == res; v++)
+    {
+        res = WarmUpSession(m_vecVariantSessions[v], m_vecVariantValues[v]);
+    }
+    return res;
+}
+
+/**
+ * @brief warm up one session
+ *
+ * @param pSession  session to run
+ * @param nVariantValue  value of the variant dim of this session, <0 for the generic session
+ * @return result_t
+ */
+result_t OnnxRuntimeModelHandle::WarmUpSession(OrtSession *pSession, int64_t nVariantValue)
+{
+    const warmup_params_t *pWarmup = &m_tModelParam->warmup_params;
+
+    int64_t nDynamicDimValue = pWarmup->nDynamicDimValue > 0 ? pWarmup->nDynamicDimValue : 1;
+    size_t num_inputs = m_vecInputNodesName.size();
+    if (pWarmup->nInputs != 0 && (size_t)pWarmup->nInputs != num_inputs)
+    {
+        MY_ERROR("warm up shapes given for %d inputs, model has %zu\n", pWarmup->nInputs, num_inputs);
+        return MY_PARAM_SET_ERROR;
+    }
+    int nMaxInputs = sizeof(pWarmup->nDims) / sizeof(pWarmup->nDims[0]);
+    int nMaxDims = sizeof(pWarmup->pShape[0]) / sizeof(pWarmup->pShape[0][0]);
+    if (pWarmup->nInputs < 0 || pWarmup->nInputs > nMaxInputs)
+    {
+        MY_ERROR("warm up shapes: nInputs should be 0 ~ %d\n", nMaxInputs);
+        return MY_PARAM_SET_ERROR;
+    }
+    for (int i = 0; i < pWarmup->nInputs; i++)
+    {
+        if (pWarmup->nDims[i] < 0 || pWarmup->nDims[i] > nMaxDims)
+        {
+            MY_ERROR("warm up shape of input %d: nDims should be 0 ~ %d\n", i, nMaxDims);
+            return MY_PARAM_SET_ERROR;
+        }
+    }
+
+    // input shapes
+    std::vector<std::vector<int64_t>> vecInputDims(num_inputs);
+    for (size_t i = 0; i < num_inputs; i++)
+    {
+        if (pWarmup->nInputs > 0)
+        {
+            vecInputDims[i].assign(pWarmup->pShape[i], pWarmup->pShape[i] + pWarmup->nDims[i]);
+        }
+        else
+        {
+            vecInputDims[i] = m_vecInputNodesDims[i];
+        }
+
+        for (size_t j = 0; j < vecInputDims[i].size(); j++)
+        {
+            if (vecInputDims[i][j] <= 0)
+            {
+                vecInputDims[i][j] = nDynamicDimValue;
+            }
+        }
+    }
+    if (nVariantValue >= 0)
+    {
+        for (size_t k = 0; k < m_vecVariantDimPos.size(); k++)
+        {
+            vecInputDims[m_vecVariantDimPos[k].first][m_vecVariantDimPos[k].second] = nVariantValue;
+        }
+    }
+
+    OrtAllocator *allocator;
+    CheckStatus(g_pOrt->GetAllocatorWithDefaultOptions(&allocator));
+
+    result_t res = MY_SUCCESS;
+    std::vector<OrtValue *> input_tensors(num_inputs, nullptr);
+    for (size_t i = 0; i < num_inputs; i++)
+    {
+        size_t nElementSize = OnnxElementSize(m_vecInputNodesType[i]);
+        if (nElementSize == 0)
+        {
+            MY_ERROR("input %s type %d is not supported by warm up\n", m_vecInputNodesName[i], m_vecInputNodesType[i]);
+            res = MY_FAILED;
+            break;
+        }
+
+        size_t nElements = 1;
+        for (size_t j = 0; j < vecInputDims[i].size(); j++)
+        {
+            nElements *= vecInputDims[i][j];
+        }
+
+        // 配置的 shape 与模型不符时只是加载失败, 不退出进程
+        void *pData = nullptr;
+        res = ReportStatus(g_pOrt->CreateTensorAsOrtValue(allocator, vecInputDims[i].data(), vecInputDims[i].size(),
+                                                          m_vecInputNodesType[i], &input_tensors[i]));
+        if (MY_SUCCESS == res)
+        {
+            res = ReportStatus(g_pOrt->GetTensorMutableData(input_tensors[i], &pData));
+        }
+        if (MY_SUCCESS != res)
+        {
+            break;
+        }
+        memset(pData, 0, nElements * nElementSize);
+    }
+
+    for (int n = 0; n < pWarmup->nIterations && MY_SUCCESS == res; n++)
+    {
+        double dStartMs = GetTimeMs();
+        std::vector<OrtValue *> output_tensors(m_vecOutputNodesName.size(), nullptr);
+
+        m_onnx_mutex.lock();
+        res = ReportStatus(g_pOrt->Run(pSession, NULL, m_vecInputNodesName.data(),
+                                       (const OrtValue *const *)input_tensors.data(), input_tensors.size(),
+                                       m_vecOutputNodesName.data(), m_vecOutputNodesName.size(),
+                                       output_tensors.data()));
+        m_onnx_mutex.unlock();
+
+        for (auto &tensor : output_tensors)
+        {
+            if (tensor != nullptr)
+            {
+                g_pOrt->ReleaseValue(tensor);
+            }
+        }
+
+        if (MY_SUCCESS == res && !m_bFirstRunDone)
+        {
+            RecordLoadPhase(LOAD_PHASE_FIRST_RUN, dStartMs);
+            m_bFirstRunDone = true;
+        }
+        MY_DEBUG("warm up iteration %d cost %.3f ms\n", n, GetTimeMs() - dStartMs);
+    }
+
+    for (auto &tensor : input_tensors)
+    {
+        if (tensor != nullptr)
+        {
+            g_pOrt->ReleaseValue(tensor);
+        }
+    }
+
+    return res;
+}
+
+/**
+ * @brief member get
+ *
+ * @return const model_params_t*
+ */
+const model_params_t *OnnxRuntimeModelHandle::get_model_param() const
+{
+    return m_tModelParam;
+}
+
+/**
+ * @brief member get
+ *
+ * @return tensor_array_t*
+ */
+tensor_array_t *OnnxRuntimeModelHandle::get_input_tensor_array()
+{
+    return m_input_tensor_array;
+}
+
+/**
+ * @brief member get
+ *
+ * @return tensor_array_t*
+ */
+tensor_array_t *OnnxRuntimeModelHandle::get_output_tensor_array()
+{
+    return m_ouput_tensor_array;
+}
+
+/**
+ * @brief whether a dimension of a model input is symbolic in the model, i.e. any size is accepted
+ *
+ * @param nInput  输入序号
+ * @param nDim  维度序号
+ * @return bool
+ */
+bool OnnxRuntimeModelHandle::is_dynamic_input_dim(size_t nInput, size_t nDim) const
+{
+    return nInput < m_vecModelInputDims.size() && nDim < m_vecModelInputDims[nInput].size() &&
+           m_vecModelInputDims[nInput][nDim] < 0;
+}
+
+/**
+ * @brief tensor params of all model inputs and outputs from the shapes and types declared in the model,
+ *        for allocating tensors without filling tensor_params_array_t by hand. Symbolic dims are replaced by
+ *        nBatch for the first dim and nDynamicDimValue for the others. Output conversion is taken into account,
+ *        postprocessing is not.
+ *
+ * @param vecInputs  输入参数, 顺序与模型一致
+ * @param vecOutputs  输出参数
+ * @param nBatch  batch 大小
+ * @param nDynamicDimValue  其他符号维度的值, <=0 时为1
+ * @return result_t
+ */
+result_t OnnxRuntimeModelHandle::get_model_tensor_params(std::vector<tensor_params_t> &vecInputs,
+                                                         std::vector<tensor_params_t> &vecOutputs, int nBatch,
+                                                         int nDynamicDimValue)
+{
+    const std::vector<ONNXTensorElementDataType> *apTypes[2] = {&m_vecInputNodesType, &m_vecOutputNodesType};
+    const std::vector<const char *> *apNames[2] = {&m_vecInputNodesName, &m_vecOutputNodesName};
+    const std::vector<std::vector<int64_t>> *apDims[2] = {&m_vecModelInputDims, &m_vecOutputNodesDims};
+    std::vector<tensor_params_t> *apParams[2] = {&vecInputs, &vecOutputs};
+
+    for (int k = 0; k < 2; k++)
+    {
+        apParams[k]->clear();
+        for (size_t i = 0; i < apNames[k]->size(); i++)
+        {
+            const std::vector<int64_t> &dims = (*apDims[k])[i];
+            tensor_params_t tParam;
+            memset(&tParam, 0, sizeof(tensor_params_t));
+            strncpy(tParam.aTensorName, (*apNames[k])[i], sizeof(tParam.aTensorName) - 1);
+            if (!OnnxToTensorType((*apTypes[k])[i], &tParam.type) || dims.size() > 8)
+            {
+                MY_ERROR("tensor %s of type %d, rank %zu is not supported\n", tParam.aTensorName, (*apTypes[k])[i],
+                         dims.size());
+                return MY_FAILED;
+            }
+
+            const output_convert_params_t *pConvert = k == 1 ? FindOutputConvert(tParam.aTensorName) : nullptr;
+            if (pConvert != nullptr)
+            {
+                tParam.type = pConvert->type;
+            }
+
+            tParam.nDims = (int)dims.size();
+            for (size_t j = 0; j < dims.size(); j++)
+            {
+                if (dims[j] >= 0)
+                {
+                    tParam.pShape[j] = (int)dims[j];
+                }
+                else
+                {
+                    tParam.pShape[j] = j == 0 ? nBatch : (nDynamicDimValue > 0 ? nDynamicDimValue : 1);
+                }
+            }
+            apParams[k]->push_back(tParam);
+        }
+    }
+    return MY_SUCCESS;
+}
+
+/**
+ * @brief member get
+ *
+ * @return ImagePreprocessor*, nullptr if preprocess_params is not enabled
+ */
+ImagePreprocessor *OnnxRuntimeModelHandle::get_preprocessor()
+{
+    return m_pPreprocessor;
+}
+
+/**
+ * @brief member get
+ *
+ * @return AdmissionController*, nullptr if admission_params is not set
+ */
+AdmissionController *OnnxRuntimeModelHandle::get_admission_controller()
+{
+    return m_pAdmission;
+}
+
+/**
+ * @brief member get
+ *
+ * @return RequestCoalescer*, nullptr if bCoalesceRequests is not set
+ */
+RequestCoalescer *OnnxRuntimeModelHandle::get_coalescer()
+{
+    return m_pCoalescer;
+}
+
+/**
+ * @brief member get
+ *
+ * @return ResultCache*, nullptr if cache_params is not set
+ */
+ResultCache *OnnxRuntimeModelHandle::get_result_cache()
+{
+    return m_pResultCache;
+}
+
+/**
+ * @brief member get
+ *
+ * @return const std::vector<const char *>&  model input names
+ */
+const std::vector<const char *> &OnnxRuntimeModelHandle::get_input_names() const
+{
+    return m_vecInputNodesName;
+}
+
+/**
+ * @brief member get
+ *
+ * @return const std::vector<const char *>&  model output names
+ */
+const std::vector<const char *> &OnnxRuntimeModelHandle::get_output_names() const
+{
+    return m_vecOutputNodesName;
+}
+
+/**
+ * @brief wrap the caller's buffer into an OrtValue without copying, the buffer must outlive the value
+ *
+ * @param pTensor  tensor, shape 和 type 须已设置
+ * @param ppValue  创建的OrtValue, 用 OrtApi::ReleaseValue 释放
+ * @return result_t
+ */
+result_t OnnxRuntimeModelHandle::WrapTensorValue(tensor_t *pTensor, OrtValue **ppValue)
+{
+    MY_CHECK_NULL(pTensor, MY_PARAM_NULL);
+    MY_CHECK_NULL(ppValue, MY_PARAM_NULL);
+
+    static OrtMemoryInfo *s_pMemoryInfo = nullptr;
+    static std::once_flag s_memory_info_once;
+    std::call_once(s_memory_info_once, []() {
+        if (MY_SUCCESS != ReportStatus(g_pOrt->CreateCpuMemoryInfo(OrtArenaAllocator, OrtMemTypeDefault,
+                                                                   &s_pMemoryInfo)))
+        {
+            s_pMemoryInfo = nullptr;
+        }
+    });
+
+    tensor_params_t *pParam = pTensor->pTensorInfo;
+    ONNXTensorElementDataType onnx_type;
+    if (s_pMemoryInfo == nullptr || !TensorTypeToOnnx(pParam->type, &onnx_type))
+    {
+        MY_ERROR("tensor %s: data type not supported\n", pParam->aTensorName);
+        return MY_FAILED;
+    }
+
+    GetTensorSize(pTensor);
+    std::vector<int64_t> dims(pParam->pShape, pParam->pShape + pParam->nDims);
+    OrtStatus *status = g_pOrt->CreateTensorWithDataAsOrtValue(s_pMemoryInfo, pTensor->pValue, pParam->nLength,
+                                                               dims.data(), dims.size(), onnx_type, ppValue);
+    if (status != NULL)
+    {
+        MY_ERROR("tensor %s: %s\n", pParam->aTensorName, g_pOrt->GetErrorMessage(status));
+        g_pOrt->ReleaseStatus(status);
+        return MY_FAILED;
+    }
+    return MY_SUCCESS;
+}
+
+/**
+ * @brief copy an OrtValue into the caller's tensor and set its dims to the value's shape
+ *
+ * @param pValue  onnxruntime tensor
+ * @param pTensor  tensor, type 须一致, nLength 为容量
+ * @return result_t
+ */
+result_t OnnxRuntimeModelHandle::CopyValueToTensor(OrtValue *pValue, tensor_t *pTensor)
+{
+    MY_CHECK_NULL(pValue, MY_PARAM_NULL);
+    MY_CHECK_NULL(pTensor, MY_PARAM_NULL);
+
+    OrtTensorTypeAndShapeInfo *shape_info;
+    OrtStatus *status = g_pOrt->GetTensorTypeAndShape(pValue, &shape_info);
+    if (status != NULL)
+    {
+        MY_ERROR("%s\n", g_pOrt->GetErrorMessage(status));
+        g_pOrt->ReleaseStatus(status);
+        return MY_FAILED;
+    }
+    ONNXTensorElementDataType type = ONNX_TENSOR_ELEMENT_DATA_TYPE_UNDEFINED;
+    size_t num_dims = 0, nElements = 0;
+    std::vector<int64_t> dims;
+    result_t res = ReportStatus(g_pOrt->GetTensorElementType(shape_info, &type));
+    if (MY_SUCCESS == res)
+    {
+        res = ReportStatus(g_pOrt->GetDimensionsCount(shape_info, &num_dims));
+    }
+    if (MY_SUCCESS == res)
+    {
+        dims.resize(num_dims);
+        res = ReportStatus(g_pOrt->GetDimensions(shape_info, dims.data(), num_dims));
+    }
+    if (MY_SUCCESS == res)
+    {
+        res = ReportStatus(g_pOrt->GetTensorShapeElementCount(shape_info, &nElements));
+    }
+    g_pOrt->ReleaseTensorTypeAndShapeInfo(shape_info);
+    if (MY_SUCCESS != res)
+    {
+        return res;
+    }
+
+    tensor_params_t *pParam = pTensor->pTensorInfo;
+    tensor_types_t value_type;
+    if (!OnnxToTensorType(type, &value_type) || value_type != pParam->type)
+    {
+        MY_ERROR("tensor %s: type of the value does not match\n", pParam->aTensorName);
+        return MY_FAILED;
+    }
+    size_t nBytes = nElements * OnnxElementSize(type);
+    if (num_dims > sizeof(pParam->pShape) / sizeof(pParam->pShape[0]) || nBytes > (size_t)pParam->nLength)
+    {
+        MY_ERROR("tensor %s: %zu bytes do not fit in %d\n", pParam->aTensorName, nBytes, pParam->nLength);
+        return MY_FAILED;
+    }
+
+    if (nBytes > 0)
+    {
+        void *pData;
+        res = ReportStatus(g_pOrt->GetTensorMutableData(pValue, &pData));
+        if (MY_SUCCESS != res)
+        {
+            return res;
+        }
+        memcpy(pTensor->pValue, pData, nBytes);
+    }
+    pParam->nDims = (int)num_dims;
+    for (size_t j = 0; j < num_dims; j++)
+    {
+        pParam->pShape[j] = (int)dims[j];
+    }
+    pParam->nElementSize = (int)nElements;
+    return MY_SUCCESS;
 }
@@ -3,6 +3,7 @@
 #include <vector>
 #include <memory>
 #include <mutex>
+#include <string>
 #include "common.h"
 #include "onnxruntime/onnxruntime_c_api.h"
 #include "onnxruntime/cuda_provider_factory.h"
@@ -13,19 +14,75 @@
 #include "onnxruntime/tensorrt_provider_factory.h"
 #endif
 
+class ImagePreprocessor;
+class OutputPostprocessor;
+class AdmissionController;
+class RequestCoalescer;
+class ResultCache;
+
 class OnnxRuntimeModelHandle
 {
 public:
     OnnxRuntimeModelHandle(model_params_t *tModelParam);
     ~OnnxRuntimeModelHandle();
-    result_t my_onnxruntime_open_model();
+    result_t my_onnxruntime_open_model(const std::string *pModelContent = NULL);
     result_t my_onnxruntime_inference_tensors();
+    result_t my_onnxruntime_inference_tensors(tensor_array_t *input_tensor_array, tensor_array_t *output_tensor_array);
+    result_t my_onnxruntime_inference_tensors(tensor_array_t *input_tensor_array, tensor_array_t *output_tensor_array,
+                                              OrtRunOptions *pRunOptions);
+    result_t my_onnxruntime_run_ort_values(tensor_array_t *input_tensor_array, std::vector<const char *> &output_names,
+                                           std::vector<OrtValue *> &output_values);
+    result_t my_onnxruntime_run_values(const std::vector<const char *> &input_names,
+                                       const std::vector<OrtValue *> &input_values,
+                                       std::vector<const char *> &output_names, std::vector<OrtValue *> &output_values);
     result_t my_onnxruntime_release_model();
     void set_input_tensor_array(tensor_array_t *input_tensor_array);
     void set_output_tensor_array(tensor_array_t *ouput_tensor_array);
+    const load_profile_t &get_load_profile() const;
+    const model_params_t *get_model_param() const;
+    tensor_array_t *get_input_tensor_array();
+    tensor_array_t *get_output_tensor_array();
+    bool is_dynamic_input_dim(size_t nInput, size_t nDim) const;
+    result_t get_model_tensor_params(std::vector<tensor_params_t> &vecInputs, std::vector<tensor_params_t> &vecOutputs,
+                                     int nBatch, int nDynamicDimValue);
+    ImagePreprocessor *get_preprocessor();
+    AdmissionController *get_admission_controller();
+    RequestCoalescer *get_coalescer();
+    ResultCache *get_result_cache();
+    const std::vector<const char *> &get_input_names() const;
+    const std::vector<const char *> &get_output_names() const;
+
+    static result_t WrapTensorValue(tensor_t *pTensor, OrtValue **ppValue);
+    static result_t ReportStatus(OrtStatus *status);
+    static result_t CopyValueToTensor(OrtValue *pValue, tensor_t *pTensor);
 
 private:
     void GetModelInfo();
+    result_t WarmUp();
+    result_t WarmUpSession(OrtSession *pSession, int64_t nVariantValue);
+    void SetupSessionOptions(OrtSessionOptions *pSessionOptions);
+    bool IsQuantizedModel(OrtSession *pSession);
+    void CreateVariantSessions(const std::string &strModelPath, const std::string &strModelContent);
+    void FindVariantDims();
+    OrtSession *SelectSession(const std::vector<std::vector<int64_t>> &vecInputDims);
+    result_t CreateInputValues(tensor_array_t *input_array, std::vector<std::vector<int64_t>> &vecInputDims,
+                               std::vector<OrtValue *> &input_tensors, int64_t *pSeqLen, int64_t *pBucketLen);
+    result_t RunCoalesced(tensor_array_t *input_tensor_array, tensor_array_t *output_tensor_array,
+                          OrtRunOptions *pRunOptions);
+    result_t RunAdmitted(tensor_array_t *input_tensor_array, tensor_array_t *output_tensor_array,
+                         OrtRunOptions *pRunOptions);
+    result_t RunTensors(tensor_array_t *input_array, tensor_array_t *output_array, OrtRunOptions *pRunOptions);
+    bool GetBucketLength(const std::vector<std::vector<int64_t>> &vecInputDims, int64_t *pSeqLen,
+                         int64_t *pBucketLen);
+    void PadInputToBucket(size_t i, tensor_t *cur_tensor, int64_t nSeqLen, int64_t nBucketLen,
+                          std::vector<int64_t> &dims);
+    OutputPostprocessor *FindPostprocessor(const char *pName);
+    result_t PostprocessOutputTensor(OrtValue *output_value, tensor_t *cur_tensor,
+                                     OutputPostprocessor *pPostprocessor);
+    const output_convert_params_t *FindOutputConvert(const char *pName);
+    result_t CopyOutputTensor(OrtValue *output_value, tensor_t *cur_tensor, int64_t nSeqLen, int64_t nBucketLen,
+                              const output_convert_params_t *pConvert);
+    void RecordLoadPhase(load_phase_t ePhase, double dStartMs);
     void CheckStatus(OrtStatus *status);
     inline bool FindNameInTensorNames(const char *cur_name, std::vector<const char *> &node_names);
 
@@ -35,15 +92,33 @@ private:
     tensor_array_t *m_ouput_tensor_array;
     OrtSessionOptions *m_pSessionOptions;
     OrtSession *m_pSession;
+    OrtMemoryInfo *m_pCpuMemoryInfo;
+
+    // 按 model_variants_t 特化的session, 与 m_vecVariantValues 一一对应
+    std::vector<OrtSession *> m_vecVariantSessions;
+    std::vector<int64_t> m_vecVariantValues;
+    std::vector<std::pair<size_t, size_t>> m_vecVariantDimPos; // 特化维度在输入中的位置(输入序号, 维度序号)
 
     std::vector<const char *> m_vecInputNodesName;
     std::vector<ONNXTensorElementDataType> m_vecInputNodesType;
     std::vector<std::vector<int64_t>> m_vecInputNodesDims;
+    std::vector<std::vector<int64_t>> m_vecModelInputDims; // 模型中声明的输入shape, 符号维度为 -1
 
     std::vector<const char *> m_vecOutputNodesName;
     std::vector<ONNXTensorElementDataType> m_vecOutputNodesType;
     std::vector<std::vector<int64_t>> m_vecOutputNodesDims;
     std::mutex m_onnx_mutex;
+
+    ImagePreprocessor *m_pPreprocessor; // preprocess_params 启用时创建
+    std::vector<OutputPostprocessor *> m_vecPostprocessors; // 按 aPostprocess 配置, 每个输出名一个
+    std::vector<std::vector<my_u8>> m_vecPadBuffers; // 按长度桶补齐后的输入, 每次推理复用
+
+    AdmissionController *m_pAdmission; // admission_params 设置时创建
+    RequestCoalescer *m_pCoalescer;    // bCoalesceRequests 设置时创建
+    ResultCache *m_pResultCache;       // cache_params 设置时创建
+
+    load_profile_t m_tLoadProfile;
+    bool m_bFirstRunDone;
 };
 
 #endif //MY_INFERENCE_ONNX_MY_ONNX_INFERENCE_H
@@ -0,0 +1,140 @@
+#include "my_onnx_proto.h"
+
+void PbVarint(std::string &out, unsigned long long value)
+{
+    while (value >= 0x80)
+    {
+        out += (char)((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    out += (char)value;
+}
+
+void PbVarintField(std::string &out, int field, unsigned long long value)
+{
+    PbVarint(out, (unsigned long long)(field << 3));
+    PbVarint(out, value);
+}
+
+void PbBytesField(std::string &out, int field, const std::string &bytes)
+{
+    PbVarint(out, (unsigned long long)((field << 3) | 2));
+    PbVarint(out, bytes.size());
+    out += bytes;
+}
+
+static bool PbReadVarint(const std::string &msg, size_t &nPos, size_t nEnd, unsigned long long *pValue)
+{
+    unsigned long long value = 0;
+    for (int shift = 0; nPos < nEnd && shift < 64; shift += 7)
+    {
+        unsigned char c = (unsigned char)msg[nPos++];
+        value |= (unsigned long long)(c & 0x7f) << shift;
+        if (!(c & 0x80))
+        {
+            *pValue = value;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief split one level of a message into fields, nested messages are parsed again from their data range
+ *
+ * @param msg  消息
+ * @param nBegin  起点
+ * @param nEnd  终点
+ * @param vecFields  按出现顺序的字段
+ * @return true if the range is well formed
+ */
+bool PbParseMessage(const std::string &msg, size_t nBegin, size_t nEnd, std::vector<PbField> &vecFields)
+{
+    vecFields.clear();
+    size_t nPos = nBegin;
+    while (nPos < nEnd)
+    {
+        PbField field;
+        field.nBegin = nPos;
+        field.nValue = 0;
+        field.nDataBegin = 0;
+        field.nDataLength = 0;
+
+        unsigned long long tag;
+        if (!PbReadVarint(msg, nPos, nEnd, &tag))
+        {
+            return false;
+        }
+        field.nField = (int)(tag >> 3);
+        field.nWireType = (int)(tag & 7);
+
+        switch (field.nWireType)
+        {
+        case 0:
+            if (!PbReadVarint(msg, nPos, nEnd, &field.nValue))
+            {
+                return false;
+            }
+            break;
+        case 1:
+        case 5:
+        {
+            size_t nBytes = field.nWireType == 1 ? 8 : 4;
+            if (nPos + nBytes > nEnd)
+            {
+                return false;
+            }
+            for (size_t i = 0; i < nBytes; i++)
+            {
+                field.nValue |= (unsigned long long)(unsigned char)msg[nPos + i] << (8 * i);
+            }
+            nPos += nBytes;
+            break;
+        }
+        case 2:
+        {
+            unsigned long long nLength;
+            if (!PbReadVarint(msg, nPos, nEnd, &nLength) || nLength > nEnd - nPos)
+            {
+                return false;
+            }
+            field.nDataBegin = nPos;
+            field.nDataLength = nLength;
+            nPos += nLength;
+            break;
+        }
+        default:
+            return false;
+        }
+
+        field.nEnd = nPos;
+        vecFields.push_back(field);
+    }
+    return true;
+}
+
+std::string PbFieldData(const std::string &msg, const PbField &field)
+{
+    return msg.substr(field.nDataBegin, field.nDataLength);
+}
+
+bool PbParsePackedVarints(const std::string &msg, const PbField &field, std::vector<unsigned long long> &vecValues)
+{
+    size_t nPos = field.nDataBegin;
+    size_t nEnd = field.nDataBegin + field.nDataLength;
+    while (nPos < nEnd)
+    {
+        unsigned long long value;
+        if (!PbReadVarint(msg, nPos, nEnd, &value))
+        {
+            return false;
+        }
+        vecValues.push_back(value);
+    }
+    return true;
+}
+
+void PbCopyField(std::string &out, const std::string &msg, const PbField &field)
+{
+    out.append(msg, field.nBegin, field.nEnd - field.nBegin);
+}
@@ -0,0 +1,38 @@
+#ifndef MY_INFERENCE_ONNX_MY_ONNX_PROTO_H
+#define MY_INFERENCE_ONNX_MY_ONNX_PROTO_H
+#include <string>
+#include <vector>
+
+// 最小的 protobuf 编解码, 用于生成和改写 onnx 模型, 不依赖 libprotobuf
+
+void PbVarint(std::string &out, unsigned long long value);
+
+void PbVarintField(std::string &out, int field, unsigned long long value);
+
+void PbBytesField(std::string &out, int field, const std::string &bytes);
+
+// 一个字段在消息中的位置, 改写时没有修改的字段按原样拷贝
+struct PbField
+{
+    int nField;
+    int nWireType;
+    unsigned long long nValue; // varint / fixed 的值
+    size_t nBegin;             // 整个字段(含tag)在消息中的起止
+    size_t nEnd;
+    size_t nDataBegin;         // length-delimited 字段的内容
+    size_t nDataLength;
+};
+
+// 解析 msg[nBegin, nEnd) 中的一层字段, 不支持 group
+bool PbParseMessage(const std::string &msg, size_t nBegin, size_t nEnd, std::vector<PbField> &vecFields);
+
+// length-delimited 字段的内容
+std::string PbFieldData(const std::string &msg, const PbField &field);
+
+// packed repeated varint 字段, 如 TensorProto.dims
+bool PbParsePackedVarints(const std::string &msg, const PbField &field, std::vector<unsigned long long> &vecValues);
+
+// 字段原样追加到 out
+void PbCopyField(std::string &out, const std::string &msg, const PbField &field);
+
+#endif //MY_INFERENCE_ONNX_MY_ONNX_PROTO_H
@@ -0,0 +1,342 @@
+#include "my_memory.h"
+#include "my_preprocess.h"
+#include "my_onnx_inference.h"
+#include "my_pipeline.h"
+
+/**
+ * @brief Construct a new Image Pipeline:: Image Pipeline object
+ *
+ * @param pOnnxHdl  已加载的模型, preprocess_params 必须启用
+ * @param callback  每个batch推理完成后的回调, 在推理线程中调用
+ * @param user_data  回调参数
+ */
+ImagePipeline::ImagePipeline(OnnxRuntimeModelHandle *pOnnxHdl, pipeline_callback_t callback, void *user_data)
+    : m_pOnnxHdl(pOnnxHdl), m_callback(callback), m_user_data(user_data), m_nBatchSize(1), m_nQueueDepth(1),
+      m_nCurSlot(-1), m_bStop(true)
+{
+}
+
+/**
+ * @brief Destroy the Image Pipeline:: Image Pipeline object
+ *
+ */
+ImagePipeline::~ImagePipeline()
+{
+    Stop();
+
+    for (size_t i = 0; i < m_vecSlots.size(); i++)
+    {
+        release_tensor_arry(m_vecSlots[i].input_tensors);
+        release_tensor_arry(m_vecSlots[i].output_tensors);
+    }
+    m_vecSlots.clear();
+
+    for (size_t i = 0; i < m_vecPreprocessors.size(); i++)
+    {
+        delete m_vecPreprocessors[i];
+    }
+    m_vecPreprocessors.clear();
+}
+
+/**
+ * @brief allocate nSlots input/output buffers and start the preprocessing workers and the inference thread.
+ *        With nSlots >= 2, frames of one slot are preprocessed while another slot is inside Run.
+ *
+ * @param input_params  输入tensor参数, 预处理的输入第0维为batch大小
+ * @param output_params  输出tensor参数
+ * @param nWorkers  预处理线程数
+ * @param nSlots  buffer组数, 至少2
+ * @param nQueueDepth  等待预处理的最大帧数, 满了以后 Submit 阻塞
+ * @return result_t
+ */
+result_t ImagePipeline::Start(tensor_params_array_t *input_params, tensor_params_array_t *output_params,
+                              int nWorkers, int nSlots, int nQueueDepth)
+{
+    MY_CHECK_NULL(m_pOnnxHdl, MY_PARAM_NULL);
+    MY_CHECK_NULL(input_params, MY_PARAM_NULL);
+    MY_CHECK_NULL(output_params, MY_PARAM_NULL);
+
+    const image_preprocess_params_t *pPreParams = &m_pOnnxHdl->get_model_param()->preprocess_params;
+    if (!pPreParams->bEnable || pPreParams->nInputIndex < 0 || pPreParams->nInputIndex >= input_params->nArraySize)
+    {
+        MY_ERROR("preprocess_params of the model is not enabled or invalid\n");
+        return MY_PARAM_SET_ERROR;
+    }
+    if (nWorkers <= 0 || nSlots < 2 || nQueueDepth <= 0 || !m_bStop)
+    {
+        return MY_PARAM_SET_ERROR;
+    }
+
+    m_nBatchSize = input_params->pTensorParamArray[pPreParams->nInputIndex].pShape[0];
+    m_nQueueDepth = nQueueDepth;
+    if (m_nBatchSize <= 0)
+    {
+        MY_ERROR("batch size of the preprocessed input should be > 0\n");
+        return MY_PARAM_SET_ERROR;
+    }
+
+    for (int i = 0; i < nSlots; i++)
+    {
+        PipelineSlot slot;
+        slot.input_tensors = NULL;
+        slot.output_tensors = NULL;
+        slot.nDone = 0;
+        slot.bSealed = false;
+        slot.res = MY_SUCCESS;
+        if (MY_SUCCESS != alloc_tensor_arry(input_params, &slot.input_tensors) ||
+            MY_SUCCESS != alloc_tensor_arry(output_params, &slot.output_tensors))
+        {
+            return MY_TENSOR_ALLOC_FAILED;
+        }
+        m_vecSlots.push_back(slot);
+        m_freeSlots.push_back(i);
+    }
+
+    m_bStop = false;
+    for (int i = 0; i < nWorkers; i++)
+    {
+        m_vecPreprocessors.push_back(new ImagePreprocessor(pPreParams));
+        m_vecWorkers.push_back(std::thread(&ImagePipeline::WorkerLoop, this, i));
+    }
+    m_inferenceThread = std::thread(&ImagePipeline::InferenceLoop, this);
+
+    return MY_SUCCESS;
+}
+
+/**
+ * @brief queue one frame. Blocks while the preprocessing queue is full or all slots are in use (backpressure).
+ *        The image is not copied, cv::Mat keeps its data alive by reference count; a Mat wrapping external
+ *        memory must stay valid until the frame's callback.
+ *
+ * @param nFrameId  帧号, 回调时返回
+ * @param image  uint8 图像
+ * @param format  像素格式
+ * @return result_t
+ */
+result_t ImagePipeline::Submit(long long nFrameId, const cv::Mat &image, pixel_format_t format)
+{
+    PipelineJob job;
+    job.image = image;
+    job.format = format;
+    return AssignFrame(nFrameId, job);
+}
+
+/**
+ * @brief queue one encoded frame (jpg/png/...), decoded on the workers. The encoded bytes are copied.
+ *
+ * @param nFrameId  帧号
+ * @param pData  编码后的图像
+ * @param nLength  字节数
+ * @return result_t
+ */
+result_t ImagePipeline::SubmitEncoded(long long nFrameId, const my_u8 *pData, int nLength)
+{
+    MY_CHECK_NULL(pData, MY_PARAM_NULL);
+
+    PipelineJob job;
+    job.format = PIXEL_FORMAT_BGR;
+    job.encoded.assign(pData, pData + nLength);
+    return AssignFrame(nFrameId, job);
+}
+
+/**
+ * @brief put a frame into the current slot at the next batch index and queue it for preprocessing
+ *
+ * @param nFrameId  帧号
+ * @param job  预处理任务
+ * @return result_t
+ */
+result_t ImagePipeline::AssignFrame(long long nFrameId, PipelineJob &job)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cvFreeSlot.wait(lock, [this] {
+        return m_bStop || ((int)m_jobs.size() < m_nQueueDepth && (m_nCurSlot >= 0 || !m_freeSlots.empty()));
+    });
+    if (m_bStop)
+    {
+        return MY_FAILED;
+    }
+
+    if (m_nCurSlot < 0)
+    {
+        m_nCurSlot = m_freeSlots.front();
+        m_freeSlots.pop_front();
+
+        PipelineSlot &slot = m_vecSlots[m_nCurSlot];
+        slot.vecFrameIds.clear();
+        slot.nDone = 0;
+        slot.bSealed = false;
+        slot.res = MY_SUCCESS;
+    }
+
+    PipelineSlot &slot = m_vecSlots[m_nCurSlot];
+    job.nSlot = m_nCurSlot;
+    job.nBatchIndex = (int)slot.vecFrameIds.size();
+    slot.vecFrameIds.push_back(nFrameId);
+    m_jobs.push_back(job);
+    m_cvJob.notify_one();
+
+    if ((int)slot.vecFrameIds.size() == m_nBatchSize)
+    {
+        SealSlot(m_nCurSlot);
+        m_nCurSlot = -1;
+    }
+    return MY_SUCCESS;
+}
+
+/**
+ * @brief no more frames for this slot, queue it for inference once all its frames are preprocessed.
+ *        Called with m_mutex held.
+ *
+ * @param nSlot  slot序号
+ */
+void ImagePipeline::SealSlot(int nSlot)
+{
+    m_vecSlots[nSlot].bSealed = true;
+    m_sealedSlots.push_back(nSlot);
+    m_cvReady.notify_one();
+}
+
+/**
+ * @brief run the partially filled slot and wait until every queued frame has been inferred
+ *
+ * @return result_t
+ */
+result_t ImagePipeline::Flush()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_nCurSlot >= 0)
+    {
+        SealSlot(m_nCurSlot);
+        m_nCurSlot = -1;
+    }
+
+    m_cvIdle.wait(lock, [this] { return m_bStop || m_freeSlots.size() == m_vecSlots.size(); });
+    return MY_SUCCESS;
+}
+
+/**
+ * @brief flush, then stop and join all threads
+ *
+ */
+void ImagePipeline::Stop()
+{
+    if (m_bStop)
+    {
+        return;
+    }
+    Flush();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_bStop = true;
+    }
+    m_cvJob.notify_all();
+    m_cvReady.notify_all();
+    m_cvFreeSlot.notify_all();
+    m_cvIdle.notify_all();
+
+    for (size_t i = 0; i < m_vecWorkers.size(); i++)
+    {
+        m_vecWorkers[i].join();
+    }
+    m_vecWorkers.clear();
+    if (m_inferenceThread.joinable())
+    {
+        m_inferenceThread.join();
+    }
+}
+
+/**
+ * @brief preprocessing worker: decode/resize/normalize frames straight into their slot's input tensor
+ *
+ * @param nWorker  worker序号
+ */
+void ImagePipeline::WorkerLoop(int nWorker)
+{
+    ImagePreprocessor *pPreprocessor = m_vecPreprocessors[nWorker];
+    int nInputIndex = m_pOnnxHdl->get_model_param()->preprocess_params.nInputIndex;
+
+    while (true)
+    {
+        PipelineJob job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cvJob.wait(lock, [this] { return m_bStop || !m_jobs.empty(); });
+            if (m_jobs.empty())
+            {
+                return;
+            }
+            job = m_jobs.front();
+            m_jobs.pop_front();
+            m_cvFreeSlot.notify_one();
+        }
+
+        // 不同帧写入slot中不同的batch位置, 不需要加锁
+        tensor_t *pDstTensor = &m_vecSlots[job.nSlot].input_tensors->pTensorArray[nInputIndex];
+        result_t res;
+        if (!job.encoded.empty())
+        {
+            res = pPreprocessor->ProcessEncoded(job.encoded.data(), (int)job.encoded.size(), pDstTensor,
+                                                job.nBatchIndex);
+        }
+        else
+        {
+            res = pPreprocessor->Process(job.image, job.format, pDstTensor, job.nBatchIndex);
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        PipelineSlot &slot = m_vecSlots[job.nSlot];
+        slot.nDone++;
+        if (MY_SUCCESS != res)
+        {
+            slot.res = res;
+        }
+        m_cvReady.notify_one();
+    }
+}
+
+/**
+ * @brief run sealed slots in submit order on the model handle, report results, then recycle the slot
+ *
+ */
+void ImagePipeline::InferenceLoop()
+{
+    while (true)
+    {
+        int nSlot;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cvReady.wait(lock, [this] {
+                if (m_sealedSlots.empty())
+                {
+                    return m_bStop;
+                }
+                const PipelineSlot &front = m_vecSlots[m_sealedSlots.front()];
+                return front.nDone == (int)front.vecFrameIds.size();
+            });
+            if (m_sealedSlots.empty())
+            {
+                return;
+            }
+            nSlot = m_sealedSlots.front();
+            m_sealedSlots.pop_front();
+        }
+
+        PipelineSlot &slot = m_vecSlots[nSlot];
+        result_t res = slot.res;
+        if (MY_SUCCESS == res)
+        {
+            res = m_pOnnxHdl->my_onnxruntime_inference_tensors(slot.input_tensors, slot.output_tensors);
+        }
+        if (m_callback)
+        {
+            m_callback(slot.vecFrameIds.data(), (int)slot.vecFrameIds.size(), res, slot.output_tensors, m_user_data);
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_freeSlots.push_back(nSlot);
+        m_cvFreeSlot.notify_all();
+        m_cvIdle.notify_all();
+    }
+}
@@ -0,0 +1,76 @@
+#ifndef MY_INFERENCE_ONNX_MY_PIPELINE_H
+#define MY_INFERENCE_ONNX_MY_PIPELINE_H
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "opencv2/core.hpp"
+#include "common.h"
+
+class OnnxRuntimeModelHandle;
+class ImagePreprocessor;
+
+// 一组输入输出buffer, 装一个batch的帧
+struct PipelineSlot
+{
+    tensor_array_t *input_tensors;
+    tensor_array_t *output_tensors;
+    std::vector<long long> vecFrameIds; // 已分配到该slot的帧, 下标即batch index
+    int nDone;                          // 已完成预处理的帧数
+    bool bSealed;                       // 不再分配新的帧
+    result_t res;                       // 预处理结果, 任意一帧失败则失败
+};
+
+struct PipelineJob
+{
+    int nSlot;
+    int nBatchIndex;
+    cv::Mat image;                // 未编码的图像, 与 encoded 二选一
+    pixel_format_t format;
+    std::vector<my_u8> encoded;   // 编码后的图像
+};
+
+class ImagePipeline
+{
+public:
+    ImagePipeline(OnnxRuntimeModelHandle *pOnnxHdl, pipeline_callback_t callback, void *user_data);
+    ~ImagePipeline();
+    result_t Start(tensor_params_array_t *input_params, tensor_params_array_t *output_params, int nWorkers,
+                   int nSlots, int nQueueDepth);
+    result_t Submit(long long nFrameId, const cv::Mat &image, pixel_format_t format);
+    result_t SubmitEncoded(long long nFrameId, const my_u8 *pData, int nLength);
+    result_t Flush();
+    void Stop();
+
+private:
+    result_t AssignFrame(long long nFrameId, PipelineJob &job);
+    void SealSlot(int nSlot);
+    void WorkerLoop(int nWorker);
+    void InferenceLoop();
+
+private:
+    OnnxRuntimeModelHandle *m_pOnnxHdl;
+    pipeline_callback_t m_callback;
+    void *m_user_data;
+    int m_nBatchSize;   // 输入tensor的第0维
+    int m_nQueueDepth;
+
+    std::vector<PipelineSlot> m_vecSlots;
+    std::vector<ImagePreprocessor *> m_vecPreprocessors; // 每个worker一个
+    std::vector<std::thread> m_vecWorkers;
+    std::thread m_inferenceThread;
+
+    std::mutex m_mutex;
+    std::condition_variable m_cvFreeSlot;  // 有空闲slot或job队列有空位
+    std::condition_variable m_cvJob;       // 有新的预处理任务
+    std::condition_variable m_cvReady;     // 有slot可以推理
+    std::condition_variable m_cvIdle;      // 所有slot都空闲
+    std::deque<int> m_freeSlots;
+    std::deque<PipelineJob> m_jobs;
+    std::deque<int> m_sealedSlots;         // 按分配顺序等待推理的slot
+    int m_nCurSlot;                        // 正在分配帧的slot, -1 表示没有
+    bool m_bStop;
+};
+
+#endif //MY_INFERENCE_ONNX_MY_PIPELINE_H
@@ -0,0 +1,393 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include "my_kernels.h"
+#include "my_utils.h"
+#include "my_postprocess.h"
+
+/**
+ * @brief softmax of one row: max, exp(x - max) with its sum, then one scale pass, all on the SIMD kernels
+ *
+ * @param src  输入
+ * @param dst  输出, 可以等于 src
+ * @param n  元素个数
+ */
+void SoftmaxF32(const float *src, float *dst, size_t n)
+{
+    if (0 == n)
+    {
+        return;
+    }
+    float fMax = ReduceMaxF32(src, n);
+    float fSum = ExpSumF32(src, dst, n, fMax);
+    NormalizeF32(dst, dst, n, 1.0f / fSum, 0.0f);
+}
+
+/**
+ * @brief top-k of one row. k == 1 is a vectorized max plus one scan, otherwise a size-k min-heap whose
+ *        root rejects most elements with a single compare. softmax is monotonic, so only the k winners are
+ *        converted to probabilities, the full row just contributes to the exp sum.
+ *
+ * @param src  输入, 长度 n
+ * @param n  元素个数
+ * @param k  取前k个, 不超过 n
+ * @param bSoftmax  score 是否为softmax概率
+ * @param vecScratch  softmax 的临时空间
+ * @param pDst  输出 k 个 (index, score)
+ */
+void TopKF32(const float *src, size_t n, int k, bool bSoftmax, std::vector<float> &vecScratch, float *pDst)
+{
+    typedef std::pair<float, int> ScoreIndex;
+    std::vector<ScoreIndex> vecTop;
+
+    float fMax = ReduceMaxF32(src, n);
+    if (1 == k)
+    {
+        size_t nIndex = 0;
+        while (nIndex + 1 < n && src[nIndex] != fMax)
+        {
+            nIndex++;
+        }
+        vecTop.push_back(ScoreIndex(fMax, (int)nIndex));
+    }
+    else
+    {
+        vecTop.reserve(k);
+        for (size_t i = 0; i < n; i++)
+        {
+            if ((int)vecTop.size() < k)
+            {
+                vecTop.push_back(ScoreIndex(src[i], (int)i));
+                std::push_heap(vecTop.begin(), vecTop.end(), std::greater<ScoreIndex>());
+            }
+            else if (src[i] > vecTop.front().first)
+            {
+                std::pop_heap(vecTop.begin(), vecTop.end(), std::greater<ScoreIndex>());
+                vecTop.back() = ScoreIndex(src[i], (int)i);
+                std::push_heap(vecTop.begin(), vecTop.end(), std::greater<ScoreIndex>());
+            }
+        }
+        std::sort_heap(vecTop.begin(), vecTop.end(), std::greater<ScoreIndex>());
+    }
+
+    float fInvSum = 1.0f;
+    if (bSoftmax)
+    {
+        vecScratch.resize(n);
+        fInvSum = 1.0f / ExpSumF32(src, vecScratch.data(), n, fMax);
+    }
+
+    for (size_t i = 0; i < vecTop.size(); i++)
+    {
+        pDst[2 * i] = (float)vecTop[i].second;
+        pDst[2 * i + 1] = bSoftmax ? expf(vecTop[i].first - fMax) * fInvSum : vecTop[i].first;
+    }
+}
+
+/**
+ * @brief decode raw detector rows into boxes, dropping low scores before NMS
+ *
+ * @param src  [nBoxes, nStride]
+ * @param nBoxes  框个数
+ * @param nStride  每个框的float个数
+ * @param layout  排布
+ * @param fScoreThreshold  score 阈值
+ * @param vecBoxes  结果追加到末尾
+ */
+void DecodeBoxes(const float *src, size_t nBoxes, size_t nStride, box_layout_t layout, float fScoreThreshold,
+                 std::vector<DetectionBox> &vecBoxes)
+{
+    for (size_t i = 0; i < nBoxes; i++)
+    {
+        const float *p = src + i * nStride;
+        DetectionBox box;
+
+        if (BOX_LAYOUT_XYXY_SCORE_CLASS == layout)
+        {
+            if (p[4] < fScoreThreshold)
+            {
+                continue;
+            }
+            box.x1 = p[0];
+            box.y1 = p[1];
+            box.x2 = p[2];
+            box.y2 = p[3];
+            box.score = p[4];
+            box.nClass = (int)p[5];
+        }
+        else
+        {
+            // 类别分数不超过1, objectness 不过阈值时整行跳过
+            float fObj = p[4];
+            if (fObj < fScoreThreshold)
+            {
+                continue;
+            }
+            size_t nClasses = nStride - 5;
+            size_t nBest = 0;
+            for (size_t c = 1; c < nClasses; c++)
+            {
+                nBest = p[5 + c] > p[5 + nBest] ? c : nBest;
+            }
+            box.score = fObj * (nClasses > 0 ? p[5 + nBest] : 1.0f);
+            if (box.score < fScoreThreshold)
+            {
+                continue;
+            }
+            box.x1 = p[0] - 0.5f * p[2];
+            box.y1 = p[1] - 0.5f * p[3];
+            box.x2 = p[0] + 0.5f * p[2];
+            box.y2 = p[1] + 0.5f * p[3];
+            box.nClass = (int)nBest;
+        }
+        vecBoxes.push_back(box);
+    }
+}
+
+/**
+ * @brief greedy NMS. Boxes are sorted by score and copied into SoA arrays so the inner IoU loop is
+ *        branch free and vectorizable; division is avoided by comparing inter > thr * union.
+ *
+ * @param vecBoxes  输入框, 返回时只保留留下的框, 按 score 从大到小
+ * @param fIouThreshold  IoU 阈值
+ * @param nMaxDetections  最多保留的框数, <=0 不限制
+ * @param bClassAgnostic  不区分类别
+ */
+void NonMaxSuppression(std::vector<DetectionBox> &vecBoxes, float fIouThreshold, int nMaxDetections,
+                       bool bClassAgnostic)
+{
+    std::sort(vecBoxes.begin(), vecBoxes.end(),
+              [](const DetectionBox &a, const DetectionBox &b) { return a.score > b.score; });
+
+    size_t n = vecBoxes.size();
+    size_t nMaxKeep = nMaxDetections > 0 ? (size_t)nMaxDetections : n;
+    std::vector<float> x1(n), y1(n), x2(n), y2(n), area(n);
+    std::vector<int> cls(n);
+    std::vector<my_u8> suppressed(n, 0);
+    for (size_t i = 0; i < n; i++)
+    {
+        x1[i] = vecBoxes[i].x1;
+        y1[i] = vecBoxes[i].y1;
+        x2[i] = vecBoxes[i].x2;
+        y2[i] = vecBoxes[i].y2;
+        area[i] = std::max(0.0f, x2[i] - x1[i]) * std::max(0.0f, y2[i] - y1[i]);
+        cls[i] = bClassAgnostic ? 0 : vecBoxes[i].nClass;
+    }
+
+    size_t nKeep = 0;
+    for (size_t i = 0; i < n && nKeep < nMaxKeep; i++)
+    {
+        if (suppressed[i])
+        {
+            continue;
+        }
+        vecBoxes[nKeep++] = vecBoxes[i];
+
+        for (size_t j = i + 1; j < n; j++)
+        {
+            float w = std::max(0.0f, std::min(x2[i], x2[j]) - std::max(x1[i], x1[j]));
+            float h = std::max(0.0f, std::min(y2[i], y2[j]) - std::max(y1[i], y1[j]));
+            float inter = w * h;
+            bool bOverlap = inter > fIouThreshold * (area[i] + area[j] - inter);
+            suppressed[j] |= (my_u8)(bOverlap & (cls[i] == cls[j]));
+        }
+    }
+    vecBoxes.resize(nKeep);
+}
+
+/**
+ * @brief Construct a new Output Postprocessor:: Output Postprocessor object
+ *
+ * @param pParams  后处理参数
+ */
+OutputPostprocessor::OutputPostprocessor(const postprocess_params_t *pParams)
+{
+    m_tParams = *pParams;
+}
+
+const char *OutputPostprocessor::GetTensorName() const
+{
+    return m_tParams.aTensorName;
+}
+
+/**
+ * @brief run the configured operator on a float model output and write the compact result into dst_tensor.
+ *        dst_tensor must be DT_FLOAT and allocated with the result shape, its shape is rewritten on success.
+ *
+ * @param pSrc  模型输出
+ * @param pDims  模型输出的shape
+ * @param nDims  rank
+ * @param dst_tensor  结果
+ * @return result_t
+ */
+result_t OutputPostprocessor::Process(const float *pSrc, const int64_t *pDims, size_t nDims, tensor_t *dst_tensor)
+{
+    MY_CHECK_NULL(pSrc, MY_PARAM_NULL);
+    MY_CHECK_NULL(dst_tensor, MY_PARAM_NULL);
+    MY_CHECK_NULL(dst_tensor->pValue, MY_PARAM_NULL);
+
+    if (DT_FLOAT != dst_tensor->pTensorInfo->type || 0 == nDims)
+    {
+        MY_ERROR("postprocess of %s needs a DT_FLOAT output with rank > 0\n", m_tParams.aTensorName);
+        return MY_PARAM_SET_ERROR;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    switch (m_tParams.type)
+    {
+    case POSTPROCESS_SOFTMAX:
+        return ProcessSoftmax(pSrc, pDims, nDims, dst_tensor);
+    case POSTPROCESS_ARGMAX:
+    case POSTPROCESS_TOPK:
+        return ProcessTopK(pSrc, pDims, nDims, dst_tensor);
+    case POSTPROCESS_NMS:
+        return ProcessNms(pSrc, pDims, nDims, dst_tensor);
+    default:
+        MY_ERROR("unknown postprocess type %d\n", (int)m_tParams.type);
+        return MY_PARAM_SET_ERROR;
+    }
+}
+
+/**
+ * @brief set dst shape and check that the result fits the allocated buffer
+ *
+ */
+static result_t SetResultShape(tensor_t *dst_tensor, const std::vector<int64_t> &vecShape)
+{
+    tensor_params_t *dst_param = dst_tensor->pTensorInfo;
+    size_t nElements = 1;
+    for (size_t j = 0; j < vecShape.size(); j++)
+    {
+        nElements *= vecShape[j];
+    }
+    if (vecShape.size() > 8 || nElements * sizeof(float) > (size_t)dst_param->nLength)
+    {
+        MY_ERROR("output %s is too small for the postprocess result (%zu floats)\n", dst_param->aTensorName,
+                 nElements);
+        return MY_TENSOR_ALLOC_FAILED;
+    }
+
+    dst_param->nDims = (int)vecShape.size();
+    for (size_t j = 0; j < vecShape.size(); j++)
+    {
+        dst_param->pShape[j] = (int)vecShape[j];
+    }
+    GetTensorSize(dst_tensor);
+    return MY_SUCCESS;
+}
+
+result_t OutputPostprocessor::ProcessSoftmax(const float *pSrc, const int64_t *pDims, size_t nDims,
+                                             tensor_t *dst_tensor)
+{
+    std::vector<int64_t> vecShape(pDims, pDims + nDims);
+    result_t res = SetResultShape(dst_tensor, vecShape);
+    if (MY_SUCCESS != res)
+    {
+        return res;
+    }
+
+    size_t nCols = pDims[nDims - 1];
+    size_t nRows = nCols > 0 ? dst_tensor->pTensorInfo->nElementSize / nCols : 0;
+    float *pDst = (float *)dst_tensor->pValue;
+    for (size_t r = 0; r < nRows; r++)
+    {
+        SoftmaxF32(pSrc + r * nCols, pDst + r * nCols, nCols);
+    }
+    return MY_SUCCESS;
+}
+
+result_t OutputPostprocessor::ProcessTopK(const float *pSrc, const int64_t *pDims, size_t nDims,
+                                          tensor_t *dst_tensor)
+{
+    size_t nCols = pDims[nDims - 1];
+    size_t nRows = 1;
+    for (size_t j = 0; j + 1 < nDims; j++)
+    {
+        nRows *= pDims[j];
+    }
+
+    int k = POSTPROCESS_ARGMAX == m_tParams.type ? 1 : std::min(m_tParams.nTopK, (int)nCols);
+    if (k <= 0)
+    {
+        MY_ERROR("nTopK of %s should be > 0\n", m_tParams.aTensorName);
+        return MY_PARAM_SET_ERROR;
+    }
+
+    std::vector<int64_t> vecShape(pDims, pDims + nDims - 1);
+    vecShape.push_back(k);
+    vecShape.push_back(2);
+    result_t res = SetResultShape(dst_tensor, vecShape);
+    if (MY_SUCCESS != res)
+    {
+        return res;
+    }
+
+    float *pDst = (float *)dst_tensor->pValue;
+    for (size_t r = 0; r < nRows; r++)
+    {
+        TopKF32(pSrc + r * nCols, nCols, k, m_tParams.bSoftmax, m_vecScratch, pDst + r * k * 2);
+    }
+    return MY_SUCCESS;
+}
+
+result_t OutputPostprocessor::ProcessNms(const float *pSrc, const int64_t *pDims, size_t nDims,
+                                         tensor_t *dst_tensor)
+{
+    if (nDims < 2 || nDims > 3)
+    {
+        MY_ERROR("NMS input %s should be [batch, N, C] or [N, C]\n", m_tParams.aTensorName);
+        return MY_PARAM_SET_ERROR;
+    }
+
+    size_t nBatch = 3 == nDims ? pDims[0] : 1;
+    size_t nBoxes = pDims[nDims - 2];
+    size_t nStride = pDims[nDims - 1];
+    size_t nMinStride = BOX_LAYOUT_XYXY_SCORE_CLASS == m_tParams.box_layout ? 6 : 5;
+    if (nStride < nMinStride || m_tParams.nMaxDetections <= 0)
+    {
+        MY_ERROR("NMS input %s has %zu values per box, nMaxDetections %d\n", m_tParams.aTensorName, nStride,
+                 m_tParams.nMaxDetections);
+        return MY_PARAM_SET_ERROR;
+    }
+
+    std::vector<int64_t> vecShape;
+    vecShape.push_back(nBatch);
+    vecShape.push_back(m_tParams.nMaxDetections);
+    vecShape.push_back(6);
+    result_t res = SetResultShape(dst_tensor, vecShape);
+    if (MY_SUCCESS != res)
+    {
+        return res;
+    }
+
+    for (size_t b = 0; b < nBatch; b++)
+    {
+        m_vecBoxes.clear();
+        DecodeBoxes(pSrc + b * nBoxes * nStride, nBoxes, nStride, m_tParams.box_layout, m_tParams.fScoreThreshold,
+                    m_vecBoxes);
+        NonMaxSuppression(m_vecBoxes, m_tParams.fIouThreshold, m_tParams.nMaxDetections,
+                          m_tParams.bClassAgnostic != FALSE);
+
+        float *pDst = (float *)dst_tensor->pValue + b * m_tParams.nMaxDetections * 6;
+        for (int i = 0; i < m_tParams.nMaxDetections; i++, pDst += 6)
+        {
+            if ((size_t)i < m_vecBoxes.size())
+            {
+                const DetectionBox &box = m_vecBoxes[i];
+                pDst[0] = box.x1;
+                pDst[1] = box.y1;
+                pDst[2] = box.x2;
+                pDst[3] = box.y2;
+                pDst[4] = box.score;
+                pDst[5] = (float)box.nClass;
+            }
+            else
+            {
+                memset(pDst, 0, 5 * sizeof(float));
+                pDst[5] = -1.0f;
+            }
+        }
+    }
+    return MY_SUCCESS;
+}
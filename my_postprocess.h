@@ -0,0 +1,51 @@
+#ifndef MY_INFERENCE_ONNX_MY_POSTPROCESS_H
+#define MY_INFERENCE_ONNX_MY_POSTPROCESS_H
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include "common.h"
+
+// 检测框, 坐标为 x1, y1, x2, y2
+struct DetectionBox
+{
+    float x1, y1, x2, y2;
+    float score;
+    int nClass;
+};
+
+// dst = softmax(src), dst 可以等于 src
+void SoftmaxF32(const float *src, float *dst, size_t n);
+
+// 前k个 (index, score) 写入 pDst[2 * k], 按 score 从大到小; bSoftmax 时 score 为softmax概率
+void TopKF32(const float *src, size_t n, int k, bool bSoftmax, std::vector<float> &vecScratch, float *pDst);
+
+// 解码 nBoxes 个框(每个框 nStride 个float), 丢弃 score 低于 fScoreThreshold 的框, 结果追加到 vecBoxes
+void DecodeBoxes(const float *src, size_t nBoxes, size_t nStride, box_layout_t layout, float fScoreThreshold,
+                 std::vector<DetectionBox> &vecBoxes);
+
+// 按 score 排序后贪心抑制, vecBoxes 只保留留下的框(最多 nMaxDetections 个, <=0 不限制)
+void NonMaxSuppression(std::vector<DetectionBox> &vecBoxes, float fIouThreshold, int nMaxDetections,
+                       bool bClassAgnostic);
+
+class OutputPostprocessor
+{
+public:
+    explicit OutputPostprocessor(const postprocess_params_t *pParams);
+    const char *GetTensorName() const;
+    result_t Process(const float *pSrc, const int64_t *pDims, size_t nDims, tensor_t *dst_tensor);
+
+private:
+    result_t ProcessSoftmax(const float *pSrc, const int64_t *pDims, size_t nDims, tensor_t *dst_tensor);
+    result_t ProcessTopK(const float *pSrc, const int64_t *pDims, size_t nDims, tensor_t *dst_tensor);
+    result_t ProcessNms(const float *pSrc, const int64_t *pDims, size_t nDims, tensor_t *dst_tensor);
+
+private:
+    postprocess_params_t m_tParams;
+
+    // 每次调用复用的中间结果
+    std::vector<float> m_vecScratch;
+    std::vector<DetectionBox> m_vecBoxes;
+    std::mutex m_mutex;
+};
+
+#endif //MY_INFERENCE_ONNX_MY_POSTPROCESS_H
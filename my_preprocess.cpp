@@ -0,0 +1,243 @@
+#include "opencv2/imgproc.hpp"
+#include "opencv2/imgcodecs.hpp"
+#include <algorithm>
+#include <cmath>
+#include "my_kernels.h"
+#include "my_preprocess.h"
+
+/**
+ * @brief Construct a new Image Preprocessor:: Image Preprocessor object
+ *
+ * @param pParams  预处理参数
+ */
+ImagePreprocessor::ImagePreprocessor(const image_preprocess_params_t *pParams)
+{
+    m_tParams = *pParams;
+
+    // (x - mean) / std 合并成一次乘加
+    for (int c = 0; c < 3; c++)
+    {
+        float fStd = m_tParams.aStd[c] != 0 ? m_tParams.aStd[c] : 1.0f;
+        m_aScale[c] = 1.0f / fStd;
+        m_aBias[c] = -m_tParams.aMean[c] / fStd;
+    }
+}
+
+/**
+ * @brief convert color if needed, resize to the tensor H/W, then write normalized NCHW floats into
+ *        batch nBatchIndex of dst_tensor. With bLetterbox the aspect ratio is kept, the image is centered
+ *        and only the border is filled with fPadValue, so nothing is written twice.
+ *
+ * @param src  uint8 HWC image
+ * @param src_format  src 的像素格式
+ * @param dst_tensor  DT_FLOAT tensor, shape [N, C, H, W]
+ * @param nBatchIndex  写到第几个batch
+ * @param pLetterbox  返回源图像到tensor的坐标变换, 可以为NULL
+ * @return result_t
+ */
+result_t ImagePreprocessor::Process(const cv::Mat &src, pixel_format_t src_format, tensor_t *dst_tensor,
+                                    int nBatchIndex, letterbox_info_t *pLetterbox)
+{
+    MY_CHECK_NULL(dst_tensor, MY_PARAM_NULL);
+    MY_CHECK_NULL(dst_tensor->pValue, MY_PARAM_NULL);
+
+    tensor_params_t *dst_param = dst_tensor->pTensorInfo;
+    if (dst_param->type != DT_FLOAT || dst_param->nDims != 4)
+    {
+        MY_ERROR("tensor %s should be DT_FLOAT with shape [N, C, H, W]\n", dst_param->aTensorName);
+        return MY_PARAM_SET_ERROR;
+    }
+
+    int nChannels = dst_param->pShape[1];
+    int nHeight = dst_param->pShape[2];
+    int nWidth = dst_param->pShape[3];
+    if (nBatchIndex < 0 || nBatchIndex >= dst_param->pShape[0] || (nChannels != 1 && nChannels != 3))
+    {
+        MY_ERROR("batch index %d or channels %d of tensor %s is invalid\n", nBatchIndex, nChannels,
+                 dst_param->aTensorName);
+        return MY_PARAM_SET_ERROR;
+    }
+    if (src.empty() || src.depth() != CV_8U || (src.channels() != 1 && src.channels() != 3))
+    {
+        MY_ERROR("source image should be uint8 with 1 or 3 channels\n");
+        return MY_PARAM_SET_ERROR;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // 通道数不同时先转换颜色, 通道顺序在归一化时处理
+    const cv::Mat *pCur = &src;
+    if (nChannels == 1 && src.channels() == 3)
+    {
+        cv::cvtColor(src, m_converted, src_format == PIXEL_FORMAT_RGB ? cv::COLOR_RGB2GRAY : cv::COLOR_BGR2GRAY);
+        pCur = &m_converted;
+        src_format = PIXEL_FORMAT_GRAY;
+    }
+    else if (nChannels == 3 && src.channels() == 1)
+    {
+        cv::cvtColor(src, m_converted, cv::COLOR_GRAY2BGR);
+        pCur = &m_converted;
+        src_format = PIXEL_FORMAT_BGR;
+    }
+
+    // 缩放后的大小和在tensor中的位置
+    int nDstWidth = nWidth, nDstHeight = nHeight, nPadX = 0, nPadY = 0;
+    if (m_tParams.bLetterbox)
+    {
+        float fScale = std::min((float)nWidth / pCur->cols, (float)nHeight / pCur->rows);
+        nDstWidth = std::max(1, std::min(nWidth, (int)lroundf(pCur->cols * fScale)));
+        nDstHeight = std::max(1, std::min(nHeight, (int)lroundf(pCur->rows * fScale)));
+        nPadX = (nWidth - nDstWidth) / 2;
+        nPadY = (nHeight - nDstHeight) / 2;
+    }
+    if (pLetterbox)
+    {
+        pLetterbox->fScaleX = (float)nDstWidth / src.cols;
+        pLetterbox->fScaleY = (float)nDstHeight / src.rows;
+        pLetterbox->fPadX = (float)nPadX;
+        pLetterbox->fPadY = (float)nPadY;
+        pLetterbox->nSrcWidth = src.cols;
+        pLetterbox->nSrcHeight = src.rows;
+    }
+
+    if (pCur->cols != nDstWidth || pCur->rows != nDstHeight)
+    {
+        cv::resize(*pCur, m_resized, cv::Size(nDstWidth, nDstHeight), 0, 0, m_tParams.nInterpolation);
+        pCur = &m_resized;
+    }
+
+    float *pDst = (float *)dst_tensor->pValue + (size_t)nBatchIndex * nChannels * nHeight * nWidth;
+    if (nDstWidth != nWidth || nDstHeight != nHeight)
+    {
+        FillBorder(pDst, nChannels, nWidth, nHeight, cv::Rect(nPadX, nPadY, nDstWidth, nDstHeight));
+    }
+    NormalizeToCHW(*pCur, src_format, pDst + (size_t)nPadY * nWidth + nPadX, nWidth, (size_t)nHeight * nWidth);
+    return MY_SUCCESS;
+}
+
+/**
+ * @brief fill the letterbox border of every plane with the normalized pad value
+ *
+ * @param pDst  CHW float, 第一个平面的起点
+ * @param nChannels  通道数
+ * @param nWidth  tensor 宽
+ * @param nHeight  tensor 高
+ * @param roi  图像所在区域, 不填充
+ */
+void ImagePreprocessor::FillBorder(float *pDst, int nChannels, int nWidth, int nHeight, const cv::Rect &roi)
+{
+    size_t nPlane = (size_t)nHeight * nWidth;
+    for (int c = 0; c < nChannels; c++)
+    {
+        float fValue = m_tParams.fPadValue * m_aScale[c] + m_aBias[c];
+        float *pPlane = pDst + c * nPlane;
+
+        std::fill(pPlane, pPlane + (size_t)roi.y * nWidth, fValue);
+        std::fill(pPlane + (size_t)(roi.y + roi.height) * nWidth, pPlane + nPlane, fValue);
+        for (int y = roi.y; y < roi.y + roi.height; y++)
+        {
+            float *pRow = pPlane + (size_t)y * nWidth;
+            std::fill(pRow, pRow + roi.x, fValue);
+            std::fill(pRow + roi.x + roi.width, pRow + nWidth, fValue);
+        }
+    }
+}
+
+/**
+ * @brief same as Process(cv::Mat), on a raw uint8 HWC buffer
+ *
+ * @param pData  图像数据
+ * @param nWidth  宽
+ * @param nHeight  高
+ * @param nStride  每行字节数, 0 表示连续
+ * @param src_format  像素格式
+ * @param dst_tensor  输出tensor
+ * @param nBatchIndex  写到第几个batch
+ * @return result_t
+ */
+result_t ImagePreprocessor::Process(const my_u8 *pData, int nWidth, int nHeight, int nStride,
+                                    pixel_format_t src_format, tensor_t *dst_tensor, int nBatchIndex,
+                                    letterbox_info_t *pLetterbox)
+{
+    MY_CHECK_NULL(pData, MY_PARAM_NULL);
+
+    int nType = src_format == PIXEL_FORMAT_GRAY ? CV_8UC1 : CV_8UC3;
+    cv::Mat src(nHeight, nWidth, nType, (void *)pData, nStride > 0 ? (size_t)nStride : (size_t)cv::Mat::AUTO_STEP);
+    return Process(src, src_format, dst_tensor, nBatchIndex, pLetterbox);
+}
+
+/**
+ * @brief decode an encoded image (jpg/png/...) then preprocess it
+ *
+ * @param pData  编码后的图像
+ * @param nLength  字节数
+ * @param dst_tensor  输出tensor
+ * @param nBatchIndex  写到第几个batch
+ * @return result_t
+ */
+result_t ImagePreprocessor::ProcessEncoded(const my_u8 *pData, int nLength, tensor_t *dst_tensor, int nBatchIndex)
+{
+    MY_CHECK_NULL(pData, MY_PARAM_NULL);
+
+    cv::Mat decoded = cv::imdecode(cv::Mat(1, nLength, CV_8UC1, (void *)pData), cv::IMREAD_COLOR);
+    if (decoded.empty())
+    {
+        MY_ERROR("decode image failed\n");
+        return MY_FAILED;
+    }
+    return Process(decoded, PIXEL_FORMAT_BGR, dst_tensor, nBatchIndex);
+}
+
+/**
+ * @brief one pass over the image: uint8 -> float, x * scale + bias and HWC -> CHW, swapping R/B if the
+ *        source and model channel orders differ. The inner loops are the SIMD kernels of my_kernels.h.
+ *
+ * @param src  uint8 HWC image, already resized
+ * @param src_format  像素格式
+ * @param pDst  CHW float output, 图像左上角在第一个平面中的位置
+ * @param nDstStride  输出每行的float个数
+ * @param nPlane  输出每个平面的float个数
+ */
+void ImagePreprocessor::NormalizeToCHW(const cv::Mat &src, pixel_format_t src_format, float *pDst, int nDstStride,
+                                       size_t nPlane)
+{
+    int nChannels = src.channels();
+    int nHeight = src.rows;
+    int nWidth = src.cols;
+
+    if (nChannels == 1)
+    {
+        for (int y = 0; y < nHeight; y++)
+        {
+            NormalizeU8ToF32(src.ptr<my_u8>(y), pDst + (size_t)y * nDstStride, nWidth, m_aScale[0], m_aBias[0]);
+        }
+        return;
+    }
+
+    // 源图像第k个通道写到输出的第aDstChannel[k]个平面
+    int aDstChannel[3] = {0, 1, 2};
+    if (src_format != m_tParams.dst_format)
+    {
+        aDstChannel[0] = 2;
+        aDstChannel[2] = 0;
+    }
+
+    float aScale[3], aBias[3];
+    for (int k = 0; k < 3; k++)
+    {
+        aScale[k] = m_aScale[aDstChannel[k]];
+        aBias[k] = m_aBias[aDstChannel[k]];
+    }
+
+    // 连续的图像并且占满整行时一次处理完
+    bool bWhole = src.isContinuous() && nDstStride == nWidth;
+    int nRows = bWhole ? 1 : nHeight;
+    size_t nRowPixels = bWhole ? (size_t)nHeight * nWidth : (size_t)nWidth;
+    for (int y = 0; y < nRows; y++)
+    {
+        size_t nOffset = (size_t)y * (bWhole ? nRowPixels : (size_t)nDstStride);
+        float *const pDstRow[3] = {pDst + aDstChannel[0] * nPlane + nOffset, pDst + aDstChannel[1] * nPlane + nOffset,
+                                   pDst + aDstChannel[2] * nPlane + nOffset};
+        HWC3ToCHWNormalizeU8(src.ptr<my_u8>(y), nRowPixels, pDstRow, aScale, aBias);
+    }
+}
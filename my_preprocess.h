@@ -0,0 +1,32 @@
+#ifndef MY_INFERENCE_ONNX_MY_PREPROCESS_H
+#define MY_INFERENCE_ONNX_MY_PREPROCESS_H
+#include <mutex>
+#include "opencv2/core.hpp"
+#include "common.h"
+
+class ImagePreprocessor
+{
+public:
+    explicit ImagePreprocessor(const image_preprocess_params_t *pParams);
+    result_t Process(const cv::Mat &src, pixel_format_t src_format, tensor_t *dst_tensor, int nBatchIndex,
+                     letterbox_info_t *pLetterbox = NULL);
+    result_t Process(const my_u8 *pData, int nWidth, int nHeight, int nStride, pixel_format_t src_format,
+                     tensor_t *dst_tensor, int nBatchIndex, letterbox_info_t *pLetterbox = NULL);
+    result_t ProcessEncoded(const my_u8 *pData, int nLength, tensor_t *dst_tensor, int nBatchIndex);
+
+private:
+    void NormalizeToCHW(const cv::Mat &src, pixel_format_t src_format, float *pDst, int nDstStride, size_t nPlane);
+    void FillBorder(float *pDst, int nChannels, int nWidth, int nHeight, const cv::Rect &roi);
+
+private:
+    image_preprocess_params_t m_tParams;
+    float m_aScale[3]; // 1 / std
+    float m_aBias[3];  // -mean / std
+
+    // 每次调用复用的中间结果
+    cv::Mat m_converted;
+    cv::Mat m_resized;
+    std::mutex m_mutex;
+};
+
+#endif //MY_INFERENCE_ONNX_MY_PREPROCESS_H
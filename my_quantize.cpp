@@ -0,0 +1,915 @@
+#include "my_quantize.h"
+
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <climits>
+#include <algorithm>
+#include "aes.h"
+#include "my_utils.h"
+#include "my_kernels.h"
+#include "my_onnx_inference.h"
+
+static const OrtApi *g_pOrt = OrtGetApiBase()->GetApi(ORT_API_VERSION);
+
+// onnx TensorProto.DataType
+#define ONNX_DATA_FLOAT 1
+#define ONNX_DATA_UINT8 2
+#define ONNX_DATA_INT8 3
+#define ONNX_DATA_INT32 6
+
+// QuantizeLinear / DequantizeLinear 从 opset 10 开始
+#define MIN_QDQ_OPSET 10
+
+static bool CheckOrt(OrtStatus *status)
+{
+    if (status != nullptr)
+    {
+        MY_ERROR("%s\n", g_pOrt->GetErrorMessage(status));
+        g_pOrt->ReleaseStatus(status);
+        return false;
+    }
+    return true;
+}
+
+static bool IsDefaultDomain(const std::string &strDomain)
+{
+    return strDomain.empty() || strDomain == "ai.onnx";
+}
+
+static void AddUnique(std::vector<std::string> &vecNames, const std::string &strName)
+{
+    if (std::find(vecNames.begin(), vecNames.end(), strName) == vecNames.end())
+    {
+        vecNames.push_back(strName);
+    }
+}
+
+/*===================== onnx message builders =====================*/
+
+static std::string MakeNode(const char *pOpType, const std::vector<std::string> &vecInputs,
+                            const std::string &strOutput, const std::string &strName)
+{
+    std::string node;
+    for (size_t i = 0; i < vecInputs.size(); i++)
+    {
+        PbBytesField(node, 1, vecInputs[i]);
+    }
+    PbBytesField(node, 2, strOutput);
+    PbBytesField(node, 3, strName);
+    PbBytesField(node, 4, pOpType);
+    return node;
+}
+
+static std::string MakeTensor(const std::string &strName, int nDataType, const std::vector<int64_t> &vecDims,
+                              const void *pData, size_t nBytes)
+{
+    std::string tensor;
+    for (size_t i = 0; i < vecDims.size(); i++)
+    {
+        PbVarintField(tensor, 1, (unsigned long long)vecDims[i]);
+    }
+    PbVarintField(tensor, 2, nDataType);
+    PbBytesField(tensor, 8, strName);
+    PbBytesField(tensor, 9, std::string((const char *)pData, nBytes));
+    return tensor;
+}
+
+/**
+ * @brief ValueInfoProto of a float tensor without shape
+ */
+static std::string MakeFloatValueInfo(const std::string &strName)
+{
+    std::string elem, tensor_type, value_info;
+    PbVarintField(elem, 1, ONNX_DATA_FLOAT);  // TypeProto.Tensor.elem_type
+    PbBytesField(tensor_type, 1, elem);       // TypeProto.tensor_type
+    PbBytesField(value_info, 1, strName);     // ValueInfoProto.name
+    PbBytesField(value_info, 2, tensor_type); // ValueInfoProto.type
+    return value_info;
+}
+
+// ValueInfoProto.name / TensorProto.name
+static std::string MessageName(const std::string &msg, int nNameField)
+{
+    std::vector<PbField> vecFields;
+    PbParseMessage(msg, 0, msg.size(), vecFields);
+    for (size_t i = 0; i < vecFields.size(); i++)
+    {
+        if (vecFields[i].nField == nNameField && vecFields[i].nWireType == 2)
+        {
+            return PbFieldData(msg, vecFields[i]);
+        }
+    }
+    return std::string();
+}
+
+/*===================== ModelCalibrator =====================*/
+
+ModelCalibrator::ModelCalibrator(const model_params_t *pModelParam)
+{
+    memcpy(&m_tModelParam, pModelParam, sizeof(model_params_t));
+    m_nBatches = 0;
+    m_pHandle = nullptr;
+}
+
+ModelCalibrator::~ModelCalibrator()
+{
+    if (m_pHandle != nullptr)
+    {
+        m_pHandle->my_onnxruntime_release_model();
+        delete m_pHandle;
+    }
+}
+
+/**
+ * @brief read (and decrypt) the model, find the tensors to quantize and load a session with all of the
+ *        activations as outputs
+ *
+ * @return result_t
+ */
+result_t ModelCalibrator::Open()
+{
+    std::string strContent = my_onnx::ReadModelFile(m_tModelParam.model_path);
+    if (strContent == "error")
+    {
+        MY_ERROR("read model %s failed\n", m_tModelParam.model_path);
+        return MY_MODEL_LOAD_FAILED;
+    }
+    if (m_tModelParam.bIsCipher)
+    {
+        strContent = my_onnx::DecryptionBufferPartial(strContent, m_tModelParam.encStartPoint / 16,
+                                                      m_tModelParam.encLength / 16);
+        if (strContent == "error")
+        {
+            MY_ERROR("decrypt model %s failed\n", m_tModelParam.model_path);
+            return MY_MODEL_LOAD_FAILED;
+        }
+    }
+    m_strModel.swap(strContent);
+
+    result_t res = ParseModel();
+    if (MY_SUCCESS != res)
+    {
+        return res;
+    }
+    FindQuantizableTensors();
+    if (m_vecActivations.empty())
+    {
+        MY_ERROR("no Conv/MatMul/Gemm to quantize in %s\n", m_tModelParam.model_path);
+        return MY_FAILED;
+    }
+
+    // 只保留线程/内存设置, 统计用的是模型的原始输出
+    model_params_t tParam;
+    memcpy(&tParam, &m_tModelParam, sizeof(model_params_t));
+    tParam.bIsCipher = FALSE;
+    tParam.bProfileLoad = FALSE;
+    tParam.warmup_params.nIterations = 0;
+    tParam.variants.nValues = 0;
+    tParam.bucket_params.nBuckets = 0;
+    tParam.preprocess_params.bEnable = FALSE;
+    tParam.nPostprocess = 0;
+    tParam.nOutputConverts = 0;
+    tParam.bQuantizedModel = FALSE;
+
+    // 增强后的模型只在内存中创建 session, 加密模型的明文不落盘
+    std::string strAugmented = BuildAugmentedModel();
+    m_pHandle = new OnnxRuntimeModelHandle(&tParam);
+    res = m_pHandle->my_onnxruntime_open_model(&strAugmented);
+
+    MY_DEBUG("Calibrate %d activations, %d weights of %s\n", (int)m_vecActivations.size(), (int)m_vecWeights.size(),
+             m_tModelParam.model_path);
+    return res;
+}
+
+/**
+ * @brief split ModelProto / GraphProto and collect nodes, initializers, graph inputs and outputs
+ *
+ * @return result_t
+ */
+result_t ModelCalibrator::ParseModel()
+{
+    if (!PbParseMessage(m_strModel, 0, m_strModel.size(), m_vecModelFields))
+    {
+        MY_ERROR("%s is not an onnx model\n", m_tModelParam.model_path);
+        return MY_MODEL_LOAD_FAILED;
+    }
+
+    long long nOpset = 0;
+    bool bHasGraph = false;
+    for (size_t i = 0; i < m_vecModelFields.size(); i++)
+    {
+        const PbField &field = m_vecModelFields[i];
+        if (field.nWireType != 2)
+        {
+            continue;
+        }
+        if (field.nField == 7) // ModelProto.graph
+        {
+            m_strGraph = PbFieldData(m_strModel, field);
+            bHasGraph = true;
+        }
+        else if (field.nField == 8) // ModelProto.opset_import
+        {
+            std::string strOpset = PbFieldData(m_strModel, field);
+            std::vector<PbField> vecFields;
+            PbParseMessage(strOpset, 0, strOpset.size(), vecFields);
+            std::string strDomain;
+            long long nVersion = 0;
+            for (size_t j = 0; j < vecFields.size(); j++)
+            {
+                if (vecFields[j].nField == 1 && vecFields[j].nWireType == 2)
+                {
+                    strDomain = PbFieldData(strOpset, vecFields[j]);
+                }
+                else if (vecFields[j].nField == 2 && vecFields[j].nWireType == 0)
+                {
+                    nVersion = (long long)vecFields[j].nValue;
+                }
+            }
+            if (IsDefaultDomain(strDomain))
+            {
+                nOpset = nVersion;
+            }
+        }
+        else if (field.nField == 14) // ModelProto.metadata_props
+        {
+            std::string strEntry = PbFieldData(m_strModel, field);
+            if (MessageName(strEntry, 1) == MY_QUANTIZATION_METADATA_KEY)
+            {
+                MY_ERROR("%s is already quantized\n", m_tModelParam.model_path);
+                return MY_FAILED;
+            }
+        }
+    }
+
+    if (!bHasGraph || !PbParseMessage(m_strGraph, 0, m_strGraph.size(), m_vecGraphFields))
+    {
+        MY_ERROR("%s has no valid graph\n", m_tModelParam.model_path);
+        return MY_MODEL_LOAD_FAILED;
+    }
+    if (nOpset < MIN_QDQ_OPSET)
+    {
+        MY_ERROR("QuantizeLinear needs opset >= %d, model opset is %lld\n", MIN_QDQ_OPSET, nOpset);
+        return MY_FAILED;
+    }
+
+    for (size_t i = 0; i < m_vecGraphFields.size(); i++)
+    {
+        const PbField &field = m_vecGraphFields[i];
+        if (field.nWireType != 2)
+        {
+            continue;
+        }
+        std::string strMessage = PbFieldData(m_strGraph, field);
+        if (field.nField == 1) // GraphProto.node
+        {
+            OnnxNode node;
+            node.field = field;
+            std::vector<PbField> vecFields;
+            PbParseMessage(strMessage, 0, strMessage.size(), vecFields);
+            for (size_t j = 0; j < vecFields.size(); j++)
+            {
+                if (vecFields[j].nWireType != 2)
+                {
+                    continue;
+                }
+                std::string strValue = PbFieldData(strMessage, vecFields[j]);
+                switch (vecFields[j].nField)
+                {
+                case 1:
+                    node.vecInputs.push_back(strValue);
+                    break;
+                case 2:
+                    node.vecOutputs.push_back(strValue);
+                    break;
+                case 4:
+                    node.strOpType = strValue;
+                    break;
+                case 7:
+                    node.strDomain = strValue;
+                    break;
+                default:
+                    break;
+                }
+            }
+            m_vecNodes.push_back(node);
+        }
+        else if (field.nField == 5) // GraphProto.initializer
+        {
+            if (!ParseInitializer(strMessage))
+            {
+                MY_ERROR("bad initializer in %s\n", m_tModelParam.model_path);
+                return MY_MODEL_LOAD_FAILED;
+            }
+        }
+        else if (field.nField == 11) // GraphProto.input
+        {
+            m_setGraphInputs.insert(MessageName(strMessage, 1));
+        }
+        else if (field.nField == 12) // GraphProto.output
+        {
+            m_setGraphOutputs.insert(MessageName(strMessage, 1));
+        }
+    }
+    return MY_SUCCESS;
+}
+
+/**
+ * @brief record the initializer name, keep the data of float initializers stored in the model
+ *
+ * @param strTensor  TensorProto
+ * @return bool  false if the message is malformed
+ */
+bool ModelCalibrator::ParseInitializer(const std::string &strTensor)
+{
+    std::vector<PbField> vecFields;
+    if (!PbParseMessage(strTensor, 0, strTensor.size(), vecFields))
+    {
+        return false;
+    }
+
+    std::string strName;
+    int nDataType = 0;
+    OnnxInitializer tInit;
+    for (size_t i = 0; i < vecFields.size(); i++)
+    {
+        const PbField &field = vecFields[i];
+        switch (field.nField)
+        {
+        case 1: // dims
+            if (field.nWireType == 0)
+            {
+                tInit.vecDims.push_back((int64_t)field.nValue);
+            }
+            else if (field.nWireType == 2)
+            {
+                std::vector<unsigned long long> vecDims;
+                if (!PbParsePackedVarints(strTensor, field, vecDims))
+                {
+                    return false;
+                }
+                tInit.vecDims.insert(tInit.vecDims.end(), vecDims.begin(), vecDims.end());
+            }
+            break;
+        case 2: // data_type
+            nDataType = (int)field.nValue;
+            break;
+        case 4: // float_data
+            if (field.nWireType == 5)
+            {
+                unsigned int nBits = (unsigned int)field.nValue;
+                float fValue;
+                memcpy(&fValue, &nBits, sizeof(float));
+                tInit.vecData.push_back(fValue);
+            }
+            else if (field.nWireType == 2)
+            {
+                size_t nCount = field.nDataLength / sizeof(float);
+                size_t nOld = tInit.vecData.size();
+                tInit.vecData.resize(nOld + nCount);
+                memcpy(tInit.vecData.data() + nOld, strTensor.data() + field.nDataBegin, nCount * sizeof(float));
+            }
+            break;
+        case 8: // name
+            strName = PbFieldData(strTensor, field);
+            break;
+        case 9: // raw_data, little endian
+            tInit.vecData.resize(field.nDataLength / sizeof(float));
+            memcpy(tInit.vecData.data(), strTensor.data() + field.nDataBegin,
+                   tInit.vecData.size() * sizeof(float));
+            break;
+        default:
+            break;
+        }
+    }
+
+    m_setInitializerNames.insert(strName);
+
+    size_t nElements = 1;
+    for (size_t i = 0; i < tInit.vecDims.size(); i++)
+    {
+        nElements *= (size_t)tInit.vecDims[i];
+    }
+    // 外部数据等取不到值的 initializer 不量化
+    if (nDataType == ONNX_DATA_FLOAT && !tInit.vecData.empty() && tInit.vecData.size() == nElements)
+    {
+        m_mapInitializers[strName] = tInit;
+    }
+    return true;
+}
+
+/**
+ * @brief inputs and output of Conv / MatMul / Gemm: float initializers are weights, the others are
+ *        activations to calibrate. A Conv bias is quantized to int32 when it is used only once.
+ *
+ */
+void ModelCalibrator::FindQuantizableTensors()
+{
+    std::map<std::string, int> mapUses;
+    for (size_t i = 0; i < m_vecNodes.size(); i++)
+    {
+        for (size_t j = 0; j < m_vecNodes[i].vecInputs.size(); j++)
+        {
+            mapUses[m_vecNodes[i].vecInputs[j]]++;
+        }
+    }
+
+    for (size_t i = 0; i < m_vecNodes.size(); i++)
+    {
+        const OnnxNode &node = m_vecNodes[i];
+        if (!IsDefaultDomain(node.strDomain) ||
+            (node.strOpType != "Conv" && node.strOpType != "MatMul" && node.strOpType != "Gemm"))
+        {
+            continue;
+        }
+        if (node.vecInputs.size() < 2 || node.vecOutputs.empty())
+        {
+            continue;
+        }
+
+        // 非 float 或数据不在模型中的 initializer 无法量化, 整个节点保持 float
+        bool bSupported = true;
+        for (size_t j = 0; j < 2; j++)
+        {
+            const std::string &strName = node.vecInputs[j];
+            if (strName.empty() || (m_setInitializerNames.count(strName) && !m_mapInitializers.count(strName)))
+            {
+                bSupported = false;
+            }
+        }
+        if (!bSupported)
+        {
+            continue;
+        }
+
+        for (size_t j = 0; j < 2; j++)
+        {
+            const std::string &strName = node.vecInputs[j];
+            if (m_mapInitializers.count(strName))
+            {
+                AddUnique(m_vecWeights, strName);
+            }
+            else
+            {
+                AddUnique(m_vecActivations, strName);
+            }
+        }
+        AddUnique(m_vecActivations, node.vecOutputs[0]);
+
+        // bias 的 scale 为 sx * sw, 被多个节点共用时无法确定
+        if (node.strOpType == "Conv" && node.vecInputs.size() > 2)
+        {
+            const std::string &strBias = node.vecInputs[2];
+            if (m_mapInitializers.count(strBias) && mapUses[strBias] == 1 && !m_setGraphOutputs.count(strBias) &&
+                !m_mapInitializers.count(node.vecInputs[0]) && m_mapInitializers.count(node.vecInputs[1]))
+            {
+                m_mapBiases[strBias] = std::make_pair(node.vecInputs[0], node.vecInputs[1]);
+            }
+        }
+    }
+}
+
+/**
+ * @brief the original model with every activation except graph inputs added as a graph output
+ *
+ * @return std::string
+ */
+std::string ModelCalibrator::BuildAugmentedModel()
+{
+    std::string strGraph = m_strGraph;
+    for (size_t i = 0; i < m_vecActivations.size(); i++)
+    {
+        if (!m_setGraphOutputs.count(m_vecActivations[i]) && !m_setGraphInputs.count(m_vecActivations[i]))
+        {
+            PbBytesField(strGraph, 12, MakeFloatValueInfo(m_vecActivations[i]));
+        }
+    }
+
+    std::string strModel;
+    for (size_t i = 0; i < m_vecModelFields.size(); i++)
+    {
+        if (m_vecModelFields[i].nField == 7)
+        {
+            PbBytesField(strModel, 7, strGraph);
+        }
+        else
+        {
+            PbCopyField(strModel, m_strModel, m_vecModelFields[i]);
+        }
+    }
+    return strModel;
+}
+
+void ModelCalibrator::UpdateRange(const std::string &strName, const float *pData, size_t nElements)
+{
+    if (nElements == 0)
+    {
+        return;
+    }
+    float fMin = pData[0];
+    float fMax = pData[0];
+    for (size_t i = 1; i < nElements; i++)
+    {
+        fMin = std::min(fMin, pData[i]);
+        fMax = std::max(fMax, pData[i]);
+    }
+
+    std::map<std::string, std::pair<float, float>>::iterator it = m_mapRanges.find(strName);
+    if (it == m_mapRanges.end())
+    {
+        m_mapRanges[strName] = std::make_pair(fMin, fMax);
+    }
+    else
+    {
+        it->second.first = std::min(it->second.first, fMin);
+        it->second.second = std::max(it->second.second, fMax);
+    }
+}
+
+/**
+ * @brief run one batch of representative inputs and update the min/max of every activation
+ *
+ * @param input_tensor_array  输入, 与模型输入一致
+ * @return result_t  MY_FAILED if the batch does not fit the model, the statistics are left unchanged then
+ */
+result_t ModelCalibrator::Collect(tensor_array_t *input_tensor_array)
+{
+    MY_CHECK_NULL(input_tensor_array, MY_PARAM_NULL);
+    MY_CHECK_NULL(m_pHandle, MY_FAILED);
+
+    // 图输入直接从输入 tensor 统计, 其余作为输出取回
+    std::vector<const char *> vecNames;
+    for (size_t i = 0; i < m_vecActivations.size(); i++)
+    {
+        if (!m_setGraphInputs.count(m_vecActivations[i]))
+        {
+            vecNames.push_back(m_vecActivations[i].c_str());
+        }
+    }
+
+    // 执行失败的 batch 不计入统计
+    std::vector<OrtValue *> vecValues;
+    result_t res = m_pHandle->my_onnxruntime_run_ort_values(input_tensor_array, vecNames, vecValues);
+    for (size_t i = 0; i < m_vecActivations.size() && MY_SUCCESS == res; i++)
+    {
+        for (int j = 0; j < input_tensor_array->nArraySize && m_setGraphInputs.count(m_vecActivations[i]); j++)
+        {
+            const tensor_t *cur_tensor = &input_tensor_array->pTensorArray[j];
+            if (cur_tensor->pTensorInfo->type == DT_FLOAT &&
+                m_vecActivations[i] == cur_tensor->pTensorInfo->aTensorName)
+            {
+                UpdateRange(m_vecActivations[i], (const float *)cur_tensor->pValue,
+                            (size_t)cur_tensor->pTensorInfo->nElementSize);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < vecValues.size(); i++)
+    {
+        if (vecValues[i] == nullptr)
+        {
+            continue;
+        }
+
+        OrtTensorTypeAndShapeInfo *pInfo = nullptr;
+        size_t nElements = 0;
+        ONNXTensorElementDataType type = ONNX_TENSOR_ELEMENT_DATA_TYPE_UNDEFINED;
+        float *pData = nullptr;
+        if (MY_SUCCESS == res && CheckOrt(g_pOrt->GetTensorTypeAndShape(vecValues[i], &pInfo)))
+        {
+            CheckOrt(g_pOrt->GetTensorShapeElementCount(pInfo, &nElements));
+            CheckOrt(g_pOrt->GetTensorElementType(pInfo, &type));
+            g_pOrt->ReleaseTensorTypeAndShapeInfo(pInfo);
+        }
+        if (type == ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT && nElements > 0 &&
+            CheckOrt(g_pOrt->GetTensorMutableData(vecValues[i], (void **)&pData)))
+        {
+            UpdateRange(vecNames[i], pData, nElements);
+        }
+        g_pOrt->ReleaseValue(vecValues[i]);
+    }
+
+    if (MY_SUCCESS == res)
+    {
+        m_nBatches++;
+    }
+    return res;
+}
+
+/**
+ * @brief write "name min max" per activation
+ *
+ * @param pcPath  校准表路径
+ * @return result_t
+ */
+result_t ModelCalibrator::WriteCalibrationTable(const char *pcPath)
+{
+    MY_CHECK_NULL(pcPath, MY_PARAM_NULL);
+    if (m_nBatches == 0)
+    {
+        MY_ERROR("no calibration batch collected\n");
+        return MY_FAILED;
+    }
+
+    std::string strTable = "# tensor min max, " + std::to_string(m_nBatches) + " batches\n";
+    char aLine[512];
+    for (size_t i = 0; i < m_vecActivations.size(); i++)
+    {
+        std::map<std::string, std::pair<float, float>>::iterator it = m_mapRanges.find(m_vecActivations[i]);
+        if (it != m_mapRanges.end())
+        {
+            snprintf(aLine, sizeof(aLine), "%s %.9g %.9g\n", it->first.c_str(), it->second.first,
+                     it->second.second);
+            strTable += aLine;
+        }
+    }
+
+    if (!WriteFile(pcPath, strTable))
+    {
+        MY_ERROR("write calibration table %s failed\n", pcPath);
+        return MY_FAILED;
+    }
+    return MY_SUCCESS;
+}
+
+/**
+ * @brief uint8 asymmetric parameters of an activation, the range always contains 0
+ */
+void ModelCalibrator::GetActivationParams(const std::string &strName, float *pScale, my_u8 *pZeroPoint)
+{
+    float fMin = 0.0f;
+    float fMax = 0.0f;
+    std::map<std::string, std::pair<float, float>>::iterator it = m_mapRanges.find(strName);
+    if (it != m_mapRanges.end())
+    {
+        fMin = std::min(it->second.first, 0.0f);
+        fMax = std::max(it->second.second, 0.0f);
+    }
+
+    float fScale = (fMax - fMin) / 255.0f;
+    if (!(fScale > 0.0f))
+    {
+        fScale = 1.0f;
+    }
+    float fZeroPoint = std::round(-fMin / fScale);
+    *pScale = fScale;
+    *pZeroPoint = (my_u8)std::max(0.0f, std::min(255.0f, fZeroPoint));
+}
+
+/**
+ * @brief re-encode a node with renamed inputs/outputs, other fields (attributes etc.) are kept as is
+ */
+std::string ModelCalibrator::RewriteNode(const OnnxNode &node, const std::map<std::string, std::string> &mapInputRename,
+                                         const std::map<std::string, std::string> &mapOutputRename)
+{
+    std::string strNode = PbFieldData(m_strGraph, node.field);
+    std::vector<PbField> vecFields;
+    PbParseMessage(strNode, 0, strNode.size(), vecFields);
+
+    std::string strOut;
+    for (size_t i = 0; i < vecFields.size(); i++)
+    {
+        const PbField &field = vecFields[i];
+        if ((field.nField == 1 || field.nField == 2) && field.nWireType == 2)
+        {
+            const std::map<std::string, std::string> &mapRename = field.nField == 1 ? mapInputRename : mapOutputRename;
+            std::string strName = PbFieldData(strNode, field);
+            std::map<std::string, std::string>::const_iterator it = mapRename.find(strName);
+            PbBytesField(strOut, field.nField, it == mapRename.end() ? strName : it->second);
+        }
+        else
+        {
+            PbCopyField(strOut, strNode, field);
+        }
+    }
+    return strOut;
+}
+
+/**
+ * @brief GraphProto with QuantizeLinear -> DequantizeLinear on every activation and DequantizeLinear on
+ *        int8 weights / int32 biases. Dequantized tensors keep the original names so that all consumers and
+ *        graph outputs stay valid; graph inputs are the exception, their consumers read "<name>_dequantized".
+ *
+ * @return std::string
+ */
+std::string ModelCalibrator::BuildQuantizedGraph()
+{
+    std::vector<std::string> vecNewNodes;
+    std::string strInitializers;
+    std::set<std::string> setReplaced; // 被 DequantizeLinear 输出替换的 float initializer
+    std::map<std::string, float> mapWeightScales;
+    const std::vector<int64_t> vecScalar;
+
+    // 权重: int8 对称
+    for (size_t i = 0; i < m_vecWeights.size(); i++)
+    {
+        const std::string &strName = m_vecWeights[i];
+        const OnnxInitializer &tInit = m_mapInitializers[strName];
+
+        float fAbsMax = 0.0f;
+        for (size_t j = 0; j < tInit.vecData.size(); j++)
+        {
+            fAbsMax = std::max(fAbsMax, std::fabs(tInit.vecData[j]));
+        }
+        float fScale = fAbsMax > 0.0f ? fAbsMax / 127.0f : 1.0f;
+        std::vector<my_s8> vecQuantized(tInit.vecData.size());
+        QuantizeF32ToS8(tInit.vecData.data(), vecQuantized.data(), vecQuantized.size(), 1.0f / fScale);
+        my_s8 nZeroPoint = 0;
+        mapWeightScales[strName] = fScale;
+
+        PbBytesField(strInitializers, 5, MakeTensor(strName + "_quantized", ONNX_DATA_INT8, tInit.vecDims,
+                                                    vecQuantized.data(), vecQuantized.size()));
+        PbBytesField(strInitializers, 5, MakeTensor(strName + "_scale", ONNX_DATA_FLOAT, vecScalar, &fScale,
+                                                    sizeof(float)));
+        PbBytesField(strInitializers, 5, MakeTensor(strName + "_zero_point", ONNX_DATA_INT8, vecScalar,
+                                                    &nZeroPoint, 1));
+        vecNewNodes.push_back(MakeNode("DequantizeLinear",
+                                       {strName + "_quantized", strName + "_scale", strName + "_zero_point"},
+                                       strName, strName + "_DequantizeLinear"));
+        setReplaced.insert(strName);
+    }
+
+    // Conv bias: int32, scale = sx * sw
+    for (std::map<std::string, std::pair<std::string, std::string>>::iterator it = m_mapBiases.begin();
+         it != m_mapBiases.end(); ++it)
+    {
+        const std::string &strName = it->first;
+        const OnnxInitializer &tInit = m_mapInitializers[strName];
+        float fInputScale;
+        my_u8 nInputZeroPoint;
+        GetActivationParams(it->second.first, &fInputScale, &nInputZeroPoint);
+        float fScale = fInputScale * mapWeightScales[it->second.second];
+
+        std::vector<int32_t> vecQuantized(tInit.vecData.size());
+        for (size_t j = 0; j < vecQuantized.size(); j++)
+        {
+            double dValue = std::round((double)tInit.vecData[j] / fScale);
+            vecQuantized[j] = (int32_t)std::max((double)INT_MIN, std::min((double)INT_MAX, dValue));
+        }
+        int32_t nZeroPoint = 0;
+
+        PbBytesField(strInitializers, 5, MakeTensor(strName + "_quantized", ONNX_DATA_INT32, tInit.vecDims,
+                                                    vecQuantized.data(), vecQuantized.size() * sizeof(int32_t)));
+        PbBytesField(strInitializers, 5, MakeTensor(strName + "_scale", ONNX_DATA_FLOAT, vecScalar, &fScale,
+                                                    sizeof(float)));
+        PbBytesField(strInitializers, 5, MakeTensor(strName + "_zero_point", ONNX_DATA_INT32, vecScalar,
+                                                    &nZeroPoint, sizeof(int32_t)));
+        vecNewNodes.push_back(MakeNode("DequantizeLinear",
+                                       {strName + "_quantized", strName + "_scale", strName + "_zero_point"},
+                                       strName, strName + "_DequantizeLinear"));
+        setReplaced.insert(strName);
+    }
+
+    // 激活: uint8 非对称. 图输入没有生产者, 改名消费者的输入; 其余改名生产者的输出, Q/DQ 紧跟在生产者之后
+    std::map<std::string, std::string> mapInputRename;
+    std::map<std::string, std::string> mapOutputRename;
+    std::vector<std::string> vecQdqNodes; // 按激活顺序, 与 m_vecActivations 对应
+    for (size_t i = 0; i < m_vecActivations.size(); i++)
+    {
+        const std::string &strName = m_vecActivations[i];
+        float fScale;
+        my_u8 nZeroPoint;
+        GetActivationParams(strName, &fScale, &nZeroPoint);
+        PbBytesField(strInitializers, 5, MakeTensor(strName + "_scale", ONNX_DATA_FLOAT, vecScalar, &fScale,
+                                                    sizeof(float)));
+        PbBytesField(strInitializers, 5, MakeTensor(strName + "_zero_point", ONNX_DATA_UINT8, vecScalar,
+                                                    &nZeroPoint, 1));
+
+        std::string strFloat = strName;
+        std::string strDequantized = strName;
+        if (m_setGraphInputs.count(strName))
+        {
+            strDequantized = strName + "_dequantized";
+            mapInputRename[strName] = strDequantized;
+        }
+        else
+        {
+            strFloat = strName + "_float";
+            mapOutputRename[strName] = strFloat;
+        }
+
+        std::string strQdq;
+        PbBytesField(strQdq, 1, MakeNode("QuantizeLinear", {strFloat, strName + "_scale", strName + "_zero_point"},
+                                         strName + "_quantized", strName + "_QuantizeLinear"));
+        PbBytesField(strQdq, 1, MakeNode("DequantizeLinear",
+                                         {strName + "_quantized", strName + "_scale", strName + "_zero_point"},
+                                         strDequantized, strName + "_DequantizeLinear"));
+        vecQdqNodes.push_back(strQdq);
+    }
+
+    std::string strGraph;
+    for (size_t i = 0; i < m_vecGraphFields.size(); i++)
+    {
+        const PbField &field = m_vecGraphFields[i];
+        if (field.nField == 1)
+        {
+            continue;
+        }
+        if ((field.nField == 5 || field.nField == 11) && field.nWireType == 2)
+        {
+            int nNameField = field.nField == 5 ? 8 : 1;
+            if (setReplaced.count(MessageName(PbFieldData(m_strGraph, field), nNameField)))
+            {
+                continue;
+            }
+        }
+        PbCopyField(strGraph, m_strGraph, field);
+    }
+    strGraph += strInitializers;
+
+    for (size_t i = 0; i < vecNewNodes.size(); i++)
+    {
+        PbBytesField(strGraph, 1, vecNewNodes[i]);
+    }
+    for (size_t i = 0; i < m_vecActivations.size(); i++)
+    {
+        if (mapInputRename.count(m_vecActivations[i]))
+        {
+            strGraph += vecQdqNodes[i];
+        }
+    }
+
+    for (size_t i = 0; i < m_vecNodes.size(); i++)
+    {
+        const OnnxNode &node = m_vecNodes[i];
+        bool bRename = false;
+        for (size_t j = 0; j < node.vecInputs.size(); j++)
+        {
+            bRename = bRename || mapInputRename.count(node.vecInputs[j]);
+        }
+        for (size_t j = 0; j < node.vecOutputs.size(); j++)
+        {
+            bRename = bRename || mapOutputRename.count(node.vecOutputs[j]);
+        }
+
+        if (bRename)
+        {
+            PbBytesField(strGraph, 1, RewriteNode(node, mapInputRename, mapOutputRename));
+        }
+        else
+        {
+            PbCopyField(strGraph, m_strGraph, node.field);
+        }
+
+        for (size_t j = 0; j < node.vecOutputs.size(); j++)
+        {
+            std::vector<std::string>::iterator it =
+                std::find(m_vecActivations.begin(), m_vecActivations.end(), node.vecOutputs[j]);
+            if (it != m_vecActivations.end())
+            {
+                strGraph += vecQdqNodes[it - m_vecActivations.begin()];
+            }
+        }
+    }
+    return strGraph;
+}
+
+/**
+ * @brief write the QDQ model, encrypted the same way as the source model when bIsCipher is set
+ *
+ * @param pcPath  量化模型路径
+ * @return result_t
+ */
+result_t ModelCalibrator::WriteQuantizedModel(const char *pcPath)
+{
+    MY_CHECK_NULL(pcPath, MY_PARAM_NULL);
+    if (m_nBatches == 0)
+    {
+        MY_ERROR("no calibration batch collected\n");
+        return MY_FAILED;
+    }
+
+    std::string strGraph = BuildQuantizedGraph();
+    std::string strModel;
+    for (size_t i = 0; i < m_vecModelFields.size(); i++)
+    {
+        if (m_vecModelFields[i].nField == 7)
+        {
+            PbBytesField(strModel, 7, strGraph);
+        }
+        else
+        {
+            PbCopyField(strModel, m_strModel, m_vecModelFields[i]);
+        }
+    }
+    std::string strEntry;
+    PbBytesField(strEntry, 1, MY_QUANTIZATION_METADATA_KEY);
+    PbBytesField(strEntry, 2, MY_QUANTIZATION_FORMAT_QDQ);
+    PbBytesField(strModel, 14, strEntry);
+
+    if (m_tModelParam.bIsCipher)
+    {
+        strModel = my_onnx::EncryptionBufferPartial(strModel, m_tModelParam.encStartPoint / 16,
+                                                    m_tModelParam.encLength / 16);
+    }
+    if (!WriteFile(pcPath, strModel))
+    {
+        MY_ERROR("write quantized model %s failed\n", pcPath);
+        return MY_FAILED;
+    }
+
+    std::cout << "Write quantized model " << pcPath << std::endl;
+    return MY_SUCCESS;
+}
@@ -0,0 +1,78 @@
+#ifndef MY_INFERENCE_ONNX_MY_QUANTIZE_H
+#define MY_INFERENCE_ONNX_MY_QUANTIZE_H
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include "common.h"
+#include "my_onnx_proto.h"
+
+// 量化模型的 metadata_props, 加载时据此开启 QDQ 融合
+#define MY_QUANTIZATION_METADATA_KEY "my_quantization"
+#define MY_QUANTIZATION_FORMAT_QDQ "qdq_u8s8"
+
+class OnnxRuntimeModelHandle;
+
+// 用代表性输入统计 Conv / MatMul / Gemm 激活的范围, 生成 int8 QDQ 模型
+// 激活 uint8 非对称, 权重 int8 对称, Conv 的 bias int32; 均为 per-tensor
+class ModelCalibrator
+{
+public:
+    explicit ModelCalibrator(const model_params_t *pModelParam);
+    ~ModelCalibrator();
+    result_t Open();
+    result_t Collect(tensor_array_t *input_tensor_array);
+    result_t WriteCalibrationTable(const char *pcPath);
+    result_t WriteQuantizedModel(const char *pcPath);
+
+private:
+    struct OnnxNode
+    {
+        std::string strOpType;
+        std::string strDomain;
+        std::vector<std::string> vecInputs;
+        std::vector<std::string> vecOutputs;
+        PbField field; // NodeProto 在 m_strGraph 中的位置
+    };
+
+    // float initializer
+    struct OnnxInitializer
+    {
+        std::vector<int64_t> vecDims;
+        std::vector<float> vecData;
+    };
+
+    result_t ParseModel();
+    bool ParseInitializer(const std::string &strTensor);
+    void FindQuantizableTensors();
+    std::string BuildAugmentedModel();
+    void UpdateRange(const std::string &strName, const float *pData, size_t nElements);
+    std::string BuildQuantizedGraph();
+    std::string RewriteNode(const OnnxNode &node, const std::map<std::string, std::string> &mapInputRename,
+                            const std::map<std::string, std::string> &mapOutputRename);
+    void GetActivationParams(const std::string &strName, float *pScale, my_u8 *pZeroPoint);
+
+private:
+    model_params_t m_tModelParam;
+    std::string m_strModel; // 明文模型
+    std::string m_strGraph;
+    std::vector<PbField> m_vecModelFields;
+    std::vector<PbField> m_vecGraphFields;
+
+    std::vector<OnnxNode> m_vecNodes;
+    std::map<std::string, OnnxInitializer> m_mapInitializers; // float initializer
+    std::set<std::string> m_setInitializerNames;              // 所有 initializer
+    std::set<std::string> m_setGraphInputs;
+    std::set<std::string> m_setGraphOutputs;
+
+    std::vector<std::string> m_vecActivations;              // 需要校准的激活
+    std::vector<std::string> m_vecWeights;                  // 量化成 int8 的权重
+    std::map<std::string, std::pair<std::string, std::string>> m_mapBiases; // bias -> (激活, 权重)
+    std::map<std::string, std::pair<float, float>> m_mapRanges; // 激活 -> (min, max)
+    int m_nBatches;
+
+    OnnxRuntimeModelHandle *m_pHandle; // 激活作为输出的模型
+};
+
+#endif //MY_INFERENCE_ONNX_MY_QUANTIZE_H
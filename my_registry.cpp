@@ -0,0 +1,661 @@
+#include "my_registry.h"
+
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <climits>
+#include <algorithm>
+#include <dirent.h>
+#include <malloc.h>
+#include <sys/stat.h>
+#include "my_utils.h"
+#include "my_onnx_inference.h"
+
+// 版本目录下的模型文件名
+#define REGISTRY_MODEL_FILE "model.onnx"
+
+static void ReleaseHandle(OnnxRuntimeModelHandle *pHandle)
+{
+    pHandle->my_onnxruntime_release_model();
+    delete pHandle;
+}
+
+/**
+ * @brief sub directories of strDir
+ *
+ * @param strDir  目录
+ * @param vecNames  子目录名, 不含 . 和 ..
+ * @return bool  false if strDir can't be opened
+ */
+static bool ListSubDirs(const std::string &strDir, std::vector<std::string> &vecNames)
+{
+    DIR *pDir = opendir(strDir.c_str());
+    if (pDir == NULL)
+    {
+        return false;
+    }
+
+    struct dirent *pEntry;
+    while ((pEntry = readdir(pDir)) != NULL)
+    {
+        if (pEntry->d_name[0] == '.')
+        {
+            continue;
+        }
+        struct stat tStat;
+        std::string strPath = strDir + "/" + pEntry->d_name;
+        if (stat(strPath.c_str(), &tStat) == 0 && S_ISDIR(tStat.st_mode))
+        {
+            vecNames.push_back(pEntry->d_name);
+        }
+    }
+    closedir(pDir);
+    return true;
+}
+
+ModelRegistry::ModelRegistry(const char *pcRootDir, const model_params_t *pDefaultParam)
+{
+    m_strRootDir = pcRootDir;
+    memcpy(&m_tDefaultParam, pDefaultParam, sizeof(model_params_t));
+    // 几十个模型各自建线程池会严重超订CPU
+    m_tDefaultParam.memory_params.bShareEnvThreadPools = TRUE;
+    m_pModels = std::make_shared<const ModelMap>();
+    m_nMemoryBudgetKB = 0;
+    m_bLazyLoad = false;
+}
+
+ModelRegistry::~ModelRegistry()
+{
+    m_thread_mutex.lock();
+    std::vector<ReloadThread> vecThreads;
+    vecThreads.swap(m_vecReloadThreads);
+    m_thread_mutex.unlock();
+    for (size_t i = 0; i < vecThreads.size(); i++)
+    {
+        vecThreads[i].thread.join();
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::atomic_store(&m_pModels, std::make_shared<const ModelMap>());
+}
+
+/**
+ * @brief numeric version directories of a model
+ *
+ * @param strName  模型名
+ * @param vecVersions  版本号
+ * @return bool  false if the model directory doesn't exist
+ */
+bool ModelRegistry::ListVersions(const std::string &strName, std::vector<int> &vecVersions)
+{
+    std::vector<std::string> vecDirs;
+    if (!ListSubDirs(m_strRootDir + "/" + strName, vecDirs))
+    {
+        return false;
+    }
+    for (size_t i = 0; i < vecDirs.size(); i++)
+    {
+        char *pEnd = NULL;
+        long nVersion = strtol(vecDirs[i].c_str(), &pEnd, 10);
+        if (*pEnd == '\0' && nVersion > 0 && nVersion <= INT_MAX)
+        {
+            vecVersions.push_back((int)nVersion);
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief load a model and measure its load time and resident memory, caller holds m_load_mutex
+ *
+ * @param pParam  加载参数
+ * @param pHandle  加载好的句柄, 最后一个引用释放时释放session
+ * @param pInfo  填写耗时, 内存, 输入输出个数和文件大小
+ * @return result_t
+ */
+result_t ModelRegistry::CreateHandle(const model_params_t *pParam, std::shared_ptr<OnnxRuntimeModelHandle> &pHandle,
+                                     registry_model_info_t *pInfo)
+{
+    struct stat tStat;
+    if (stat(pParam->model_path, &tStat) != 0)
+    {
+        MY_ERROR("model file %s not exist\n", pParam->model_path);
+        return MY_FILE_NOT_EXIST;
+    }
+
+    long nRssBeforeKB = GetCurrentRssKB();
+    double dStartMs = GetTimeMs();
+
+    OnnxRuntimeModelHandle *pOnnxHdl = new OnnxRuntimeModelHandle(const_cast<model_params_t *>(pParam));
+    result_t res = pOnnxHdl->my_onnxruntime_open_model();
+    if (MY_SUCCESS != res)
+    {
+        MY_ERROR("load model %s failed!\n", pParam->model_path);
+        ReleaseHandle(pOnnxHdl);
+        return res;
+    }
+    pHandle = std::shared_ptr<OnnxRuntimeModelHandle>(pOnnxHdl, ReleaseHandle);
+
+    pInfo->dLoadMs = GetTimeMs() - dStartMs;
+    pInfo->nMemoryKB = GetCurrentRssKB() - nRssBeforeKB;
+    pInfo->nModelFileBytes = tStat.st_size;
+
+    std::vector<tensor_params_t> vecInputs, vecOutputs;
+    if (MY_SUCCESS == pOnnxHdl->get_model_tensor_params(vecInputs, vecOutputs, 1, 1))
+    {
+        pInfo->nInputs = (int)vecInputs.size();
+        pInfo->nOutputs = (int)vecOutputs.size();
+    }
+    return MY_SUCCESS;
+}
+
+/**
+ * @brief load <root>/<name>/<version>/model.onnx and register it
+ *
+ * @param pcName  模型名
+ * @param nVersion  版本号, <=0 时加载目录中最大的版本
+ * @param pParam  加载参数, 为NULL时使用注册表的默认参数; model_path 会被替换, 总是共用 env 的线程池
+ * @return result_t
+ */
+result_t ModelRegistry::LoadModel(const char *pcName, int nVersion, const model_params_t *pParam)
+{
+    MY_CHECK_NULL(pcName, MY_PARAM_NULL);
+    std::string strName = pcName;
+
+    if (nVersion <= 0)
+    {
+        std::vector<int> vecVersions;
+        if (!ListVersions(strName, vecVersions) || vecVersions.empty())
+        {
+            MY_ERROR("no version of model %s under %s\n", pcName, m_strRootDir.c_str());
+            return MY_FILE_NOT_EXIST;
+        }
+        for (size_t i = 0; i < vecVersions.size(); i++)
+        {
+            nVersion = std::max(nVersion, vecVersions[i]);
+        }
+    }
+
+    std::string strPath = m_strRootDir + "/" + strName + "/" + std::to_string(nVersion) + "/" REGISTRY_MODEL_FILE;
+    if (strPath.size() >= sizeof(m_tDefaultParam.model_path))
+    {
+        MY_ERROR("model path %s too long\n", strPath.c_str());
+        return MY_PARAM_SET_ERROR;
+    }
+
+    std::shared_ptr<ModelSlot> pSlot = std::make_shared<ModelSlot>();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (pParam != NULL)
+        {
+            m_mapParams[strName] = *pParam;
+        }
+        std::map<std::string, model_params_t>::iterator it = m_mapParams.find(strName);
+        memcpy(&pSlot->tParam, it != m_mapParams.end() ? &it->second : &m_tDefaultParam, sizeof(model_params_t));
+    }
+    memset(pSlot->tParam.model_path, 0, sizeof(pSlot->tParam.model_path));
+    strcpy(pSlot->tParam.model_path, strPath.c_str());
+    // 调用者给的参数也共用 env 的线程池, 否则每个模型各建线程池会超订CPU
+    pSlot->tParam.memory_params.bShareEnvThreadPools = TRUE;
+    memset(&pSlot->tInfo, 0, sizeof(registry_model_info_t));
+    strncpy(pSlot->tInfo.aName, pcName, sizeof(pSlot->tInfo.aName) - 1);
+    pSlot->tInfo.nVersion = nVersion;
+
+    ModelKey key(strName, nVersion);
+    std::lock_guard<std::mutex> load_lock(m_load_mutex);
+    if (std::atomic_load(&m_pModels)->count(key))
+    {
+        return MY_SUCCESS;
+    }
+
+    result_t res = CreateHandle(&pSlot->tParam, pSlot->pHandle, &pSlot->tInfo);
+    if (MY_SUCCESS != res)
+    {
+        return res;
+    }
+
+    pSlot->dLastUsedMs = GetTimeMs();
+
+    // 复制模型表后整体替换, 正在查找的线程继续使用旧快照
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::shared_ptr<ModelMap> pModels = std::make_shared<ModelMap>(*std::atomic_load(&m_pModels));
+        (*pModels)[key] = pSlot;
+        std::atomic_store(&m_pModels, std::shared_ptr<const ModelMap>(pModels));
+    }
+    std::cout << "Register model " << strName << " version " << nVersion << ", " << pSlot->tInfo.nMemoryKB << " KB"
+              << std::endl;
+
+    EvictOverBudget(key);
+    return MY_SUCCESS;
+}
+
+/**
+ * @brief the memory a model is charged in the budget: the resident memory measured at load time, at least
+ *        the model file size since freed pages may be reused by the load
+ */
+static long ModelCostKB(const registry_model_info_t &tInfo)
+{
+    return std::max(tInfo.nMemoryKB, (long)(tInfo.nModelFileBytes / 1024));
+}
+
+/**
+ * @brief unload least recently used models that are neither pinned nor running until the loaded models fit
+ *        in the memory budget, caller holds m_load_mutex
+ *
+ * @param keep  刚加载的模型, 不淘汰
+ */
+void ModelRegistry::EvictOverBudget(const ModelKey &keep)
+{
+    long nBudgetKB = m_nMemoryBudgetKB;
+    if (nBudgetKB <= 0)
+    {
+        return;
+    }
+
+    std::vector<std::pair<double, ModelKey>> vecCandidates;
+    long nTotalKB = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::shared_ptr<const ModelMap> pModels = std::atomic_load(&m_pModels);
+        for (ModelMap::const_iterator it = pModels->begin(); it != pModels->end(); ++it)
+        {
+            nTotalKB += ModelCostKB(it->second->tInfo);
+            if (it->first != keep && !it->second->bPinned)
+            {
+                vecCandidates.push_back(std::make_pair((double)it->second->dLastUsedMs, it->first));
+            }
+        }
+    }
+    std::sort(vecCandidates.begin(), vecCandidates.end());
+
+    bool bEvicted = false;
+    for (size_t i = 0; i < vecCandidates.size() && nTotalKB > nBudgetKB; i++)
+    {
+        const ModelKey &key = vecCandidates[i].second;
+        std::shared_ptr<ModelSlot> pSlot;
+        {
+            // 检查和摘除在同一把锁内, 摘除后新的请求会重新加载; 已经拿到句柄的请求仍可执行完
+            std::lock_guard<std::mutex> lock(m_mutex);
+            std::shared_ptr<const ModelMap> pModels = std::atomic_load(&m_pModels);
+            ModelMap::const_iterator it = pModels->find(key);
+            if (it == pModels->end() || it->second->bPinned || it->second->nInFlight > 0)
+            {
+                continue;
+            }
+            pSlot = it->second;
+            std::shared_ptr<ModelMap> pNewModels = std::make_shared<ModelMap>(*pModels);
+            pNewModels->erase(key);
+            std::atomic_store(&m_pModels, std::shared_ptr<const ModelMap>(pNewModels));
+        }
+
+        nTotalKB -= ModelCostKB(pSlot->tInfo);
+        std::atomic_store(&pSlot->pHandle, std::shared_ptr<OnnxRuntimeModelHandle>());
+        bEvicted = true;
+        std::cout << "Evict model " << key.first << " version " << key.second << std::endl;
+    }
+
+    if (bEvicted)
+    {
+        malloc_trim(0); // 释放的session内存归还系统
+    }
+    if (nTotalKB > nBudgetKB)
+    {
+        std::cout << "Models use " << nTotalKB << " KB over budget " << nBudgetKB << " KB, the rest are pinned or busy"
+                  << std::endl;
+    }
+}
+
+/**
+ * @brief memory budget of the loaded models and whether models are loaded on their first request
+ *
+ * @param nMemoryBudgetKB  内存预算(KB), <=0 表示不限制
+ * @param bLazyLoad  请求未加载的模型时自动加载
+ */
+void ModelRegistry::SetCachePolicy(long nMemoryBudgetKB, bool bLazyLoad)
+{
+    m_nMemoryBudgetKB = nMemoryBudgetKB > 0 ? nMemoryBudgetKB : 0;
+    m_bLazyLoad = bLazyLoad;
+
+    std::lock_guard<std::mutex> load_lock(m_load_mutex);
+    EvictOverBudget(ModelKey());
+}
+
+/**
+ * @brief pin a model so that it is never evicted, loading it if needed
+ *
+ * @param pcName  模型名
+ * @param nVersion  版本号, <=0 表示最新版本
+ * @param bPin  true 常驻, false 取消常驻
+ * @return result_t
+ */
+result_t ModelRegistry::PinModel(const char *pcName, int nVersion, bool bPin)
+{
+    MY_CHECK_NULL(pcName, MY_PARAM_NULL);
+    std::shared_ptr<ModelSlot> pSlot = FindSlot(pcName, nVersion);
+    if (!pSlot && bPin)
+    {
+        result_t res = LoadModel(pcName, nVersion);
+        if (MY_SUCCESS != res)
+        {
+            return res;
+        }
+        pSlot = FindSlot(pcName, nVersion);
+    }
+    if (!pSlot)
+    {
+        return MY_MODEL_NOT_FOUND;
+    }
+
+    pSlot->bPinned = bPin;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    pSlot->tInfo.bPinned = bPin ? TRUE : FALSE;
+    return MY_SUCCESS;
+}
+
+/**
+ * @brief FindSlot, loading the model first when it is not loaded and lazy loading is on
+ *
+ * @param pcName  模型名
+ * @param nVersion  版本号, <=0 表示最新版本
+ * @return std::shared_ptr<ModelSlot>, empty if not found
+ */
+std::shared_ptr<ModelRegistry::ModelSlot> ModelRegistry::AcquireSlot(const char *pcName, int nVersion)
+{
+    std::shared_ptr<ModelSlot> pSlot = FindSlot(pcName, nVersion);
+    if (!pSlot && m_bLazyLoad && MY_SUCCESS == LoadModel(pcName, nVersion))
+    {
+        pSlot = FindSlot(pcName, nVersion);
+    }
+    if (pSlot)
+    {
+        pSlot->dLastUsedMs = GetTimeMs();
+    }
+    return pSlot;
+}
+
+/**
+ * @brief load the highest version of every model directory under the root
+ *
+ * @return result_t  the first failure, the other models are still loaded
+ */
+result_t ModelRegistry::LoadAll()
+{
+    std::vector<std::string> vecNames;
+    if (!ListSubDirs(m_strRootDir, vecNames))
+    {
+        MY_ERROR("model root %s not exist\n", m_strRootDir.c_str());
+        return MY_FILE_NOT_EXIST;
+    }
+
+    result_t res = MY_SUCCESS;
+    for (size_t i = 0; i < vecNames.size(); i++)
+    {
+        result_t cur_res = LoadModel(vecNames[i].c_str(), 0);
+        if (MY_SUCCESS == res)
+        {
+            res = cur_res;
+        }
+    }
+    return res;
+}
+
+/**
+ * @brief remove a model version, the session is released when the last running inference returns
+ *
+ * @param pcName  模型名
+ * @param nVersion  版本号, <=0 表示最新版本
+ * @return result_t
+ */
+result_t ModelRegistry::UnloadModel(const char *pcName, int nVersion)
+{
+    MY_CHECK_NULL(pcName, MY_PARAM_NULL);
+
+    std::shared_ptr<ModelSlot> pSlot;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        pSlot = FindSlot(pcName, nVersion);
+        if (!pSlot)
+        {
+            return MY_MODEL_NOT_FOUND;
+        }
+        std::shared_ptr<ModelMap> pModels = std::make_shared<ModelMap>(*std::atomic_load(&m_pModels));
+        pModels->erase(ModelKey(pcName, pSlot->tInfo.nVersion));
+        std::atomic_store(&m_pModels, std::shared_ptr<const ModelMap>(pModels));
+    }
+    // 在锁外释放session
+    std::atomic_store(&pSlot->pHandle, std::shared_ptr<OnnxRuntimeModelHandle>());
+    return MY_SUCCESS;
+}
+
+/**
+ * @brief load the model file of a registered version again and swap it in once it is loaded and warmed up.
+ *        Requests keep running on the old session meanwhile, it is released after the last of them returns.
+ *
+ * @param pcName  模型名
+ * @param nVersion  版本号, <=0 表示最新版本
+ * @return result_t  the old session stays in service on failure
+ */
+result_t ModelRegistry::ReloadModel(const char *pcName, int nVersion)
+{
+    MY_CHECK_NULL(pcName, MY_PARAM_NULL);
+
+    std::lock_guard<std::mutex> load_lock(m_load_mutex);
+    std::shared_ptr<ModelSlot> pSlot = FindSlot(pcName, nVersion);
+    if (!pSlot)
+    {
+        MY_ERROR("model %s version %d not registered\n", pcName, nVersion);
+        return MY_MODEL_NOT_FOUND;
+    }
+
+    registry_model_info_t tInfo;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        tInfo = pSlot->tInfo;
+    }
+    // 新session换上之前至少跑一次, 第一个请求不承担初始化的开销
+    model_params_t tParam;
+    memcpy(&tParam, &pSlot->tParam, sizeof(model_params_t));
+    if (tParam.warmup_params.nIterations <= 0)
+    {
+        tParam.warmup_params.nIterations = 1;
+    }
+
+    std::shared_ptr<OnnxRuntimeModelHandle> pHandle;
+    result_t res = CreateHandle(&tParam, pHandle, &tInfo);
+    if (MY_SUCCESS != res)
+    {
+        return res;
+    }
+
+    // 没有进行中的请求时旧session在函数返回时释放, 否则由最后一个请求释放
+    std::shared_ptr<OnnxRuntimeModelHandle> pOldHandle = std::atomic_exchange(&pSlot->pHandle, pHandle);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        tInfo.nGeneration++;
+        pSlot->tInfo = tInfo;
+    }
+    std::cout << "Reload model " << pcName << " version " << tInfo.nVersion << ", generation " << tInfo.nGeneration
+              << std::endl;
+    return MY_SUCCESS;
+}
+
+/**
+ * @brief ReloadModel on a background thread, failures are only logged
+ *
+ * @param pcName  模型名
+ * @param nVersion  版本号, <=0 表示最新版本
+ * @return result_t
+ */
+result_t ModelRegistry::ReloadModelAsync(const char *pcName, int nVersion)
+{
+    MY_CHECK_NULL(pcName, MY_PARAM_NULL);
+    if (!FindSlot(pcName, nVersion))
+    {
+        return MY_MODEL_NOT_FOUND;
+    }
+
+    std::string strName = pcName;
+    std::lock_guard<std::mutex> lock(m_thread_mutex);
+    for (size_t i = 0; i < m_vecReloadThreads.size();)
+    {
+        if (m_vecReloadThreads[i].pDone->load())
+        {
+            m_vecReloadThreads[i].thread.join();
+            m_vecReloadThreads.erase(m_vecReloadThreads.begin() + i);
+        }
+        else
+        {
+            i++;
+        }
+    }
+
+    ReloadThread reload;
+    reload.pDone = std::make_shared<std::atomic<bool>>(false);
+    std::shared_ptr<std::atomic<bool>> pDone = reload.pDone;
+    reload.thread = std::thread([this, strName, nVersion, pDone]() {
+        if (MY_SUCCESS != ReloadModel(strName.c_str(), nVersion))
+        {
+            MY_ERROR("background reload of model %s failed\n", strName.c_str());
+        }
+        pDone->store(true);
+    });
+    m_vecReloadThreads.push_back(std::move(reload));
+    return MY_SUCCESS;
+}
+
+/**
+ * @brief slot of a model version in the current snapshot, without locking
+ *
+ * @param pcName  模型名
+ * @param nVersion  版本号, <=0 表示最新版本
+ * @return std::shared_ptr<ModelSlot>, empty if not found
+ */
+std::shared_ptr<ModelRegistry::ModelSlot> ModelRegistry::FindSlot(const char *pcName, int nVersion)
+{
+    std::shared_ptr<const ModelMap> pModels = std::atomic_load(&m_pModels);
+    ModelMap::const_iterator it;
+    if (nVersion <= 0)
+    {
+        // 同名的版本按版本号排列, 最后一个即最新版本
+        it = pModels->upper_bound(ModelKey(pcName, INT_MAX));
+        if (it == pModels->begin())
+        {
+            return std::shared_ptr<ModelSlot>();
+        }
+        --it;
+        if (it->first.first != pcName)
+        {
+            return std::shared_ptr<ModelSlot>();
+        }
+    }
+    else
+    {
+        it = pModels->find(ModelKey(pcName, nVersion));
+        if (it == pModels->end())
+        {
+            return std::shared_ptr<ModelSlot>();
+        }
+    }
+    return it->second;
+}
+
+/**
+ * @brief look up the current handle of a model version (loading it if lazy loading is on), the returned
+ *        handle stays valid after the model is unloaded, evicted or reloaded
+ *
+ * @param pcName  模型名
+ * @param nVersion  版本号, <=0 表示最新版本
+ * @return std::shared_ptr<OnnxRuntimeModelHandle>, empty if not found
+ */
+std::shared_ptr<OnnxRuntimeModelHandle> ModelRegistry::FindModel(const char *pcName, int nVersion)
+{
+    std::shared_ptr<ModelSlot> pSlot = AcquireSlot(pcName, nVersion);
+    if (!pSlot)
+    {
+        return std::shared_ptr<OnnxRuntimeModelHandle>();
+    }
+    return std::atomic_load(&pSlot->pHandle);
+}
+
+/**
+ * @brief run a model by name
+ *
+ * @param pcName  模型名
+ * @param nVersion  版本号, <=0 表示最新版本
+ * @param input_tensor_array  输入
+ * @param output_tensor_array  输出
+ * @return result_t
+ */
+result_t ModelRegistry::Inference(const char *pcName, int nVersion, tensor_array_t *input_tensor_array,
+                                  tensor_array_t *output_tensor_array)
+{
+    MY_CHECK_NULL(pcName, MY_PARAM_NULL);
+
+    // 在 AcquireSlot 和 nInFlight++ 之间被淘汰时再取一次, 延迟加载会重新加载
+    for (int nTry = 0; nTry < 2; nTry++)
+    {
+        std::shared_ptr<ModelSlot> pSlot = AcquireSlot(pcName, nVersion);
+        if (!pSlot)
+        {
+            break;
+        }
+
+        pSlot->nInFlight++;
+        std::shared_ptr<OnnxRuntimeModelHandle> pHandle = std::atomic_load(&pSlot->pHandle);
+        result_t res = MY_MODEL_NOT_FOUND;
+        if (pHandle)
+        {
+            res = pHandle->my_onnxruntime_inference_tensors(input_tensor_array, output_tensor_array);
+        }
+        pSlot->nInFlight--;
+        if (pHandle)
+        {
+            return res;
+        }
+    }
+
+    MY_ERROR("model %s version %d not registered\n", pcName, nVersion);
+    return MY_MODEL_NOT_FOUND;
+}
+
+/**
+ * @brief tensor params of a model from its declared inputs and outputs
+ *
+ * @param pcName  模型名
+ * @param nVersion  版本号, <=0 表示最新版本
+ * @param nBatch  batch 维为符号维度时的值
+ * @param vecInputs  输入参数
+ * @param vecOutputs  输出参数
+ * @return result_t
+ */
+result_t ModelRegistry::GetTensorParams(const char *pcName, int nVersion, int nBatch,
+                                        std::vector<tensor_params_t> &vecInputs,
+                                        std::vector<tensor_params_t> &vecOutputs)
+{
+    MY_CHECK_NULL(pcName, MY_PARAM_NULL);
+    std::shared_ptr<OnnxRuntimeModelHandle> pHandle = FindModel(pcName, nVersion);
+    if (!pHandle)
+    {
+        return MY_MODEL_NOT_FOUND;
+    }
+    return pHandle->get_model_tensor_params(vecInputs, vecOutputs, nBatch,
+                                            pHandle->get_model_param()->warmup_params.nDynamicDimValue);
+}
+
+/**
+ * @brief information of all registered model versions, ordered by name and version
+ *
+ * @param vecInfos  模型信息
+ */
+void ModelRegistry::ListModels(std::vector<registry_model_info_t> &vecInfos)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::shared_ptr<const ModelMap> pModels = std::atomic_load(&m_pModels);
+    vecInfos.clear();
+    for (ModelMap::const_iterator it = pModels->begin(); it != pModels->end(); ++it)
+    {
+        vecInfos.push_back(it->second->tInfo);
+        vecInfos.back().dLastUsedMs = it->second->dLastUsedMs;
+    }
+}
@@ -0,0 +1,82 @@
+#ifndef MY_INFERENCE_ONNX_MY_REGISTRY_H
+#define MY_INFERENCE_ONNX_MY_REGISTRY_H
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "common.h"
+
+class OnnxRuntimeModelHandle;
+
+// 按 (模型名, 版本) 管理同一进程内的多个模型, 模型文件位于 <root>/<name>/<version>/model.onnx
+// 所有模型共用 env 和 env 的线程池; 版本号 <=0 表示已加载的最新版本
+// 查找模型不加锁: 模型表是只读快照, 修改时复制后整体替换; 热更新只替换槽位中的句柄
+// 设置内存预算后按 LRU 淘汰空闲且未常驻的模型, 开启延迟加载后首次请求时才加载
+class ModelRegistry
+{
+public:
+    ModelRegistry(const char *pcRootDir, const model_params_t *pDefaultParam);
+    ~ModelRegistry();
+    result_t LoadModel(const char *pcName, int nVersion, const model_params_t *pParam = NULL);
+    result_t LoadAll();
+    result_t UnloadModel(const char *pcName, int nVersion);
+    result_t ReloadModel(const char *pcName, int nVersion);
+    result_t ReloadModelAsync(const char *pcName, int nVersion);
+    void SetCachePolicy(long nMemoryBudgetKB, bool bLazyLoad);
+    result_t PinModel(const char *pcName, int nVersion, bool bPin);
+    result_t Inference(const char *pcName, int nVersion, tensor_array_t *input_tensor_array,
+                       tensor_array_t *output_tensor_array);
+    result_t GetTensorParams(const char *pcName, int nVersion, int nBatch, std::vector<tensor_params_t> &vecInputs,
+                             std::vector<tensor_params_t> &vecOutputs);
+    void ListModels(std::vector<registry_model_info_t> &vecInfos);
+    std::shared_ptr<OnnxRuntimeModelHandle> FindModel(const char *pcName, int nVersion);
+
+private:
+    typedef std::pair<std::string, int> ModelKey;
+
+    // 一个模型版本, 热更新时 pHandle 用 std::atomic_store 替换, 旧句柄在最后一个请求返回后释放
+    struct ModelSlot
+    {
+        ModelSlot() : bPinned(false), nInFlight(0), dLastUsedMs(0) {}
+
+        std::shared_ptr<OnnxRuntimeModelHandle> pHandle;
+        model_params_t tParam;       // 重新加载时使用
+        registry_model_info_t tInfo; // m_mutex 保护
+        std::atomic<bool> bPinned;
+        std::atomic<int> nInFlight;        // 正在执行的推理, 不为0时不淘汰
+        std::atomic<double> dLastUsedMs;
+    };
+    typedef std::map<ModelKey, std::shared_ptr<ModelSlot>> ModelMap;
+
+    // 后台重新加载的线程, 结束后在下一次 ReloadModelAsync 时回收
+    struct ReloadThread
+    {
+        std::thread thread;
+        std::shared_ptr<std::atomic<bool>> pDone;
+    };
+
+    std::shared_ptr<ModelSlot> FindSlot(const char *pcName, int nVersion);
+    std::shared_ptr<ModelSlot> AcquireSlot(const char *pcName, int nVersion);
+    void EvictOverBudget(const ModelKey &keep);
+    result_t CreateHandle(const model_params_t *pParam, std::shared_ptr<OnnxRuntimeModelHandle> &pHandle,
+                          registry_model_info_t *pInfo);
+    bool ListVersions(const std::string &strName, std::vector<int> &vecVersions);
+
+private:
+    std::string m_strRootDir;
+    model_params_t m_tDefaultParam;
+    std::shared_ptr<const ModelMap> m_pModels; // 只读快照, std::atomic_load / std::atomic_store
+    std::mutex m_mutex;                        // 串行化快照的修改, 保护 tInfo
+    std::mutex m_load_mutex;                   // 加载串行化, 常驻内存的差值才能归到单个模型
+    std::map<std::string, model_params_t> m_mapParams; // LoadModel 指定的参数, 淘汰后延迟加载时使用; m_mutex 保护
+    std::atomic<long> m_nMemoryBudgetKB;                // 0 表示不限制
+    std::atomic<bool> m_bLazyLoad;
+    std::vector<ReloadThread> m_vecReloadThreads; // m_thread_mutex 保护
+    std::mutex m_thread_mutex;
+};
+
+#endif //MY_INFERENCE_ONNX_MY_REGISTRY_H
@@ -0,0 +1,177 @@
+#include "my_request.h"
+
+#include <iostream>
+#include <chrono>
+#include "my_utils.h"
+
+static const OrtApi *g_pOrt = OrtGetApiBase()->GetApi(ORT_API_VERSION);
+
+static RequestTracker *g_pTracker = nullptr; // 进程退出时不析构, 同 InferenceExecutor
+static std::mutex g_tracker_mutex;
+
+RequestState::~RequestState()
+{
+    if (pRunOptions != NULL)
+    {
+        g_pOrt->ReleaseRunOptions(pRunOptions);
+    }
+}
+
+RequestTracker::RequestTracker() : m_nNextId(1)
+{
+    m_watchdog = std::thread(&RequestTracker::WatchdogLoop, this);
+}
+
+/**
+ * @brief the process wide tracker, the watchdog thread starts on first use
+ *
+ * @return RequestTracker*
+ */
+RequestTracker *RequestTracker::GetInstance()
+{
+    std::lock_guard<std::mutex> lock(g_tracker_mutex);
+    if (g_pTracker == nullptr)
+    {
+        g_pTracker = new RequestTracker();
+    }
+    return g_pTracker;
+}
+
+/**
+ * @brief register a request with its own run options, the deadline counts from now
+ *
+ * @param pOptions  请求选项, 可为NULL
+ * @return std::shared_ptr<RequestState>  NULL if the run options can not be created
+ */
+std::shared_ptr<RequestState> RequestTracker::Create(const request_options_t *pOptions)
+{
+    std::shared_ptr<RequestState> pState = std::make_shared<RequestState>();
+    OrtStatus *status = g_pOrt->CreateRunOptions(&pState->pRunOptions);
+    if (status != NULL)
+    {
+        MY_ERROR("create run options failed: %s\n", g_pOrt->GetErrorMessage(status));
+        g_pOrt->ReleaseStatus(status);
+        pState->pRunOptions = NULL;
+        return std::shared_ptr<RequestState>();
+    }
+
+    pState->nRequestId = m_nNextId++;
+    if (pOptions != NULL && pOptions->nTimeoutMs > 0)
+    {
+        pState->dDeadlineMs = GetTimeMs() + pOptions->nTimeoutMs;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_mapRequests[pState->nRequestId] = pState;
+    if (pState->dDeadlineMs > 0)
+    {
+        bool bEarliest = m_mapDeadlines.empty() || pState->dDeadlineMs < m_mapDeadlines.begin()->first;
+        m_mapDeadlines.insert(std::make_pair(pState->dDeadlineMs, std::weak_ptr<RequestState>(pState)));
+        if (bEarliest)
+        {
+            m_cvDeadline.notify_one();
+        }
+    }
+    return pState;
+}
+
+/**
+ * @brief the request is done, it can no longer be cancelled
+ *
+ * @param pState  Create 返回的请求
+ */
+void RequestTracker::Finish(const std::shared_ptr<RequestState> &pState)
+{
+    if (!pState)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_mapRequests.erase(pState->nRequestId);
+    if (pState->dDeadlineMs > 0)
+    {
+        auto range = m_mapDeadlines.equal_range(pState->dDeadlineMs);
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            if (it->second.lock() == pState)
+            {
+                m_mapDeadlines.erase(it);
+                break;
+            }
+        }
+    }
+}
+
+/**
+ * @brief cancel a queued or running request. A queued request is dropped without running,
+ *        a running one is terminated inside onnxruntime.
+ *
+ * @param nRequestId  提交时返回的请求id
+ * @return result_t  MY_PARAM_SET_ERROR if the request is unknown or already done
+ */
+result_t RequestTracker::Cancel(long long nRequestId)
+{
+    std::shared_ptr<RequestState> pState;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_mapRequests.find(nRequestId);
+        if (it == m_mapRequests.end())
+        {
+            return MY_PARAM_SET_ERROR;
+        }
+        pState = it->second;
+    }
+    Stop(pState, true);
+    return MY_SUCCESS;
+}
+
+void RequestTracker::Stop(const std::shared_ptr<RequestState> &pState, bool bCancel)
+{
+    if (pState->IsStopped())
+    {
+        return;
+    }
+    if (bCancel)
+    {
+        pState->bCancelled = true;
+    }
+    else
+    {
+        pState->bExpired = true;
+    }
+    OrtStatus *status = g_pOrt->RunOptionsSetTerminate(pState->pRunOptions);
+    if (status != NULL)
+    {
+        MY_ERROR("terminate request %lld failed: %s\n", pState->nRequestId, g_pOrt->GetErrorMessage(status));
+        g_pOrt->ReleaseStatus(status);
+    }
+}
+
+void RequestTracker::WatchdogLoop()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+        if (m_mapDeadlines.empty())
+        {
+            m_cvDeadline.wait(lock);
+            continue;
+        }
+
+        double dNowMs = GetTimeMs();
+        auto it = m_mapDeadlines.begin();
+        if (it->first > dNowMs)
+        {
+            m_cvDeadline.wait_for(lock, std::chrono::microseconds((long long)((it->first - dNowMs) * 1000)));
+            continue;
+        }
+
+        std::shared_ptr<RequestState> pState = it->second.lock();
+        m_mapDeadlines.erase(it);
+        if (pState)
+        {
+            Stop(pState, false);
+        }
+    }
+}
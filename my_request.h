@@ -0,0 +1,52 @@
+#ifndef MY_INFERENCE_ONNX_MY_REQUEST_H
+#define MY_INFERENCE_ONNX_MY_REQUEST_H
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "common.h"
+#include "onnxruntime/onnxruntime_c_api.h"
+
+// 一个可取消的推理请求; pRunOptions 传给 Run, 终止它即中止正在执行的推理
+struct RequestState
+{
+    RequestState() : nRequestId(0), dDeadlineMs(0), pRunOptions(NULL), bCancelled(false), bExpired(false) {}
+    ~RequestState();
+
+    long long nRequestId;
+    double dDeadlineMs; // GetTimeMs 的绝对时间, 0 表示不限制
+    OrtRunOptions *pRunOptions;
+    std::atomic<bool> bCancelled;
+    std::atomic<bool> bExpired;
+
+    bool IsStopped() const { return bCancelled || bExpired; }
+    result_t StopReason() const { return bCancelled ? MY_CANCELLED : MY_DEADLINE_EXCEEDED; }
+};
+
+// 登记进行中的请求, 按 id 取消; 后台线程在截止时间到达时终止请求
+class RequestTracker
+{
+public:
+    std::shared_ptr<RequestState> Create(const request_options_t *pOptions);
+    void Finish(const std::shared_ptr<RequestState> &pState);
+    result_t Cancel(long long nRequestId);
+
+    static RequestTracker *GetInstance();
+
+private:
+    RequestTracker(); // 不析构, 见 GetInstance
+    void Stop(const std::shared_ptr<RequestState> &pState, bool bCancel);
+    void WatchdogLoop();
+
+private:
+    std::atomic<long long> m_nNextId;
+    std::map<long long, std::shared_ptr<RequestState>> m_mapRequests;
+    std::multimap<double, std::weak_ptr<RequestState>> m_mapDeadlines; // 截止时间 -> 请求
+    std::mutex m_mutex;
+    std::condition_variable m_cvDeadline;
+    std::thread m_watchdog;
+};
+
+#endif //MY_INFERENCE_ONNX_MY_REQUEST_H
@@ -0,0 +1,456 @@
+#include "my_sharded.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#include "my_onnx_inference.h"
+#include "my_request.h"
+
+#define NUMA_NODE_DIR "/sys/devices/system/node"
+#define DEFAULT_SHARD_QUEUE_DEPTH 256
+#define SHARD_IDLE_WAIT_MS 50 // 空闲分片定期检查同节点的队列
+
+/**
+ * @brief parse a sysfs cpu list such as "0-3,8-11"
+ *
+ * @param strList  cpulist 内容
+ * @param vecCpus  解析出的cpu编号
+ */
+static void ParseCpuList(const std::string &strList, std::vector<int> &vecCpus)
+{
+    size_t nPos = 0;
+    while (nPos < strList.size())
+    {
+        size_t nEnd = strList.find(',', nPos);
+        if (nEnd == std::string::npos)
+        {
+            nEnd = strList.size();
+        }
+        std::string strRange = strList.substr(nPos, nEnd - nPos);
+        size_t nDash = strRange.find('-');
+        if (!strRange.empty() && isdigit((unsigned char)strRange[0]))
+        {
+            int nFirst = atoi(strRange.c_str());
+            int nLast = nDash == std::string::npos ? nFirst : atoi(strRange.c_str() + nDash + 1);
+            for (int nCpu = nFirst; nCpu <= nLast; nCpu++)
+            {
+                vecCpus.push_back(nCpu);
+            }
+        }
+        nPos = nEnd + 1;
+    }
+}
+
+/**
+ * @brief cpus of each NUMA node that this process may run on. Without NUMA information in sysfs
+ *        all allowed cpus form one node.
+ *
+ * @param vecNodeCpus  每个节点可用的cpu
+ */
+static void ReadNumaNodes(std::vector<std::vector<int>> &vecNodeCpus)
+{
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+    {
+        MY_ERROR("sched_getaffinity failed\n");
+        return;
+    }
+
+    DIR *pDir = opendir(NUMA_NODE_DIR);
+    if (pDir != NULL)
+    {
+        std::vector<std::pair<int, std::vector<int>>> vecNodes;
+        struct dirent *pEntry;
+        while ((pEntry = readdir(pDir)) != NULL)
+        {
+            if (strncmp(pEntry->d_name, "node", 4) != 0 || !isdigit((unsigned char)pEntry->d_name[4]))
+            {
+                continue;
+            }
+
+            std::ifstream file(std::string(NUMA_NODE_DIR) + "/" + pEntry->d_name + "/cpulist");
+            std::string strList;
+            std::vector<int> vecCpus, vecAllowed;
+            std::getline(file, strList);
+            ParseCpuList(strList, vecCpus);
+            for (size_t i = 0; i < vecCpus.size(); i++)
+            {
+                if (vecCpus[i] < CPU_SETSIZE && CPU_ISSET(vecCpus[i], &allowed))
+                {
+                    vecAllowed.push_back(vecCpus[i]);
+                }
+            }
+            if (!vecAllowed.empty())
+            {
+                vecNodes.push_back(std::make_pair(atoi(pEntry->d_name + 4), vecAllowed));
+            }
+        }
+        closedir(pDir);
+
+        std::sort(vecNodes.begin(), vecNodes.end());
+        for (size_t i = 0; i < vecNodes.size(); i++)
+        {
+            vecNodeCpus.push_back(vecNodes[i].second);
+        }
+    }
+
+    if (vecNodeCpus.empty())
+    {
+        std::vector<int> vecCpus;
+        for (int nCpu = 0; nCpu < CPU_SETSIZE; nCpu++)
+        {
+            if (CPU_ISSET(nCpu, &allowed))
+            {
+                vecCpus.push_back(nCpu);
+            }
+        }
+        vecNodeCpus.push_back(vecCpus);
+    }
+}
+
+/**
+ * @brief bind the calling thread, threads it creates afterwards inherit the binding
+ *
+ * @param vecCpus  cpu编号
+ * @return bool
+ */
+static bool PinCurrentThread(const std::vector<int> &vecCpus)
+{
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    for (size_t i = 0; i < vecCpus.size(); i++)
+    {
+        CPU_SET(vecCpus[i], &cpus);
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) == 0;
+}
+
+/**
+ * @brief Construct a new Sharded Model object, shards are planned and loaded by Start
+ *
+ * @param pModelParam  模型参数, 所有分片相同
+ * @param pShardParam  分片参数
+ */
+ShardedModel::ShardedModel(const model_params_t *pModelParam, const shard_params_t *pShardParam)
+    : m_nNextShard(0), m_bStop(false), m_nStarted(0)
+{
+    memcpy(&m_tModelParam, pModelParam, sizeof(model_params_t));
+    memcpy(&m_tShardParam, pShardParam, sizeof(shard_params_t));
+    if (m_tShardParam.nCoresPerShard <= 0)
+    {
+        m_tShardParam.nCoresPerShard = 1;
+    }
+    if (m_tShardParam.nQueueDepth <= 0)
+    {
+        m_tShardParam.nQueueDepth = DEFAULT_SHARD_QUEUE_DEPTH;
+    }
+
+    // 计算线程由分片的执行线程创建, 继承它的绑核; env 共享线程池不属于任何分片
+    m_tModelParam.memory_params.bShareEnvThreadPools = FALSE;
+}
+
+/**
+ * @brief run the queued requests, then stop the shard threads and release the sessions
+ */
+ShardedModel::~ShardedModel()
+{
+    m_bStop = true;
+    for (size_t i = 0; i < m_vecShards.size(); i++)
+    {
+        WakeShard((int)i);
+    }
+    for (size_t i = 0; i < m_vecShards.size(); i++)
+    {
+        if (m_vecShards[i]->worker.joinable())
+        {
+            m_vecShards[i]->worker.join();
+        }
+        if (m_vecShards[i]->pHandle != NULL)
+        {
+            m_vecShards[i]->pHandle->my_onnxruntime_release_model();
+            delete m_vecShards[i]->pHandle;
+        }
+    }
+}
+
+/**
+ * @brief split every NUMA node into disjoint groups of nCoresPerShard cores. The cores left over on a node
+ *        go to its last shard; a node with fewer cores than nCoresPerShard gets one shard with all of them.
+ */
+void ShardedModel::PlanShards()
+{
+    std::vector<std::vector<int>> vecNodeCpus;
+    ReadNumaNodes(vecNodeCpus);
+
+    size_t nCoresPerShard = (size_t)m_tShardParam.nCoresPerShard;
+    for (size_t nNode = 0; nNode < vecNodeCpus.size(); nNode++)
+    {
+        const std::vector<int> &vecCpus = vecNodeCpus[nNode];
+        size_t nFirstShard = m_vecShards.size();
+        for (size_t nBegin = 0; nBegin < vecCpus.size(); nBegin += nCoresPerShard)
+        {
+            if (m_tShardParam.nMaxShards > 0 && (int)m_vecShards.size() >= m_tShardParam.nMaxShards)
+            {
+                break;
+            }
+            if (nBegin > 0 && vecCpus.size() - nBegin < nCoresPerShard)
+            {
+                Shard *pLast = m_vecShards.back().get();
+                pLast->vecCpus.insert(pLast->vecCpus.end(), vecCpus.begin() + nBegin, vecCpus.end());
+                break;
+            }
+
+            size_t nEnd = std::min(nBegin + nCoresPerShard, vecCpus.size());
+            std::unique_ptr<Shard> pShard(new Shard((size_t)m_tShardParam.nQueueDepth));
+            pShard->nNode = (int)nNode;
+            pShard->vecCpus.assign(vecCpus.begin() + nBegin, vecCpus.begin() + nEnd);
+            m_vecShards.push_back(std::move(pShard));
+        }
+
+        // 从下一个分片开始依次窃取, 避免同节点的空闲分片都去抢同一个队列
+        size_t nNodeShards = m_vecShards.size() - nFirstShard;
+        for (size_t i = 0; i < nNodeShards; i++)
+        {
+            for (size_t j = 1; j < nNodeShards; j++)
+            {
+                m_vecShards[nFirstShard + i]->vecSiblings.push_back((int)(nFirstShard + (i + j) % nNodeShards));
+            }
+        }
+    }
+}
+
+/**
+ * @brief plan the shards and load one session per shard on its pinned thread
+ *
+ * @return result_t  the first failure of the shard sessions
+ */
+result_t ShardedModel::Start()
+{
+    PlanShards();
+    if (m_vecShards.empty())
+    {
+        MY_ERROR("no cpu available for shards\n");
+        return MY_FAILED;
+    }
+
+    for (size_t i = 0; i < m_vecShards.size(); i++)
+    {
+        m_vecShards[i]->worker = std::thread(&ShardedModel::ShardLoop, this, (int)i);
+    }
+
+    std::unique_lock<std::mutex> lock(m_start_mutex);
+    m_cvStarted.wait(lock, [this]() { return m_nStarted == (int)m_vecShards.size(); });
+
+    for (size_t i = 0; i < m_vecShards.size(); i++)
+    {
+        Shard *pShard = m_vecShards[i].get();
+        std::string strCpus;
+        for (size_t j = 0; j < pShard->vecCpus.size(); j++)
+        {
+            strCpus += " " + std::to_string(pShard->vecCpus[j]);
+        }
+        MY_DEBUG("shard %zu node %d cpus%s\n", i, pShard->nNode, strCpus.c_str());
+        if (MY_SUCCESS != pShard->res)
+        {
+            return pShard->res;
+        }
+    }
+    return MY_SUCCESS;
+}
+
+/**
+ * @brief queue a request on the shorter of two shard queues without taking a lock
+ *
+ * @param request  推理请求, pOnnxHdl 不使用
+ * @return result_t  MY_OVERLOADED if both queues are full
+ */
+result_t ShardedModel::Submit(const InferenceRequest &request)
+{
+    MY_CHECK_NULL(request.callback, MY_PARAM_NULL);
+    if (m_bStop || m_vecShards.empty())
+    {
+        return MY_OVERLOADED;
+    }
+
+    // 两个随机选择中取较短的队列, 比轮询更能避开正在执行慢请求的分片
+    unsigned nTicket = m_nNextShard.fetch_add(1, std::memory_order_relaxed);
+    int nShards = (int)m_vecShards.size();
+    int nFirst = (int)(nTicket % nShards);
+    int nSecond = (int)((nTicket * 2654435761u >> 16) % nShards);
+    if (m_vecShards[nSecond]->queue.Size() < m_vecShards[nFirst]->queue.Size())
+    {
+        std::swap(nFirst, nSecond);
+    }
+
+    int nShard = nFirst;
+    if (!m_vecShards[nShard]->queue.Push(request))
+    {
+        nShard = nSecond;
+        if (nSecond == nFirst || !m_vecShards[nShard]->queue.Push(request))
+        {
+            return MY_OVERLOADED;
+        }
+    }
+
+    // 目标分片在忙时叫醒同节点的一个空闲分片来窃取
+    Shard *pShard = m_vecShards[nShard].get();
+    if (!pShard->bIdle.load())
+    {
+        for (size_t i = 0; i < pShard->vecSiblings.size(); i++)
+        {
+            if (m_vecShards[pShard->vecSiblings[i]]->bIdle.load())
+            {
+                nShard = pShard->vecSiblings[i];
+                break;
+            }
+        }
+    }
+    WakeShard(nShard);
+    return MY_SUCCESS;
+}
+
+static void PromiseCallback(result_t res, tensor_array_t * /*output_tensors*/, void *user_data)
+{
+    ((std::promise<result_t> *)user_data)->set_value(res);
+}
+
+/**
+ * @brief run on one of the shards and wait for the result
+ *
+ * @param input_tensor_array  输入tensor
+ * @param output_tensor_array  输出tensor
+ * @return result_t
+ */
+result_t ShardedModel::Inference(tensor_array_t *input_tensor_array, tensor_array_t *output_tensor_array)
+{
+    std::promise<result_t> promise;
+    std::future<result_t> future = promise.get_future();
+
+    InferenceRequest request;
+    request.input_tensors = input_tensor_array;
+    request.output_tensors = output_tensor_array;
+    request.callback = PromiseCallback;
+    request.user_data = &promise;
+    result_t res = Submit(request);
+    return MY_SUCCESS == res ? future.get() : res;
+}
+
+int ShardedModel::GetShardCount() const
+{
+    return (int)m_vecShards.size();
+}
+
+void ShardedModel::WakeShard(int nShard)
+{
+    Shard *pShard = m_vecShards[nShard].get();
+    if (pShard->bIdle.load() || m_bStop)
+    {
+        std::lock_guard<std::mutex> lock(pShard->mutex);
+        pShard->cvRequest.notify_one();
+    }
+}
+
+/**
+ * @brief own queue first, then the other shards of the same node
+ *
+ * @param pShard  分片
+ * @param request  取到的请求
+ * @return bool
+ */
+bool ShardedModel::TakeRequest(Shard *pShard, InferenceRequest &request)
+{
+    if (pShard->queue.Pop(request))
+    {
+        return true;
+    }
+    for (size_t i = 0; i < pShard->vecSiblings.size(); i++)
+    {
+        if (m_vecShards[pShard->vecSiblings[i]]->queue.Pop(request))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ShardedModel::HasRequest(Shard *pShard)
+{
+    if (pShard->queue.Size() > 0)
+    {
+        return true;
+    }
+    for (size_t i = 0; i < pShard->vecSiblings.size(); i++)
+    {
+        if (m_vecShards[pShard->vecSiblings[i]]->queue.Size() > 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void ShardedModel::ShardLoop(int nShard)
+{
+    Shard *pShard = m_vecShards[nShard].get();
+    if (!PinCurrentThread(pShard->vecCpus))
+    {
+        MY_ERROR("pin shard %d failed, it runs unpinned\n", nShard);
+    }
+
+    // session 在绑核之后创建, onnxruntime 的计算线程继承这个线程的绑核, 线程数按本分片实际的核数
+    model_params_t tParam;
+    memcpy(&tParam, &m_tModelParam, sizeof(model_params_t));
+    tParam.nIntraOpThreads = (int)pShard->vecCpus.size();
+    OnnxRuntimeModelHandle *pHandle = new OnnxRuntimeModelHandle(&tParam);
+    pShard->res = pHandle->my_onnxruntime_open_model();
+    if (MY_SUCCESS == pShard->res)
+    {
+        pShard->pHandle = pHandle;
+    }
+    else
+    {
+        pHandle->my_onnxruntime_release_model();
+        delete pHandle;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_start_mutex);
+        m_nStarted++;
+    }
+    m_cvStarted.notify_one();
+    if (MY_SUCCESS != pShard->res)
+    {
+        return;
+    }
+
+    while (true)
+    {
+        InferenceRequest request;
+        if (TakeRequest(pShard, request))
+        {
+            request.pOnnxHdl = pShard->pHandle;
+            result_t res = RunRequest(request);
+            request.callback(res, request.output_tensors, request.user_data);
+            continue;
+        }
+        if (m_bStop)
+        {
+            return;
+        }
+
+        // 先标记空闲再检查队列, 与 Submit 的入队后检查空闲配对, 不会漏掉唤醒
+        std::unique_lock<std::mutex> lock(pShard->mutex);
+        pShard->bIdle = true;
+        if (!HasRequest(pShard) && !m_bStop)
+        {
+            pShard->cvRequest.wait_for(lock, std::chrono::milliseconds(SHARD_IDLE_WAIT_MS));
+        }
+        pShard->bIdle = false;
+    }
+}
@@ -0,0 +1,167 @@
+#ifndef MY_INFERENCE_ONNX_MY_SHARDED_H
+#define MY_INFERENCE_ONNX_MY_SHARDED_H
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "common.h"
+#include "my_async.h"
+
+class OnnxRuntimeModelHandle;
+
+// 有界多生产者多消费者无锁队列, 每个格子用序号区分空/满 (Vyukov)
+template <typename T>
+class BoundedMpmcQueue
+{
+public:
+    explicit BoundedMpmcQueue(size_t nCapacity)
+    {
+        size_t nSize = 2;
+        while (nSize < nCapacity)
+        {
+            nSize <<= 1;
+        }
+        m_vecCells.resize(nSize);
+        for (size_t i = 0; i < nSize; i++)
+        {
+            m_vecCells[i].nSequence.store(i, std::memory_order_relaxed);
+        }
+        m_nMask = nSize - 1;
+        m_nEnqueuePos.store(0, std::memory_order_relaxed);
+        m_nDequeuePos.store(0, std::memory_order_relaxed);
+    }
+
+    bool Push(const T &value)
+    {
+        size_t nPos = m_nEnqueuePos.load(std::memory_order_relaxed);
+        while (true)
+        {
+            Cell &cell = m_vecCells[nPos & m_nMask];
+            size_t nSequence = cell.nSequence.load(std::memory_order_acquire);
+            intptr_t nDiff = (intptr_t)nSequence - (intptr_t)nPos;
+            if (nDiff == 0)
+            {
+                if (m_nEnqueuePos.compare_exchange_weak(nPos, nPos + 1, std::memory_order_relaxed))
+                {
+                    cell.value = value;
+                    cell.nSequence.store(nPos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (nDiff < 0)
+            {
+                return false; // 满
+            }
+            else
+            {
+                nPos = m_nEnqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool Pop(T &value)
+    {
+        size_t nPos = m_nDequeuePos.load(std::memory_order_relaxed);
+        while (true)
+        {
+            Cell &cell = m_vecCells[nPos & m_nMask];
+            size_t nSequence = cell.nSequence.load(std::memory_order_acquire);
+            intptr_t nDiff = (intptr_t)nSequence - (intptr_t)(nPos + 1);
+            if (nDiff == 0)
+            {
+                if (m_nDequeuePos.compare_exchange_weak(nPos, nPos + 1, std::memory_order_relaxed))
+                {
+                    value = cell.value;
+                    cell.value = T();
+                    cell.nSequence.store(nPos + m_nMask + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (nDiff < 0)
+            {
+                return false; // 空
+            }
+            else
+            {
+                nPos = m_nDequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // 近似长度, 仅用于选择分片
+    size_t Size() const
+    {
+        size_t nEnqueue = m_nEnqueuePos.load(std::memory_order_relaxed);
+        size_t nDequeue = m_nDequeuePos.load(std::memory_order_relaxed);
+        return nEnqueue > nDequeue ? nEnqueue - nDequeue : 0;
+    }
+
+private:
+    struct Cell
+    {
+        Cell() : nSequence(0) {}
+        Cell(const Cell &other) : nSequence(other.nSequence.load()), value(other.value) {}
+
+        std::atomic<size_t> nSequence;
+        T value;
+    };
+
+    std::vector<Cell> m_vecCells;
+    size_t m_nMask;
+    char m_aPad0[64];
+    std::atomic<size_t> m_nEnqueuePos; // 生产者和消费者的位置放在不同cache line
+    char m_aPad1[64];
+    std::atomic<size_t> m_nDequeuePos;
+};
+
+// 同一模型加载多个session, 每个session(分片)的执行线程和计算线程绑定到同一NUMA节点上独占的一组核
+// 请求按两个随机分片中较短的队列分发, 空闲分片从同一节点的其它分片窃取请求, 不跨节点窃取
+class ShardedModel
+{
+public:
+    ShardedModel(const model_params_t *pModelParam, const shard_params_t *pShardParam);
+    ~ShardedModel();
+    result_t Start();
+    result_t Submit(const InferenceRequest &request);
+    result_t Inference(tensor_array_t *input_tensor_array, tensor_array_t *output_tensor_array);
+    int GetShardCount() const;
+
+private:
+    struct Shard
+    {
+        Shard(size_t nQueueDepth) : queue(nQueueDepth), nNode(0), pHandle(NULL), bIdle(false), res(MY_SUCCESS) {}
+
+        BoundedMpmcQueue<InferenceRequest> queue;
+        int nNode;
+        std::vector<int> vecCpus;
+        std::vector<int> vecSiblings; // 同一节点的其它分片, 窃取的顺序
+        OnnxRuntimeModelHandle *pHandle;
+        std::thread worker;
+        std::mutex mutex;
+        std::condition_variable cvRequest;
+        std::atomic<bool> bIdle;
+        result_t res; // 加载结果
+    };
+
+    void PlanShards();
+    void ShardLoop(int nShard);
+    bool TakeRequest(Shard *pShard, InferenceRequest &request);
+    bool HasRequest(Shard *pShard);
+    void WakeShard(int nShard);
+
+private:
+    model_params_t m_tModelParam;
+    shard_params_t m_tShardParam;
+    std::vector<std::unique_ptr<Shard>> m_vecShards;
+    std::atomic<unsigned> m_nNextShard;
+    std::atomic<bool> m_bStop;
+
+    std::mutex m_start_mutex;
+    std::condition_variable m_cvStarted;
+    int m_nStarted;
+};
+
+#endif //MY_INFERENCE_ONNX_MY_SHARDED_H
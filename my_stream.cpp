@@ -0,0 +1,351 @@
+#include "my_stream.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include "my_onnx_inference.h"
+#include "my_utils.h"
+
+static const OrtApi *g_pOrt = OrtGetApiBase()->GetApi(ORT_API_VERSION);
+
+StreamSession::~StreamSession()
+{
+    for (size_t i = 0; i < vecStates.size(); i++)
+    {
+        if (vecStates[i] != nullptr)
+        {
+            g_pOrt->ReleaseValue(vecStates[i]);
+        }
+    }
+}
+
+/**
+ * @brief Construct a new Stream Model object
+ *
+ * @param pOnnxHdl  已加载的流式模型
+ * @param pParams  状态和回收参数
+ */
+StreamModel::StreamModel(OnnxRuntimeModelHandle *pOnnxHdl, const stream_params_t *pParams)
+    : m_pOnnxHdl(pOnnxHdl), m_nNextId(1), m_bStop(false)
+{
+    memcpy(&m_tParams, pParams, sizeof(stream_params_t));
+}
+
+StreamModel::~StreamModel()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_bStop = true;
+    }
+    m_cvStop.notify_all();
+    if (m_reaper.joinable())
+    {
+        m_reaper.join();
+    }
+
+    m_mapStreams.clear();
+    for (size_t i = 0; i < m_vecInitialStates.size(); i++)
+    {
+        if (m_vecInitialStates[i] != nullptr)
+        {
+            g_pOrt->ReleaseValue(m_vecInitialStates[i]);
+        }
+    }
+}
+
+/**
+ * @brief check the state names against the model, create the initial states and start the reaper
+ *
+ * @return result_t
+ */
+result_t StreamModel::Start()
+{
+    int nMaxStates = sizeof(m_tParams.aStates) / sizeof(m_tParams.aStates[0]);
+    if (m_tParams.nStates < 0 || m_tParams.nStates > nMaxStates)
+    {
+        MY_ERROR("stream: nStates should be 0 ~ %d\n", nMaxStates);
+        return MY_PARAM_SET_ERROR;
+    }
+
+    std::vector<tensor_params_t> vecInputs, vecOutputs;
+    result_t res = m_pOnnxHdl->get_model_tensor_params(vecInputs, vecOutputs, 1, 0);
+    for (int s = 0; s < m_tParams.nStates && MY_SUCCESS == res; s++)
+    {
+        const stream_state_t *pState = &m_tParams.aStates[s];
+        int nMaxDims = sizeof(pState->pShape) / sizeof(pState->pShape[0]);
+        bool bShapeValid = pState->nDims >= 0 && pState->nDims <= nMaxDims;
+        for (int j = 0; bShapeValid && j < pState->nDims; j++)
+        {
+            bShapeValid = pState->pShape[j] >= 0;
+        }
+        if (!bShapeValid)
+        {
+            MY_ERROR("stream: state %s should have 0 ~ %d dims and no negative dim\n", pState->aInputName, nMaxDims);
+            res = MY_PARAM_SET_ERROR;
+            break;
+        }
+
+        auto itInput = std::find_if(vecInputs.begin(), vecInputs.end(), [pState](const tensor_params_t &tParam) {
+            return strncmp(tParam.aTensorName, pState->aInputName, sizeof(pState->aInputName)) == 0;
+        });
+        auto itOutput = std::find_if(vecOutputs.begin(), vecOutputs.end(), [pState](const tensor_params_t &tParam) {
+            return strncmp(tParam.aTensorName, pState->aOutputName, sizeof(pState->aOutputName)) == 0;
+        });
+        if (itInput == vecInputs.end() || itOutput == vecOutputs.end())
+        {
+            MY_ERROR("stream: model has no state input %s or output %s\n", pState->aInputName,
+                     pState->aOutputName);
+            res = MY_PARAM_SET_ERROR;
+            break;
+        }
+
+        OrtValue *pValue = nullptr;
+        res = CreateInitialState(pState, &(*itInput), &pValue);
+        m_vecInitialStates.push_back(pValue);
+    }
+
+    if (MY_SUCCESS == res && m_tParams.nIdleTimeoutMs > 0)
+    {
+        m_reaper = std::thread(&StreamModel::ReaperLoop, this);
+    }
+    return res;
+}
+
+/**
+ * @brief zero state shared by every stream until its first call
+ *
+ * @param pState  状态配置, nDims > 0 时使用其中的 shape, 由 Start() 检查过
+ * @param pModelInput  模型声明的状态输入, 符号维度已替换为1
+ * @param ppValue  初始状态
+ * @return result_t
+ */
+result_t StreamModel::CreateInitialState(const stream_state_t *pState, const tensor_params_t *pModelInput,
+                                         OrtValue **ppValue)
+{
+    tensor_params_t tParam;
+    memcpy(&tParam, pModelInput, sizeof(tensor_params_t));
+    if (pState->nDims > 0)
+    {
+        tParam.nDims = pState->nDims;
+        memcpy(tParam.pShape, pState->pShape, tParam.nDims * sizeof(int));
+    }
+
+    tensor_t tTensor;
+    tTensor.pTensorInfo = &tParam;
+    GetTensorSize(&tTensor);
+
+    // 如 KV cache 初始长度为0, 保留一个字节使数据指针非空
+    m_vecInitialData.push_back(std::vector<my_u8>(std::max(tParam.nLength, 1), 0));
+    tTensor.pValue = m_vecInitialData.back().data();
+    return OnnxRuntimeModelHandle::WrapTensorValue(&tTensor, ppValue);
+}
+
+/**
+ * @brief open a stream that starts from the initial states
+ *
+ * @param pStreamId  流id
+ * @return result_t  MY_OVERLOADED if nMaxStreams streams are open
+ */
+result_t StreamModel::Open(long long *pStreamId)
+{
+    std::shared_ptr<StreamSession> pStream = std::make_shared<StreamSession>();
+    pStream->vecStates.assign(m_tParams.nStates, nullptr);
+    pStream->dLastUsedMs = GetTimeMs();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_tParams.nMaxStreams > 0 && m_mapStreams.size() >= (size_t)m_tParams.nMaxStreams)
+    {
+        return MY_OVERLOADED;
+    }
+    *pStreamId = m_nNextId++;
+    m_mapStreams[*pStreamId] = pStream;
+    return MY_SUCCESS;
+}
+
+/**
+ * @brief run one chunk of a stream. The state inputs are fed from the stream, the state outputs are kept
+ *        in it for the next chunk; the caller only gives the other inputs and the outputs it wants. A state
+ *        input given by the caller overrides the stream's state for this chunk. On failure the stream keeps
+ *        its previous states.
+ *
+ * @param nStreamId  流id
+ * @param input_tensor_array  本次的输入tensor
+ * @param output_tensor_array  本次要取的输出tensor, 可以包含状态输出, 按实际shape填写 pShape
+ * @return result_t  MY_STREAM_NOT_FOUND if the stream was closed or expired
+ */
+result_t StreamModel::Run(long long nStreamId, tensor_array_t *input_tensor_array,
+                          tensor_array_t *output_tensor_array)
+{
+    std::shared_ptr<StreamSession> pStream = FindStream(nStreamId);
+    if (!pStream)
+    {
+        MY_ERROR("stream %lld is closed or expired\n", nStreamId);
+        return MY_STREAM_NOT_FOUND;
+    }
+    std::lock_guard<std::mutex> lock(pStream->mutex);
+
+    result_t res = MY_SUCCESS;
+    std::vector<const char *> vecInputNames;
+    std::vector<OrtValue *> vecInputValues;
+    for (int i = 0; i < input_tensor_array->nArraySize && MY_SUCCESS == res; i++)
+    {
+        OrtValue *pValue = nullptr;
+        res = OnnxRuntimeModelHandle::WrapTensorValue(&input_tensor_array->pTensorArray[i], &pValue);
+        if (MY_SUCCESS == res)
+        {
+            vecInputNames.push_back(input_tensor_array->pTensorArray[i].pTensorInfo->aTensorName);
+            vecInputValues.push_back(pValue);
+        }
+    }
+    size_t nWrapped = vecInputValues.size(); // 之后的是流中的状态, 不释放
+
+    std::vector<const char *> vecOutputNames;
+    for (int i = 0; i < output_tensor_array->nArraySize; i++)
+    {
+        vecOutputNames.push_back(output_tensor_array->pTensorArray[i].pTensorInfo->aTensorName);
+    }
+
+    std::vector<size_t> vecStateOutputs(m_tParams.nStates); // 每个状态在输出中的位置
+    for (int s = 0; s < m_tParams.nStates; s++)
+    {
+        const stream_state_t *pState = &m_tParams.aStates[s];
+        auto MatchInput = [pState](const char *pName) {
+            return strncmp(pName, pState->aInputName, sizeof(pState->aInputName)) == 0;
+        };
+        if (std::find_if(vecInputNames.begin(), vecInputNames.end(), MatchInput) == vecInputNames.end())
+        {
+            vecInputNames.push_back(pState->aInputName);
+            vecInputValues.push_back(pStream->vecStates[s] ? pStream->vecStates[s] : m_vecInitialStates[s]);
+        }
+
+        auto MatchOutput = [pState](const char *pName) {
+            return strncmp(pName, pState->aOutputName, sizeof(pState->aOutputName)) == 0;
+        };
+        auto it = std::find_if(vecOutputNames.begin(), vecOutputNames.end(), MatchOutput);
+        vecStateOutputs[s] = it - vecOutputNames.begin();
+        if (it == vecOutputNames.end())
+        {
+            vecOutputNames.push_back(pState->aOutputName);
+        }
+    }
+
+    std::vector<OrtValue *> vecOutputValues;
+    if (MY_SUCCESS == res)
+    {
+        res = m_pOnnxHdl->my_onnxruntime_run_values(vecInputNames, vecInputValues, vecOutputNames, vecOutputValues);
+    }
+    for (int i = 0; i < output_tensor_array->nArraySize && MY_SUCCESS == res; i++)
+    {
+        res = OnnxRuntimeModelHandle::CopyValueToTensor(vecOutputValues[i], &output_tensor_array->pTensorArray[i]);
+    }
+
+    // 新状态直接留在流中
+    for (int s = 0; s < m_tParams.nStates && MY_SUCCESS == res; s++)
+    {
+        if (pStream->vecStates[s] != nullptr)
+        {
+            g_pOrt->ReleaseValue(pStream->vecStates[s]);
+        }
+        pStream->vecStates[s] = vecOutputValues[vecStateOutputs[s]];
+        vecOutputValues[vecStateOutputs[s]] = nullptr;
+    }
+
+    for (size_t i = 0; i < nWrapped; i++)
+    {
+        g_pOrt->ReleaseValue(vecInputValues[i]);
+    }
+    for (size_t i = 0; i < vecOutputValues.size(); i++)
+    {
+        if (vecOutputValues[i] != nullptr)
+        {
+            g_pOrt->ReleaseValue(vecOutputValues[i]);
+        }
+    }
+    return res;
+}
+
+/**
+ * @brief start the stream over from the initial states
+ *
+ * @param nStreamId  流id
+ * @return result_t
+ */
+result_t StreamModel::Reset(long long nStreamId)
+{
+    std::shared_ptr<StreamSession> pStream = FindStream(nStreamId);
+    if (!pStream)
+    {
+        return MY_STREAM_NOT_FOUND;
+    }
+
+    std::lock_guard<std::mutex> lock(pStream->mutex);
+    for (size_t i = 0; i < pStream->vecStates.size(); i++)
+    {
+        if (pStream->vecStates[i] != nullptr)
+        {
+            g_pOrt->ReleaseValue(pStream->vecStates[i]);
+            pStream->vecStates[i] = nullptr;
+        }
+    }
+    return MY_SUCCESS;
+}
+
+/**
+ * @brief close a stream, its states are released after a running chunk finishes
+ *
+ * @param nStreamId  流id
+ * @return result_t
+ */
+result_t StreamModel::Close(long long nStreamId)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_mapStreams.erase(nStreamId) > 0 ? MY_SUCCESS : MY_STREAM_NOT_FOUND;
+}
+
+/**
+ * @brief look up a stream and mark it used
+ *
+ * @param nStreamId  流id
+ * @return std::shared_ptr<StreamSession>  empty if not found
+ */
+std::shared_ptr<StreamSession> StreamModel::FindStream(long long nStreamId)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_mapStreams.find(nStreamId);
+    if (it == m_mapStreams.end())
+    {
+        return std::shared_ptr<StreamSession>();
+    }
+    it->second->dLastUsedMs = GetTimeMs();
+    return it->second;
+}
+
+/**
+ * @brief every half idle timeout, close the streams not used for nIdleTimeoutMs and not running
+ */
+void StreamModel::ReaperLoop()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    int nPeriodMs = std::max(m_tParams.nIdleTimeoutMs / 2, 1);
+    while (!m_bStop)
+    {
+        m_cvStop.wait_for(lock, std::chrono::milliseconds(nPeriodMs));
+
+        double dNowMs = GetTimeMs();
+        auto it = m_mapStreams.begin();
+        while (it != m_mapStreams.end())
+        {
+            StreamSession *pStream = it->second.get();
+            if (dNowMs - pStream->dLastUsedMs > m_tParams.nIdleTimeoutMs && pStream->mutex.try_lock())
+            {
+                pStream->mutex.unlock();
+                MY_DEBUG("stream %lld expired\n", it->first);
+                it = m_mapStreams.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef MY_INFERENCE_ONNX_MY_STREAM_H
+#define MY_INFERENCE_ONNX_MY_STREAM_H
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "common.h"
+#include "onnxruntime/onnxruntime_c_api.h"
+
+class OnnxRuntimeModelHandle;
+
+// 一个流: 上一次调用产生的状态 OrtValue 常驻, 同一个流的调用按顺序执行
+struct StreamSession
+{
+    StreamSession() : dLastUsedMs(0) {}
+    ~StreamSession();
+
+    std::vector<OrtValue *> vecStates; // 与 stream_params_t::aStates 一一对应, NULL 时使用初始状态
+    double dLastUsedMs;
+    std::mutex mutex;
+};
+
+// 一个流式模型上的多个流, 模型句柄由调用者加载和释放
+// 状态在调用之间以 onnxruntime 的 OrtValue 保存, 直接作为下一次的输入, 不拷贝到 tensor_t
+class StreamModel
+{
+public:
+    StreamModel(OnnxRuntimeModelHandle *pOnnxHdl, const stream_params_t *pParams);
+    ~StreamModel();
+    result_t Start();
+    result_t Open(long long *pStreamId);
+    result_t Run(long long nStreamId, tensor_array_t *input_tensor_array, tensor_array_t *output_tensor_array);
+    result_t Reset(long long nStreamId);
+    result_t Close(long long nStreamId);
+
+private:
+    std::shared_ptr<StreamSession> FindStream(long long nStreamId);
+    result_t CreateInitialState(const stream_state_t *pState, const tensor_params_t *pModelInput, OrtValue **ppValue);
+    void ReaperLoop();
+
+private:
+    OnnxRuntimeModelHandle *m_pOnnxHdl;
+    stream_params_t m_tParams;
+    std::vector<OrtValue *> m_vecInitialStates; // 全0的初始状态, 所有流共用
+    std::vector<std::vector<my_u8>> m_vecInitialData;
+
+    long long m_nNextId;
+    std::map<long long, std::shared_ptr<StreamSession>> m_mapStreams;
+    std::mutex m_mutex;
+    std::condition_variable m_cvStop;
+    std::thread m_reaper; // nIdleTimeoutMs > 0 时回收空闲的流
+    bool m_bStop;
+};
+
+#endif //MY_INFERENCE_ONNX_MY_STREAM_H
@@ -1,4 +1,10 @@
 #include <iostream>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <algorithm>
+#include "my_kernels.h"
 #include "my_utils.h"
 
 unsigned int ElementSize(tensor_types_t t)
@@ -18,6 +24,16 @@ unsigned int ElementSize(tensor_types_t t)
     case DT_UINT8:
         nDataSize = sizeof(my_u8);
         break;
+    case DT_INT16:
+        nDataSize = sizeof(my_s16);
+        break;
+    case DT_INT8:
+        nDataSize = sizeof(my_s8);
+        break;
+    case DT_HALF:
+    case DT_BFLOAT16:
+        nDataSize = sizeof(my_u16);
+        break;
     case DT_STRING:
         nDataSize = sizeof(char);
         break;
@@ -68,3 +84,330 @@ void GetTensorSize(tensor_t *cur_tensor)
 
     MY_DEBUG("cur_tensor->nValueLen:  %d\n", cur_tensor_param->nLength);
 }
+
+/**
+ * @brief fill nElements elements of the given type with dValue
+ *
+ * @param pDst  destination
+ * @param nElements  element count
+ * @param type  tensor type
+ * @param dValue  value, converted to type
+ */
+void FillTensorValue(void *pDst, size_t nElements, tensor_types_t type, double dValue)
+{
+    switch (type)
+    {
+    case DT_FLOAT:
+        std::fill((float *)pDst, (float *)pDst + nElements, (float)dValue);
+        break;
+    case DT_DOUBLE:
+        std::fill((double *)pDst, (double *)pDst + nElements, dValue);
+        break;
+    case DT_INT32:
+        std::fill((int *)pDst, (int *)pDst + nElements, (int)dValue);
+        break;
+    case DT_INT64:
+        std::fill((long long *)pDst, (long long *)pDst + nElements, (long long)dValue);
+        break;
+    case DT_INT16:
+        std::fill((my_s16 *)pDst, (my_s16 *)pDst + nElements, (my_s16)dValue);
+        break;
+    case DT_BOOL:
+        std::fill((bool *)pDst, (bool *)pDst + nElements, dValue != 0);
+        break;
+    case DT_INT8:
+        std::fill((my_s8 *)pDst, (my_s8 *)pDst + nElements, (my_s8)dValue);
+        break;
+    case DT_HALF:
+    case DT_BFLOAT16:
+    {
+        float fValue = (float)dValue;
+        my_u16 nBits;
+        if (DT_HALF == type)
+        {
+            ConvertF32ToF16Scalar(&fValue, &nBits, 1);
+        }
+        else
+        {
+            ConvertF32ToBF16Scalar(&fValue, &nBits, 1);
+        }
+        std::fill((my_u16 *)pDst, (my_u16 *)pDst + nElements, nBits);
+        break;
+    }
+    default:
+        memset(pDst, (my_u8)dValue, nElements * ElementSize(type));
+        break;
+    }
+}
+
+/**
+ * @brief monotonic time in milliseconds, for measuring durations only
+ *
+ * @return double
+ */
+double GetTimeMs()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief read a "Vm*:  123 kB" field from /proc/self/status
+ *
+ * @param pcField field name with colon, e.g. "VmRSS:"
+ * @return long  KB, -1 if not available
+ */
+static long ReadProcStatusKB(const char *pcField)
+{
+    FILE *fp = fopen("/proc/self/status", "r");
+    if (fp == NULL)
+    {
+        return -1;
+    }
+
+    char line[256];
+    long nValue = -1;
+    size_t nFieldLen = strlen(pcField);
+    while (fgets(line, sizeof(line), fp) != NULL)
+    {
+        if (strncmp(line, pcField, nFieldLen) == 0)
+        {
+            nValue = strtol(line + nFieldLen, NULL, 10);
+            break;
+        }
+    }
+
+    fclose(fp);
+    return nValue;
+}
+
+/**
+ * @brief current resident memory of this process
+ *
+ * @return long KB
+ */
+long GetCurrentRssKB()
+{
+    return ReadProcStatusKB("VmRSS:");
+}
+
+/**
+ * @brief peak resident memory since process start or the last ResetPeakRss
+ *
+ * @return long KB
+ */
+long GetPeakRssKB()
+{
+    return ReadProcStatusKB("VmHWM:");
+}
+
+/**
+ * @brief reset the peak resident memory to the current one (linux >= 4.0), so that the peak of a single
+ *        phase can be measured. Silently ignored when not supported.
+ */
+void ResetPeakRss()
+{
+    FILE *fp = fopen("/proc/self/clear_refs", "w");
+    if (fp == NULL)
+    {
+        return;
+    }
+    fputs("5", fp);
+    fclose(fp);
+}
+
+/**
+ * @brief write the whole content to a file, overwrite if it exists
+ *
+ * @param strFileName  文件名
+ * @param strContent  内容
+ * @return bool
+ */
+bool WriteFile(const std::string &strFileName, const std::string &strContent)
+{
+    FILE *fp = fopen(strFileName.c_str(), "wb");
+    if (fp == NULL)
+    {
+        return false;
+    }
+    size_t nWritten = fwrite(strContent.data(), 1, strContent.size(), fp);
+    fclose(fp);
+    return nWritten == strContent.size();
+}
+
+#define XXH_PRIME64_1 0x9E3779B185EBCA87ULL
+#define XXH_PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define XXH_PRIME64_3 0x165667B19E3779F9ULL
+#define XXH_PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define XXH_PRIME64_5 0x27D4EB2F165667C5ULL
+
+static inline uint64_t Rotl64(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t Read64(const unsigned char *p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t Read32(const unsigned char *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t XxhRound(uint64_t acc, uint64_t input)
+{
+    acc += input * XXH_PRIME64_2;
+    acc = Rotl64(acc, 31);
+    return acc * XXH_PRIME64_1;
+}
+
+static inline uint64_t XxhMergeRound(uint64_t acc, uint64_t val)
+{
+    acc ^= XxhRound(0, val);
+    return acc * XXH_PRIME64_1 + XXH_PRIME64_4;
+}
+
+/**
+ * @brief XXH64 of a buffer: four independent lanes over 32 byte stripes, so the compiler keeps them
+ *        in registers and the hash runs at memory bandwidth on large tensors
+ *
+ * @param pData  数据
+ * @param nLength  字节数
+ * @param nSeed  种子, 可用上一段的哈希值把多段数据串起来
+ * @return uint64_t
+ */
+uint64_t HashBytes(const void *pData, size_t nLength, uint64_t nSeed)
+{
+    const unsigned char *p = (const unsigned char *)pData;
+    const unsigned char *pEnd = p + nLength;
+    uint64_t h;
+
+    if (nLength >= 32)
+    {
+        uint64_t v1 = nSeed + XXH_PRIME64_1 + XXH_PRIME64_2;
+        uint64_t v2 = nSeed + XXH_PRIME64_2;
+        uint64_t v3 = nSeed;
+        uint64_t v4 = nSeed - XXH_PRIME64_1;
+        const unsigned char *pLimit = pEnd - 32;
+        do
+        {
+            v1 = XxhRound(v1, Read64(p));
+            v2 = XxhRound(v2, Read64(p + 8));
+            v3 = XxhRound(v3, Read64(p + 16));
+            v4 = XxhRound(v4, Read64(p + 24));
+            p += 32;
+        } while (p <= pLimit);
+
+        h = Rotl64(v1, 1) + Rotl64(v2, 7) + Rotl64(v3, 12) + Rotl64(v4, 18);
+        h = XxhMergeRound(h, v1);
+        h = XxhMergeRound(h, v2);
+        h = XxhMergeRound(h, v3);
+        h = XxhMergeRound(h, v4);
+    }
+    else
+    {
+        h = nSeed + XXH_PRIME64_5;
+    }
+
+    h += (uint64_t)nLength;
+    for (; p + 8 <= pEnd; p += 8)
+    {
+        h ^= XxhRound(0, Read64(p));
+        h = Rotl64(h, 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+    }
+    if (p + 4 <= pEnd)
+    {
+        h ^= (uint64_t)Read32(p) * XXH_PRIME64_1;
+        h = Rotl64(h, 23) * XXH_PRIME64_2 + XXH_PRIME64_3;
+        p += 4;
+    }
+    for (; p < pEnd; p++)
+    {
+        h ^= (*p) * XXH_PRIME64_5;
+        h = Rotl64(h, 11) * XXH_PRIME64_1;
+    }
+
+    h ^= h >> 33;
+    h *= XXH_PRIME64_2;
+    h ^= h >> 29;
+    h *= XXH_PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+/**
+ * @brief bytes the model reads from a tensor for its current shape
+ *
+ * @param pParam  tensor参数
+ * @return size_t
+ */
+size_t TensorShapeBytes(const tensor_params_t *pParam)
+{
+    size_t nElements = 1;
+    for (int j = 0; j < pParam->nDims; j++)
+    {
+        nElements *= pParam->pShape[j] > 0 ? (size_t)pParam->pShape[j] : 0;
+    }
+    return nElements * ElementSize(pParam->type);
+}
+
+/**
+ * @brief hash of the names, types, shapes and data of all tensors
+ *
+ * @param pArray  tensor数组
+ * @param nSeed  种子, 不同种子的两个哈希可合成128位的键
+ * @return uint64_t
+ */
+uint64_t HashTensorArray(const tensor_array_t *pArray, uint64_t nSeed)
+{
+    uint64_t h = HashBytes(&pArray->nArraySize, sizeof(pArray->nArraySize), nSeed);
+    for (int i = 0; i < pArray->nArraySize; i++)
+    {
+        const tensor_t *pTensor = &pArray->pTensorArray[i];
+        const tensor_params_t *pParam = pTensor->pTensorInfo;
+        h = HashBytes(pParam->aTensorName, strnlen(pParam->aTensorName, sizeof(pParam->aTensorName)), h);
+        h = HashBytes(&pParam->type, sizeof(pParam->type), h);
+        h = HashBytes(pParam->pShape, sizeof(int) * std::min(std::max(pParam->nDims, 0), 8), h);
+        h = HashBytes(pTensor->pValue, TensorShapeBytes(pParam), h);
+    }
+    return h;
+}
+
+/**
+ * @brief byte for byte comparison behind HashTensorArray, for hash collisions
+ *
+ * @param pArray1  tensor数组
+ * @param pArray2  tensor数组
+ * @return bool
+ */
+bool SameTensorArray(const tensor_array_t *pArray1, const tensor_array_t *pArray2)
+{
+    if (pArray1->nArraySize != pArray2->nArraySize)
+    {
+        return false;
+    }
+    for (int i = 0; i < pArray1->nArraySize; i++)
+    {
+        const tensor_t *pTensor1 = &pArray1->pTensorArray[i];
+        const tensor_t *pTensor2 = &pArray2->pTensorArray[i];
+        const tensor_params_t *pParam1 = pTensor1->pTensorInfo;
+        const tensor_params_t *pParam2 = pTensor2->pTensorInfo;
+        if (pParam1->type != pParam2->type || pParam1->nDims != pParam2->nDims ||
+            strncmp(pParam1->aTensorName, pParam2->aTensorName, sizeof(pParam1->aTensorName)) != 0 ||
+            memcmp(pParam1->pShape, pParam2->pShape, sizeof(int) * std::min(std::max(pParam1->nDims, 0), 8)) != 0)
+        {
+            return false;
+        }
+        if (pTensor1->pValue != pTensor2->pValue &&
+            memcmp(pTensor1->pValue, pTensor2->pValue, TensorShapeBytes(pParam1)) != 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
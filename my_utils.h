@@ -2,8 +2,33 @@
 
 #ifndef MY_INFERENCE_ONNX_MY_UTILS_H
 #define MY_INFERENCE_ONNX_MY_UTILS_H
+#include <cstddef>
+#include <cstdint>
+#include <string>
 #include "common.h"
 
+unsigned int ElementSize(tensor_types_t t);
+
 void GetTensorSize(tensor_t *cur_tensor);
 
+void FillTensorValue(void *pDst, size_t nElements, tensor_types_t type, double dValue);
+
+double GetTimeMs();
+
+long GetCurrentRssKB();
+
+long GetPeakRssKB();
+
+void ResetPeakRss();
+
+bool WriteFile(const std::string &strFileName, const std::string &strContent);
+
+uint64_t HashBytes(const void *pData, size_t nLength, uint64_t nSeed);
+
+size_t TensorShapeBytes(const tensor_params_t *pParam);
+
+uint64_t HashTensorArray(const tensor_array_t *pArray, uint64_t nSeed = 0);
+
+bool SameTensorArray(const tensor_array_t *pArray1, const tensor_array_t *pArray2);
+
 #endif //MY_INFERENCE_ONNX_MY_UTILS_H